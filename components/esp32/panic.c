@@ -41,6 +41,7 @@
 #include "esp_cache_err_int.h"
 #include "esp_app_trace.h"
 #include "esp_system_internal.h"
+#include "esp_log.h"
 #include "sdkconfig.h"
 #if CONFIG_SYSVIEW_ENABLE
 #include "SEGGER_RTT.h"
@@ -587,6 +588,11 @@ static __attribute__((noreturn)) void commonErrorHandler(XtExcFrame *frame)
     }
 #endif //!CONFIG_FREERTOS_UNICORE
 
+#if CONFIG_LOG_ASYNC
+    panicPutStr("\r\nPending log messages:\r\n");
+    esp_log_async_panic_flush();
+#endif
+
 #if CONFIG_ESP32_APPTRACE_ENABLE
     disableAllWdts();
 #if CONFIG_SYSVIEW_ENABLE
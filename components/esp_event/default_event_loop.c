@@ -54,6 +54,17 @@ esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id,
             event_data, event_data_size, ticks_to_wait);
 }
 
+esp_err_t esp_event_isr_post(esp_event_base_t event_base, int32_t event_id,
+        void* event_data, size_t event_data_size, BaseType_t* task_unblocked)
+{
+    if (s_default_loop == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return esp_event_isr_post_to(s_default_loop, event_base, event_id,
+            event_data, event_data_size, task_unblocked);
+}
+
 
 esp_err_t esp_event_loop_create_default()
 {
@@ -66,7 +77,11 @@ esp_err_t esp_event_loop_create_default()
         .task_name = "sys_evt",
         .task_stack_size = ESP_TASKD_EVENT_STACK,
         .task_priority = ESP_TASKD_EVENT_PRIO,
-        .task_core_id = 0
+        .task_core_id = 0,
+#if CONFIG_EVENT_LOOP_DEFAULT_DATA_SLOTS
+        .event_data_slots = CONFIG_EVENT_LOOP_DEFAULT_DATA_SLOTS,
+        .event_data_slot_size = CONFIG_EVENT_LOOP_DEFAULT_DATA_SLOT_SIZE,
+#endif
     };
 
     esp_err_t err;
@@ -44,6 +44,9 @@
                                         } while(0);
 #endif
 
+// Initial number of slots in the event base and event id indexes. Indexes are kept at most half full.
+#define INDEX_MIN_SIZE                8
+
 /* ------------------------- Static Variables ------------------------------- */
 
 static const char* TAG = "event";
@@ -123,6 +126,79 @@ static void esp_event_loop_run_task(void* args)
     vTaskSuspend(NULL);
 }
 
+// Functions that operate on event base and event id indexes. Instances are found through the indexes, but stay in
+// their linked lists, which are used to iterate over them. Instances are never removed from an index individually:
+// they are only deleted along with their parent base instance or loop, which frees the whole index.
+typedef uint32_t (*index_hash_t)(const void* instance);
+
+static inline uint32_t index_hash_key(uint32_t key)
+{
+    // Finalizer of MurmurHash3, so keys differing only in high bits (such as event base pointers) spread over the slots
+    key ^= key >> 16;
+    key *= 0x85ebca6b;
+    key ^= key >> 13;
+    key *= 0xc2b2ae35;
+    key ^= key >> 16;
+    return key;
+}
+
+static uint32_t event_base_instance_hash(const void* instance)
+{
+    return index_hash_key((uint32_t) (uintptr_t) ((const esp_event_base_instance_t*) instance)->base);
+}
+
+static uint32_t event_id_instance_hash(const void* instance)
+{
+    return index_hash_key((uint32_t) ((const esp_event_id_instance_t*) instance)->id);
+}
+
+static void index_insert(void** slots, uint32_t size, void* instance, uint32_t hash)
+{
+    uint32_t i = hash & (size - 1);
+    while (slots[i] != NULL) {
+        i = (i + 1) & (size - 1);
+    }
+    slots[i] = instance;
+}
+
+// Make sure the index has room for one more instance, so that index_add() can't fail
+static esp_err_t index_reserve(esp_event_index_t* index, index_hash_t hash)
+{
+    if ((index->count + 1) * 2 <= index->size) {
+        return ESP_OK;
+    }
+
+    uint32_t size = (index->size == 0) ? INDEX_MIN_SIZE : index->size * 2;
+    void** slots = calloc(size, sizeof(void*));
+    if (slots == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (uint32_t i = 0; i < index->size; i++) {
+        if (index->slots[i] != NULL) {
+            index_insert(slots, size, index->slots[i], hash(index->slots[i]));
+        }
+    }
+
+    free(index->slots);
+    index->slots = slots;
+    index->size = size;
+
+    return ESP_OK;
+}
+
+static void index_add(esp_event_index_t* index, void* instance, index_hash_t hash)
+{
+    index_insert(index->slots, index->size, instance, hash(instance));
+    index->count++;
+}
+
+static void index_free(esp_event_index_t* index)
+{
+    free(index->slots);
+    memset(index, 0, sizeof(*index));
+}
+
 // Functions that operate on handler instance
 static esp_event_handler_instance_t* handler_instance_create(esp_event_handler_t event_handler, void* event_handler_arg)
 {
@@ -227,25 +303,33 @@ static void event_base_instance_delete(esp_event_base_instance_t* event_base_ins
         event_id_instances_remove(&(event_base_instance->event_ids), it);
     }
 
+    index_free(&(event_base_instance->event_id_index));
     free(event_base_instance);
 }
 
 static void event_base_instance_add_event_id_instance(esp_event_base_instance_t* event_base_instance, esp_event_id_instance_t* event_id_instance)
 {
     SLIST_INSERT_HEAD(&(event_base_instance->event_ids), event_id_instance, event_id_entry);
+    index_add(&(event_base_instance->event_id_index), event_id_instance, event_id_instance_hash);
 }
 
 static esp_event_id_instance_t* event_base_instance_find_event_id_instance(esp_event_base_instance_t* event_base_instance, int32_t event_id)
 {
-    esp_event_id_instance_t* it;
+    esp_event_index_t* index = &(event_base_instance->event_id_index);
 
-    SLIST_FOREACH(it, &(event_base_instance->event_ids), event_id_entry) {
+    if (index->size == 0) {
+        return NULL;
+    }
+
+    uint32_t mask = index->size - 1;
+    for (uint32_t i = index_hash_key((uint32_t) event_id) & mask; index->slots[i] != NULL; i = (i + 1) & mask) {
+        esp_event_id_instance_t* it = (esp_event_id_instance_t*) index->slots[i];
         if (it->id == event_id) {
-            break;
+            return it;
         }
     }
 
-    return it;
+    return NULL;
 }
 
 // Functions that operate on event base instances list
@@ -258,6 +342,7 @@ static void event_base_instances_remove(esp_event_base_instances_t* head, esp_ev
 // Functions that operate on loop instances
 static void loop_add_event_base_instance(esp_event_loop_instance_t* loop, esp_event_base_instance_t* event_base_instance) {
     SLIST_INSERT_HEAD(&(loop->event_bases), event_base_instance, event_base_entry);
+    index_add(&(loop->event_base_index), event_base_instance, event_base_instance_hash);
 }
 
 static void loop_remove_all_event_base_instance(esp_event_loop_instance_t* loop)
@@ -268,29 +353,62 @@ static void loop_remove_all_event_base_instance(esp_event_loop_instance_t* loop)
     SLIST_FOREACH_SAFE(it, &(loop->event_bases), event_base_entry, temp) {
         event_base_instances_remove(&(loop->event_bases), it);
     }
+
+    index_free(&(loop->event_base_index));
 }
 
 static esp_event_base_instance_t* loop_find_event_base_instance(esp_event_loop_instance_t* loop, esp_event_base_t event_base)
 {
-    esp_event_base_instance_t* it;
+    esp_event_index_t* index = &(loop->event_base_index);
 
-    SLIST_FOREACH(it, &(loop->event_bases), event_base_entry) {
+    if (index->size == 0) {
+        return NULL;
+    }
+
+    uint32_t mask = index->size - 1;
+    for (uint32_t i = index_hash_key((uint32_t) (uintptr_t) event_base) & mask; index->slots[i] != NULL; i = (i + 1) & mask) {
+        esp_event_base_instance_t* it = (esp_event_base_instance_t*) index->slots[i];
         if (it->base == event_base) {
-            break;
+            return it;
         }
     }
 
-    return it;
+    return NULL;
 }
 
 // Functions that operate on post instance
-static esp_err_t post_instance_create(esp_event_base_t event_base, int32_t event_id, void* event_data, int32_t event_data_size, esp_event_post_instance_t* post)
+static void* post_data_alloc(esp_event_loop_instance_t* loop, size_t event_data_size, bool from_isr)
+{
+    void* data = NULL;
+
+    // Use a preallocated slot if there is one free, otherwise fall back to the heap, which can't be used from an ISR
+    if (loop->data_slots != NULL && event_data_size <= loop->data_slot_size) {
+        data = esp_pool_alloc(loop->data_slots);
+    }
+
+    if (data == NULL && !from_isr) {
+        data = calloc(1, event_data_size);
+    }
+
+    return data;
+}
+
+static void post_data_free(esp_event_loop_instance_t* loop, void* data)
+{
+    if (data != NULL && loop->data_slots != NULL && esp_pool_contains(loop->data_slots, data)) {
+        esp_pool_free(loop->data_slots, data);
+    } else {
+        free(data);
+    }
+}
+
+static esp_err_t post_instance_create(esp_event_loop_instance_t* loop, esp_event_base_t event_base, int32_t event_id, void* event_data, int32_t event_data_size, esp_event_post_instance_t* post)
 {
     void** event_data_copy = NULL;
 
-    // Make persistent copy of event data on heap.
+    // Make persistent copy of event data in a slot or on heap.
     if (event_data != NULL && event_data_size != 0) {
-        event_data_copy = calloc(1, event_data_size);
+        event_data_copy = post_data_alloc(loop, event_data_size, false);
 
         if (event_data_copy == NULL) {
             ESP_LOGE(TAG, "alloc for post data to event %s:%d failed", event_base, event_id);
@@ -309,9 +427,9 @@ static esp_err_t post_instance_create(esp_event_base_t event_base, int32_t event
     return ESP_OK;
 }
 
-static void post_instance_delete(esp_event_post_instance_t* post)
+static void post_instance_delete(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post)
 {
-    free(post->data);
+    post_data_free(loop, post->data);
 }
 
 static esp_event_handler_instances_t* find_handlers_list(esp_event_loop_instance_t* loop, esp_event_base_t event_base,
@@ -376,6 +494,16 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
     }
 #endif
 
+    if (event_loop_args->event_data_slots != 0 && event_loop_args->event_data_slot_size != 0) {
+        loop->data_slots = esp_pool_create("event data", event_loop_args->event_data_slot_size,
+                    event_loop_args->event_data_slots, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, ESP_POOL_FLAG_LOCK_FREE);
+        if (loop->data_slots == NULL) {
+            ESP_LOGE(TAG, "create event loop data slots failed");
+            goto on_err;
+        }
+        loop->data_slot_size = event_loop_args->event_data_slot_size;
+    }
+
     SLIST_INIT(&(loop->loop_handlers));
     SLIST_INIT(&(loop->event_bases));
 
@@ -428,17 +556,16 @@ on_err:
     }
 #endif
 
+    esp_pool_delete(loop->data_slots);
+
     free(loop);
 
     return err;
 }
 
-// On event lookup performance: The library implements the event list as a linked list, which results to O(n)
-// lookup time. The test comparing this implementation to the O(lg n) performance of rbtrees
-// (https://github.com/freebsd/freebsd/blob/master/sys/sys/tree.h)
-// indicate that the difference is not that substantial, especially considering the additional
-// pointers per node of rbtrees. Code for the rbtree implementation of the event loop library is archived
-// in feature/esp_event_loop_library_rbtrees if needed.
+// On event lookup performance: Event bases and event ids are kept in linked lists, and found through hash indexes
+// (see index_reserve), so finding the handlers for a posted event takes constant time on average, however many
+// event bases and ids have handlers registered.
 esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t ticks_to_run)
 {
     assert(event_loop);
@@ -528,6 +655,8 @@ esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t tick
             exec |= true;
         }
 
+        post_instance_delete(loop, &post);
+
         if (ticks_to_run != portMAX_DELAY) {
             end = xTaskGetTickCount();
             remaining_ticks -= end - marker;
@@ -580,11 +709,12 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
     // Drop existing posts on the queue
     esp_event_post_instance_t post;
     while(xQueueReceive(loop->queue, &post, 0) == pdTRUE) {
-        free(post.data);
+        post_instance_delete(loop, &post);
     }
 
     // Cleanup loop
     vQueueDelete(loop->queue);
+    esp_pool_delete(loop->data_slots);
     free(loop);
     // Free loop mutex before deleting
     xSemaphoreGiveRecursive(loop_mutex);
@@ -629,7 +759,10 @@ esp_err_t esp_event_handler_register_with(esp_event_loop_handle_t event_loop, es
         // If base instance does not exist, create one
         if ((base = loop_find_event_base_instance(loop, event_base)) == NULL) {
             base = event_base_instance_create(event_base);
-            if (base == NULL) {
+            if (base == NULL || index_reserve(&(loop->event_base_index), event_base_instance_hash) != ESP_OK) {
+                if (base != NULL) {
+                    event_base_instance_delete(base);
+                }
                 xSemaphoreGiveRecursive(loop->mutex);
                 return ESP_ERR_NO_MEM;
             }
@@ -643,7 +776,10 @@ esp_err_t esp_event_handler_register_with(esp_event_loop_handle_t event_loop, es
                 (event = event_base_instance_find_event_id_instance(base, event_id)) == NULL) {
                 event = event_id_instance_create(event_id);
                 // If it does not exist, create one
-                if (event == NULL) {
+                if (event == NULL || index_reserve(&(base->event_id_index), event_id_instance_hash) != ESP_OK) {
+                    if (event != NULL) {
+                        event_id_instance_delete(event);
+                    }
                     if (base_created) {
                         event_base_instance_delete(base);
                     }
@@ -709,10 +845,12 @@ esp_err_t esp_event_handler_unregister_with(esp_event_loop_handle_t event_loop,
     esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
 
     esp_event_handler_instance_t* handler = NULL;
-    esp_event_handler_instances_t* handlers = find_handlers_list(loop, event_base, event_id);
 
+    // The indexes may be reallocated by a concurrent registration, so only look up the handlers with the mutex held
     xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
 
+    esp_event_handler_instances_t* handlers = find_handlers_list(loop, event_base, event_id);
+
     if (handlers != NULL &&
         (handler = handler_instances_find(handlers, event_handler)) != NULL) {
         handler_instances_remove(handlers, handler);
@@ -740,7 +878,7 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
     esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
 
     esp_event_post_instance_t post;
-    esp_err_t err = post_instance_create(event_base, event_id, event_data, event_data_size, &post);
+    esp_err_t err = post_instance_create(loop, event_base, event_id, event_data, event_data_size, &post);
 
     if (err != ESP_OK) {
         return err;
@@ -773,7 +911,7 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
     }
 
     if (result != pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
 
 #ifdef CONFIG_EVENT_LOOP_PROFILING
         xSemaphoreTake(loop->profiling_mutex, portMAX_DELAY);
@@ -794,6 +932,41 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
     return ESP_OK;
 }
 
+esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id,
+                                void* event_data, size_t event_data_size, BaseType_t* task_unblocked)
+{
+    assert(event_loop);
+
+    // No logging here, as logging isn't possible from an ISR
+    if (event_base == ESP_EVENT_ANY_BASE || event_id == ESP_EVENT_ANY_ID) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
+
+    esp_event_post_instance_t post = {
+        .base = event_base,
+        .id = event_id,
+        .data = NULL
+    };
+
+    if (event_data != NULL && event_data_size != 0) {
+        post.data = post_data_alloc(loop, event_data_size, true);
+        if (post.data == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(post.data, event_data, event_data_size);
+    }
+
+    // The profiling statistics are protected by a mutex, so they are not updated here
+    if (xQueueSendToBackFromISR(loop->queue, &post, task_unblocked) != pdTRUE) {
+        post_data_free(loop, post.data);
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
 esp_err_t esp_event_dump(FILE* file)
 {
 #ifdef CONFIG_EVENT_LOOP_PROFILING
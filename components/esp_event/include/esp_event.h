@@ -39,11 +39,19 @@ typedef struct {
     uint32_t task_stack_size;                   /**< stack size of the event loop task, ignored if task name is NULL */
     BaseType_t task_core_id;                    /**< core to which the event loop task is pinned to, 
                                                         ignored if task name is NULL */
+    uint32_t event_data_slots;                  /**< number of preallocated slots for copies of event data, at most
+                                                        65535; if 0, copies are allocated from the heap */
+    size_t event_data_slot_size;                /**< size of each event data slot; data which doesn't fit is copied
+                                                        to the heap, ignored if event_data_slots is 0 */
 } esp_event_loop_args_t;
 
 /**
  * @brief Create a new event loop.
  *
+ * If event_data_slots is set in event_loop_args, that many slots of event_data_slot_size bytes are allocated
+ * with the loop. Event data which fits in a slot is copied into a free slot when posted, instead of being
+ * allocated from the heap, and events can be posted with esp_event_isr_post_to.
+ *
  * @param[in] event_loop_args configuration structure for the event loop to create
  * @param[out] event_loop handle to the created event loop
  *
@@ -270,6 +278,65 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop,
                             size_t event_data_size, 
                             TickType_t ticks_to_wait);
 
+/**
+ * @brief Posts an event to the system default event loop from an interrupt handler.
+ *
+ * This function behaves in the same manner as esp_event_isr_post_to, except the event is posted to the
+ * default event loop. Event data can only be posted if CONFIG_EVENT_LOOP_DEFAULT_DATA_SLOTS is not 0.
+ *
+ * @param[in] event_base the event base that identifies the event
+ * @param[in] event_id the the event id that identifies the event
+ * @param[in] event_data the data, specific to the event occurence, that gets passed to the handler
+ * @param[in] event_data_size the size of the event data
+ * @param[out] task_unblocked set to pdTRUE if posting the event unblocked a task of higher priority than the
+ *                            interrupted one, in which case a context switch should be requested before the
+ *                            interrupt handler returns. Can be NULL.
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_FAIL: Event queue for the default event loop is full
+ *  - ESP_ERR_NO_MEM: No free event data slot for the data
+ *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event id
+ *  - ESP_ERR_INVALID_STATE: Default event loop not created
+ */
+esp_err_t esp_event_isr_post(esp_event_base_t event_base,
+                            int32_t event_id,
+                            void* event_data,
+                            size_t event_data_size,
+                            BaseType_t* task_unblocked);
+
+/**
+ * @brief Posts an event to the specified event loop from an interrupt handler.
+ *
+ * The event data is copied into one of the loop's preallocated event data slots (see esp_event_loop_args_t),
+ * as the heap can't be used from an interrupt handler. The slot is freed once the event has been handled.
+ * This function doesn't block: if the queue of the event loop is full, the event is dropped.
+ *
+ * @param[in] event_loop the event loop to post to
+ * @param[in] event_base the event base that identifies the event
+ * @param[in] event_id the the event id that identifies the event
+ * @param[in] event_data the data, specific to the event occurence, that gets passed to the handler
+ * @param[in] event_data_size the size of the event data, at most the event_data_slot_size of the loop
+ * @param[out] task_unblocked set to pdTRUE if posting the event unblocked a task of higher priority than the
+ *                            interrupted one, in which case a context switch should be requested before the
+ *                            interrupt handler returns. Can be NULL.
+ *
+ * @note This function is not in IRAM, so it can't be called from interrupts which run while the flash cache
+ *       is disabled. Events posted with this function are not counted in the profiling statistics.
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_FAIL: Event queue for the loop is full
+ *  - ESP_ERR_NO_MEM: No free event data slot for the data, or the loop has no slots large enough
+ *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event id
+ */
+esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop,
+                            esp_event_base_t event_base,
+                            int32_t event_id,
+                            void* event_data,
+                            size_t event_data_size,
+                            BaseType_t* task_unblocked);
+
 /**
  * @brief Dumps statistics of all event loops.
  *
@@ -16,11 +16,20 @@
 #define ESP_EVENT_INTERNAL_H_
 
 #include "esp_event.h"
+#include "esp_pool.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/// Hash index of event base or event id instances, used to find them without walking their list
+typedef struct esp_event_index {
+    void** slots;                                                   /**< open addressing table of instances, empty slots 
+                                                                            are NULL */
+    uint32_t size;                                                  /**< number of slots, a power of two (0 if none) */
+    uint32_t count;                                                 /**< number of instances in the index */
+} esp_event_index_t;
+
 /// Event handler
 typedef struct esp_event_handler_instance {
     esp_event_handler_t handler;                                    /**< event handler function*/
@@ -54,6 +63,7 @@ typedef struct esp_event_base_instance {
     esp_event_handler_instances_t base_handlers;                    /**< event base level handlers, handlers for 
                                                                             all events with this base */
     esp_event_id_instances_t event_ids;                             /**< list of event ids with this base */
+    esp_event_index_t event_id_index;                               /**< index of the event ids with this base */
     SLIST_ENTRY(esp_event_base_instance) event_base_entry;          /**< pointer to the next event node on the linked list */
 #ifdef CONFIG_EVENT_LOOP_PROFILING
     uint32_t base_handlers_invoked;                                 /**< total number of base-level handlers invoked */
@@ -74,6 +84,9 @@ typedef struct esp_event_loop_instance {
     esp_event_handler_instances_t loop_handlers;                    /**< loop level handlers, handlers for all events 
                                                                             registered in the loop */
     esp_event_base_instances_t event_bases;                         /**< events linked list head pointer */
+    esp_event_index_t event_base_index;                             /**< index of the event bases in the loop */
+    esp_pool_handle_t data_slots;                                   /**< preallocated slots for event data, or NULL */
+    size_t data_slot_size;                                          /**< size of each event data slot */
 #ifdef CONFIG_EVENT_LOOP_PROFILING
     uint32_t events_recieved;                                       /**< number of events successfully posted to the loop */
     uint32_t events_dropped;                                        /**< number of events dropped due to queue being full */
@@ -14,6 +14,7 @@
 #include "esp_event_internal.h"
 
 #include "esp_heap_caps.h"
+#include "driver/timer.h"
 
 #include "sdkconfig.h"
 #include "unity.h"
@@ -1027,6 +1028,177 @@ TEST_CASE("can create and delete loop from handler", "[event]")
     TEST_TEARDOWN();
 }
 
+static void test_event_latency_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    *((int64_t*) event_handler_arg) = esp_timer_get_time();
+}
+
+TEST_CASE("event dispatch latency does not grow with the number of registrations", "[event]")
+{
+    TEST_SETUP();
+
+    #define LATENCY_TEST_MAX_BASES    64
+    #define LATENCY_TEST_IDS          16
+    #define LATENCY_TEST_POSTS        100
+
+    static char bases[LATENCY_TEST_MAX_BASES][2];
+
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = NULL;
+
+    esp_event_loop_handle_t loop;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_create(&loop_args, &loop));
+
+    int64_t handled = 0;
+    int registered = 0;
+    int64_t first_latency = 0;
+    int64_t latency = 0;
+
+    for (int num_bases = 1; num_bases <= LATENCY_TEST_MAX_BASES; num_bases *= 4) {
+        for (; registered < num_bases; registered++) {
+            for (int id = 0; id < LATENCY_TEST_IDS; id++) {
+                TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_register_with(loop, bases[registered], id,
+                                  test_event_latency_handler, &handled));
+            }
+        }
+
+        // Post to the base and id registered first, which are at the end of the lists
+        int64_t total = 0;
+        for (int i = 0; i < LATENCY_TEST_POSTS; i++) {
+            int64_t start = esp_timer_get_time();
+            TEST_ASSERT_EQUAL(ESP_OK, esp_event_post_to(loop, bases[0], 0, NULL, 0, portMAX_DELAY));
+            TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_run(loop, 0));
+            total += handled - start;
+        }
+
+        latency = total / LATENCY_TEST_POSTS;
+        if (num_bases == 1) {
+            first_latency = latency;
+        }
+        ESP_LOGI(TAG, "%d handlers registered: %lld us from post to handler", num_bases * LATENCY_TEST_IDS, latency);
+    }
+
+    // Generous margin, as the measurement includes queueing and scheduling
+    TEST_ASSERT_LESS_THAN((int) (first_latency * 2 + 10), (int) latency);
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_delete(loop));
+
+    TEST_TEARDOWN();
+}
+
+#define ISR_TEST_SLOTS      2
+#define ISR_TEST_POSTS      (ISR_TEST_SLOTS + 1)
+
+typedef struct {
+    esp_event_loop_handle_t loop;
+    volatile int posted;
+    esp_err_t results[ISR_TEST_POSTS];
+} isr_post_data_t;
+
+static void test_event_post_isr(void* arg)
+{
+    isr_post_data_t* data = (isr_post_data_t*) arg;
+
+    TIMERG0.int_clr_timers.t0 = 1;
+    TIMERG0.hw_timer[0].config.alarm_en = 1;
+
+    if (data->posted < ISR_TEST_POSTS) {
+        int value = data->posted + 1;
+        BaseType_t task_unblocked = pdFALSE;
+        data->results[data->posted] = esp_event_isr_post_to(data->loop, s_test_base1, TEST_EVENT_BASE1_EV1,
+                                                            &value, sizeof(value), &task_unblocked);
+        data->posted++;
+        if (task_unblocked) {
+            portYIELD_FROM_ISR();
+        }
+    }
+}
+
+TEST_CASE("can post events with data from an ISR using preallocated slots", "[event]")
+{
+    TEST_SETUP();
+
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = NULL;
+    loop_args.event_data_slots = ISR_TEST_SLOTS;
+    loop_args.event_data_slot_size = sizeof(int);
+
+    esp_event_loop_handle_t loop;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_create(&loop_args, &loop));
+
+    int count = 0;
+
+    simple_arg_t arg = {
+        .data = &count,
+        .mutex = xSemaphoreCreateMutex()
+    };
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_event_simple_handler, &arg));
+
+    // Data posted from a task also uses the slots, and the slot is freed once the event has been handled
+    esp_pool_info_t info;
+    int value = 10;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &value, sizeof(value), portMAX_DELAY));
+    esp_pool_get_info(((esp_event_loop_instance_t*) loop)->data_slots, &info);
+    TEST_ASSERT_EQUAL(ISR_TEST_SLOTS - 1, info.free_objects);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_run(loop, 0));
+    TEST_ASSERT_EQUAL(10, count);
+    esp_pool_get_info(((esp_event_loop_instance_t*) loop)->data_slots, &info);
+    TEST_ASSERT_EQUAL(ISR_TEST_SLOTS, info.free_objects);
+
+    // Post from a timer interrupt, one event more than there are slots
+    isr_post_data_t data = {
+        .loop = loop,
+        .posted = 0
+    };
+
+    timer_config_t config = {
+        .alarm_en = 1,
+        .auto_reload = 1,
+        .counter_dir = TIMER_COUNT_UP,
+        .divider = 80,
+        .intr_type = TIMER_INTR_LEVEL,
+        .counter_en = TIMER_PAUSE
+    };
+    intr_handle_t isr_handle;
+    timer_init(TIMER_GROUP_0, TIMER_0, &config);
+    timer_set_counter_value(TIMER_GROUP_0, TIMER_0, 0);
+    timer_set_alarm_value(TIMER_GROUP_0, TIMER_0, 1000);
+    timer_enable_intr(TIMER_GROUP_0, TIMER_0);
+    TEST_ASSERT_EQUAL(ESP_OK, timer_isr_register(TIMER_GROUP_0, TIMER_0, test_event_post_isr, &data, 0, &isr_handle));
+    timer_start(TIMER_GROUP_0, TIMER_0);
+
+    for (int i = 0; i < 100 && data.posted < ISR_TEST_POSTS; i++) {
+        vTaskDelay(1);
+    }
+
+    timer_pause(TIMER_GROUP_0, TIMER_0);
+    timer_disable_intr(TIMER_GROUP_0, TIMER_0);
+    esp_intr_free(isr_handle);
+
+    TEST_ASSERT_EQUAL(ISR_TEST_POSTS, data.posted);
+    TEST_ASSERT_EQUAL(ESP_OK, data.results[0]);
+    TEST_ASSERT_EQUAL(ESP_OK, data.results[1]);
+    // All slots are in use, and the heap can't be used from an ISR
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, data.results[2]);
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+    TEST_ASSERT_EQUAL(10 + 1 + 2, count);
+
+    // Data too large for a slot can't be posted from an ISR, but can be from a task
+    int64_t large = 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, esp_event_isr_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &large, sizeof(large), NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &large, sizeof(large), portMAX_DELAY));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_run(loop, 0));
+    TEST_ASSERT_EQUAL(10 + 1 + 2 + 1, count);
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_delete(loop));
+
+    vSemaphoreDelete(arg.mutex);
+
+    TEST_TEARDOWN();
+}
+
 #ifdef CONFIG_EVENT_LOOP_PROFILING
 TEST_CASE("can dump event loop profile", "[event]")
 {
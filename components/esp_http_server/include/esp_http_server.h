@@ -17,11 +17,13 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <http_parser.h>
 #include <sdkconfig.h>
 #include <esp_err.h>
+#include <esp_partition.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,7 +51,13 @@ initializer that should be kept in sync
         .global_transport_ctx_free_fn = NULL,           \
         .open_fn = NULL,                                \
         .close_fn = NULL,                               \
-        .uri_match_fn = NULL                            \
+        .uri_match_fn = NULL,                           \
+        .worker_count       = 0,                        \
+        .worker_stack_size  = 4096,                     \
+        .worker_priority    = tskIDLE_PRIORITY+5,       \
+        .worker_core_id     = tskNO_AFFINITY,           \
+        .keep_alive_idle_timeout  = 0,                  \
+        .keep_alive_max_requests  = 0                   \
 }
 
 #define ESP_ERR_HTTPD_BASE              (0x8000)                    /*!< Starting number of HTTPD error codes */
@@ -231,8 +239,51 @@ typedef struct httpd_config {
      *
      * Users can implement their own matching functions (See description
      * of the `httpd_uri_match_func_t` function prototype)
+     *
+     * With the first two options, the registered URIs are indexed so that
+     * finding the handler of a request doesn't depend on the number of
+     * handlers. A custom function is called for each registered handler
+     * in turn, until a match is found.
      */
     httpd_uri_match_func_t uri_match_fn;
+
+    /**
+     * Number of worker tasks processing requests.
+     *
+     * With no workers, requests are processed by the server task itself, one
+     * at a time, so a slow URI handler delays all other sessions.
+     *
+     * With workers, the server task only accepts connections and waits for
+     * requests. A session with a request to process is handed over to an
+     * idle worker, which receives and parses the request, runs the URI handler
+     * and hands the session back. Up to worker_count requests from different
+     * sessions are then processed in parallel.
+     *
+     * @note  URI handlers may then run in several tasks at once, so any data
+     *        shared between handlers must be protected.
+     */
+    uint16_t    worker_count;
+    size_t      worker_stack_size;  /*!< The maximum stack size allowed for each worker task */
+    unsigned    worker_priority;    /*!< Priority of the worker tasks */
+    BaseType_t  worker_core_id;     /*!< Core to pin the worker tasks to, or tskNO_AFFINITY */
+
+    /**
+     * Time (in seconds) after which a persistent connection without
+     * any request in progress is closed by the server, 0 to keep idle
+     * connections open until the client closes them or they are purged
+     * by lru_purge_enable.
+     *
+     * The time a session was last used can be refreshed from outside a
+     * request with httpd_sess_update_timestamp().
+     */
+    uint16_t    keep_alive_idle_timeout;
+
+    /**
+     * Maximum number of requests served on a connection, 0 for no limit.
+     * The response to the last request carries a "Connection: close"
+     * header and the connection is closed once it has been sent.
+     */
+    uint16_t    keep_alive_max_requests;
 } httpd_config_t;
 
 /**
@@ -502,6 +553,29 @@ esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char* uri);
  */
 typedef int (*httpd_send_func_t)(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags);
 
+/**
+ * @brief  Prototype for HTTPDs low-level vectored send function
+ *
+ * Sends the buffers described by an array of iovec structures in order, as
+ * a single operation, so that response headers and content can leave in the
+ * same TCP segment. The semantics are the same as writev() of the BSD socket API.
+ *
+ * @note   User specified vectored send function must handle errors internally,
+ *         in the same way as httpd_send_func_t
+ *
+ * @param[in] hd        server instance
+ * @param[in] sockfd    session socket file descriptor
+ * @param[in] iov       array of buffers to send
+ * @param[in] iovcnt    number of buffers in the array
+ * @return
+ *  - Bytes : The number of bytes sent successfully, which may be less than the
+ *            total length of the buffers
+ *  - HTTPD_SOCK_ERR_INVALID  : Invalid arguments
+ *  - HTTPD_SOCK_ERR_TIMEOUT  : Timeout/interrupted while calling socket writev()
+ *  - HTTPD_SOCK_ERR_FAIL     : Unrecoverable error while calling socket writev()
+ */
+typedef int (*httpd_sendv_func_t)(httpd_handle_t hd, int sockfd, const struct iovec *iov, int iovcnt);
+
 /**
  * @brief  Prototype for HTTPDs low-level recv function
  *
@@ -594,6 +668,34 @@ esp_err_t httpd_sess_set_recv_override(httpd_handle_t hd, int sockfd, httpd_recv
  */
 esp_err_t httpd_sess_set_send_override(httpd_handle_t hd, int sockfd, httpd_send_func_t send_func);
 
+/**
+ * @brief   Override web server's vectored send function (by session FD)
+ *
+ * Responses are sent with the vectored send function if the session has
+ * one, so that the headers and the content are sent together. By default,
+ * sessions use writev() on the socket.
+ *
+ * @note    Overriding the send function with httpd_sess_set_send_override()
+ *          removes the default vectored send function, as it would bypass the
+ *          override. Responses are then sent using the send function only. Set
+ *          a vectored send function after the send function, if the transport
+ *          can send several buffers at once.
+ *
+ * @note    This API is supposed to be called either from the context of
+ *          - an http session APIs where sockfd is a valid parameter
+ *          - a URI handler where sockfd is obtained using httpd_req_to_sockfd()
+ *
+ * @param[in] hd         HTTPD instance handle
+ * @param[in] sockfd     Session socket FD
+ * @param[in] sendv_func The vectored send function to be set for this session,
+ *                       or NULL to send using the send function only
+ *
+ * @return
+ *  - ESP_OK : On successfully registering override
+ *  - ESP_ERR_INVALID_ARG : Null arguments
+ */
+esp_err_t httpd_sess_set_sendv_override(httpd_handle_t hd, int sockfd, httpd_sendv_func_t sendv_func);
+
 /**
  * @brief   Override web server's pending function (by session FD)
  *
@@ -823,6 +925,9 @@ bool httpd_uri_match_wildcard(const char *template, const char *uri, size_t len)
  *      httpd_resp_set_hdr()    - for appending any additional field
  *                                value entries in the response header
  *
+ * The status line and all headers are assembled in an internal buffer
+ * and sent together with the content in one vectored send.
+ *
  * @note
  *  - This API is supposed to be called only from the context of
  *    a URI handler where httpd_req_t* request pointer is valid.
@@ -884,6 +989,89 @@ esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len);
  */
 esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len);
 
+/**
+ * @brief   API to send a file as the HTTP response
+ *
+ * This API sends the contents of a file in a filesystem mounted in the VFS
+ * (SPIFFS, FAT...) as the response to the request, reading it into a small
+ * buffer. Files in flash partitions without a filesystem can be sent without
+ * any copy using httpd_resp_send_partition() instead.
+ *
+ * - If a file named path + ".gz" exists, and the client accepts gzip content
+ *   encoding, the compressed file is sent instead, with Content-Encoding
+ *   set to gzip. Set the content type of the uncompressed file with
+ *   httpd_resp_set_type().
+ * - An ETag is generated from the modification time and size of the file.
+ *   If the client already has the file (If-None-Match), 304 Not Modified
+ *   is sent without the contents.
+ * - Range requests for a single range of bytes are answered with
+ *   206 Partial Content, or 416 Range Not Satisfiable. If-Range is honoured.
+ * - Only the headers are sent in response to HEAD requests.
+ *
+ * Conditional and range requests are only handled if the response status
+ * is left to the default 200 OK.
+ *
+ * @note
+ * - This API is supposed to be called only from the context of
+ *   a URI handler where httpd_req_t* request pointer is valid.
+ * - Once this API is called, the request has been responded to.
+ * - Once this API is called, all request headers are purged.
+ * - On filesystems which don't keep modification times, the ETag only
+ *   depends on the size of the file.
+ *
+ * @param[in] r     The request being responded to
+ * @param[in] path  Path of the file in the VFS
+ *
+ * @return
+ *  - ESP_OK : On successfully sending the file
+ *  - ESP_ERR_INVALID_ARG : Null request pointer or path
+ *  - ESP_ERR_NOT_FOUND : File can't be opened, nothing has been sent
+ *  - ESP_ERR_NO_MEM : Failed to allocate a buffer
+ *  - ESP_ERR_HTTPD_RESP_HDR    : Essential headers are too large for internal buffer
+ *  - ESP_ERR_HTTPD_RESP_SEND   : Error in raw send
+ *  - ESP_ERR_HTTPD_INVALID_REQ : Invalid request
+ *  - ESP_FAIL : Failed to read the file
+ */
+esp_err_t httpd_resp_send_file(httpd_req_t *r, const char *path);
+
+/**
+ * @brief   API to send content stored in a flash partition as the HTTP response
+ *
+ * The content is sent straight from flash mapped in the address space with
+ * esp_partition_mmap(), without copying it into a buffer first. This suits
+ * static assets written to a raw partition, e.g. with parttool.py.
+ *
+ * Conditional requests, range requests and HEAD requests are handled
+ * as for httpd_resp_send_file(). As the server can't know when the
+ * content changes, its ETag is given by the caller, e.g. built from the
+ * version of the assets. If the content is compressed, set the
+ * Content-Encoding header with httpd_resp_set_hdr().
+ *
+ * @note
+ * - This API is supposed to be called only from the context of
+ *   a URI handler where httpd_req_t* request pointer is valid.
+ * - Once this API is called, the request has been responded to.
+ * - Once this API is called, all request headers are purged.
+ *
+ * @param[in] r          The request being responded to
+ * @param[in] partition  Partition holding the content
+ * @param[in] offset     Offset of the content in the partition
+ * @param[in] size       Size of the content
+ * @param[in] etag       Entity tag of the content, including the double
+ *                       quotes (e.g. "\"v1.2\""), or NULL if none
+ *
+ * @return
+ *  - ESP_OK : On successfully sending the content
+ *  - ESP_ERR_INVALID_ARG : Null request or partition pointer, or content
+ *                          not within the partition
+ *  - ESP_ERR_HTTPD_RESP_HDR    : Essential headers are too large for internal buffer
+ *  - ESP_ERR_HTTPD_RESP_SEND   : Error in raw send
+ *  - ESP_ERR_HTTPD_INVALID_REQ : Invalid request
+ *  - ESP_FAIL : Failed to map the partition
+ */
+esp_err_t httpd_resp_send_partition(httpd_req_t *r, const esp_partition_t *partition,
+                                    size_t offset, size_t size, const char *etag);
+
 /**
  * @brief   API to send a complete string as HTTP response.
  *
@@ -1228,10 +1416,11 @@ esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd);
  * have received traffic for some time. This is useful when all open
  * sockets/session are frequently exchanging traffic but the user specifically
  * wants one of the sessions to be kept open, irrespective of when it last
- * exchanged a packet.
+ * exchanged a packet. It also delays the closing of the session when
+ * keep_alive_idle_timeout is set.
  *
  * @note    Calling this API is only necessary if the LRU Purge Enable option
- *          is enabled.
+ *          is enabled or keep_alive_idle_timeout is set.
  *
  * @param[in] handle    Handle to server returned by httpd_start
  * @param[in] sockfd    The socket descriptor of the session for which timestamp
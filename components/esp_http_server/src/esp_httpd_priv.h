@@ -123,11 +123,15 @@ struct sock_db {
     httpd_free_ctx_fn_t free_ctx;      /*!< Function for freeing the context */
     httpd_free_ctx_fn_t free_transport_ctx; /*!< Function for freeing the 'transport' context */
     httpd_send_func_t send_fn;              /*!< Send function for this socket */
+    httpd_sendv_func_t sendv_fn;            /*!< Vectored send function for this socket, NULL to use send_fn only */
     httpd_recv_func_t recv_fn;              /*!< Receive function for this socket */
     httpd_pending_func_t pending_fn;        /*!< Pending function for this socket */
     int64_t timestamp;                      /*!< Timestamp indicating when the socket was last used */
     char pending_data[PARSER_BLOCK_SIZE];   /*!< Buffer for pending data to be received */
     size_t pending_len;                     /*!< Length of pending data to be received */
+    volatile bool busy;                     /*!< Session has been handed over to a worker */
+    volatile bool close_pending;            /*!< Session is to be closed once it is no longer busy */
+    unsigned req_count;                     /*!< Number of requests received on this session */
 };
 
 /**
@@ -143,6 +147,7 @@ struct httpd_req_aux {
     bool            first_chunk_sent;               /*!< Used to indicate if first chunk sent */
     unsigned        req_hdrs_count;                 /*!< Count of total headers in request packet */
     unsigned        resp_hdrs_count;                /*!< Count of additional headers in response packet */
+    bool            keep_alive;                     /*!< Connection is kept open after the response */
     struct resp_hdr {
         const char *field;
         const char *value;
@@ -150,6 +155,16 @@ struct httpd_req_aux {
     struct http_parser_url url_parse_res;           /*!< URL parsing result, used for retrieving URL elements */
 };
 
+/**
+ * @brief   Worker task data, including the request the worker processes
+ */
+struct httpd_worker {
+    struct thread_data td;                  /*!< Information for the worker thread */
+    struct httpd_data *hd;                  /*!< Server instance the worker belongs to */
+    struct httpd_req req;                   /*!< The request being processed by the worker */
+    struct httpd_req_aux req_aux;           /*!< Additional data about the request kept unexposed */
+};
+
 /**
  * @brief   Server data for each instance. This is exposed publicaly as
  *          httpd_handle_t but internal structure/members are kept private.
@@ -162,8 +177,11 @@ struct httpd_data {
     struct thread_data hd_td;               /*!< Information for the HTTPd thread */
     struct sock_db *hd_sd;                  /*!< The socket database */
     httpd_uri_t **hd_calls;                 /*!< Registered URI handlers */
+    struct httpd_uri_router *hd_router;     /*!< Index of the registered URI handlers */
     struct httpd_req hd_req;                /*!< The current HTTPD request */
     struct httpd_req_aux hd_req_aux;        /*!< Additional data about the HTTPD request kept unexposed */
+    struct httpd_worker *hd_workers;        /*!< Worker tasks, if any */
+    oqueue_t hd_work_queue;                 /*!< Sessions handed over to the workers */
 };
 
 /******************* Group : Session Management ********************/
@@ -213,13 +231,27 @@ esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd);
  * @brief   Processes incoming HTTP requests
  *
  * @param[in] hd    Server instance data
+ * @param[in] r     Request structure of the calling task, to process the request in
  * @param[in] clifd Descriptor of the client from which data is to be received
  *
  * @return
  *  - ESP_OK    : on successfully receiving, parsing and responding to a request
  *  - ESP_FAIL  : in case of failure in any of the stages of processing
  */
-esp_err_t httpd_sess_process(struct httpd_data *hd, int clifd);
+esp_err_t httpd_sess_process(struct httpd_data *hd, httpd_req_t *r, int clifd);
+
+/**
+ * @brief   Get the request structure of the calling task
+ *
+ * This is the request of a worker when called from a worker task, otherwise
+ * the request processed by the server task. Its session is set while a
+ * request is being processed, i.e. when called from a URI handler.
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return Request structure of the calling task
+ */
+httpd_req_t *httpd_current_req(struct httpd_data *hd);
 
 /**
  * @brief   Remove client descriptor from the session / socket database
@@ -284,6 +316,16 @@ int httpd_sess_iterate(struct httpd_data *hd, int fd);
  */
 bool httpd_is_sess_available(struct httpd_data *hd);
 
+/**
+ * @brief   Checks if the sockets database is full and all its sessions
+ *          are handed over to workers
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return True if no session can be closed before a worker hands it back
+ */
+bool httpd_sess_all_busy(struct httpd_data *hd);
+
 /**
  * @brief   Checks if session has any pending data/packets
  *          for processing
@@ -305,6 +347,32 @@ bool httpd_is_sess_available(struct httpd_data *hd);
  */
 bool httpd_sess_pending(struct httpd_data *hd, int fd);
 
+/**
+ * @brief   Time until the server task has to look at the sessions again,
+ *          even if select() reports no activity
+ *
+ * This is 0 if a session has pending data to be processed, else the time
+ * left before the first idle session expires as per keep_alive_idle_timeout.
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return Time to wait (in microseconds), or -1 to wait indefinitely
+ */
+int64_t httpd_sess_idle_wait(struct httpd_data *hd);
+
+/**
+ * @brief   Checks if a session has been idle for longer than
+ *          keep_alive_idle_timeout and is to be closed
+ *
+ * Sessions handed over to a worker never expire.
+ *
+ * @param[in] hd  Server instance data
+ * @param[in] fd  Client descriptor
+ *
+ * @return True if the session has expired
+ */
+bool httpd_sess_expired(struct httpd_data *hd, int fd);
+
 /**
  * @brief   Removes the least recently used client from the session
  *
@@ -335,12 +403,13 @@ esp_err_t httpd_sess_close_lru(struct httpd_data *hd);
  *          and invokes the appropriate one if found
  *
  * @param[in] hd  Server instance data for which handler needs to be invoked
+ * @param[in] r   The parsed request
  *
  * @return
  *  - ESP_OK    : if handler found and executed successfully
  *  - ESP_FAIL  : otherwise
  */
-esp_err_t httpd_uri(struct httpd_data *hd);
+esp_err_t httpd_uri(struct httpd_data *hd, httpd_req_t *r);
 
 /**
  * @brief   Deregister all URI handlers
@@ -349,6 +418,24 @@ esp_err_t httpd_uri(struct httpd_data *hd);
  */
 void httpd_unregister_all_uri_handlers(struct httpd_data *hd);
 
+/**
+ * @brief   Allocate the index used to find the URI handler of a request
+ *
+ * @param[in] hd   Server instance data
+ *
+ * @return
+ *  - ESP_OK : Router allocated
+ *  - ESP_ERR_NO_MEM : Failed to allocate memory
+ */
+esp_err_t httpd_uri_router_init(struct httpd_data *hd);
+
+/**
+ * @brief   Free the index used to find the URI handler of a request
+ *
+ * @param[in] hd   Server instance data
+ */
+void httpd_uri_router_deinit(struct httpd_data *hd);
+
 /**
  * @brief   Validates the request to prevent users from calling APIs, that are to
  *          be called only inside a URI handler, outside the handler context
@@ -389,25 +476,26 @@ bool httpd_validate_req_ptr(httpd_req_t *r);
  * http_recv() after this reads the body of the request.
  *
  * @param[in] hd  Server instance data
+ * @param[in] r   Request structure to fill, with its auxiliary data attached
  * @param[in] sd  Pointer to socket which is needed for receiving TCP packets.
  *
  * @return
  *  - ESP_OK    : if request packet is valid
  *  - ESP_FAIL  : otherwise
  */
-esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd);
+esp_err_t httpd_req_new(struct httpd_data *hd, httpd_req_t *r, struct sock_db *sd);
 
 /**
  * @brief   For an HTTP request, resets the resources allocated for it and
  *          purges any data left to be received
  *
- * @param[in] hd  Server instance data
+ * @param[in] r   The request to delete
  *
  * @return
  *  - ESP_OK    : if request packet deleted and resources cleaned.
  *  - ESP_FAIL  : otherwise.
  */
-esp_err_t httpd_req_delete(struct httpd_data *hd);
+esp_err_t httpd_req_delete(httpd_req_t *r);
 
 /** End of Group : Parsing
  * @}
@@ -444,6 +532,50 @@ esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_resp_t error);
  */
 int httpd_send(httpd_req_t *req, const char *buf, size_t buf_len);
 
+/**
+ * @brief   For sending out all the buffers of an iovec array, retrying partial sends.
+ *
+ * @note    The array is modified to keep track of the data sent.
+ *
+ * @param[in] r       The request being responded to
+ * @param[in] iov     Buffers to send, empty buffers are skipped
+ * @param[in] iovcnt  Number of buffers
+ *
+ * @return
+ *  - ESP_OK    : if all the data was sent
+ *  - ESP_FAIL  : if failed
+ */
+esp_err_t httpd_sendv_all(httpd_req_t *r, struct iovec *iov, int iovcnt);
+
+/**
+ * @brief   For appending a string to the response headers being assembled
+ *          in the scratch buffer. If the buffer is full, the headers assembled
+ *          so far are sent out first.
+ *
+ * @param[in]     r        The request being responded to
+ * @param[in,out] hdr_len  Length of the headers in the scratch buffer
+ * @param[in]     str      String to append
+ * @param[in]     len      Length of the string
+ *
+ * @return
+ *  - ESP_OK                  : if successful
+ *  - ESP_ERR_HTTPD_RESP_SEND : if failed to send the headers
+ */
+esp_err_t httpd_resp_hdr_append(httpd_req_t *r, size_t *hdr_len, const char *str, size_t len);
+
+/**
+ * @brief   For appending the headers set with httpd_resp_set_hdr() and the end
+ *          of the header section to the essential headers in the scratch buffer
+ *
+ * @param[in]     r        The request being responded to
+ * @param[in,out] hdr_len  Length of the headers in the scratch buffer
+ *
+ * @return
+ *  - ESP_OK                  : if successful
+ *  - ESP_ERR_HTTPD_RESP_SEND : if failed to send the headers
+ */
+esp_err_t httpd_resp_hdrs_complete(httpd_req_t *r, size_t *hdr_len);
+
 /**
  * @brief   For receiving HTTP request data
  *
@@ -503,6 +635,22 @@ size_t httpd_unrecv(struct httpd_req *r, const char *buf, size_t buf_len);
  */
 int httpd_default_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags);
 
+/**
+ * @brief   This is the low level default vectored send function of the HTTPD.
+ *          This should NEVER be called directly. The semantics of this is
+ *          exactly similar to writev() of the BSD socket API.
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] sockfd  Socket descriptor for sending data
+ * @param[in] iov     Array of buffers to send
+ * @param[in] iovcnt  Number of buffers in the array
+ *
+ * @return
+ *  - Length of data : if successful
+ *  - -1             : if failed (appropriate errno is set)
+ */
+int httpd_default_sendv(httpd_handle_t hd, int sockfd, const struct iovec *iov, int iovcnt);
+
 /**
  * @brief   This is the low level default recv function of the HTTPD. This should
  *          NEVER be called directly. The semantics of this is exactly similar to
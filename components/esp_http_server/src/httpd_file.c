@@ -0,0 +1,440 @@
+// Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <esp_log.h>
+#include <esp_err.h>
+#include <esp_partition.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+static const char *TAG = "httpd_file";
+
+/* Size of the buffer files are read into. Content in flash
+ * partitions is sent straight from the mapped flash instead */
+#define HTTPD_FILE_BUF_SIZE     2048
+
+/* Maximum length of the request headers used for conditional and range requests.
+ * Longer headers are ignored, and the full content is sent. */
+#define HTTPD_FILE_HDR_LEN      128
+
+/* Maximum length of the entity tag generated for files */
+#define HTTPD_FILE_ETAG_LEN     24
+
+/* Content being sent, and the part of it requested */
+struct httpd_file {
+    const esp_partition_t *partition;   /*!< Partition holding the content, or NULL */
+    size_t  offset;                     /*!< Offset of the content in the partition */
+    int     fd;                         /*!< File holding the content, if not in a partition */
+    size_t  size;                       /*!< Size of the content */
+    const char *etag;                   /*!< Entity tag of the content, or NULL */
+    bool    gzip;                       /*!< Content is compressed with gzip */
+    bool    vary;                       /*!< Content depends on the Accept-Encoding header */
+    size_t  start;                      /*!< Offset of the first byte to send */
+    size_t  len;                        /*!< Number of bytes to send */
+};
+
+/* Result of checking the conditional and range headers of a request */
+typedef enum {
+    HTTPD_FILE_SEND_ALL,
+    HTTPD_FILE_SEND_RANGE,
+    HTTPD_FILE_NOT_MODIFIED,
+    HTTPD_FILE_RANGE_NOT_SATISFIABLE,
+} httpd_file_resp_t;
+
+/* Copy the value of a request header, returns false if the
+ * header is not present or longer than the buffer */
+static bool httpd_file_get_hdr(httpd_req_t *r, const char *field, char *buf, size_t buf_len)
+{
+    return httpd_req_get_hdr_value_str(r, field, buf, buf_len) == ESP_OK;
+}
+
+/* Check if one of the entity tags in the value of an If-None-Match header matches 'etag'.
+ * Comparison is weak, i.e. W/"x" matches "x" (RFC 7232, section 3.2) */
+static bool httpd_file_etag_match(const char *list, const char *etag)
+{
+    const size_t etag_len = strlen(etag);
+    const char *p = list;
+
+    while (*p) {
+        while (*p == ' ' || *p == ',') {
+            p++;
+        }
+        if (*p == '*') {
+            return true;
+        }
+        if (strncmp(p, "W/", 2) == 0) {
+            p += 2;
+        }
+        const char *end = strchr(p, ',');
+        size_t len = end ? end - p : strlen(p);
+        while (len > 0 && p[len - 1] == ' ') {
+            len--;
+        }
+        if (len > 0 && len == etag_len && strncmp(p, etag, len) == 0) {
+            return true;
+        }
+        if (!end) {
+            break;
+        }
+        p = end;
+    }
+    return false;
+}
+
+/* Parse the value of a Range header, for a single range of bytes (RFC 7233, section 2.1).
+ * Other ranges, including multiple ranges, are ignored and the full content is sent. */
+static httpd_file_resp_t httpd_file_parse_range(const char *range, struct httpd_file *f)
+{
+    char *end;
+
+    if (strncmp(range, "bytes=", 6) != 0 || strchr(range, ',') != NULL) {
+        return HTTPD_FILE_SEND_ALL;
+    }
+    range += 6;
+
+    if (*range == '-') {
+        /* Suffix range, for the last bytes of the content */
+        unsigned long suffix = strtoul(range + 1, &end, 10);
+        if (end == range + 1 || *end != '\0') {
+            return HTTPD_FILE_SEND_ALL;
+        }
+        if (suffix == 0 || f->size == 0) {
+            return HTTPD_FILE_RANGE_NOT_SATISFIABLE;
+        }
+        f->len = MIN(suffix, f->size);
+        f->start = f->size - f->len;
+        return HTTPD_FILE_SEND_RANGE;
+    }
+
+    unsigned long first = strtoul(range, &end, 10);
+    if (end == range || *end != '-') {
+        return HTTPD_FILE_SEND_ALL;
+    }
+    range = end + 1;
+    unsigned long last = f->size ? f->size - 1 : 0;
+    if (*range != '\0') {
+        last = strtoul(range, &end, 10);
+        if (end == range || *end != '\0' || last < first) {
+            return HTTPD_FILE_SEND_ALL;
+        }
+    }
+    if (first >= f->size) {
+        return HTTPD_FILE_RANGE_NOT_SATISFIABLE;
+    }
+    f->start = first;
+    f->len = MIN(last, f->size - 1) - first + 1;
+    return HTTPD_FILE_SEND_RANGE;
+}
+
+/* Decide what to send, from the If-None-Match, Range and If-Range headers of the request */
+static httpd_file_resp_t httpd_file_check_request(httpd_req_t *r, struct httpd_file *f)
+{
+    char hdr[HTTPD_FILE_HDR_LEN];
+
+    if (f->etag && httpd_file_get_hdr(r, "If-None-Match", hdr, sizeof(hdr)) &&
+        httpd_file_etag_match(hdr, f->etag)) {
+        return HTTPD_FILE_NOT_MODIFIED;
+    }
+
+    if (!httpd_file_get_hdr(r, "Range", hdr, sizeof(hdr))) {
+        return HTTPD_FILE_SEND_ALL;
+    }
+    /* Ranges of content that has changed since If-Range can't be sent */
+    char if_range[HTTPD_FILE_HDR_LEN];
+    if (httpd_req_get_hdr_value_len(r, "If-Range") > 0 &&
+        (!f->etag || !httpd_file_get_hdr(r, "If-Range", if_range, sizeof(if_range)) ||
+         strcmp(if_range, f->etag) != 0)) {
+        return HTTPD_FILE_SEND_ALL;
+    }
+    return httpd_file_parse_range(hdr, f);
+}
+
+/* Check if the client accepts gzip content encoding */
+static bool httpd_file_accepts_gzip(httpd_req_t *r)
+{
+    char hdr[HTTPD_FILE_HDR_LEN];
+    /* gzip is usually listed first, so a truncated value is still checked */
+    esp_err_t err = httpd_req_get_hdr_value_str(r, "Accept-Encoding", hdr, sizeof(hdr));
+    if (err != ESP_OK && err != ESP_ERR_HTTPD_RESULT_TRUNC) {
+        return false;
+    }
+    const char *gzip = strstr(hdr, "gzip");
+    if (gzip == NULL) {
+        return false;
+    }
+    /* gzip;q=0 means the client doesn't accept it */
+    const char *q = gzip + 4;
+    while (*q == ' ') {
+        q++;
+    }
+    if (*q == ';') {
+        q++;
+        while (*q == ' ') {
+            q++;
+        }
+        if (strncmp(q, "q=", 2) == 0 && strtod(q + 2, NULL) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Assemble the response headers in the scratch buffer */
+static esp_err_t httpd_file_resp_hdrs(httpd_req_t *r, struct httpd_file *f,
+                                      httpd_file_resp_t resp, size_t *hdr_len)
+{
+    struct httpd_req_aux *ra = r->aux;
+    const char *status = ra->status;
+    char *buf = ra->scratch;
+    const size_t buf_size = sizeof(ra->scratch);
+    int len;
+
+    switch (resp) {
+    case HTTPD_FILE_SEND_RANGE:
+        status = "206 Partial Content";
+        break;
+    case HTTPD_FILE_NOT_MODIFIED:
+        status = "304 Not Modified";
+        break;
+    case HTTPD_FILE_RANGE_NOT_SATISFIABLE:
+        status = "416 Range Not Satisfiable";
+        f->len = 0;
+        break;
+    default:
+        break;
+    }
+
+    len = snprintf(buf, buf_size, "HTTP/1.1 %s\r\nContent-Type: %s\r\nAccept-Ranges: bytes\r\n",
+                   status, ra->content_type);
+    /* A 304 response has no content, and must not give the length of the content it stands for */
+    if (resp != HTTPD_FILE_NOT_MODIFIED && len < buf_size) {
+        len += snprintf(buf + len, buf_size - len, "Content-Length: %u\r\n", (unsigned) f->len);
+    }
+    if (f->etag && len < buf_size) {
+        len += snprintf(buf + len, buf_size - len, "ETag: %s\r\n", f->etag);
+    }
+    if (resp == HTTPD_FILE_SEND_RANGE && len < buf_size) {
+        len += snprintf(buf + len, buf_size - len, "Content-Range: bytes %u-%u/%u\r\n",
+                        (unsigned) f->start, (unsigned) (f->start + f->len - 1), (unsigned) f->size);
+    } else if (resp == HTTPD_FILE_RANGE_NOT_SATISFIABLE && len < buf_size) {
+        len += snprintf(buf + len, buf_size - len, "Content-Range: bytes */%u\r\n", (unsigned) f->size);
+    }
+    if (f->gzip && len < buf_size) {
+        len += snprintf(buf + len, buf_size - len, "Content-Encoding: gzip\r\n");
+    }
+    if (f->vary && len < buf_size) {
+        len += snprintf(buf + len, buf_size - len, "Vary: Accept-Encoding\r\n");
+    }
+    if (len >= buf_size) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+
+    /* Assemble additional headers based on set_header */
+    *hdr_len = len;
+    return httpd_resp_hdrs_complete(r, hdr_len);
+}
+
+/* Send content straight from the mapped flash, one MMU page at a time.
+ * The first data is sent together with the headers. */
+static esp_err_t httpd_file_send_partition_data(httpd_req_t *r, struct httpd_file *f, struct iovec *hdrs)
+{
+    size_t offset = f->offset + f->start;
+    size_t remaining = f->len;
+
+    while (remaining > 0) {
+        const size_t page_offset = (f->partition->address + offset) % SPI_FLASH_MMU_PAGE_SIZE;
+        const size_t len = MIN(remaining, SPI_FLASH_MMU_PAGE_SIZE - page_offset);
+        const void *data;
+        spi_flash_mmap_handle_t handle;
+
+        esp_err_t err = esp_partition_mmap(f->partition, offset, len, SPI_FLASH_MMAP_DATA, &data, &handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, LOG_FMT("failed to map partition %s (0x%x)"), f->partition->label, err);
+            return ESP_FAIL;
+        }
+        struct iovec iov[] = {
+            *hdrs,
+            { .iov_base = (void *) data, .iov_len = len },
+        };
+        err = httpd_sendv_all(r, iov, sizeof(iov) / sizeof(iov[0]));
+        spi_flash_munmap(handle);
+        if (err != ESP_OK) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+
+        hdrs->iov_len = 0;
+        offset += len;
+        remaining -= len;
+    }
+    return ESP_OK;
+}
+
+/* Send content read from a file. The first data is sent together with the headers. */
+static esp_err_t httpd_file_send_fd_data(httpd_req_t *r, struct httpd_file *f, struct iovec *hdrs)
+{
+    size_t remaining = f->len;
+
+    if (f->start > 0 && lseek(f->fd, f->start, SEEK_SET) != f->start) {
+        ESP_LOGE(TAG, LOG_FMT("seek failed (%d)"), errno);
+        return ESP_FAIL;
+    }
+
+    char *buf = malloc(MIN(remaining, HTTPD_FILE_BUF_SIZE));
+    if (buf == NULL) {
+        ESP_LOGE(TAG, LOG_FMT("mem alloc failed"));
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = ESP_OK;
+    while (remaining > 0) {
+        int len = read(f->fd, buf, MIN(remaining, HTTPD_FILE_BUF_SIZE));
+        if (len <= 0) {
+            /* The file may have been truncated after the headers were sent */
+            ESP_LOGE(TAG, LOG_FMT("read failed (%d)"), len < 0 ? errno : 0);
+            err = ESP_FAIL;
+            break;
+        }
+        struct iovec iov[] = {
+            *hdrs,
+            { .iov_base = buf, .iov_len = len },
+        };
+        if (httpd_sendv_all(r, iov, sizeof(iov) / sizeof(iov[0])) != ESP_OK) {
+            err = ESP_ERR_HTTPD_RESP_SEND;
+            break;
+        }
+        hdrs->iov_len = 0;
+        remaining -= len;
+    }
+
+    free(buf);
+    return err;
+}
+
+static esp_err_t httpd_file_send(httpd_req_t *r, struct httpd_file *f)
+{
+    struct httpd_req_aux *ra = r->aux;
+    httpd_file_resp_t resp = HTTPD_FILE_SEND_ALL;
+
+    f->start = 0;
+    f->len = f->size;
+    /* Conditional and range requests only apply to successful responses,
+     * not to content sent along with another status */
+    if (strcmp(ra->status, HTTPD_200) == 0) {
+        resp = httpd_file_check_request(r, f);
+    }
+
+    /* Request headers are no longer available */
+    ra->req_hdrs_count = 0;
+
+    size_t hdr_len;
+    esp_err_t err = httpd_file_resp_hdrs(r, f, resp, &hdr_len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    struct iovec hdrs = { .iov_base = ra->scratch, .iov_len = hdr_len };
+
+    if (resp == HTTPD_FILE_NOT_MODIFIED || f->len == 0 || r->method == HTTP_HEAD) {
+        return (httpd_sendv_all(r, &hdrs, 1) == ESP_OK) ? ESP_OK : ESP_ERR_HTTPD_RESP_SEND;
+    }
+    if (f->partition) {
+        return httpd_file_send_partition_data(r, f, &hdrs);
+    }
+    return httpd_file_send_fd_data(r, f, &hdrs);
+}
+
+esp_err_t httpd_resp_send_partition(httpd_req_t *r, const esp_partition_t *partition,
+                                    size_t offset, size_t size, const char *etag)
+{
+    if (r == NULL || partition == NULL || offset > partition->size || size > partition->size - offset) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+
+    struct httpd_file f = {
+        .partition = partition,
+        .offset    = offset,
+        .fd        = -1,
+        .size      = size,
+        .etag      = etag,
+    };
+    return httpd_file_send(r, &f);
+}
+
+esp_err_t httpd_resp_send_file(httpd_req_t *r, const char *path)
+{
+    if (r == NULL || path == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+
+    struct httpd_file f = {
+        .fd = -1,
+    };
+
+    /* Prefer the precompressed variant of the file, if any */
+    const size_t path_len = strlen(path);
+    char *gz_path = malloc(path_len + sizeof(".gz"));
+    if (gz_path == NULL) {
+        ESP_LOGE(TAG, LOG_FMT("mem alloc failed"));
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(gz_path, path, path_len);
+    memcpy(gz_path + path_len, ".gz", sizeof(".gz"));
+    struct stat st;
+    if (stat(gz_path, &st) == 0) {
+        f.vary = true;
+        if (httpd_file_accepts_gzip(r)) {
+            f.fd = open(gz_path, O_RDONLY);
+            f.gzip = (f.fd >= 0);
+        }
+    }
+    free(gz_path);
+
+    if (f.fd < 0) {
+        f.fd = open(path, O_RDONLY);
+        if (f.fd < 0) {
+            ESP_LOGD(TAG, LOG_FMT("failed to open %s (%d)"), path, errno);
+            return ESP_ERR_NOT_FOUND;
+        }
+    }
+    if (fstat(f.fd, &st) != 0) {
+        ESP_LOGE(TAG, LOG_FMT("failed to stat %s (%d)"), path, errno);
+        close(f.fd);
+        return ESP_FAIL;
+    }
+
+    /* The entity tag changes whenever the file is modified or replaced */
+    char etag[HTTPD_FILE_ETAG_LEN];
+    snprintf(etag, sizeof(etag), "\"%lx-%lx%s\"", (unsigned long) st.st_mtime,
+             (unsigned long) st.st_size, f.gzip ? "z" : "");
+    f.etag = etag;
+    f.size = st.st_size;
+
+    esp_err_t err = httpd_file_send(r, &f);
+    close(f.fd);
+    return err;
+}
@@ -62,6 +62,12 @@ static esp_err_t httpd_accept_conn(struct httpd_data *hd, int listen_fd)
     tv.tv_usec = 0;
     setsockopt(new_fd, SOL_SOCKET, SO_SNDTIMEO, (const char*)&tv, sizeof(tv));
 
+    /* Responses are sent with as few calls as possible, so Nagle's algorithm
+     * would only hold back the responses to pipelined requests while waiting
+     * for the client to acknowledge the previous one */
+    int nodelay = 1;
+    setsockopt(new_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
     if (ESP_OK != httpd_sess_new(hd, new_fd)) {
         ESP_LOGW(TAG, LOG_FMT("session creation failed"));
         close(new_fd);
@@ -75,6 +81,7 @@ struct httpd_ctrl_data {
     enum httpd_ctrl_msg {
         HTTPD_CTRL_SHUTDOWN,
         HTTPD_CTRL_WORK,
+        HTTPD_CTRL_WAKE,
     } hc_msg;
     httpd_work_fn_t hc_work;
     void *hc_work_arg;
@@ -146,17 +153,125 @@ static void httpd_process_ctrl_msg(struct httpd_data *hd)
         ESP_LOGD(TAG, LOG_FMT("shutdown"));
         hd->hd_td.status = THREAD_STOPPING;
         break;
+    case HTTPD_CTRL_WAKE:
+        /* A worker has handed a session back, which
+         * is watched again from the next select() */
+        ESP_LOGD(TAG, LOG_FMT("wake"));
+        break;
     default:
         break;
     }
 }
 
+httpd_req_t *httpd_current_req(struct httpd_data *hd)
+{
+    if (hd->hd_workers) {
+        othread_t self = httpd_os_thread_handle();
+        for (int i = 0; i < hd->config.worker_count; i++) {
+            if (hd->hd_workers[i].td.handle == self) {
+                return &hd->hd_workers[i].req;
+            }
+        }
+    }
+    return &hd->hd_req;
+}
+
+static void httpd_worker_thread(void *arg)
+{
+    struct httpd_worker *worker = (struct httpd_worker *) arg;
+    struct httpd_data *hd = worker->hd;
+    struct sock_db *sd;
+    struct httpd_ctrl_data msg = {
+        .hc_msg = HTTPD_CTRL_WAKE,
+    };
+
+    worker->td.status = THREAD_RUNNING;
+
+    /* A NULL session tells the worker to stop */
+    while (httpd_os_queue_recv(hd->hd_work_queue, &sd) == OS_SUCCESS && sd != NULL) {
+        ESP_LOGD(TAG, LOG_FMT("processing socket %d"), sd->fd);
+        if (httpd_sess_process(hd, &worker->req, sd->fd) != ESP_OK) {
+            sd->close_pending = true;
+        }
+
+        /* Hand the session back. The server task closes it if needed,
+         * as sessions are only created and deleted by the server task */
+        sd->busy = false;
+        if (cs_send_to_ctrl_sock(hd->msg_fd, hd->config.ctrl_port, &msg, sizeof(msg)) < 0) {
+            ESP_LOGW(TAG, LOG_FMT("failed to wake server"));
+        }
+    }
+
+    ESP_LOGD(TAG, LOG_FMT("worker exiting"));
+    worker->td.status = THREAD_STOPPED;
+    httpd_os_thread_delete();
+}
+
+static void httpd_stop_workers(struct httpd_data *hd)
+{
+    struct sock_db *stop = NULL;
+    for (int i = 0; i < hd->config.worker_count; i++) {
+        if (hd->hd_workers[i].td.status != THREAD_IDLE) {
+            httpd_os_queue_send(hd->hd_work_queue, &stop);
+        }
+    }
+
+    /* Workers finish processing their current request before stopping */
+    for (int i = 0; i < hd->config.worker_count; i++) {
+        while (hd->hd_workers[i].td.status != THREAD_IDLE &&
+               hd->hd_workers[i].td.status != THREAD_STOPPED) {
+            httpd_os_thread_sleep(10);
+        }
+    }
+}
+
+static esp_err_t httpd_start_workers(struct httpd_data *hd)
+{
+    for (int i = 0; i < hd->config.worker_count; i++) {
+        struct httpd_worker *worker = &hd->hd_workers[i];
+        /* Mark the worker as started before it runs, so it is stopped in case of failure */
+        worker->td.status = THREAD_RUNNING;
+        if (httpd_os_thread_create_pinned(&worker->td.handle, "httpd_worker",
+                                          hd->config.worker_stack_size,
+                                          hd->config.worker_priority,
+                                          httpd_worker_thread, worker,
+                                          hd->config.worker_core_id) != OS_SUCCESS) {
+            ESP_LOGE(TAG, LOG_FMT("failed to launch worker %d"), i);
+            worker->td.status = THREAD_IDLE;
+            httpd_stop_workers(hd);
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+/* Process a request on a session, or hand the session over to a worker.
+ * Returns an error if the session is to be closed. */
+static esp_err_t httpd_process_sess(struct httpd_data *hd, int fd)
+{
+    if (hd->config.worker_count == 0) {
+        return httpd_sess_process(hd, &hd->hd_req, fd);
+    }
+
+    /* The session is not watched by select() until the worker hands it back.
+     * The queue has room for all sessions, so this never blocks. */
+    struct sock_db *sd = httpd_sess_get(hd, fd);
+    sd->busy = true;
+    httpd_os_queue_send(hd->hd_work_queue, &sd);
+    return ESP_OK;
+}
+
 /* Manage in-coming connection or data requests */
 static esp_err_t httpd_server(struct httpd_data *hd)
 {
     fd_set read_set;
     FD_ZERO(&read_set);
-    FD_SET(hd->listen_fd, &read_set);
+    /* When all sessions are with workers, the least recently used one can
+     * only be purged once it is handed back, which wakes up the server task.
+     * Until then, a pending connection would keep select() returning at once */
+    if (!hd->config.lru_purge_enable || !httpd_sess_all_busy(hd)) {
+        FD_SET(hd->listen_fd, &read_set);
+    }
     FD_SET(hd->ctrl_fd, &read_set);
 
     int tmp_max_fd;
@@ -165,8 +280,17 @@ static esp_err_t httpd_server(struct httpd_data *hd)
     tmp_max_fd = maxfd;
     maxfd = MAX(hd->ctrl_fd, tmp_max_fd);
 
+    /* Wake up in time to process pending requests and close idle sessions */
+    struct timeval tv, *timeout = NULL;
+    int64_t wait = httpd_sess_idle_wait(hd);
+    if (wait >= 0) {
+        tv.tv_sec = wait / 1000000;
+        tv.tv_usec = wait % 1000000;
+        timeout = &tv;
+    }
+
     ESP_LOGD(TAG, LOG_FMT("doing select maxfd+1 = %d"), maxfd + 1);
-    int active_cnt = select(maxfd + 1, &read_set, NULL, NULL, NULL);
+    int active_cnt = select(maxfd + 1, &read_set, NULL, NULL, timeout);
     if (active_cnt < 0) {
         ESP_LOGE(TAG, LOG_FMT("error in select (%d)"), errno);
         httpd_sess_delete_invalid(hd);
@@ -187,15 +311,29 @@ static esp_err_t httpd_server(struct httpd_data *hd)
      * sessions? */
     int fd = -1;
     while ((fd = httpd_sess_iterate(hd, fd)) != -1) {
+        struct sock_db *sd = httpd_sess_get(hd, fd);
+        if (sd->busy) {
+            continue;
+        }
+        if (sd->close_pending) {
+            ESP_LOGD(TAG, LOG_FMT("closing socket %d"), fd);
+            close(fd);
+            fd = httpd_sess_delete(hd, fd);
+            continue;
+        }
         if (FD_ISSET(fd, &read_set) || (httpd_sess_pending(hd, fd))) {
             ESP_LOGD(TAG, LOG_FMT("processing socket %d"), fd);
-            if (httpd_sess_process(hd, fd) != ESP_OK) {
+            if (httpd_process_sess(hd, fd) != ESP_OK) {
                 ESP_LOGD(TAG, LOG_FMT("closing socket %d"), fd);
                 close(fd);
                 /* Delete session and update fd to that
                  * preceding the one being deleted */
                 fd = httpd_sess_delete(hd, fd);
             }
+        } else if (httpd_sess_expired(hd, fd)) {
+            ESP_LOGD(TAG, LOG_FMT("closing idle socket %d"), fd);
+            close(fd);
+            fd = httpd_sess_delete(hd, fd);
         }
     }
 
@@ -226,6 +364,7 @@ static void httpd_thread(void *arg)
     }
 
     ESP_LOGD(TAG, LOG_FMT("web server exiting"));
+    httpd_stop_workers(hd);
     close(hd->msg_fd);
     cs_free_ctrl_sock(hd->ctrl_fd);
     httpd_close_all_sessions(hd);
@@ -284,36 +423,53 @@ static esp_err_t httpd_server_init(struct httpd_data *hd)
     return ESP_OK;
 }
 
+static void httpd_delete(struct httpd_data *hd);
+
 static struct httpd_data *httpd_create(const httpd_config_t *config)
 {
     /* Allocate memory for httpd instance data */
     struct httpd_data *hd = calloc(1, sizeof(struct httpd_data));
-    if (hd != NULL) {
-        hd->hd_calls = calloc(config->max_uri_handlers, sizeof(httpd_uri_t *));
-        if (hd->hd_calls == NULL) {
-            free(hd);
-            return NULL;
-        }
-        hd->hd_sd = calloc(config->max_open_sockets, sizeof(struct sock_db));
-        if (hd->hd_sd == NULL) {
-            free(hd->hd_calls);
-            free(hd);
-            return NULL;
+    if (hd == NULL) {
+        ESP_LOGE(TAG, "mem alloc failed");
+        return NULL;
+    }
+    /* Save the configuration for this instance */
+    hd->config = *config;
+
+    hd->hd_calls = calloc(config->max_uri_handlers, sizeof(httpd_uri_t *));
+    hd->hd_sd = calloc(config->max_open_sockets, sizeof(struct sock_db));
+    struct httpd_req_aux *ra = &hd->hd_req_aux;
+    ra->resp_hdrs = calloc(config->max_resp_headers, sizeof(struct resp_hdr));
+    hd->hd_req.aux = ra;
+    if (hd->hd_calls == NULL || hd->hd_sd == NULL || ra->resp_hdrs == NULL ||
+        httpd_uri_router_init(hd) != ESP_OK) {
+        goto err;
+    }
+
+    if (config->worker_count > 0) {
+        hd->hd_workers = calloc(config->worker_count, sizeof(struct httpd_worker));
+        /* Each session is queued at most once, plus one stop request per worker */
+        hd->hd_work_queue = httpd_os_queue_create(config->max_open_sockets + config->worker_count,
+                                                  sizeof(struct sock_db *));
+        if (hd->hd_workers == NULL || hd->hd_work_queue == NULL) {
+            goto err;
         }
-        struct httpd_req_aux *ra = &hd->hd_req_aux;
-        ra->resp_hdrs = calloc(config->max_resp_headers, sizeof(struct resp_hdr));
-        if (ra->resp_hdrs == NULL) {
-            free(hd->hd_sd);
-            free(hd->hd_calls);
-            free(hd);
-            return NULL;
+        for (int i = 0; i < config->worker_count; i++) {
+            struct httpd_worker *worker = &hd->hd_workers[i];
+            worker->hd = hd;
+            worker->req.aux = &worker->req_aux;
+            worker->req_aux.resp_hdrs = calloc(config->max_resp_headers, sizeof(struct resp_hdr));
+            if (worker->req_aux.resp_hdrs == NULL) {
+                goto err;
+            }
         }
-        /* Save the configuration for this instance */
-        hd->config = *config;
-    } else {
-        ESP_LOGE(TAG, "mem alloc failed");
     }
     return hd;
+
+err:
+    ESP_LOGE(TAG, "mem alloc failed");
+    httpd_delete(hd);
+    return NULL;
 }
 
 static void httpd_delete(struct httpd_data *hd)
@@ -323,9 +479,22 @@ static void httpd_delete(struct httpd_data *hd)
     free(ra->resp_hdrs);
     free(hd->hd_sd);
 
+    if (hd->hd_workers) {
+        for (int i = 0; i < hd->config.worker_count; i++) {
+            free(hd->hd_workers[i].req_aux.resp_hdrs);
+        }
+        free(hd->hd_workers);
+    }
+    if (hd->hd_work_queue) {
+        httpd_os_queue_delete(hd->hd_work_queue);
+    }
+
     /* Free registered URI handlers */
-    httpd_unregister_all_uri_handlers(hd);
-    free(hd->hd_calls);
+    if (hd->hd_calls) {
+        httpd_unregister_all_uri_handlers(hd);
+        free(hd->hd_calls);
+    }
+    httpd_uri_router_deinit(hd);
     free(hd);
 }
 
@@ -347,11 +516,22 @@ esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
     }
 
     httpd_sess_init(hd);
+    if (httpd_start_workers(hd) != ESP_OK) {
+        close(hd->listen_fd);
+        close(hd->msg_fd);
+        cs_free_ctrl_sock(hd->ctrl_fd);
+        httpd_delete(hd);
+        return ESP_ERR_HTTPD_TASK;
+    }
     if (httpd_os_thread_create(&hd->hd_td.handle, "httpd",
                                hd->config.stack_size,
                                hd->config.task_priority,
                                httpd_thread, hd) != ESP_OK) {
         /* Failed to launch task */
+        httpd_stop_workers(hd);
+        close(hd->listen_fd);
+        close(hd->msg_fd);
+        cs_free_ctrl_sock(hd->ctrl_fd);
         httpd_delete(hd);
         return ESP_ERR_HTTPD_TASK;
     }
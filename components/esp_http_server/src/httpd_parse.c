@@ -305,6 +305,13 @@ static esp_err_t cb_headers_complete(http_parser *parser)
         return ESP_FAIL;
     }
 
+    /* Keep the connection open unless the client asked to close it, it is
+     * HTTP/1.0 without keep-alive or its last request has been received */
+    struct httpd_data *hd = (struct httpd_data *) r->handle;
+    ra->keep_alive = http_should_keep_alive(parser) &&
+                     (hd->config.keep_alive_max_requests == 0 ||
+                      ra->sd->req_count < hd->config.keep_alive_max_requests);
+
     parser_data->status = PARSING_BODY;
     ra->remaining_len = r->content_len;
     return ESP_OK;
@@ -493,9 +500,8 @@ static void parse_init(httpd_req_t *r, http_parser *parser, parser_data_t *data)
 
 /* Function that receives TCP data and runs parser on it
  */
-static esp_err_t httpd_parse_req(struct httpd_data *hd)
+static esp_err_t httpd_parse_req(struct httpd_data *hd, httpd_req_t *r)
 {
-    httpd_req_t *r = &hd->hd_req;
     int blk_len,  offset;
     http_parser   parser;
     parser_data_t parser_data;
@@ -518,13 +524,17 @@ static esp_err_t httpd_parse_req(struct httpd_data *hd)
 
         /* Parse data block from buffer */
         if ((offset = parse_block(&parser, offset, blk_len)) < 0) {
-            /* Server/Client error. Send error code as response status */
+            /* Server/Client error. Send error code as response status.
+             * The rest of the stream can't be parsed, so the connection
+             * is closed after the response */
+            struct httpd_req_aux *ra = r->aux;
+            ra->keep_alive = false;
             return httpd_resp_send_err(r, parser_data.error);
         }
     } while (parser_data.status != PARSING_COMPLETE);
 
     ESP_LOGD(TAG, LOG_FMT("parsing complete"));
-    return httpd_uri(hd);
+    return httpd_uri(hd, r);
 }
 
 static void init_req(httpd_req_t *r, httpd_config_t *config)
@@ -533,7 +543,6 @@ static void init_req(httpd_req_t *r, httpd_config_t *config)
     r->method = 0;
     memset((char*)r->uri, 0, sizeof(r->uri));
     r->content_len = 0;
-    r->aux = 0;
     r->user_ctx = 0;
     r->sess_ctx = 0;
     r->free_ctx = 0;
@@ -549,6 +558,7 @@ static void init_req_aux(struct httpd_req_aux *ra, httpd_config_t *config)
     ra->first_chunk_sent = 0;
     ra->req_hdrs_count = 0;
     ra->resp_hdrs_count = 0;
+    ra->keep_alive = true;
     memset(ra->resp_hdrs, 0, config->max_resp_headers * sizeof(struct resp_hdr));
 }
 
@@ -564,24 +574,22 @@ static void httpd_req_cleanup(httpd_req_t *r)
     }
     ra->sd->free_ctx = r->free_ctx;
 
-    /* Clear out the request and request_aux structures */
+    /* Clear out the request and request_aux structures. The
+     * request_aux structure stays attached to the request */
     ra->sd = NULL;
     r->handle = NULL;
-    r->aux = NULL;
 }
 
 /* Function that processes incoming TCP data and
  * updates the http request data httpd_req_t
  */
-esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
+esp_err_t httpd_req_new(struct httpd_data *hd, httpd_req_t *r, struct sock_db *sd)
 {
-    httpd_req_t *r = &hd->hd_req;
+    struct httpd_req_aux *ra = r->aux;
     init_req(r, &hd->config);
-    init_req_aux(&hd->hd_req_aux, &hd->config);
+    init_req_aux(ra, &hd->config);
     r->handle = hd;
-    r->aux = &hd->hd_req_aux;
     /* Associate the request to the socket */
-    struct httpd_req_aux *ra = r->aux;
     ra->sd = sd;
     /* Set defaults */
     ra->status = (char *)HTTPD_200;
@@ -591,7 +599,7 @@ esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
     r->sess_ctx = sd->ctx;
     r->free_ctx = sd->free_ctx;
     /* Parse request */
-    esp_err_t err = httpd_parse_req(hd);
+    esp_err_t err = httpd_parse_req(hd, r);
     if (err != ESP_OK) {
         httpd_req_cleanup(r);
     }
@@ -600,9 +608,8 @@ esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
 
 /* Function that resets the http request data
  */
-esp_err_t httpd_req_delete(struct httpd_data *hd)
+esp_err_t httpd_req_delete(httpd_req_t *r)
 {
-    httpd_req_t *r = &hd->hd_req;
     struct httpd_req_aux *ra = r->aux;
 
     /* Finish off reading any pending/leftover data */
@@ -635,8 +642,22 @@ bool httpd_validate_req_ptr(httpd_req_t *r)
         struct httpd_data *hd = (struct httpd_data *) r->handle;
         if (hd) {
             /* Check if this function is running in the context of
-             * the correct httpd server thread */
-            if (httpd_os_thread_handle() == hd->hd_td.handle) {
+             * the httpd server thread, or with workers, of the worker
+             * processing the request */
+            othread_t owner = hd->hd_td.handle;
+            if (hd->hd_workers) {
+                owner = NULL;
+                for (int i = 0; i < hd->config.worker_count; i++) {
+                    if (&hd->hd_workers[i].req == r) {
+                        owner = hd->hd_workers[i].td.handle;
+                        break;
+                    }
+                }
+            } else if (r != &hd->hd_req) {
+                owner = NULL;
+            }
+            if (owner && httpd_os_thread_handle() == owner &&
+                ((struct httpd_req_aux *)r->aux)->sd) {
                 return true;
             }
         }
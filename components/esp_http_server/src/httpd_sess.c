@@ -33,6 +33,16 @@ bool httpd_is_sess_available(struct httpd_data *hd)
     return false;
 }
 
+bool httpd_sess_all_busy(struct httpd_data *hd)
+{
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        if (hd->hd_sd[i].fd == -1 || !hd->hd_sd[i].busy) {
+            return false;
+        }
+    }
+    return true;
+}
+
 struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd)
 {
     if (hd == NULL) {
@@ -41,10 +51,11 @@ struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd)
 
     /* Check if called inside a request handler, and the
      * session sockfd in use is same as the parameter */
-    if ((hd->hd_req_aux.sd) && (hd->hd_req_aux.sd->fd == sockfd)) {
+    struct httpd_req_aux *ra = httpd_current_req(hd)->aux;
+    if ((ra->sd) && (ra->sd->fd == sockfd)) {
         /* Just return the pointer to the sock_db
          * corresponding to the request */
-        return hd->hd_req_aux.sd;
+        return ra->sd;
     }
 
     int i;
@@ -72,7 +83,9 @@ esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd)
             hd->hd_sd[i].fd = newfd;
             hd->hd_sd[i].handle = (httpd_handle_t) hd;
             hd->hd_sd[i].send_fn = httpd_default_send;
+            hd->hd_sd[i].sendv_fn = httpd_default_sendv;
             hd->hd_sd[i].recv_fn = httpd_default_recv;
+            hd->hd_sd[i].timestamp = httpd_os_get_timestamp();
 
             /* Call user-defined session opening function */
             if (hd->config.open_fn) {
@@ -107,9 +120,9 @@ void *httpd_sess_get_ctx(httpd_handle_t handle, int sockfd)
     /* Check if the function has been called from inside a
      * request handler, in which case fetch the context from
      * the httpd_req_t structure */
-    struct httpd_data *hd = (struct httpd_data *) handle;
-    if (hd->hd_req_aux.sd == sd) {
-        return hd->hd_req.sess_ctx;
+    httpd_req_t *r = httpd_current_req((struct httpd_data *) handle);
+    if (((struct httpd_req_aux *) r->aux)->sd == sd) {
+        return r->sess_ctx;
     }
 
     return sd->ctx;
@@ -125,18 +138,18 @@ void httpd_sess_set_ctx(httpd_handle_t handle, int sockfd, void *ctx, httpd_free
     /* Check if the function has been called from inside a
      * request handler, in which case set the context inside
      * the httpd_req_t structure */
-    struct httpd_data *hd = (struct httpd_data *) handle;
-    if (hd->hd_req_aux.sd == sd) {
-        if (hd->hd_req.sess_ctx != ctx) {
+    httpd_req_t *r = httpd_current_req((struct httpd_data *) handle);
+    if (((struct httpd_req_aux *) r->aux)->sd == sd) {
+        if (r->sess_ctx != ctx) {
             /* Don't free previous context if it is in sockdb
              * as it will be freed inside httpd_req_cleanup() */
-            if (sd->ctx != hd->hd_req.sess_ctx) {
+            if (sd->ctx != r->sess_ctx) {
                 /* Free previous context */
-                httpd_sess_free_ctx(hd->hd_req.sess_ctx, hd->hd_req.free_ctx);
+                httpd_sess_free_ctx(r->sess_ctx, r->free_ctx);
             }
-            hd->hd_req.sess_ctx = ctx;
+            r->sess_ctx = ctx;
         }
-        hd->hd_req.free_ctx = free_fn;
+        r->free_ctx = free_fn;
         return;
     }
 
@@ -180,7 +193,8 @@ void httpd_sess_set_descriptors(struct httpd_data *hd,
     int i;
     *maxfd = -1;
     for (i = 0; i < hd->config.max_open_sockets; i++) {
-        if (hd->hd_sd[i].fd != -1) {
+        /* Sessions handed over to a worker are not watched */
+        if (hd->hd_sd[i].fd != -1 && !hd->hd_sd[i].busy) {
             FD_SET(hd->hd_sd[i].fd, fdset);
             if (hd->hd_sd[i].fd > *maxfd) {
                 *maxfd = hd->hd_sd[i].fd;
@@ -198,7 +212,7 @@ static int fd_is_valid(int fd)
 void httpd_sess_delete_invalid(struct httpd_data *hd)
 {
     for (int i = 0; i < hd->config.max_open_sockets; i++) {
-        if (hd->hd_sd[i].fd != -1 && !fd_is_valid(hd->hd_sd[i].fd)) {
+        if (hd->hd_sd[i].fd != -1 && !hd->hd_sd[i].busy && !fd_is_valid(hd->hd_sd[i].fd)) {
             ESP_LOGW(TAG, LOG_FMT("Closing invalid socket %d"), hd->hd_sd[i].fd);
             httpd_sess_delete(hd, hd->hd_sd[i].fd);
         }
@@ -261,6 +275,17 @@ void httpd_sess_init(struct httpd_data *hd)
     }
 }
 
+static bool httpd_sess_has_pending(struct httpd_data *hd, struct sock_db *sd)
+{
+    if (sd->pending_fn) {
+        // test if there's any data to be read (besides read() function, which is handled by select() in the main httpd loop)
+        // this should check e.g. for the SSL data buffer
+        if (sd->pending_fn(hd, sd->fd) > 0) return true;
+    }
+
+    return (sd->pending_len != 0);
+}
+
 bool httpd_sess_pending(struct httpd_data *hd, int fd)
 {
     struct sock_db *sd = httpd_sess_get(hd, fd);
@@ -268,36 +293,82 @@ bool httpd_sess_pending(struct httpd_data *hd, int fd)
         return ESP_FAIL;
     }
 
-    if (sd->pending_fn) {
-        // test if there's any data to be read (besides read() function, which is handled by select() in the main httpd loop)
-        // this should check e.g. for the SSL data buffer
-        if (sd->pending_fn(hd, fd) > 0) return true;
+    /* Pending data of a busy session is left to its worker */
+    if (sd->busy) {
+        return false;
     }
 
-    return (sd->pending_len != 0);
+    return httpd_sess_has_pending(hd, sd);
+}
+
+int64_t httpd_sess_idle_wait(struct httpd_data *hd)
+{
+    int64_t wait = -1;
+    int64_t now = httpd_os_get_timestamp();
+    int64_t timeout = hd->config.keep_alive_idle_timeout * 1000000LL;
+
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        struct sock_db *sd = &hd->hd_sd[i];
+        if (sd->fd == -1 || sd->busy) {
+            continue;
+        }
+        /* Requests left in the pending buffer are not signalled by select() */
+        if (httpd_sess_has_pending(hd, sd)) {
+            return 0;
+        }
+        if (timeout) {
+            int64_t left = MAX(sd->timestamp + timeout - now, 0);
+            if (wait == -1 || left < wait) {
+                wait = left;
+            }
+        }
+    }
+    return wait;
+}
+
+bool httpd_sess_expired(struct httpd_data *hd, int fd)
+{
+    struct sock_db *sd = httpd_sess_get(hd, fd);
+    if (! sd || sd->busy || ! hd->config.keep_alive_idle_timeout) {
+        return false;
+    }
+
+    return (httpd_os_get_timestamp() - sd->timestamp >=
+            hd->config.keep_alive_idle_timeout * 1000000LL);
 }
 
 /* This MUST return ESP_OK on successful execution. If any other
  * value is returned, everything related to this socket will be
  * cleaned up and the socket will be closed.
  */
-esp_err_t httpd_sess_process(struct httpd_data *hd, int newfd)
+esp_err_t httpd_sess_process(struct httpd_data *hd, httpd_req_t *r, int newfd)
 {
     struct sock_db *sd = httpd_sess_get(hd, newfd);
     if (! sd) {
         return ESP_FAIL;
     }
 
+    /* Only one request is processed per call, so that other sessions are not
+     * starved by a client pipelining requests. Requests left in the pending
+     * buffer are picked up on the next pass of the server loop, as
+     * httpd_sess_idle_wait() keeps select() from blocking meanwhile */
     ESP_LOGD(TAG, LOG_FMT("httpd_req_new"));
-    if (httpd_req_new(hd, sd) != ESP_OK) {
+    sd->req_count++;
+    if (httpd_req_new(hd, r, sd) != ESP_OK) {
         return ESP_FAIL;
     }
     ESP_LOGD(TAG, LOG_FMT("httpd_req_delete"));
-    if (httpd_req_delete(hd) != ESP_OK) {
+    if (httpd_req_delete(r) != ESP_OK) {
         return ESP_FAIL;
     }
     ESP_LOGD(TAG, LOG_FMT("success"));
     sd->timestamp = httpd_os_get_timestamp();
+
+    /* The response announced that the connection is closed */
+    if (! ((struct httpd_req_aux *) r->aux)->keep_alive) {
+        ESP_LOGD(TAG, LOG_FMT("connection not kept alive"));
+        return ESP_FAIL;
+    }
     return ESP_OK;
 }
 
@@ -323,6 +394,7 @@ esp_err_t httpd_sess_close_lru(struct httpd_data *hd)
 {
     int64_t timestamp = INT64_MAX;
     int lru_fd = -1;
+    bool lru_busy = false;
     int i;
     for (i = 0; i < hd->config.max_open_sockets; i++) {
         /* If a descriptor is -1, there is no need to close any session.
@@ -332,7 +404,11 @@ esp_err_t httpd_sess_close_lru(struct httpd_data *hd)
         if (hd->hd_sd[i].fd == -1) {
             return ESP_OK;
         }
-        if (hd->hd_sd[i].timestamp < timestamp) {
+        /* Prefer sessions which are not busy, as closing a busy session is deferred */
+        bool busy = hd->hd_sd[i].busy;
+        if (lru_fd == -1 || (lru_busy && !busy) ||
+            (lru_busy == busy && hd->hd_sd[i].timestamp < timestamp)) {
+            lru_busy = busy;
             timestamp = hd->hd_sd[i].timestamp;
             lru_fd = hd->hd_sd[i].fd;
         }
@@ -368,6 +444,12 @@ static void httpd_sess_close(void *arg)
 {
     struct sock_db *sock_db = (struct sock_db *)arg;
     if (sock_db) {
+        /* A worker is using the session, let the server close
+         * it once the session has been handed back */
+        if (sock_db->busy) {
+            sock_db->close_pending = true;
+            return;
+        }
         int fd = sock_db->fd;
         struct httpd_data *hd = (struct httpd_data *) sock_db->handle;
         httpd_sess_delete(hd, fd);
@@ -19,6 +19,7 @@
 
 #include <esp_http_server.h>
 #include "esp_httpd_priv.h"
+#include <sys/uio.h>
 
 static const char *TAG = "httpd_txrx";
 
@@ -29,6 +30,20 @@ esp_err_t httpd_sess_set_send_override(httpd_handle_t hd, int sockfd, httpd_send
         return ESP_ERR_INVALID_ARG;
     }
     sess->send_fn = send_func;
+    /* The default vectored send function would bypass the override */
+    if (sess->sendv_fn == httpd_default_sendv) {
+        sess->sendv_fn = NULL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_sess_set_sendv_override(httpd_handle_t hd, int sockfd, httpd_sendv_func_t sendv_func)
+{
+    struct sock_db *sess = httpd_sess_get(hd, sockfd);
+    if (!sess) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sess->sendv_fn = sendv_func;
     return ESP_OK;
 }
 
@@ -89,6 +104,97 @@ static esp_err_t httpd_send_all(httpd_req_t *r, const char *buf, size_t buf_len)
     return ESP_OK;
 }
 
+/* Sends all the buffers in 'iov', which is modified to track partial sends.
+ * Without a vectored send function, the buffers are sent one by one. */
+esp_err_t httpd_sendv_all(httpd_req_t *r, struct iovec *iov, int iovcnt)
+{
+    struct httpd_req_aux *ra = r->aux;
+    int ret;
+
+    while (iovcnt > 0) {
+        /* Skip empty buffers */
+        if (iov->iov_len == 0) {
+            iov++;
+            iovcnt--;
+            continue;
+        }
+
+        if (ra->sd->sendv_fn) {
+            ret = ra->sd->sendv_fn(ra->sd->handle, ra->sd->fd, iov, iovcnt);
+        } else {
+            ret = ra->sd->send_fn(ra->sd->handle, ra->sd->fd, iov->iov_base, iov->iov_len, 0);
+        }
+        if (ret < 0) {
+            ESP_LOGD(TAG, LOG_FMT("error in send_fn"));
+            return ESP_FAIL;
+        }
+        ESP_LOGD(TAG, LOG_FMT("sent = %d"), ret);
+
+        /* Move past the data sent */
+        while (iovcnt > 0 && ret >= iov->iov_len) {
+            ret -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *) iov->iov_base + ret;
+            iov->iov_len -= ret;
+        }
+    }
+    return ESP_OK;
+}
+
+/* Appends a string to the response headers being assembled in the scratch buffer.
+ * If the buffer is full, the headers assembled so far are sent out first. */
+esp_err_t httpd_resp_hdr_append(httpd_req_t *r, size_t *hdr_len, const char *str, size_t len)
+{
+    struct httpd_req_aux *ra = r->aux;
+
+    if (*hdr_len + len > sizeof(ra->scratch)) {
+        if (httpd_send_all(r, ra->scratch, *hdr_len) != ESP_OK) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+        *hdr_len = 0;
+
+        /* Send strings larger than the buffer directly */
+        if (len > sizeof(ra->scratch)) {
+            return (httpd_send_all(r, str, len) == ESP_OK) ? ESP_OK : ESP_ERR_HTTPD_RESP_SEND;
+        }
+    }
+
+    memcpy(ra->scratch + *hdr_len, str, len);
+    *hdr_len += len;
+    return ESP_OK;
+}
+
+/* Appends the additional headers set with httpd_resp_set_hdr() and the end of the
+ * header section to the essential headers already in the scratch buffer */
+esp_err_t httpd_resp_hdrs_complete(httpd_req_t *r, size_t *hdr_len)
+{
+    struct httpd_req_aux *ra = r->aux;
+    esp_err_t ret = ESP_OK;
+
+    for (unsigned i = 0; i < ra->resp_hdrs_count && ret == ESP_OK; i++) {
+        const char *field = ra->resp_hdrs[i].field;
+        const char *value = ra->resp_hdrs[i].value;
+        if ((ret = httpd_resp_hdr_append(r, hdr_len, field, strlen(field))) != ESP_OK ||
+            (ret = httpd_resp_hdr_append(r, hdr_len, ": ", 2)) != ESP_OK ||
+            (ret = httpd_resp_hdr_append(r, hdr_len, value, strlen(value))) != ESP_OK) {
+            break;
+        }
+        ret = httpd_resp_hdr_append(r, hdr_len, "\r\n", 2);
+    }
+
+    /* Tell the client the connection is closed after this response */
+    if (ret == ESP_OK && !ra->keep_alive) {
+        ret = httpd_resp_hdr_append(r, hdr_len, "Connection: close\r\n", 19);
+    }
+    if (ret == ESP_OK) {
+        ret = httpd_resp_hdr_append(r, hdr_len, "\r\n", 2);
+    }
+    return ret;
+}
+
 static size_t httpd_recv_pending(httpd_req_t *r, char *buf, size_t buf_len)
 {
     struct httpd_req_aux *ra = r->aux;
@@ -243,8 +349,6 @@ esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
 
     struct httpd_req_aux *ra = r->aux;
     const char *httpd_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\n";
-    const char *colon_separator = ": ";
-    const char *cr_lf_seperator = "\r\n";
 
     if (buf_len == HTTPD_RESP_USE_STRLEN) {
         buf_len = strlen(buf);
@@ -254,46 +358,35 @@ esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
     ra->req_hdrs_count = 0;
 
     /* Size of essential headers is limited by scratch buffer size */
-    if (snprintf(ra->scratch, sizeof(ra->scratch), httpd_hdr_str,
-                 ra->status, ra->content_type, buf_len) >= sizeof(ra->scratch)) {
+    int hdr_str_len = snprintf(ra->scratch, sizeof(ra->scratch), httpd_hdr_str,
+                               ra->status, ra->content_type, buf_len);
+    if (hdr_str_len >= sizeof(ra->scratch)) {
         return ESP_ERR_HTTPD_RESP_HDR;
     }
 
-    /* Sending essential headers */
-    if (httpd_send_all(r, ra->scratch, strlen(ra->scratch)) != ESP_OK) {
-        return ESP_ERR_HTTPD_RESP_SEND;
+    /* Assemble additional headers based on set_header */
+    size_t hdr_len = hdr_str_len;
+    esp_err_t ret = httpd_resp_hdrs_complete(r, &hdr_len);
+    if (ret != ESP_OK) {
+        return ret;
     }
 
-    /* Sending additional headers based on set_header */
-    for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
-        /* Send header field */
-        if (httpd_send_all(r, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send ': ' */
-        if (httpd_send_all(r, colon_separator, strlen(colon_separator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send header value */
-        if (httpd_send_all(r, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send CR + LF */
-        if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-    }
+    /* Send the headers and the content together */
+    struct iovec iov[] = {
+        { .iov_base = ra->scratch, .iov_len = hdr_len },
+        { .iov_base = (char *) buf, .iov_len = buf ? buf_len : 0 },
+    };
 
-    /* End header section */
-    if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-        return ESP_ERR_HTTPD_RESP_SEND;
+    /* When the buffers have to be sent one by one, short content
+     * goes out in the same send as the headers */
+    if (!ra->sd->sendv_fn && iov[1].iov_len > 0 && iov[1].iov_len <= sizeof(ra->scratch) - hdr_len) {
+        memcpy(ra->scratch + hdr_len, buf, iov[1].iov_len);
+        iov[0].iov_len += iov[1].iov_len;
+        iov[1].iov_len = 0;
     }
 
-    /* Sending content */
-    if (buf && buf_len) {
-        if (httpd_send_all(r, buf, buf_len) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
+    if (httpd_sendv_all(r, iov, sizeof(iov) / sizeof(iov[0])) != ESP_OK) {
+        return ESP_ERR_HTTPD_RESP_SEND;
     }
     return ESP_OK;
 }
@@ -314,66 +407,43 @@ esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len
 
     struct httpd_req_aux *ra = r->aux;
     const char *httpd_chunked_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nTransfer-Encoding: chunked\r\n";
-    const char *colon_separator = ": ";
-    const char *cr_lf_seperator = "\r\n";
+    char len_str[10];
+    size_t len_str_len = snprintf(len_str, sizeof(len_str), "%x\r\n", buf_len);
 
     /* Request headers are no longer available */
     ra->req_hdrs_count = 0;
 
+    /* The chunk size line, chunk data and end of chunk are sent together,
+     * preceded by the headers for the first chunk */
+    struct iovec iov[] = {
+        { .iov_base = len_str, .iov_len = len_str_len },
+        { .iov_base = (char *) buf, .iov_len = buf ? buf_len : 0 },
+        { .iov_base = (char *) "\r\n", .iov_len = 2 },
+    };
+
     if (!ra->first_chunk_sent) {
         /* Size of essential headers is limited by scratch buffer size */
-        if (snprintf(ra->scratch, sizeof(ra->scratch), httpd_chunked_hdr_str,
-                     ra->status, ra->content_type) >= sizeof(ra->scratch)) {
+        int hdr_str_len = snprintf(ra->scratch, sizeof(ra->scratch), httpd_chunked_hdr_str,
+                                   ra->status, ra->content_type);
+        if (hdr_str_len >= sizeof(ra->scratch)) {
             return ESP_ERR_HTTPD_RESP_HDR;
         }
 
-        /* Sending essential headers */
-        if (httpd_send_all(r, ra->scratch, strlen(ra->scratch)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
+        /* Assemble additional headers based on set_header, followed by the chunk size */
+        size_t hdr_len = hdr_str_len;
+        esp_err_t ret = httpd_resp_hdrs_complete(r, &hdr_len);
+        if (ret == ESP_OK) {
+            ret = httpd_resp_hdr_append(r, &hdr_len, len_str, len_str_len);
         }
-
-        /* Sending additional headers based on set_header */
-        for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
-            /* Send header field */
-            if (httpd_send_all(r, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send ': ' */
-            if (httpd_send_all(r, colon_separator, strlen(colon_separator)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send header value */
-            if (httpd_send_all(r, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send CR + LF */
-            if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-        }
-
-        /* End header section */
-        if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
+        if (ret != ESP_OK) {
+            return ret;
         }
+        iov[0].iov_base = ra->scratch;
+        iov[0].iov_len  = hdr_len;
         ra->first_chunk_sent = true;
     }
 
-    /* Sending chunked content */
-    char len_str[10];
-    snprintf(len_str, sizeof(len_str), "%x\r\n", buf_len);
-    if (httpd_send_all(r, len_str, strlen(len_str)) != ESP_OK) {
-        return ESP_ERR_HTTPD_RESP_SEND;
-    }
-
-    if (buf) {
-        if (httpd_send_all(r, buf, (size_t) buf_len) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-    }
-
-    /* Indicate end of chunk */
-    if (httpd_send_all(r, "\r\n", strlen("\r\n")) != ESP_OK) {
+    if (httpd_sendv_all(r, iov, sizeof(iov) / sizeof(iov[0])) != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
     return ESP_OK;
@@ -542,6 +612,20 @@ int httpd_default_send(httpd_handle_t hd, int sockfd, const char *buf, size_t bu
     return ret;
 }
 
+int httpd_default_sendv(httpd_handle_t hd, int sockfd, const struct iovec *iov, int iovcnt)
+{
+    (void)hd;
+    if (iov == NULL || iovcnt <= 0) {
+        return HTTPD_SOCK_ERR_INVALID;
+    }
+
+    int ret = writev(sockfd, iov, iovcnt);
+    if (ret < 0) {
+        return httpd_sock_err("writev", sockfd);
+    }
+    return ret;
+}
+
 int httpd_default_recv(httpd_handle_t hd, int sockfd, char *buf, size_t buf_len, int flags)
 {
     (void)hd;
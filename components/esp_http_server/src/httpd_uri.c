@@ -88,12 +88,13 @@ bool httpd_uri_match_wildcard(const char *template, const char *uri, size_t len)
     }
 }
 
-/* Find handler with matching URI and method, and set
- * appropriate error code if URI or method not found */
-static httpd_uri_t* httpd_find_uri_handler(struct httpd_data *hd,
-                                           const char *uri, size_t uri_len,
-                                           httpd_method_t method,
-                                           httpd_err_resp_t *err)
+/* Find handler with matching URI and method by comparing the URI with all
+ * handlers in turn. Used with custom URI matching functions, which can't be
+ * indexed by the router */
+static httpd_uri_t* httpd_find_uri_handler_linear(struct httpd_data *hd,
+                                                  const char *uri, size_t uri_len,
+                                                  httpd_method_t method,
+                                                  httpd_err_resp_t *err)
 {
     if (err) {
         *err = HTTPD_404_NOT_FOUND;
@@ -131,6 +132,301 @@ static httpd_uri_t* httpd_find_uri_handler(struct httpd_data *hd,
     return NULL;
 }
 
+/*
+ * URI routing
+ *
+ * Handlers are kept in hd_calls in the order they were registered, and a
+ * request goes to the first handler in this order with matching URI and
+ * method. To avoid comparing the URI with every handler, the router keeps
+ * an index of the handlers:
+ *
+ *  - Handlers with an exact URI (all handlers with the default matching, and
+ *    those without trailing wildcards with httpd_uri_match_wildcard) are kept
+ *    in a hash table of their URIs.
+ *  - Wildcard handlers are kept in a trie of path segments, at the node of
+ *    the last complete segment of the part of their URI which must match
+ *    exactly. Only wildcards found at the nodes along the path of a request
+ *    URI can match it, and are checked with httpd_uri_match_wildcard.
+ *
+ * Routes are identified by their handler's index in hd_calls, so the lists
+ * are rebuilt when a handler is unregistered. Trie nodes are only freed with
+ * the server, so rebuilding never allocates memory.
+ *
+ * With a custom uri_match_fn the handlers can't be indexed, and they are
+ * checked in turn as before.
+ */
+
+#define HTTPD_ROUTE_NONE    UINT16_MAX
+
+struct httpd_uri_route {
+    uint32_t hash;                  /*!< Hash of the URI, for exact routes */
+    uint16_t next;                  /*!< Next route in the same hash bucket or trie node */
+};
+
+struct httpd_uri_node {
+    struct httpd_uri_node *child;   /*!< First node of the next path segment */
+    struct httpd_uri_node *sibling; /*!< Next node with the same parent */
+    uint16_t routes;                /*!< First wildcard route of this node */
+    uint16_t seg_len;               /*!< Length of the path segment */
+    char seg[];                     /*!< Path segment, including the trailing '/' */
+};
+
+struct httpd_uri_router {
+    struct httpd_uri_route *routes; /*!< Routes, one for each slot of hd_calls */
+    uint16_t *buckets;              /*!< Hash table of exact routes */
+    uint16_t bucket_mask;           /*!< Number of buckets - 1, a power of 2 - 1 */
+    struct httpd_uri_node root;     /*!< Root of the trie of wildcard routes */
+};
+
+/* FNV-1a hash of a URI */
+static uint32_t httpd_uri_hash(const char *uri, size_t len)
+{
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t) uri[i]) * 16777619U;
+    }
+    return hash;
+}
+
+/* Length of the part of a wildcard template which must match exactly
+ * (see httpd_uri_match_wildcard), or -1 if it has no trailing wildcard */
+static int httpd_uri_wildcard_prefix_len(const char *template)
+{
+    const size_t tpl_len = strlen(template);
+    const char last = (const char) (tpl_len > 0 ? template[tpl_len - 1] : 0);
+    const char prevlast = (const char) (tpl_len > 1 ? template[tpl_len - 2] : 0);
+    const bool asterisk = last == '*' || (prevlast == '*' && last == '?');
+    const bool quest = last == '?' || (prevlast == '?' && last == '*');
+
+    if (!asterisk && !quest) {
+        return -1;
+    }
+    /* Invalid templates such as "?" never match, and stay at the root */
+    return tpl_len > asterisk + quest*2 ? tpl_len - (asterisk + quest*2) : 0;
+}
+
+/* Find the child of a trie node for a path segment, optionally creating it */
+static struct httpd_uri_node *httpd_uri_node_child(struct httpd_uri_node *node,
+                                                   const char *seg, size_t seg_len,
+                                                   bool create)
+{
+    struct httpd_uri_node *child;
+    for (child = node->child; child != NULL; child = child->sibling) {
+        if (child->seg_len == seg_len && memcmp(child->seg, seg, seg_len) == 0) {
+            return child;
+        }
+    }
+    if (!create || seg_len > UINT16_MAX) {
+        return NULL;
+    }
+    child = calloc(1, sizeof(struct httpd_uri_node) + seg_len);
+    if (child == NULL) {
+        return NULL;
+    }
+    memcpy(child->seg, seg, seg_len);
+    child->seg_len = seg_len;
+    child->routes = HTTPD_ROUTE_NONE;
+    child->sibling = node->child;
+    node->child = child;
+    return child;
+}
+
+static void httpd_uri_node_free_children(struct httpd_uri_node *node)
+{
+    while (node->child) {
+        struct httpd_uri_node *child = node->child;
+        node->child = child->sibling;
+        httpd_uri_node_free_children(child);
+        free(child);
+    }
+}
+
+static void httpd_uri_node_clear_routes(struct httpd_uri_node *node)
+{
+    node->routes = HTTPD_ROUTE_NONE;
+    for (struct httpd_uri_node *child = node->child; child != NULL; child = child->sibling) {
+        httpd_uri_node_clear_routes(child);
+    }
+}
+
+static inline bool httpd_uri_router_wildcard(struct httpd_data *hd)
+{
+    return hd->config.uri_match_fn == httpd_uri_match_wildcard;
+}
+
+static inline bool httpd_uri_router_enabled(struct httpd_data *hd)
+{
+    return hd->config.uri_match_fn == NULL || httpd_uri_router_wildcard(hd);
+}
+
+/* Add the handler in slot 'index' of hd_calls to the router */
+static esp_err_t httpd_uri_router_add(struct httpd_data *hd, uint16_t index)
+{
+    struct httpd_uri_router *router = hd->hd_router;
+    struct httpd_uri_route *route = &router->routes[index];
+    const char *uri = hd->hd_calls[index]->uri;
+    uint16_t *list;
+
+    if (!httpd_uri_router_enabled(hd)) {
+        return ESP_OK;
+    }
+
+    const int prefix_len = httpd_uri_router_wildcard(hd) ? httpd_uri_wildcard_prefix_len(uri) : -1;
+    if (prefix_len < 0) {
+        route->hash = httpd_uri_hash(uri, strlen(uri));
+        list = &router->buckets[route->hash & router->bucket_mask];
+    } else {
+        struct httpd_uri_node *node = &router->root;
+        const char *seg = uri;
+        const char *end;
+        while ((end = memchr(seg, '/', uri + prefix_len - seg)) != NULL) {
+            node = httpd_uri_node_child(node, seg, end + 1 - seg, true);
+            if (node == NULL) {
+                return ESP_ERR_HTTPD_ALLOC_MEM;
+            }
+            seg = end + 1;
+        }
+        list = &node->routes;
+    }
+
+    /* Keep each list in registration order */
+    while (*list != HTTPD_ROUTE_NONE) {
+        list = &router->routes[*list].next;
+    }
+    route->next = HTTPD_ROUTE_NONE;
+    *list = index;
+    return ESP_OK;
+}
+
+/* Rebuild the router after handlers have been removed from hd_calls */
+static void httpd_uri_router_rebuild(struct httpd_data *hd)
+{
+    struct httpd_uri_router *router = hd->hd_router;
+    if (router == NULL) {
+        return;
+    }
+    for (unsigned i = 0; i <= router->bucket_mask; i++) {
+        router->buckets[i] = HTTPD_ROUTE_NONE;
+    }
+    httpd_uri_node_clear_routes(&router->root);
+
+    /* All trie nodes needed already exist, so this can't fail */
+    for (unsigned i = 0; i < hd->config.max_uri_handlers && hd->hd_calls[i]; i++) {
+        httpd_uri_router_add(hd, i);
+    }
+}
+
+esp_err_t httpd_uri_router_init(struct httpd_data *hd)
+{
+    struct httpd_uri_router *router = calloc(1, sizeof(struct httpd_uri_router));
+    if (router == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* At least as many buckets as handlers */
+    unsigned buckets = 1;
+    while (buckets < hd->config.max_uri_handlers) {
+        buckets <<= 1;
+    }
+    router->bucket_mask = buckets - 1;
+    router->root.routes = HTTPD_ROUTE_NONE;
+    router->routes = calloc(hd->config.max_uri_handlers, sizeof(struct httpd_uri_route));
+    router->buckets = malloc(buckets * sizeof(uint16_t));
+    if (router->routes == NULL || router->buckets == NULL) {
+        free(router->routes);
+        free(router->buckets);
+        free(router);
+        return ESP_ERR_NO_MEM;
+    }
+    for (unsigned i = 0; i < buckets; i++) {
+        router->buckets[i] = HTTPD_ROUTE_NONE;
+    }
+    hd->hd_router = router;
+    return ESP_OK;
+}
+
+void httpd_uri_router_deinit(struct httpd_data *hd)
+{
+    struct httpd_uri_router *router = hd->hd_router;
+    if (router == NULL) {
+        return;
+    }
+    httpd_uri_node_free_children(&router->root);
+    free(router->routes);
+    free(router->buckets);
+    free(router);
+    hd->hd_router = NULL;
+}
+
+/* Find handler with matching URI and method, and set
+ * appropriate error code if URI or method not found */
+static httpd_uri_t* httpd_find_uri_handler(struct httpd_data *hd,
+                                           const char *uri, size_t uri_len,
+                                           httpd_method_t method,
+                                           httpd_err_resp_t *err)
+{
+    if (!httpd_uri_router_enabled(hd)) {
+        return httpd_find_uri_handler_linear(hd, uri, uri_len, method, err);
+    }
+
+    struct httpd_uri_router *router = hd->hd_router;
+    uint16_t found = HTTPD_ROUTE_NONE;
+    bool uri_found = false;
+
+    /* Exact routes. The URI and method of each
+     * handler are unique, so the first match is the only one */
+    const uint32_t hash = httpd_uri_hash(uri, uri_len);
+    for (uint16_t i = router->buckets[hash & router->bucket_mask];
+         i != HTTPD_ROUTE_NONE; i = router->routes[i].next) {
+        if (router->routes[i].hash == hash &&
+            httpd_uri_match_simple(hd->hd_calls[i]->uri, uri, uri_len)) {
+            uri_found = true;
+            if (hd->hd_calls[i]->method == method) {
+                found = i;
+                break;
+            }
+        }
+    }
+
+    /* Wildcard routes, at the nodes along the path of the URI. Routes
+     * registered after the handler already found can be skipped */
+    if (httpd_uri_router_wildcard(hd)) {
+        const struct httpd_uri_node *node = &router->root;
+        const char *seg = uri;
+        const char *end;
+        while (node != NULL) {
+            for (uint16_t i = node->routes; i < found; i = router->routes[i].next) {
+                if (httpd_uri_match_wildcard(hd->hd_calls[i]->uri, uri, uri_len)) {
+                    uri_found = true;
+                    if (hd->hd_calls[i]->method == method) {
+                        found = i;
+                        break;
+                    }
+                }
+            }
+            end = memchr(seg, '/', uri + uri_len - seg);
+            if (end == NULL) {
+                break;
+            }
+            node = httpd_uri_node_child((struct httpd_uri_node *) node, seg, end + 1 - seg, false);
+            seg = end + 1;
+        }
+    }
+
+    if (found != HTTPD_ROUTE_NONE) {
+        ESP_LOGD(TAG, LOG_FMT("[%d] = %s"), found, hd->hd_calls[found]->uri);
+        if (err) {
+            *err = 0;
+        }
+        return hd->hd_calls[found];
+    }
+    if (err) {
+        /* URI found but method not allowed */
+        *err = uri_found ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND;
+    }
+    return NULL;
+}
+
 esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
                                      const httpd_uri_t *uri_handler)
 {
@@ -172,6 +468,14 @@ esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
             hd->hd_calls[i]->method   = uri_handler->method;
             hd->hd_calls[i]->handler  = uri_handler->handler;
             hd->hd_calls[i]->user_ctx = uri_handler->user_ctx;
+
+            if (httpd_uri_router_add(hd, i) != ESP_OK) {
+                /* Failed to allocate memory */
+                free((char*)hd->hd_calls[i]->uri);
+                free(hd->hd_calls[i]);
+                hd->hd_calls[i] = NULL;
+                return ESP_ERR_HTTPD_ALLOC_MEM;
+            }
             ESP_LOGD(TAG, LOG_FMT("[%d] installed %s"), i, uri_handler->uri);
             return ESP_OK;
         }
@@ -211,6 +515,7 @@ esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
             }
             /* Nullify the following non null entry */
             hd->hd_calls[i-1] = NULL;
+            httpd_uri_router_rebuild(hd);
             return ESP_OK;
         }
     }
@@ -251,6 +556,9 @@ esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char *uri)
     for (int k = (i - j); k < i; k++) {
         hd->hd_calls[k] = NULL;
     }
+    if (found) {
+        httpd_uri_router_rebuild(hd);
+    }
 
     if (!found) {
         ESP_LOGW(TAG, LOG_FMT("no handler found for URI %s"), uri);
@@ -270,13 +578,13 @@ void httpd_unregister_all_uri_handlers(struct httpd_data *hd)
         free(hd->hd_calls[i]);
         hd->hd_calls[i] = NULL;
     }
+    httpd_uri_router_rebuild(hd);
 }
 
-esp_err_t httpd_uri(struct httpd_data *hd)
+esp_err_t httpd_uri(struct httpd_data *hd, httpd_req_t *req)
 {
     httpd_uri_t            *uri = NULL;
-    httpd_req_t            *req = &hd->hd_req;
-    struct http_parser_url *res = &hd->hd_req_aux.url_parse_res;
+    struct http_parser_url *res = &((struct httpd_req_aux *)req->aux)->url_parse_res;
 
     /* For conveying URI not found/method not allowed */
     httpd_err_resp_t err = 0;
@@ -17,6 +17,7 @@
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
 #include <unistd.h>
 #include <stdint.h>
 #include <esp_timer.h>
@@ -29,6 +30,7 @@ extern "C" {
 #define OS_FAIL    ESP_FAIL
 
 typedef TaskHandle_t othread_t;
+typedef QueueHandle_t oqueue_t;
 
 static inline int httpd_os_thread_create(othread_t *thread,
                                  const char *name, uint16_t stacksize, int prio,
@@ -41,6 +43,18 @@ static inline int httpd_os_thread_create(othread_t *thread,
     return OS_FAIL;
 }
 
+static inline int httpd_os_thread_create_pinned(othread_t *thread,
+                                 const char *name, uint16_t stacksize, int prio,
+                                 void (*thread_routine)(void *arg), void *arg,
+                                 BaseType_t core_id)
+{
+    int ret = xTaskCreatePinnedToCore(thread_routine, name, stacksize, arg, prio, thread, core_id);
+    if (ret == pdPASS) {
+        return OS_SUCCESS;
+    }
+    return OS_FAIL;
+}
+
 /* Only self delete is supported */
 static inline void httpd_os_thread_delete()
 {
@@ -62,6 +76,34 @@ static inline othread_t httpd_os_thread_handle()
     return xTaskGetCurrentTaskHandle();
 }
 
+static inline oqueue_t httpd_os_queue_create(unsigned length, size_t item_size)
+{
+    return xQueueCreate(length, item_size);
+}
+
+static inline void httpd_os_queue_delete(oqueue_t queue)
+{
+    vQueueDelete(queue);
+}
+
+/* Blocks until there is space in the queue */
+static inline int httpd_os_queue_send(oqueue_t queue, const void *item)
+{
+    if (xQueueSend(queue, item, portMAX_DELAY) == pdTRUE) {
+        return OS_SUCCESS;
+    }
+    return OS_FAIL;
+}
+
+/* Blocks until an item is available */
+static inline int httpd_os_queue_recv(oqueue_t queue, void *item)
+{
+    if (xQueueReceive(queue, item, portMAX_DELAY) == pdTRUE) {
+        return OS_SUCCESS;
+    }
+    return OS_FAIL;
+}
+
 #ifdef __cplusplus
 }
 #endif
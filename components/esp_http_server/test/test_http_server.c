@@ -14,8 +14,19 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <esp_system.h>
+#include <esp_timer.h>
+#include <esp_log.h>
+#include <esp_spiffs.h>
 #include <esp_http_server.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 #include "unity.h"
 #include "test_utils.h"
@@ -232,3 +243,547 @@ TEST_CASE("URI Wildcard Matcher Tests", "[HTTP SERVER]")
         ut++;
     }
 }
+
+TEST_CASE("URI handlers registered with wildcards", "[HTTP SERVER]")
+{
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.uri_match_fn = httpd_uri_match_wildcard;
+
+    test_case_uses_tcpip();
+
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+
+    httpd_uri_t api = handler_limit_uri("/api/*");
+    httpd_uri_t status = handler_limit_uri("/api/v1/status");
+    httpd_uri_t optional = handler_limit_uri("/api/v1/statu?");
+    httpd_uri_t statu = handler_limit_uri("/api/v1/statu");
+    TEST_ASSERT(httpd_register_uri_handler(hd, &api) == ESP_OK);
+
+    /* URIs matched by a registered wildcard can't be registered for the same method */
+    TEST_ASSERT(httpd_register_uri_handler(hd, &status) == ESP_ERR_HTTPD_HANDLER_EXISTS);
+    status.method = HTTP_POST;
+    TEST_ASSERT(httpd_register_uri_handler(hd, &status) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &status) == ESP_ERR_HTTPD_HANDLER_EXISTS);
+
+    /* Once the wildcard is removed, they can */
+    TEST_ASSERT(httpd_unregister_uri(hd, "/api/*") == ESP_OK);
+    status.method = HTTP_GET;
+    TEST_ASSERT(httpd_register_uri_handler(hd, &status) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &optional) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &statu) == ESP_ERR_HTTPD_HANDLER_EXISTS);
+    TEST_ASSERT(httpd_unregister_uri_handler(hd, "/api/v1/statu?", HTTP_GET) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &statu) == ESP_OK);
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+
+#define URI_LOOKUP_TEST_HANDLERS    60
+#define URI_LOOKUP_TEST_ITERATIONS  1000
+
+TEST_CASE("URI handler lookup performance", "[HTTP SERVER]")
+{
+    static const char *resources[] = { "devices", "sensors", "config", "wifi", "users",
+                                       "files", "ota", "log", "status", "scenes" };
+    static const char *actions[] = { "list", "get", "set", "add", "remove", "stats" };
+    char (*paths)[32] = calloc(URI_LOOKUP_TEST_HANDLERS, 32);
+    TEST_ASSERT_NOT_NULL(paths);
+
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.max_uri_handlers = URI_LOOKUP_TEST_HANDLERS;
+    config.uri_match_fn = httpd_uri_match_wildcard;
+
+    test_case_uses_tcpip();
+
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    for (int i = 0; i < URI_LOOKUP_TEST_HANDLERS; i++) {
+        sprintf(paths[i], "/api/v1/%s/%s%s", resources[i % 10], actions[i / 10], (i % 10 == 9) ? "/*" : "");
+        httpd_uri_t uri = handler_limit_uri(paths[i]);
+        TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+    }
+
+    /* Registering a handler again looks up its URI like a request does */
+    esp_log_level_set("httpd_uri", ESP_LOG_ERROR);
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < URI_LOOKUP_TEST_ITERATIONS; i++) {
+        httpd_uri_t uri = handler_limit_uri(paths[i % URI_LOOKUP_TEST_HANDLERS]);
+        TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_ERR_HTTPD_HANDLER_EXISTS);
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    esp_log_level_set("httpd_uri", CONFIG_LOG_DEFAULT_LEVEL);
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+    free(paths);
+
+    int ns_per_lookup = elapsed * 1000 / URI_LOOKUP_TEST_ITERATIONS;
+    TEST_PERFORMANCE_LESS_THAN(HTTPD_URI_LOOKUP_TIME, "%d ns", ns_per_lookup);
+}
+
+/********************* Loopback Client *******************/
+
+/* Tests connecting to a server over loopback. Each of them has its own port,
+ * as a connection closed by the server keeps the port in TIME_WAIT for a while */
+enum {
+    TEST_PORT_SEND,
+    TEST_PORT_WORKER,
+    TEST_PORT_PARTITION,
+    TEST_PORT_KEEP_ALIVE,
+    TEST_PORT_FILE,
+};
+
+static httpd_config_t test_loopback_config(int test_port)
+{
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    /* After the ports used by test_httpd_start() */
+    config.server_port += SERVER_INSTANCES + test_port;
+    config.ctrl_port += SERVER_INSTANCES + test_port;
+    return config;
+}
+
+/* Connects to a server over loopback and sends 'req', if not NULL */
+static int test_http_connect(uint16_t port, const char *req)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT(fd >= 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+    };
+    inet_aton("127.0.0.1", &addr.sin_addr);
+    TEST_ASSERT(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+
+    /* Don't wait forever for a response which doesn't come */
+    struct timeval tv = { .tv_sec = 5 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    if (req) {
+        TEST_ASSERT(send(fd, req, strlen(req), 0) == strlen(req));
+    }
+    return fd;
+}
+
+/* Receives one response, i.e. its headers and as much content as they announce,
+ * or if 'until_close' is set, everything until the server closes the connection.
+ * Returns the length received into 'buf', which is NULL terminated */
+static size_t test_http_recv(int fd, char *buf, size_t buf_size, bool until_close)
+{
+    size_t len = 0;
+    size_t content_len = 0;
+    char *end = NULL;
+    while (until_close || end == NULL || len < (end + 4 - buf) + content_len) {
+        int ret = recv(fd, buf + len, buf_size - 1 - len, 0);
+        if (ret <= 0) {
+            TEST_ASSERT(until_close);
+            TEST_ASSERT_EQUAL(0, ret);
+            break;
+        }
+        len += ret;
+        buf[len] = '\0';
+        if (end == NULL && (end = strstr(buf, "\r\n\r\n")) != NULL) {
+            char *cl = strstr(buf, "Content-Length: ");
+            content_len = (cl && cl < end) ? atoi(cl + 16) : 0;
+        }
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+/* Content of a response received with test_http_recv() */
+static char *test_http_body(char *resp)
+{
+    char *end = strstr(resp, "\r\n\r\n");
+    TEST_ASSERT_NOT_NULL(end);
+    return end + 4;
+}
+
+/* Sends a GET request for 'uri' with the additional headers 'extra_hdrs', and receives
+ * the response into 'resp'. Returns the status code. 'body' is set to the content and
+ * 'body_len' to its length. The headers are NULL terminated after the last CRLF */
+static int test_http_get(uint16_t port, const char *uri, const char *extra_hdrs,
+                         char *resp, size_t resp_size, char **body, size_t *body_len)
+{
+    char req[160];
+    snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: localhost\r\n%s\r\n", uri, extra_hdrs);
+    int fd = test_http_connect(port, req);
+    size_t len = test_http_recv(fd, resp, resp_size, false);
+    close(fd);
+
+    *body = test_http_body(resp);
+    *body_len = len - (*body - resp);
+    (*body)[-2] = '\0';
+    return atoi(resp + 9);
+}
+
+/********************* Test Response Send Calls *******************/
+
+static int send_calls;
+
+static int test_counting_sendv(httpd_handle_t hd, int sockfd, const struct iovec *iov, int iovcnt)
+{
+    send_calls++;
+    return writev(sockfd, iov, iovcnt);
+}
+
+static esp_err_t test_send_open_fn(httpd_handle_t hd, int sockfd)
+{
+    return httpd_sess_set_sendv_override(hd, sockfd, test_counting_sendv);
+}
+
+static esp_err_t test_send_handler(httpd_req_t *req)
+{
+    httpd_resp_set_hdr(req, "X-One", "1");
+    httpd_resp_set_hdr(req, "X-Two", "2");
+    httpd_resp_set_hdr(req, "X-Three", "3");
+    httpd_resp_set_hdr(req, "X-Four", "4");
+    httpd_resp_set_hdr(req, "X-Five", "5");
+    return httpd_resp_send(req, "hello", HTTPD_RESP_USE_STRLEN);
+}
+
+TEST_CASE("Response headers and content are sent together", "[HTTP SERVER]")
+{
+    const char *expected = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: 5\r\n"
+                           "X-One: 1\r\nX-Two: 2\r\nX-Three: 3\r\nX-Four: 4\r\nX-Five: 5\r\n\r\nhello";
+    httpd_uri_t uri = {
+        .uri      = "/send",
+        .method   = HTTP_GET,
+        .handler  = test_send_handler,
+        .user_ctx = NULL,
+    };
+    httpd_handle_t hd;
+    httpd_config_t config = test_loopback_config(TEST_PORT_SEND);
+    config.open_fn = test_send_open_fn;
+
+    test_case_uses_tcpip();
+
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+
+    char resp[256];
+    send_calls = 0;
+    int fd = test_http_connect(config.server_port, "GET /send HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    test_http_recv(fd, resp, sizeof(resp), false);
+    close(fd);
+    TEST_ASSERT_EQUAL_STRING(expected, resp);
+    TEST_ASSERT_EQUAL(1, send_calls);
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+
+/********************* Test Worker Tasks *******************/
+
+static SemaphoreHandle_t slow_handler_release;
+
+static esp_err_t test_slow_handler(httpd_req_t *req)
+{
+    /* Blocks one worker until the fast request has been answered */
+    xSemaphoreTake(slow_handler_release, portMAX_DELAY);
+    return httpd_resp_send(req, "slow", HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t test_fast_handler(httpd_req_t *req)
+{
+    return httpd_resp_send(req, "fast", HTTPD_RESP_USE_STRLEN);
+}
+
+TEST_CASE("Slow handlers don't block requests on other sessions", "[HTTP SERVER]")
+{
+    httpd_uri_t uris[] = {
+        { .uri = "/slow", .method = HTTP_GET, .handler = test_slow_handler },
+        { .uri = "/fast", .method = HTTP_GET, .handler = test_fast_handler },
+    };
+    httpd_handle_t hd;
+    httpd_config_t config = test_loopback_config(TEST_PORT_WORKER);
+    config.worker_count = 2;
+
+    test_case_uses_tcpip();
+    slow_handler_release = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(slow_handler_release);
+
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    for (int i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        TEST_ASSERT(httpd_register_uri_handler(hd, &uris[i]) == ESP_OK);
+    }
+
+    char resp[128];
+    int slow_fd = test_http_connect(config.server_port, "GET /slow HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    vTaskDelay(100 / portTICK_PERIOD_MS);
+    int fast_fd = test_http_connect(config.server_port, "GET /fast HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    test_http_recv(fast_fd, resp, sizeof(resp), false);
+    close(fast_fd);
+    TEST_ASSERT_EQUAL_STRING("fast", test_http_body(resp));
+
+    xSemaphoreGive(slow_handler_release);
+    test_http_recv(slow_fd, resp, sizeof(resp), false);
+    close(slow_fd);
+    TEST_ASSERT_EQUAL_STRING("slow", test_http_body(resp));
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+    vSemaphoreDelete(slow_handler_release);
+}
+
+/********************* Test Partition Content *******************/
+
+/* Spans an MMU page boundary */
+#define PARTITION_TEST_OFFSET   0xF000
+#define PARTITION_TEST_SIZE     0x3000
+
+static esp_err_t test_partition_handler(httpd_req_t *req)
+{
+    return httpd_resp_send_partition(req, get_test_data_partition(), PARTITION_TEST_OFFSET,
+                                     PARTITION_TEST_SIZE, "\"test\"");
+}
+
+TEST_CASE("Content is sent from a flash partition", "[HTTP SERVER]")
+{
+    const esp_partition_t *part = get_test_data_partition();
+    char *data = malloc(PARTITION_TEST_SIZE);
+    char *resp = malloc(PARTITION_TEST_SIZE + 512);
+    TEST_ASSERT_NOT_NULL(data);
+    TEST_ASSERT_NOT_NULL(resp);
+    for (int i = 0; i < PARTITION_TEST_SIZE; i++) {
+        data[i] = i * 7 + (i >> 8);
+    }
+    TEST_ESP_OK(esp_partition_erase_range(part, PARTITION_TEST_OFFSET & ~0xFFF, 0x4000));
+    TEST_ESP_OK(esp_partition_write(part, PARTITION_TEST_OFFSET, data, PARTITION_TEST_SIZE));
+
+    httpd_uri_t uri = {
+        .uri      = "/part",
+        .method   = HTTP_GET,
+        .handler  = test_partition_handler,
+        .user_ctx = NULL,
+    };
+    httpd_handle_t hd;
+    httpd_config_t config = test_loopback_config(TEST_PORT_PARTITION);
+    uint16_t port = config.server_port;
+
+    test_case_uses_tcpip();
+
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+
+    const size_t resp_size = PARTITION_TEST_SIZE + 512;
+    char *body;
+    size_t len;
+    TEST_ASSERT_EQUAL(200, test_http_get(port, "/part", "", resp, resp_size, &body, &len));
+    TEST_ASSERT_EQUAL(PARTITION_TEST_SIZE, len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data, body, PARTITION_TEST_SIZE);
+
+    TEST_ASSERT_EQUAL(206, test_http_get(port, "/part", "Range: bytes=4000-4999\r\n",
+                                         resp, resp_size, &body, &len));
+    TEST_ASSERT_EQUAL(1000, len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data + 4000, body, 1000);
+
+    TEST_ASSERT_EQUAL(416, test_http_get(port, "/part", "Range: bytes=20000-\r\n",
+                                         resp, resp_size, &body, &len));
+    TEST_ASSERT_EQUAL(0, len);
+
+    TEST_ASSERT_EQUAL(304, test_http_get(port, "/part", "If-None-Match: \"test\"\r\n",
+                                         resp, resp_size, &body, &len));
+    TEST_ASSERT_EQUAL(0, len);
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+    free(resp);
+    free(data);
+}
+
+/********************* Test File Content *******************/
+
+#define FILE_TEST_PATH          "/spiffs/page.txt"
+/* More than the buffer the file is read into */
+#define FILE_TEST_SIZE          3000
+#define FILE_TEST_GZ_SIZE       1000
+
+static esp_err_t test_file_handler(httpd_req_t *req)
+{
+    esp_err_t err = httpd_resp_send_file(req, (const char *) req->user_ctx);
+    if (err == ESP_ERR_NOT_FOUND) {
+        return httpd_resp_send_404(req);
+    }
+    return err;
+}
+
+static void test_file_write(const char *path, const char *data, size_t size)
+{
+    FILE *f = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL(size, fwrite(data, 1, size, f));
+    TEST_ASSERT_EQUAL(0, fclose(f));
+}
+
+/* Checks if the headers of a response received with test_http_get() include 'hdr' */
+static bool test_http_has_hdr(const char *resp, const char *hdr)
+{
+    const char *p = strstr(resp, hdr);
+    return p && p[-1] == '\n' && strncmp(p + strlen(hdr), "\r\n", 2) == 0;
+}
+
+TEST_CASE("Content is sent from a file", "[HTTP SERVER]")
+{
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = "/spiffs",
+        .partition_label = get_test_data_partition()->label,
+        .max_files = 5,
+        .format_if_mount_failed = true,
+    };
+    TEST_ESP_OK(esp_vfs_spiffs_register(&conf));
+    TEST_ESP_OK(esp_spiffs_format(conf.partition_label));
+
+    /* The precompressed variant only needs to differ from the file */
+    char *data = malloc(FILE_TEST_SIZE);
+    char *resp = malloc(FILE_TEST_SIZE + 512);
+    TEST_ASSERT_NOT_NULL(data);
+    TEST_ASSERT_NOT_NULL(resp);
+    for (int i = 0; i < FILE_TEST_SIZE; i++) {
+        data[i] = 'a' + i % 26;
+    }
+    test_file_write(FILE_TEST_PATH, data, FILE_TEST_SIZE);
+    test_file_write(FILE_TEST_PATH ".gz", data + 1, FILE_TEST_GZ_SIZE);
+
+    struct stat st;
+    char etag[48], gz_etag[48];
+    TEST_ASSERT_EQUAL(0, stat(FILE_TEST_PATH, &st));
+    snprintf(etag, sizeof(etag), "ETag: \"%lx-%lx\"", (unsigned long) st.st_mtime,
+             (unsigned long) st.st_size);
+    TEST_ASSERT_EQUAL(0, stat(FILE_TEST_PATH ".gz", &st));
+    snprintf(gz_etag, sizeof(gz_etag), "ETag: \"%lx-%lxz\"", (unsigned long) st.st_mtime,
+             (unsigned long) st.st_size);
+
+    httpd_uri_t uris[] = {
+        { .uri = "/page", .method = HTTP_GET, .handler = test_file_handler, .user_ctx = FILE_TEST_PATH },
+        { .uri = "/missing", .method = HTTP_GET, .handler = test_file_handler, .user_ctx = "/spiffs/missing" },
+    };
+    httpd_handle_t hd;
+    httpd_config_t config = test_loopback_config(TEST_PORT_FILE);
+    uint16_t port = config.server_port;
+
+    test_case_uses_tcpip();
+
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    for (int i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        TEST_ASSERT(httpd_register_uri_handler(hd, &uris[i]) == ESP_OK);
+    }
+
+    const size_t resp_size = FILE_TEST_SIZE + 512;
+    char *body;
+    size_t len;
+
+    /* The file itself, to a client which doesn't accept gzip */
+    TEST_ASSERT_EQUAL(200, test_http_get(port, "/page", "", resp, resp_size, &body, &len));
+    TEST_ASSERT_EQUAL(FILE_TEST_SIZE, len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data, body, FILE_TEST_SIZE);
+    TEST_ASSERT(test_http_has_hdr(resp, etag));
+    TEST_ASSERT(test_http_has_hdr(resp, "Vary: Accept-Encoding"));
+    TEST_ASSERT_NULL(strstr(resp, "Content-Encoding"));
+
+    /* The precompressed variant, to a client which accepts gzip */
+    TEST_ASSERT_EQUAL(200, test_http_get(port, "/page", "Accept-Encoding: deflate, gzip\r\n",
+                                         resp, resp_size, &body, &len));
+    TEST_ASSERT_EQUAL(FILE_TEST_GZ_SIZE, len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data + 1, body, FILE_TEST_GZ_SIZE);
+    TEST_ASSERT(test_http_has_hdr(resp, gz_etag));
+    TEST_ASSERT(test_http_has_hdr(resp, "Content-Encoding: gzip"));
+
+    /* gzip with a quality of 0 is refused */
+    TEST_ASSERT_EQUAL(200, test_http_get(port, "/page", "Accept-Encoding: gzip;q=0, deflate\r\n",
+                                         resp, resp_size, &body, &len));
+    TEST_ASSERT_EQUAL(FILE_TEST_SIZE, len);
+    TEST_ASSERT_NULL(strstr(resp, "Content-Encoding"));
+
+    /* Conditional request with the entity tag of the file */
+    char hdr[64];
+    snprintf(hdr, sizeof(hdr), "If-None-Match: %s\r\n", etag + strlen("ETag: "));
+    TEST_ASSERT_EQUAL(304, test_http_get(port, "/page", hdr, resp, resp_size, &body, &len));
+    TEST_ASSERT_EQUAL(0, len);
+    TEST_ASSERT(test_http_has_hdr(resp, etag));
+
+    /* Ranges crossing the read buffer boundary, and at the end of the file */
+    TEST_ASSERT_EQUAL(206, test_http_get(port, "/page", "Range: bytes=2000-2999\r\n",
+                                         resp, resp_size, &body, &len));
+    TEST_ASSERT_EQUAL(1000, len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data + 2000, body, 1000);
+    TEST_ASSERT(test_http_has_hdr(resp, "Content-Range: bytes 2000-2999/3000"));
+
+    TEST_ASSERT_EQUAL(206, test_http_get(port, "/page", "Range: bytes=-100\r\n",
+                                         resp, resp_size, &body, &len));
+    TEST_ASSERT_EQUAL(100, len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data + FILE_TEST_SIZE - 100, body, 100);
+
+    /* A range of a file which has changed since the client got If-Range */
+    TEST_ASSERT_EQUAL(200, test_http_get(port, "/page", "Range: bytes=2000-2999\r\nIf-Range: \"0-0\"\r\n",
+                                         resp, resp_size, &body, &len));
+    TEST_ASSERT_EQUAL(FILE_TEST_SIZE, len);
+
+    TEST_ASSERT_EQUAL(404, test_http_get(port, "/missing", "", resp, resp_size, &body, &len));
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+    free(resp);
+    free(data);
+    TEST_ESP_OK(esp_vfs_spiffs_unregister(conf.partition_label));
+}
+
+/********************* Test Persistent Connections *******************/
+
+#define KEEP_ALIVE_TEST_MAX_REQ 3
+
+static int test_count_str(const char *buf, const char *str)
+{
+    int count = 0;
+    while ((buf = strstr(buf, str)) != NULL) {
+        count++;
+        buf++;
+    }
+    return count;
+}
+
+TEST_CASE("Persistent connections are pipelined, limited and closed when idle", "[HTTP SERVER]")
+{
+    httpd_uri_t uri = {
+        .uri      = "/fast",
+        .method   = HTTP_GET,
+        .handler  = test_fast_handler,
+        .user_ctx = NULL,
+    };
+    httpd_handle_t hd;
+    httpd_config_t config = test_loopback_config(TEST_PORT_KEEP_ALIVE);
+    config.keep_alive_idle_timeout = 1;
+    config.keep_alive_max_requests = KEEP_ALIVE_TEST_MAX_REQ;
+
+    test_case_uses_tcpip();
+
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+
+    /* All requests allowed on a connection are sent at once. They are all
+     * answered without waiting for further data, the last one with
+     * "Connection: close" */
+    const char *req = "GET /fast HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    char buf[1024] = "";
+    for (int i = 0; i < KEEP_ALIVE_TEST_MAX_REQ; i++) {
+        strcat(buf, req);
+    }
+    int fd = test_http_connect(config.server_port, buf);
+    test_http_recv(fd, buf, sizeof(buf), true);
+    close(fd);
+    TEST_ASSERT_EQUAL(KEEP_ALIVE_TEST_MAX_REQ, test_count_str(buf, "\r\n\r\nfast"));
+    TEST_ASSERT_EQUAL(1, test_count_str(buf, "Connection: close"));
+
+    /* The client asks for the connection to be closed */
+    fd = test_http_connect(config.server_port,
+                           "GET /fast HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+    test_http_recv(fd, buf, sizeof(buf), true);
+    close(fd);
+    TEST_ASSERT_EQUAL(1, test_count_str(buf, "Connection: close"));
+
+    /* An idle connection is closed by the server after the timeout */
+    fd = test_http_connect(config.server_port, req);
+    int64_t start = esp_timer_get_time();
+    test_http_recv(fd, buf, sizeof(buf), true);
+    int64_t idle_time = esp_timer_get_time() - start;
+    close(fd);
+    TEST_ASSERT_EQUAL(1, test_count_str(buf, "\r\n\r\nfast"));
+    TEST_ASSERT_EQUAL(0, test_count_str(buf, "Connection: close"));
+    TEST_ASSERT_INT_WITHIN(500, 1000, idle_time / 1000);
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
@@ -95,6 +95,12 @@ typedef struct httpd_ssl_config httpd_ssl_config_t;
         .global_transport_ctx_free_fn = NULL,     \
         .open_fn = NULL,                          \
         .close_fn = NULL,                         \
+        .worker_count       = 0,                  \
+        .worker_stack_size  = 10240,              \
+        .worker_priority    = tskIDLE_PRIORITY+5, \
+        .worker_core_id     = tskNO_AFFINITY,     \
+        .keep_alive_idle_timeout = 0,             \
+        .keep_alive_max_requests = 0,             \
     },                                            \
     .cacert_pem = NULL,                           \
     .cacert_len = 0,                              \
@@ -52,9 +52,29 @@ typedef enum {
 	 * sequence of byte and any number of bytes can be sent or retrieved each
 	 * time.
 	 */
-	RINGBUF_TYPE_BYTEBUF
+	RINGBUF_TYPE_BYTEBUF,
+	/**
+	 * Single-producer/single-consumer buffers store items like no-split
+	 * buffers, but items may only ever be sent by one task (or ISR) and
+	 * retrieved/returned by one other task (or ISR). Sending and receiving
+	 * do not take any locks and do not use semaphores. A task that blocks
+	 * on a full or empty buffer waits on its direct-to-task notification,
+	 * which must therefore not be used for other purposes by the sending
+	 * and receiving tasks. Items must be received with xRingbufferReceive()
+	 * or xRingbufferReceiveFromISR(), and the ring buffer cannot be added to
+	 * a queue set.
+	 */
+	RINGBUF_TYPE_SPSC
 } ringbuf_type_t;
 
+/**
+ * Item retrieved from a no-split ring buffer by uxRingbufferReceiveMultiple()
+ */
+typedef struct {
+	void *pvItem;       /**< Pointer to the retrieved item */
+	size_t xItemSize;   /**< Size of the retrieved item */
+} RingbufItem_t;
+
 /**
  * @brief       Create a ring buffer
  *
@@ -125,6 +145,44 @@ BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer, const void *pvItem, size
  */
 BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer, const void *pvItem, size_t xItemSize, BaseType_t *pxHigherPriorityTaskWoken);
 
+/**
+ * @brief       Acquire space in the ring buffer for an item to be written in place
+ *
+ * Attempt to reserve space for an item in the ring buffer. This function will
+ * block until enough free space is available or until it timesout. The caller
+ * writes the item directly into the returned memory and then calls
+ * xRingbufferSendComplete() to make it available to readers. Multiple items
+ * can be acquired at the same time and completed in any order, but readers
+ * will only retrieve an item once every item acquired or sent before it has
+ * been completed.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to acquire the item from
+ * @param[out]  ppvItem         Double pointer to the memory reserved for the item. Set to NULL on failure.
+ * @param[in]   xItemSize       Size of the item to reserve.
+ * @param[in]   xTicksToWait    Ticks to wait for room in the ring buffer.
+ *
+ * @note    Only applicable to no-split ring buffers.
+ * @note    Every acquired item must be completed, otherwise items sent after
+ *          it can never be retrieved.
+ *
+ * @return
+ *      - pdTRUE if succeeded
+ *      - pdFALSE on time-out or when the item is larger than the maximum permissible size of the buffer
+ */
+BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, size_t xItemSize, TickType_t xTicksToWait);
+
+/**
+ * @brief       Complete an item previously acquired by xRingbufferSendAcquire()
+ *
+ * @param[in]   xRingbuffer     Ring buffer the item was acquired from
+ * @param[in]   pvItem          Pointer to the item returned by xRingbufferSendAcquire()
+ *
+ * @note    Only applicable to no-split ring buffers.
+ *
+ * @return  pdTRUE once the item has been completed
+ */
+BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem);
+
 /**
  * @brief   Retrieve an item from the ring buffer
  *
@@ -255,6 +313,45 @@ void *xRingbufferReceiveUpTo(RingbufHandle_t xRingbuffer, size_t *pxItemSize, Ti
  */
 void *xRingbufferReceiveUpToFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize, size_t xMaxSize);
 
+/**
+ * @brief   Retrieve multiple items from a no-split ring buffer
+ *
+ * Attempt to retrieve up to uxMaxItems items from a no-split ring buffer in a
+ * single call. This function will block until at least one item is available
+ * or until it timesout, and then retrieves every item that is available up to
+ * uxMaxItems without blocking again.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the items from
+ * @param[out]  pxItems         Array to which the retrieved items will be written, in FIFO order
+ * @param[in]   uxMaxItems      Maximum number of items to retrieve (length of pxItems)
+ * @param[in]   xTicksToWait    Ticks to wait for items in the ring buffer.
+ *
+ * @note    The retrieved items can be returned in a single call to vRingbufferReturnMultiple()
+ *          or individually with vRingbufferReturnItem().
+ * @note    This function should only be called on no-split buffers
+ *
+ * @return  Number of items retrieved, 0 on time-out
+ */
+UBaseType_t uxRingbufferReceiveMultiple(RingbufHandle_t xRingbuffer, RingbufItem_t *pxItems, UBaseType_t uxMaxItems, TickType_t xTicksToWait);
+
+/**
+ * @brief   Retrieve multiple items from a no-split ring buffer in an ISR
+ *
+ * Attempt to retrieve up to uxMaxItems items from a no-split ring buffer. This
+ * function returns immediately if there are no items available for retrieval.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the items from
+ * @param[out]  pxItems         Array to which the retrieved items will be written, in FIFO order
+ * @param[in]   uxMaxItems      Maximum number of items to retrieve (length of pxItems)
+ *
+ * @note    The retrieved items can be returned in a single call to vRingbufferReturnMultipleFromISR()
+ *          or individually with vRingbufferReturnItemFromISR().
+ * @note    This function should only be called on no-split buffers
+ *
+ * @return  Number of items retrieved
+ */
+UBaseType_t uxRingbufferReceiveMultipleFromISR(RingbufHandle_t xRingbuffer, RingbufItem_t *pxItems, UBaseType_t uxMaxItems);
+
 /**
  * @brief   Return a previously-retrieved item to the ring buffer
  *
@@ -277,6 +374,30 @@ void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem);
  */
 void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, BaseType_t *pxHigherPriorityTaskWoken);
 
+/**
+ * @brief   Return multiple previously-retrieved items to a no-split ring buffer
+ *
+ * @param[in]   xRingbuffer Ring buffer the items were retrieved from
+ * @param[in]   pxItems     Items that were received earlier, e.g. by uxRingbufferReceiveMultiple()
+ * @param[in]   uxItems     Number of items in pxItems
+ *
+ * @note    This function should only be called on no-split buffers
+ */
+void vRingbufferReturnMultiple(RingbufHandle_t xRingbuffer, const RingbufItem_t *pxItems, UBaseType_t uxItems);
+
+/**
+ * @brief   Return multiple previously-retrieved items to a no-split ring buffer from an ISR
+ *
+ * @param[in]   xRingbuffer Ring buffer the items were retrieved from
+ * @param[in]   pxItems     Items that were received earlier, e.g. by uxRingbufferReceiveMultipleFromISR()
+ * @param[in]   uxItems     Number of items in pxItems
+ * @param[out]  pxHigherPriorityTaskWoken   Value pointed to will be set to pdTRUE
+ *                                          if the function woke up a higher priority task.
+ *
+ * @note    This function should only be called on no-split buffers
+ */
+void vRingbufferReturnMultipleFromISR(RingbufHandle_t xRingbuffer, const RingbufItem_t *pxItems, UBaseType_t uxItems, BaseType_t *pxHigherPriorityTaskWoken);
+
 /**
  * @brief   Delete a ring buffer
  *
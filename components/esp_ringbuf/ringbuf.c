@@ -27,11 +27,13 @@
 #define rbALLOW_SPLIT_FLAG          ( ( UBaseType_t ) 1 )   //The ring buffer allows items to be split
 #define rbBYTE_BUFFER_FLAG          ( ( UBaseType_t ) 2 )   //The ring buffer is a byte buffer
 #define rbBUFFER_FULL_FLAG          ( ( UBaseType_t ) 4 )   //The ring buffer is currently full (write pointer == free pointer)
+#define rbSPSC_FLAG                 ( ( UBaseType_t ) 8 )   //The ring buffer is a single-producer/single-consumer no-split buffer
 
 //Item flags
 #define rbITEM_FREE_FLAG            ( ( UBaseType_t ) 1 )   //Item has been retrieved and returned by application, free to overwrite
 #define rbITEM_DUMMY_DATA_FLAG      ( ( UBaseType_t ) 2 )   //Data from here to end of the ring buffer is dummy data. Restart reading at start of head of the buffer
 #define rbITEM_SPLIT_FLAG           ( ( UBaseType_t ) 4 )   //Valid for RINGBUF_TYPE_ALLOWSPLIT, indicating that rest of the data is wrapped around
+#define rbITEM_ACQUIRED_FLAG        ( ( UBaseType_t ) 8 )   //Valid for RINGBUF_TYPE_NOSPLIT, space has been acquired but the sender has not yet completed the item
 
 typedef struct {
     //This size of this structure must be 32-bit aligned
@@ -69,8 +71,27 @@ struct Ringbuffer_t {
     SemaphoreHandle_t xFreeSpaceSemaphore;      //Binary semaphore, wakes up writing threads when more free space becomes available or when another thread times out attempting to write
     SemaphoreHandle_t xItemsBufferedSemaphore;  //Binary semaphore, indicates there are new packets in the circular buffer. See remark.
     portMUX_TYPE mux;                           //Spinlock required for SMP
+
+    TaskHandle_t xSpscSendTask;                 //SPSC buffers only. Sending task blocked waiting for free space
+    TaskHandle_t xSpscReceiveTask;              //SPSC buffers only. Receiving task blocked waiting for an item
+    UBaseType_t uxSpscItemsSent;                //SPSC buffers only. Number of items sent, only modified by the sender
+    UBaseType_t uxSpscItemsReceived;            //SPSC buffers only. Number of items received, only modified by the receiver
 };
 
+/*
+Remark: SPSC buffers do not use the spinlock or the semaphores. The sender only
+modifies pucWrite and the receiver only modifies pucRead and pucFree, each
+publishing its pointer with release semantics and loading the other side's
+pointer with acquire semantics. As the full flag cannot be shared without a
+lock, an item is never allowed to advance pucWrite onto pucFree, so
+pucWrite == pucFree always means the buffer is empty. A task that has to block
+registers itself in xSpscSendTask/xSpscReceiveTask and waits for a task
+notification from the other side. The registration is claimed with an atomic
+exchange by whichever of the two tasks gets to it first: the notifying side
+then sends exactly one notification, which the waiting task consumes before it
+returns even if it no longer needs it.
+*/
+
 /*
 Remark: A counting semaphore for items_buffered_sem would be more logical, but counting semaphores in
 FreeRTOS need a maximum count, and allocate more memory the larger the maximum count is. Here, we
@@ -97,6 +118,9 @@ static BaseType_t prvCheckItemFitsDefault( Ringbuffer_t *pxRingbuffer, size_t xI
 //Checks if an item will currently fit in a byte buffer
 static BaseType_t prvCheckItemFitsByteBuffer( Ringbuffer_t *pxRingbuffer, size_t xItemSize);
 
+//Reserves space for an item in a no-split ring buffer and returns a pointer to its data. Only call this function after calling prvCheckItemFitsDefault()
+static uint8_t *prvAcquireItemNoSplit(Ringbuffer_t *pxRingbuffer, size_t xItemSize);
+
 //Copies an item to a no-split ring buffer. Only call this function after calling prvCheckItemFitsDefault()
 static void prvCopyItemNoSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize);
 
@@ -112,6 +136,12 @@ static void *prvGetItemDefault(Ringbuffer_t *pxRingbuffer, BaseType_t *pxIsSplit
 //Retrieve data from byte buffer. If xMaxSize is 0, all continuous data is retrieved
 static void *prvGetItemByteBuf(Ringbuffer_t *pxRingbuffer, BaseType_t *pxUnusedParam ,size_t xMaxSize,  size_t *pxItemSize);
 
+//Mark an item of a split/no-split ring buffer as free without advancing the free pointer
+static void prvMarkItemFreeDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
+
+//Advance the free pointer of a split/no-split ring buffer past all items that have been marked as free
+static void prvAdvanceFreeDefault(Ringbuffer_t *pxRingbuffer);
+
 //Return an item to a split/no-split ring buffer
 static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
 
@@ -138,6 +168,39 @@ static BaseType_t prvReceiveGeneric(Ringbuffer_t *pxRingbuffer, void **pvItem1,
 //Generic function used to retrieve an item/data from ring buffers in an ISR
 static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer, void **pvItem1, void **pvItem2, size_t *xItemSize1, size_t *xItemSize2, size_t xMaxSize);
 
+//Retrieve up to uxMaxItems items from a no-split ring buffer. Returns the number of items retrieved
+static UBaseType_t prvGetItemMultiple(Ringbuffer_t *pxRingbuffer, RingbufItem_t *pxItems, UBaseType_t uxMaxItems);
+
+/*
+ * The following SPSC functions are thread safe as long as the sender and
+ * receiver functions are each only ever called by a single task/ISR. They must
+ * not be called within a critical section.
+ */
+
+//Copies an item to an SPSC buffer if it currently fits. Only call this function from the sender
+static BaseType_t prvCopyItemSpsc(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize);
+
+//Retrieve an item from an SPSC buffer, or NULL if the buffer is empty. Only call this function from the receiver
+static void *prvGetItemSpsc(Ringbuffer_t *pxRingbuffer, size_t *pxItemSize);
+
+//Return an item to an SPSC buffer. Only call this function from the receiver
+static void prvReturnItemSpsc(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
+
+//Get the maximum size an item that can currently have if sent to an SPSC buffer
+static size_t prvGetCurMaxSizeSpsc(Ringbuffer_t *pxRingbuffer);
+
+//Notify the task registered in *pxTask (if any) that the other side of an SPSC buffer has made progress
+static void prvNotifySpsc(TaskHandle_t *pxTask, BaseType_t xInISR, BaseType_t *pxHigherPriorityTaskWoken);
+
+//Remove the calling task's registration from *pxTask, consuming the notification of a task that claimed it first
+static void prvUnregisterSpsc(TaskHandle_t *pxTask, uint32_t ulNotified);
+
+//Send an item to an SPSC buffer, blocking on a task notification until it fits or times out
+static BaseType_t prvSendSpsc(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize, TickType_t xTicksToWait);
+
+//Retrieve an item from an SPSC buffer, blocking on a task notification until one is available or times out
+static void *prvReceiveSpsc(Ringbuffer_t *pxRingbuffer, size_t *pxItemSize, TickType_t xTicksToWait);
+
 /* ------------------------------------------------ Static Definitions ------------------------------------------- */
 
 static size_t prvGetFreeSize(Ringbuffer_t *pxRingbuffer)
@@ -202,7 +265,7 @@ static BaseType_t prvCheckItemFitsByteBuffer( Ringbuffer_t *pxRingbuffer, size_t
     return (xItemSize <= pxRingbuffer->xSize - (pxRingbuffer->pucWrite - pxRingbuffer->pucFree)) ? pdTRUE : pdFALSE;
 }
 
-static void prvCopyItemNoSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
+static uint8_t *prvAcquireItemNoSplit(Ringbuffer_t *pxRingbuffer, size_t xItemSize)
 {
     //Check arguments and buffer state
     size_t xAlignedItemSize = rbALIGN_SIZE(xItemSize);                  //Rounded up aligned item size
@@ -219,13 +282,12 @@ static void prvCopyItemNoSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucIte
         pxRingbuffer->pucWrite = pxRingbuffer->pucHead;     //Reset write pointer to wrap around
     }
 
-    //Item should be guaranteed to fit at this point. Set item header and copy data
+    //Item should be guaranteed to fit at this point. Set item header and reserve space for data
     ItemHeader_t *pxHeader = (ItemHeader_t *)pxRingbuffer->pucWrite;
     pxHeader->xItemLen = xItemSize;
     pxHeader->uxItemFlags = 0;
     pxRingbuffer->pucWrite += rbHEADER_SIZE;    //Advance pucWrite past header
-    memcpy(pxRingbuffer->pucWrite, pucItem, xItemSize);
-    pxRingbuffer->xItemsWaiting++;
+    uint8_t *pucData = pxRingbuffer->pucWrite;
     pxRingbuffer->pucWrite += xAlignedItemSize; //Advance pucWrite past item to next aligned address
 
     //If current remaining length can't fit a header, wrap around write pointer
@@ -237,6 +299,14 @@ static void prvCopyItemNoSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucIte
         //Mark the buffer as full to distinguish with an empty buffer
         pxRingbuffer->uxRingbufferFlags |= rbBUFFER_FULL_FLAG;
     }
+    return pucData;
+}
+
+static void prvCopyItemNoSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
+{
+    uint8_t *pucData = prvAcquireItemNoSplit(pxRingbuffer, xItemSize);
+    memcpy(pucData, pucItem, xItemSize);
+    pxRingbuffer->xItemsWaiting++;
 }
 
 static void prvCopyItemAllowSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
@@ -327,6 +397,16 @@ static BaseType_t prvCheckItemAvail(Ringbuffer_t *pxRingbuffer)
         return pdFALSE;     //Byte buffers do not allow multiple retrievals before return
     }
     if ((pxRingbuffer->xItemsWaiting > 0) && ((pxRingbuffer->pucRead != pxRingbuffer->pucWrite) || (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG))) {
+        if (!(pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG)) {
+            //Items completed out of order only become available once every item before them is completed
+            ItemHeader_t *pxHeader = (ItemHeader_t *)pxRingbuffer->pucRead;
+            if (pxHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+                pxHeader = (ItemHeader_t *)pxRingbuffer->pucHead;
+            }
+            if (pxHeader->uxItemFlags & rbITEM_ACQUIRED_FLAG) {
+                return pdFALSE;     //Next item is still being written by its sender
+            }
+        }
         return pdTRUE;      //Items/data available for retrieval
     } else {
         return pdFALSE;     //No items/data available for retrieval
@@ -409,7 +489,7 @@ static void *prvGetItemByteBuf(Ringbuffer_t *pxRingbuffer, BaseType_t *pxUnusedP
     return (void *)ret;
 }
 
-static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+static void prvMarkItemFreeDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
 {
     //Check arguments and buffer state
     configASSERT(rbCHECK_ALIGNED(pucItem));
@@ -423,14 +503,17 @@ static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
     configASSERT((pxCurHeader->uxItemFlags & rbITEM_FREE_FLAG) == 0);       //Indicates item has already been returned before
     pxCurHeader->uxItemFlags &= ~rbITEM_SPLIT_FLAG;                         //Clear wrap flag if set (not strictly necessary)
     pxCurHeader->uxItemFlags |= rbITEM_FREE_FLAG;                           //Mark as free
+}
 
+static void prvAdvanceFreeDefault(Ringbuffer_t *pxRingbuffer)
+{
     /*
      * Items might not be returned in the order they were retrieved. Move the free pointer
      * up to the next item that has not been marked as free (by free flag) or up
      * till the read pointer. When advancing the free pointer, items that have already been
      * freed or items with dummy data should be skipped over
      */
-    pxCurHeader = (ItemHeader_t *)pxRingbuffer->pucFree;
+    ItemHeader_t *pxCurHeader = (ItemHeader_t *)pxRingbuffer->pucFree;
     //Skip over Items that have already been freed or are dummy items
     while (((pxCurHeader->uxItemFlags & rbITEM_FREE_FLAG) || (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG)) && pxRingbuffer->pucFree != pxRingbuffer->pucRead) {
         if (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
@@ -461,6 +544,12 @@ static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
     }
 }
 
+static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    prvMarkItemFreeDefault(pxRingbuffer, pucItem);
+    prvAdvanceFreeDefault(pxRingbuffer);
+}
+
 static void prvReturnItemByteBuf(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
 {
     //Check pointer points to address inside buffer
@@ -552,6 +641,223 @@ static size_t prvGetCurMaxSizeByteBuf(Ringbuffer_t *pxRingbuffer)
     return xFreeSize;
 }
 
+static UBaseType_t prvGetItemMultiple(Ringbuffer_t *pxRingbuffer, RingbufItem_t *pxItems, UBaseType_t uxMaxItems)
+{
+    UBaseType_t uxCount = 0;
+    //Retrieve items until uxMaxItems is reached or no more items are available
+    while (uxCount < uxMaxItems && prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+        BaseType_t xIsSplit;
+        pxItems[uxCount].pvItem = pxRingbuffer->pvGetItem(pxRingbuffer, &xIsSplit, 0, &pxItems[uxCount].xItemSize);
+        configASSERT(xIsSplit == pdFALSE);      //Items in no-split buffers are never split
+        uxCount++;
+    }
+    return uxCount;
+}
+
+static BaseType_t prvCopyItemSpsc(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
+{
+    size_t xTotalItemSize = rbALIGN_SIZE(xItemSize) + rbHEADER_SIZE;    //Rounded up aligned item size with header
+    uint8_t *pucWrite = pxRingbuffer->pucWrite;                         //Only ever modified by the sender
+    uint8_t *pucFree = __atomic_load_n(&pxRingbuffer->pucFree, __ATOMIC_ACQUIRE);
+    uint8_t *pucItemStart;
+
+    if (pucWrite < pucFree) {
+        //Free space is contiguous between pucWrite and pucFree. pucWrite must stay behind pucFree
+        if (xTotalItemSize >= (size_t)(pucFree - pucWrite)) {
+            return pdFALSE;
+        }
+        pucItemStart = pucWrite;
+    } else if (xTotalItemSize <= (size_t)(pxRingbuffer->pucTail - pucWrite) &&
+               !(pucFree == pxRingbuffer->pucHead && (size_t)(pxRingbuffer->pucTail - pucWrite) - xTotalItemSize < rbHEADER_SIZE)) {
+        //Item fits at the tail, and pucWrite will not wrap around onto pucFree
+        pucItemStart = pucWrite;
+    } else if (xTotalItemSize < (size_t)(pucFree - pxRingbuffer->pucHead)) {
+        //Item fits at the head. Set remaining length as dummy data and wrap around
+        ItemHeader_t *pxDummy = (ItemHeader_t *)pucWrite;
+        pxDummy->uxItemFlags = rbITEM_DUMMY_DATA_FLAG;
+        pxDummy->xItemLen = 0;
+        pucItemStart = pxRingbuffer->pucHead;
+    } else {
+        return pdFALSE;
+    }
+
+    //Set item header and copy data
+    ItemHeader_t *pxHeader = (ItemHeader_t *)pucItemStart;
+    pxHeader->xItemLen = xItemSize;
+    pxHeader->uxItemFlags = 0;
+    memcpy(pucItemStart + rbHEADER_SIZE, pucItem, xItemSize);
+    pucWrite = pucItemStart + xTotalItemSize;
+    //If current remaining length can't fit a header, wrap around write pointer
+    if (pxRingbuffer->pucTail - pucWrite < rbHEADER_SIZE) {
+        pucWrite = pxRingbuffer->pucHead;
+    }
+    pxRingbuffer->uxSpscItemsSent++;
+    //Publish the item to the receiver
+    __atomic_store_n(&pxRingbuffer->pucWrite, pucWrite, __ATOMIC_RELEASE);
+    return pdTRUE;
+}
+
+static void *prvGetItemSpsc(Ringbuffer_t *pxRingbuffer, size_t *pxItemSize)
+{
+    uint8_t *pucRead = pxRingbuffer->pucRead;                           //Only ever modified by the receiver
+    uint8_t *pucWrite = __atomic_load_n(&pxRingbuffer->pucWrite, __ATOMIC_ACQUIRE);
+    if (pucRead == pucWrite) {
+        return NULL;    //Buffer is empty
+    }
+
+    ItemHeader_t *pxHeader = (ItemHeader_t *)pucRead;
+    //Wrap around if dummy data
+    if (pxHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+        pucRead = pxRingbuffer->pucHead;
+        pxHeader = (ItemHeader_t *)pucRead;
+    }
+    configASSERT(pxHeader->xItemLen <= pxRingbuffer->xMaxItemSize);
+    uint8_t *pcReturn = pucRead + rbHEADER_SIZE;
+    *pxItemSize = pxHeader->xItemLen;
+
+    pucRead += rbHEADER_SIZE + rbALIGN_SIZE(pxHeader->xItemLen);
+    //Check if pucRead requires wrap around
+    if ((pxRingbuffer->pucTail - pucRead) < rbHEADER_SIZE) {
+        pucRead = pxRingbuffer->pucHead;
+    }
+    pxRingbuffer->pucRead = pucRead;
+    pxRingbuffer->uxSpscItemsReceived++;
+    return (void *)pcReturn;
+}
+
+static void prvReturnItemSpsc(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    prvMarkItemFreeDefault(pxRingbuffer, pucItem);
+
+    //Advance a local copy of the free pointer past all freed items (see prvAdvanceFreeDefault())
+    uint8_t *pucFree = pxRingbuffer->pucFree;                           //Only ever modified by the receiver
+    ItemHeader_t *pxCurHeader = (ItemHeader_t *)pucFree;
+    while (((pxCurHeader->uxItemFlags & rbITEM_FREE_FLAG) || (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG)) && pucFree != pxRingbuffer->pucRead) {
+        if (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+            pucFree = pxRingbuffer->pucHead;    //Wrap around due to dummy data
+        } else {
+            pucFree += rbALIGN_SIZE(pxCurHeader->xItemLen) + rbHEADER_SIZE;
+            configASSERT(pucFree <= pxRingbuffer->pucTail);
+        }
+        //Check if pucFree requires wrap around
+        if ((pxRingbuffer->pucTail - pucFree) < rbHEADER_SIZE) {
+            pucFree = pxRingbuffer->pucHead;
+        }
+        pxCurHeader = (ItemHeader_t *)pucFree;
+    }
+    //Publish the free space to the sender
+    __atomic_store_n(&pxRingbuffer->pucFree, pucFree, __ATOMIC_RELEASE);
+}
+
+static size_t prvGetCurMaxSizeSpsc(Ringbuffer_t *pxRingbuffer)
+{
+    BaseType_t xFreeSize;
+    uint8_t *pucWrite = __atomic_load_n(&pxRingbuffer->pucWrite, __ATOMIC_ACQUIRE);
+    uint8_t *pucFree = __atomic_load_n(&pxRingbuffer->pucFree, __ATOMIC_ACQUIRE);
+    if (pucWrite < pucFree) {
+        //Free space is contiguous between pucWrite and pucFree, and pucWrite must stay behind pucFree
+        xFreeSize = (pucFree - pucWrite) - (portBYTE_ALIGNMENT_MASK + 1);
+    } else {
+        //Select largest contiguous free space. pucWrite must not wrap around onto pucFree
+        BaseType_t xSize1 = pxRingbuffer->pucTail - pucWrite;
+        BaseType_t xSize2 = (pucFree - pxRingbuffer->pucHead) - (portBYTE_ALIGNMENT_MASK + 1);
+        if (pucFree == pxRingbuffer->pucHead) {
+            xSize1 -= rbHEADER_SIZE;
+        }
+        xFreeSize = (xSize1 > xSize2) ? xSize1 : xSize2;
+    }
+
+    //Items need space for a header
+    xFreeSize -= rbHEADER_SIZE;
+    //Limit free size to be within bounds
+    if (xFreeSize > (BaseType_t)pxRingbuffer->xMaxItemSize) {
+        xFreeSize = pxRingbuffer->xMaxItemSize;
+    } else if (xFreeSize < 0) {
+        xFreeSize = 0;
+    }
+    return xFreeSize;
+}
+
+static void prvNotifySpsc(TaskHandle_t *pxTask, BaseType_t xInISR, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    //Order the preceding pointer update before checking for a registered task (pairs with the fence in the waiting task)
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    //Claim the registration, so that the waiting task knows a notification is on its way
+    TaskHandle_t xTask = __atomic_exchange_n(pxTask, NULL, __ATOMIC_RELAXED);
+    if (xTask != NULL) {
+        if (xInISR) {
+            vTaskNotifyGiveFromISR(xTask, pxHigherPriorityTaskWoken);
+        } else {
+            xTaskNotifyGive(xTask);
+        }
+    }
+}
+
+static void prvUnregisterSpsc(TaskHandle_t *pxTask, uint32_t ulNotified)
+{
+    if (__atomic_exchange_n(pxTask, NULL, __ATOMIC_RELAXED) == NULL && ulNotified == 0) {
+        //The other side claimed the registration but its notification has not been taken yet.
+        //Wait for it, otherwise it would end a later, unrelated ulTaskNotifyTake() of this task early
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+static BaseType_t prvSendSpsc(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize, TickType_t xTicksToWait)
+{
+    //Fast path, item fits without blocking
+    BaseType_t xReturn = prvCopyItemSpsc(pxRingbuffer, pucItem, xItemSize);
+    if (xReturn != pdTRUE && xTicksToWait != 0) {
+        TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+        TickType_t xTicksRemaining = xTicksToWait;
+        while (xReturn != pdTRUE && xTicksRemaining <= xTicksToWait) {   //xTicksToWait will underflow once xTaskGetTickCount() > ticks_end
+            //Register as the blocked sender, then try again so that space freed in between is not missed
+            __atomic_store_n(&pxRingbuffer->xSpscSendTask, xTaskGetCurrentTaskHandle(), __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            xReturn = prvCopyItemSpsc(pxRingbuffer, pucItem, xItemSize);
+            uint32_t ulNotified = 0;
+            if (xReturn != pdTRUE) {
+                ulNotified = ulTaskNotifyTake(pdTRUE, xTicksRemaining);
+                xReturn = prvCopyItemSpsc(pxRingbuffer, pucItem, xItemSize);
+            }
+            prvUnregisterSpsc(&pxRingbuffer->xSpscSendTask, ulNotified);
+            if (xTicksToWait != portMAX_DELAY) {
+                xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+            }
+        }
+    }
+
+    if (xReturn == pdTRUE) {
+        prvNotifySpsc(&pxRingbuffer->xSpscReceiveTask, pdFALSE, NULL);
+    }
+    return xReturn;
+}
+
+static void *prvReceiveSpsc(Ringbuffer_t *pxRingbuffer, size_t *pxItemSize, TickType_t xTicksToWait)
+{
+    //Fast path, item is available without blocking
+    void *pvItem = prvGetItemSpsc(pxRingbuffer, pxItemSize);
+    if (pvItem == NULL && xTicksToWait != 0) {
+        TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+        TickType_t xTicksRemaining = xTicksToWait;
+        while (pvItem == NULL && xTicksRemaining <= xTicksToWait) {   //xTicksToWait will underflow once xTaskGetTickCount() > ticks_end
+            //Register as the blocked receiver, then try again so that an item sent in between is not missed
+            __atomic_store_n(&pxRingbuffer->xSpscReceiveTask, xTaskGetCurrentTaskHandle(), __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            pvItem = prvGetItemSpsc(pxRingbuffer, pxItemSize);
+            uint32_t ulNotified = 0;
+            if (pvItem == NULL) {
+                ulNotified = ulTaskNotifyTake(pdTRUE, xTicksRemaining);
+                pvItem = prvGetItemSpsc(pxRingbuffer, pxItemSize);
+            }
+            prvUnregisterSpsc(&pxRingbuffer->xSpscReceiveTask, ulNotified);
+            if (xTicksToWait != portMAX_DELAY) {
+                xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+            }
+        }
+    }
+    return pvItem;
+}
+
 static BaseType_t prvReceiveGeneric(Ringbuffer_t *pxRingbuffer, void **pvItem1, void **pvItem2, size_t *xItemSize1, size_t *xItemSize2, size_t xMaxSize, TickType_t xTicksToWait)
 {
     BaseType_t xReturn = pdFALSE;
@@ -673,8 +979,11 @@ RingbufHandle_t xRingbufferCreate(size_t xBufferSize, ringbuf_type_t xBufferType
     pxRingbuffer->pucRead = pxRingbuffer->pucHead;
     pxRingbuffer->pucWrite = pxRingbuffer->pucHead;
     pxRingbuffer->xItemsWaiting = 0;
-    pxRingbuffer->xFreeSpaceSemaphore = xSemaphoreCreateBinary();
-    pxRingbuffer->xItemsBufferedSemaphore = xSemaphoreCreateBinary();
+    if (xBufferType != RINGBUF_TYPE_SPSC) {
+        //SPSC buffers block on task notifications instead of semaphores
+        pxRingbuffer->xFreeSpaceSemaphore = xSemaphoreCreateBinary();
+        pxRingbuffer->xItemsBufferedSemaphore = xSemaphoreCreateBinary();
+    }
     pxRingbuffer->uxRingbufferFlags = 0;
 
     //Initialize type dependent values and function pointers
@@ -708,15 +1017,27 @@ RingbufHandle_t xRingbufferCreate(size_t xBufferSize, ringbuf_type_t xBufferType
         //Byte buffers do not incur any overhead
         pxRingbuffer->xMaxItemSize = pxRingbuffer->xSize;
         pxRingbuffer->xGetCurMaxSize = prvGetCurMaxSizeByteBuf;
+    } else if (xBufferType == RINGBUF_TYPE_SPSC) {
+        pxRingbuffer->uxRingbufferFlags |= rbSPSC_FLAG;
+        //Items are copied/retrieved/returned by the SPSC functions, bypassing the function pointers
+        pxRingbuffer->xCheckItemFits = NULL;
+        pxRingbuffer->vCopyItem = NULL;
+        pxRingbuffer->pvGetItem = NULL;
+        pxRingbuffer->vReturnItem = NULL;
+        //Same worst case as no-split buffers
+        pxRingbuffer->xMaxItemSize = rbALIGN_SIZE(pxRingbuffer->xSize / 2) - rbHEADER_SIZE;
+        pxRingbuffer->xGetCurMaxSize = prvGetCurMaxSizeSpsc;
     } else {
         //Unsupported type
         configASSERT(0);
     }
 
-    if (pxRingbuffer->xFreeSpaceSemaphore == NULL || pxRingbuffer->xItemsBufferedSemaphore == NULL) {
-        goto err;
+    if (!(pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG)) {
+        if (pxRingbuffer->xFreeSpaceSemaphore == NULL || pxRingbuffer->xItemsBufferedSemaphore == NULL) {
+            goto err;
+        }
+        xSemaphoreGive(pxRingbuffer->xFreeSpaceSemaphore);
     }
-    xSemaphoreGive(pxRingbuffer->xFreeSpaceSemaphore);
     vPortCPUInitializeMutex(&pxRingbuffer->mux);
 
     return (RingbufHandle_t)pxRingbuffer;
@@ -753,6 +1074,9 @@ BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer, const void *pvItem, size
     if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && xItemSize == 0) {
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSendSpsc(pxRingbuffer, pvItem, xItemSize, xTicksToWait);
+    }
 
     //Attempt to send an item
     BaseType_t xReturn = pdFALSE;
@@ -799,6 +1123,84 @@ BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer, const void *pvItem, size
     return xReturn;
 }
 
+BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, size_t xItemSize, TickType_t xTicksToWait)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItem != NULL);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG | rbSPSC_FLAG)) == 0);   //Only no-split buffers are supported
+    *ppvItem = NULL;
+    if (xItemSize > pxRingbuffer->xMaxItemSize) {
+        return pdFALSE;     //Data will never ever fit in the queue.
+    }
+
+    //Attempt to acquire space for an item
+    BaseType_t xReturn = pdFALSE;
+    BaseType_t xReturnSemaphore = pdFALSE;
+    TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+    TickType_t xTicksRemaining = xTicksToWait;
+    while (xTicksRemaining <= xTicksToWait) {   //xTicksToWait will underflow once xTaskGetTickCount() > ticks_end
+        //Block until more free space becomes available or timeout
+        if (xSemaphoreTake(pxRingbuffer->xFreeSpaceSemaphore, xTicksRemaining) != pdTRUE) {
+            xReturn = pdFALSE;
+            break;
+        }
+        //Semaphore obtained, check if item can fit
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        if(pxRingbuffer->xCheckItemFits(pxRingbuffer, xItemSize) == pdTRUE) {
+            //Item will fit, reserve space and mark it as acquired so that readers stop at it
+            uint8_t *pucData = prvAcquireItemNoSplit(pxRingbuffer, xItemSize);
+            ((ItemHeader_t *)(pucData - rbHEADER_SIZE))->uxItemFlags |= rbITEM_ACQUIRED_FLAG;
+            *ppvItem = pucData;
+            xReturn = pdTRUE;
+            //Check if the free semaphore should be returned to allow other tasks to send
+            if (prvGetFreeSize(pxRingbuffer) > 0) {
+                xReturnSemaphore = pdTRUE;
+            }
+            portEXIT_CRITICAL(&pxRingbuffer->mux);
+            break;
+        }
+        //Item doesn't fit, adjust ticks and take the semaphore again
+        if (xTicksToWait != portMAX_DELAY) {
+            xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+        }
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+        /*
+         * Gap between critical section and re-acquiring of the semaphore. If
+         * semaphore is given now, priority inversion might occur (see docs)
+         */
+    }
+
+    if (xReturnSemaphore == pdTRUE) {
+        xSemaphoreGive(pxRingbuffer->xFreeSpaceSemaphore);  //Give back semaphore so other tasks can send
+    }
+    return xReturn;
+}
+
+BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pvItem != NULL);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG | rbSPSC_FLAG)) == 0);   //Only no-split buffers are supported
+    configASSERT(rbCHECK_ALIGNED(pvItem));
+    configASSERT((uint8_t *)pvItem >= pxRingbuffer->pucHead + rbHEADER_SIZE);
+    configASSERT((uint8_t *)pvItem <= pxRingbuffer->pucTail);     //Inclusive of pucTail in the case of zero length item at the very end
+
+    ItemHeader_t *pxHeader = (ItemHeader_t *)((uint8_t *)pvItem - rbHEADER_SIZE);
+    portENTER_CRITICAL(&pxRingbuffer->mux);
+    configASSERT(pxHeader->uxItemFlags & rbITEM_ACQUIRED_FLAG);    //Item must have been acquired and not yet completed
+    pxHeader->uxItemFlags &= ~rbITEM_ACQUIRED_FLAG;
+    pxRingbuffer->xItemsWaiting++;
+    portEXIT_CRITICAL(&pxRingbuffer->mux);
+
+    //Indicate item was successfully sent. Readers will only retrieve it once all earlier items are completed
+    xSemaphoreGive(pxRingbuffer->xItemsBufferedSemaphore);
+    return pdTRUE;
+}
+
 BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer, const void *pvItem, size_t xItemSize, BaseType_t *pxHigherPriorityTaskWoken)
 {
     //Check arguments
@@ -811,6 +1213,13 @@ BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer, const void *pvIte
     if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && xItemSize == 0) {
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        BaseType_t xReturn = prvCopyItemSpsc(pxRingbuffer, pvItem, xItemSize);
+        if (xReturn == pdTRUE) {
+            prvNotifySpsc(&pxRingbuffer->xSpscReceiveTask, pdTRUE, pxHigherPriorityTaskWoken);
+        }
+        return xReturn;
+    }
 
     //Attempt to send an item
     BaseType_t xReturn;
@@ -847,6 +1256,13 @@ void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize, TickTy
     //Attempt to retrieve an item
     void *pvTempItem;
     size_t xTempSize;
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        pvTempItem = prvReceiveSpsc(pxRingbuffer, &xTempSize, xTicksToWait);
+        if (pvTempItem != NULL && pxItemSize != NULL) {
+            *pxItemSize = xTempSize;
+        }
+        return pvTempItem;
+    }
     if (prvReceiveGeneric(pxRingbuffer, &pvTempItem, NULL, &xTempSize, NULL, 0, xTicksToWait) == pdTRUE) {
         if (pxItemSize != NULL) {
             *pxItemSize = xTempSize;
@@ -866,6 +1282,13 @@ void *xRingbufferReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize)
     //Attempt to retrieve an item
     void *pvTempItem;
     size_t xTempSize;
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        pvTempItem = prvGetItemSpsc(pxRingbuffer, &xTempSize);
+        if (pvTempItem != NULL && pxItemSize != NULL) {
+            *pxItemSize = xTempSize;
+        }
+        return pvTempItem;
+    }
     if (prvReceiveGenericFromISR(pxRingbuffer, &pvTempItem, NULL, &xTempSize, NULL, 0) == pdTRUE) {
         if (pxItemSize != NULL) {
             *pxItemSize = xTempSize;
@@ -991,12 +1414,86 @@ void *xRingbufferReceiveUpToFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemS
     }
 }
 
+UBaseType_t uxRingbufferReceiveMultiple(RingbufHandle_t xRingbuffer, RingbufItem_t *pxItems, UBaseType_t uxMaxItems, TickType_t xTicksToWait)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG | rbSPSC_FLAG)) == 0);   //This function should only be called for no-split buffers
+    configASSERT(pxItems != NULL || uxMaxItems == 0);
+    if (uxMaxItems == 0) {
+        return 0;
+    }
+
+    //Attempt to retrieve multiple items
+    UBaseType_t uxCount = 0;
+    BaseType_t xReturnSemaphore = pdFALSE;
+    TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+    TickType_t xTicksRemaining = xTicksToWait;
+    while (xTicksRemaining <= xTicksToWait) {   //xTicksToWait will underflow once xTaskGetTickCount() > ticks_end
+        //Block until more items become available or timeout
+        if (xSemaphoreTake(pxRingbuffer->xItemsBufferedSemaphore, xTicksRemaining) != pdTRUE) {
+            break;      //Timed out attempting to get semaphore
+        }
+
+        //Semaphore obtained, retrieve as many items as are available in one go
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        uxCount = prvGetItemMultiple(pxRingbuffer, pxItems, uxMaxItems);
+        if (uxCount > 0) {
+            if (pxRingbuffer->xItemsWaiting > 0) {
+                xReturnSemaphore = pdTRUE;
+            }
+            portEXIT_CRITICAL(&pxRingbuffer->mux);
+            break;
+        }
+        //No item available for retrieval, adjust ticks and take the semaphore again
+        if (xTicksToWait != portMAX_DELAY) {
+            xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+        }
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+
+    if (xReturnSemaphore == pdTRUE) {
+        xSemaphoreGive(pxRingbuffer->xItemsBufferedSemaphore);  //Give semaphore back so other tasks can retrieve
+    }
+    return uxCount;
+}
+
+UBaseType_t uxRingbufferReceiveMultipleFromISR(RingbufHandle_t xRingbuffer, RingbufItem_t *pxItems, UBaseType_t uxMaxItems)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG | rbSPSC_FLAG)) == 0);   //This function should only be called for no-split buffers
+    configASSERT(pxItems != NULL || uxMaxItems == 0);
+
+    //Attempt to retrieve multiple items
+    UBaseType_t uxCount;
+    BaseType_t xReturnSemaphore = pdFALSE;
+    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    uxCount = prvGetItemMultiple(pxRingbuffer, pxItems, uxMaxItems);
+    if (uxCount > 0 && pxRingbuffer->xItemsWaiting > 0) {
+        xReturnSemaphore = pdTRUE;
+    }
+    portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+
+    if (xReturnSemaphore == pdTRUE) {
+        xSemaphoreGiveFromISR(pxRingbuffer->xItemsBufferedSemaphore, NULL);  //Give semaphore back so other tasks can retrieve
+    }
+    return uxCount;
+}
+
 void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvReturnItemSpsc(pxRingbuffer, (uint8_t *)pvItem);
+        prvNotifySpsc(&pxRingbuffer->xSpscSendTask, pdFALSE, NULL);
+        return;
+    }
     portENTER_CRITICAL(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     portEXIT_CRITICAL(&pxRingbuffer->mux);
@@ -1009,12 +1506,57 @@ void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, Bas
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvReturnItemSpsc(pxRingbuffer, (uint8_t *)pvItem);
+        prvNotifySpsc(&pxRingbuffer->xSpscSendTask, pdTRUE, pxHigherPriorityTaskWoken);
+        return;
+    }
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
     xSemaphoreGiveFromISR(pxRingbuffer->xFreeSpaceSemaphore, pxHigherPriorityTaskWoken);
 }
 
+void vRingbufferReturnMultiple(RingbufHandle_t xRingbuffer, const RingbufItem_t *pxItems, UBaseType_t uxItems)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG | rbSPSC_FLAG)) == 0);   //This function should only be called for no-split buffers
+    configASSERT(pxItems != NULL || uxItems == 0);
+    if (uxItems == 0) {
+        return;
+    }
+
+    portENTER_CRITICAL(&pxRingbuffer->mux);
+    for (UBaseType_t i = 0; i < uxItems; i++) {
+        configASSERT(pxItems[i].pvItem != NULL);
+        prvMarkItemFreeDefault(pxRingbuffer, (uint8_t *)pxItems[i].pvItem);
+    }
+    prvAdvanceFreeDefault(pxRingbuffer);
+    portEXIT_CRITICAL(&pxRingbuffer->mux);
+    xSemaphoreGive(pxRingbuffer->xFreeSpaceSemaphore);
+}
+
+void vRingbufferReturnMultipleFromISR(RingbufHandle_t xRingbuffer, const RingbufItem_t *pxItems, UBaseType_t uxItems, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG | rbSPSC_FLAG)) == 0);   //This function should only be called for no-split buffers
+    configASSERT(pxItems != NULL || uxItems == 0);
+    if (uxItems == 0) {
+        return;
+    }
+
+    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    for (UBaseType_t i = 0; i < uxItems; i++) {
+        configASSERT(pxItems[i].pvItem != NULL);
+        prvMarkItemFreeDefault(pxRingbuffer, (uint8_t *)pxItems[i].pvItem);
+    }
+    prvAdvanceFreeDefault(pxRingbuffer);
+    portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+    xSemaphoreGiveFromISR(pxRingbuffer->xFreeSpaceSemaphore, pxHigherPriorityTaskWoken);
+}
+
 void vRingbufferDelete(RingbufHandle_t xRingbuffer)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
@@ -1056,6 +1598,8 @@ BaseType_t xRingbufferAddToQueueSetRead(RingbufHandle_t xRingbuffer, QueueSetHan
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
 
+    configASSERT(!(pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG));     //SPSC buffers have no semaphores to add to a queue set
+
     BaseType_t xReturn;
     portENTER_CRITICAL(&pxRingbuffer->mux);
     //Cannot add semaphore to queue set if semaphore is not empty. Temporarily hold semaphore
@@ -1111,7 +1655,11 @@ void vRingbufferGetInfo(RingbufHandle_t xRingbuffer, UBaseType_t *uxFree, UBaseT
         *uxWrite = (UBaseType_t)(pxRingbuffer->pucWrite - pxRingbuffer->pucHead);
     }
     if (uxItemsWaiting != NULL) {
-        *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xItemsWaiting);
+        if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+            *uxItemsWaiting = pxRingbuffer->uxSpscItemsSent - pxRingbuffer->uxSpscItemsReceived;
+        } else {
+            *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xItemsWaiting);
+        }
     }
     portEXIT_CRITICAL(&pxRingbuffer->mux);
 }
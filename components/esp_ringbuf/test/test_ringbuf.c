@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -7,6 +8,7 @@
 #include "freertos/ringbuf.h"
 #include "driver/timer.h"
 #include "esp_spi_flash.h"
+#include "esp_timer.h"
 #include "unity.h"
 #include "test_utils.h"
 
@@ -258,6 +260,113 @@ TEST_CASE("Test ring buffer Byte Buffer", "[freertos]")
     vRingbufferDelete(buffer_handle);
 }
 
+/* --------------------- Ring buffer send acquire test -------------------------
+ * The following test case will test acquiring space in a no-split buffer and
+ * completing the items out of order. The test case will do the following...
+ * 1) Acquire two items, then send a third item with xRingbufferSend()
+ * 2) Complete the second item and check that no item can be received yet
+ * 3) Complete the first item and check that all three items are received in order
+ * 4) Repeat until the acquired items wrap around the buffer
+ */
+
+TEST_CASE("Test ring buffer send acquire", "[freertos]")
+{
+    //Create buffer
+    RingbufHandle_t buffer_handle = xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    TEST_ASSERT_MESSAGE(buffer_handle != NULL, "Failed to create ring buffer");
+    //Each iteration uses 56 bytes, so iterating several times will wrap around the buffer
+    for (int iter = 0; iter < 10; iter++) {
+        void *first, *second;
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendAcquire(buffer_handle, &first, SMALL_ITEM_SIZE, TIMEOUT_TICKS));
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendAcquire(buffer_handle, &second, LARGE_ITEM_SIZE, TIMEOUT_TICKS));
+        send_item_and_check(buffer_handle, small_item, SMALL_ITEM_SIZE, TIMEOUT_TICKS, false);
+
+        //Nothing can be received until the first acquired item is completed
+        memcpy(second, large_item, LARGE_ITEM_SIZE);
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendComplete(buffer_handle, second));
+        size_t item_size;
+        TEST_ASSERT_NULL(xRingbufferReceive(buffer_handle, &item_size, 0));
+        TEST_ASSERT_NULL(xRingbufferReceiveFromISR(buffer_handle, &item_size));
+
+        memcpy(first, small_item, SMALL_ITEM_SIZE);
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendComplete(buffer_handle, first));
+        receive_check_and_return_item_no_split(buffer_handle, small_item, SMALL_ITEM_SIZE, TIMEOUT_TICKS, false);
+        receive_check_and_return_item_no_split(buffer_handle, large_item, LARGE_ITEM_SIZE, TIMEOUT_TICKS, false);
+        receive_check_and_return_item_no_split(buffer_handle, small_item, SMALL_ITEM_SIZE, TIMEOUT_TICKS, false);
+        TEST_ASSERT_NULL(xRingbufferReceive(buffer_handle, &item_size, 0));
+    }
+
+    //Acquiring more than the maximum item size should fail immediately
+    void *item;
+    TEST_ASSERT_EQUAL(pdFALSE, xRingbufferSendAcquire(buffer_handle, &item, xRingbufferGetMaxItemSize(buffer_handle) + 1, TIMEOUT_TICKS));
+    TEST_ASSERT_NULL(item);
+
+    //Cleanup
+    vRingbufferDelete(buffer_handle);
+}
+
+/* -------------------- Ring buffer receive multiple test -----------------------
+ * The following test case will test retrieving and returning multiple items of
+ * a no-split buffer in a single call. The test case will do the following...
+ * 1) Send a burst of items that wraps around the buffer
+ * 2) Retrieve the items in batches, checking FIFO order across the wrap around
+ * 3) Return each batch in a single call
+ */
+
+TEST_CASE("Test ring buffer receive multiple", "[freertos]")
+{
+    //Create buffer
+    RingbufHandle_t buffer_handle = xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    TEST_ASSERT_MESSAGE(buffer_handle != NULL, "Failed to create ring buffer");
+    //Alternate small and large items. Six items occupy 120 bytes, so later iterations will wrap around
+    const int no_of_items = 6;
+    RingbufItem_t items[4];
+
+    //Nothing to receive yet
+    TEST_ASSERT_EQUAL(0, uxRingbufferReceiveMultiple(buffer_handle, items, 4, 0));
+
+    for (int iter = 0; iter < 3; iter++) {
+        //Send items
+        for (int i = 0; i < no_of_items; i++) {
+            if (i % 2) {
+                send_item_and_check(buffer_handle, large_item, LARGE_ITEM_SIZE, TIMEOUT_TICKS, false);
+            } else {
+                send_item_and_check(buffer_handle, small_item, SMALL_ITEM_SIZE, TIMEOUT_TICKS, false);
+            }
+        }
+        //Receive items in batches of up to 4 items, check them, then return each batch in one call
+        int i = 0;
+        while (i < no_of_items) {
+            UBaseType_t count;
+            if (iter == 1) {
+                count = uxRingbufferReceiveMultipleFromISR(buffer_handle, items, 4);
+            } else {
+                count = uxRingbufferReceiveMultiple(buffer_handle, items, 4, TIMEOUT_TICKS);
+            }
+            TEST_ASSERT_MESSAGE(count > 0 && count <= 4, "Failed to receive items");
+            for (UBaseType_t j = 0; j < count; j++, i++) {
+                if (i % 2) {
+                    TEST_ASSERT_EQUAL(LARGE_ITEM_SIZE, items[j].xItemSize);
+                    TEST_ASSERT_EQUAL_HEX8_ARRAY(large_item, items[j].pvItem, LARGE_ITEM_SIZE);
+                } else {
+                    TEST_ASSERT_EQUAL(SMALL_ITEM_SIZE, items[j].xItemSize);
+                    TEST_ASSERT_EQUAL_HEX8_ARRAY(small_item, items[j].pvItem, SMALL_ITEM_SIZE);
+                }
+            }
+            if (iter == 1) {
+                vRingbufferReturnMultipleFromISR(buffer_handle, items, count, NULL);
+            } else {
+                vRingbufferReturnMultiple(buffer_handle, items, count);
+            }
+        }
+        TEST_ASSERT_EQUAL(no_of_items, i);
+        TEST_ASSERT_EQUAL(0, uxRingbufferReceiveMultiple(buffer_handle, items, 4, 0));
+    }
+
+    //Cleanup
+    vRingbufferDelete(buffer_handle);
+}
+
 /* ----------------------- Ring buffer queue sets test ------------------------
  * The following test case will test receiving from ring buffers that have been
  * added to a queue set. The test case will do the following...
@@ -503,7 +612,7 @@ static void read_from_buffer(RingbufHandle_t buffer, ringbuf_type_t buf_type, si
             char *item_data, *item_data2;
 
             //Select appropriate receive function for type of ring buffer
-            if (buf_type ==  RINGBUF_TYPE_NOSPLIT) {
+            if (buf_type ==  RINGBUF_TYPE_NOSPLIT || buf_type == RINGBUF_TYPE_SPSC) {
                 item_data = (char *)xRingbufferReceive(buffer, &item_size, TIMEOUT_TICKS);
             } else if (buf_type == RINGBUF_TYPE_ALLOWSPLIT) {
                 BaseType_t ret = xRingbufferReceiveSplit(buffer, (void **)&item_data, (void **)&item_data2, &item_size, &item_size2, TIMEOUT_TICKS);
@@ -576,8 +685,8 @@ TEST_CASE("Test ring buffer SMP", "[freertos]")
     tasks_done = xSemaphoreCreateBinary();                //Semaphore used to to indicate send and receive tasks completed running
     srand(SRAND_SEED);                                  //Seed RNG
 
-    //Iterate through buffer types (No split, split, then byte buff)
-    for (ringbuf_type_t buf_type = 0; buf_type <= RINGBUF_TYPE_BYTEBUF; buf_type++) {
+    //Iterate through buffer types (No split, split, byte buff, then SPSC)
+    for (ringbuf_type_t buf_type = 0; buf_type <= RINGBUF_TYPE_SPSC; buf_type++) {
         //Create buffer
         task_args_t task_args;
         task_args.buffer = xRingbufferCreate(CONT_DATA_TEST_BUFF_LEN, buf_type); //Create buffer of selected type
@@ -607,6 +716,85 @@ TEST_CASE("Test ring buffer SMP", "[freertos]")
     vSemaphoreDelete(tasks_done);
 }
 
+/* ------------------------ Ring buffer throughput test ------------------------
+ * The following test case will measure the throughput of moving small fixed
+ * size records from a sending task to a receiving task on the other core, for
+ * no-split, byte, and SPSC buffers.
+ */
+
+#define THROUGHPUT_RECORD_SIZE          16
+#define THROUGHPUT_RECORDS              20000
+#define THROUGHPUT_TEST_BUFF_LEN        1024
+
+static void throughput_send_task(void *args)
+{
+    RingbufHandle_t buffer = ((task_args_t *)args)->buffer;
+    uint32_t record[THROUGHPUT_RECORD_SIZE / sizeof(uint32_t)] = {0};
+    for (uint32_t i = 0; i < THROUGHPUT_RECORDS; i++) {
+        record[0] = i;
+        TEST_ASSERT_MESSAGE(xRingbufferSend(buffer, record, sizeof(record), portMAX_DELAY) == pdTRUE, "Failed to send a record");
+    }
+    xSemaphoreGive(tx_done);
+    vTaskDelete(NULL);
+}
+
+static void throughput_rec_task(void *args)
+{
+    RingbufHandle_t buffer = ((task_args_t *)args)->buffer;
+    ringbuf_type_t buf_type = ((task_args_t *)args)->type;
+    size_t bytes_rec = 0;
+    while (bytes_rec < THROUGHPUT_RECORDS * THROUGHPUT_RECORD_SIZE) {
+        size_t item_size;
+        uint8_t *item;
+        if (buf_type == RINGBUF_TYPE_BYTEBUF) {
+            item = (uint8_t *)xRingbufferReceiveUpTo(buffer, &item_size, portMAX_DELAY, THROUGHPUT_RECORD_SIZE);
+        } else {
+            item = (uint8_t *)xRingbufferReceive(buffer, &item_size, portMAX_DELAY);
+            TEST_ASSERT_MESSAGE(item_size == THROUGHPUT_RECORD_SIZE, "Record size is incorrect");
+        }
+        TEST_ASSERT_MESSAGE(item != NULL, "Failed to receive a record");
+        //Check the sequence number of each complete record
+        if (bytes_rec % THROUGHPUT_RECORD_SIZE == 0 && item_size >= sizeof(uint32_t)) {
+            TEST_ASSERT_MESSAGE(*(uint32_t *)item == bytes_rec / THROUGHPUT_RECORD_SIZE, "Records received out of order");
+        }
+        bytes_rec += item_size;
+        vRingbufferReturnItem(buffer, item);
+    }
+    xSemaphoreGive(rx_done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("Test ring buffer SPSC throughput", "[freertos]")
+{
+    const ringbuf_type_t types[] = {RINGBUF_TYPE_NOSPLIT, RINGBUF_TYPE_BYTEBUF, RINGBUF_TYPE_SPSC};
+    const char *type_names[] = {"No-split", "Byte buffer", "SPSC"};
+    tx_done = xSemaphoreCreateBinary();
+    rx_done = xSemaphoreCreateBinary();
+
+    for (int i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        task_args_t task_args;
+        task_args.buffer = xRingbufferCreate(THROUGHPUT_TEST_BUFF_LEN, types[i]);
+        task_args.type = types[i];
+        TEST_ASSERT_MESSAGE(task_args.buffer != NULL, "Failed to create ring buffer");
+
+        int64_t start = esp_timer_get_time();
+        xTaskCreatePinnedToCore(throughput_rec_task, "rec tsk", 2048, (void *)&task_args, 10, NULL, portNUM_PROCESSORS - 1);
+        xTaskCreatePinnedToCore(throughput_send_task, "send tsk", 2048, (void *)&task_args, 10, NULL, 0);
+        xSemaphoreTake(tx_done, portMAX_DELAY);
+        xSemaphoreTake(rx_done, portMAX_DELAY);
+        int64_t elapsed = esp_timer_get_time() - start;
+        printf("%s: %d records of %d bytes in %d us, %d records/s\n", type_names[i], THROUGHPUT_RECORDS, THROUGHPUT_RECORD_SIZE,
+               (int)elapsed, (int)(THROUGHPUT_RECORDS * 1000000LL / elapsed));
+
+        vTaskDelay(5);  //Allow idle to clean up
+        vRingbufferDelete(task_args.buffer);
+    }
+
+    //Cleanup
+    vSemaphoreDelete(tx_done);
+    vSemaphoreDelete(rx_done);
+}
+
 static IRAM_ATTR __attribute__((noinline)) bool iram_ringbuf_test()
 {
     bool result = true;
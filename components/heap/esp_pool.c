@@ -0,0 +1,301 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_pool.h"
+#include "heap_private.h"
+#include "rom/ets_sys.h"
+
+/*
+ Fixed size object pools.
+
+ Each pool's objects are stored in a single array, allocated with heap_caps_malloc(). Free objects form a singly linked
+ list: the first word of each free object holds the index of the next free object, or POOL_INDEX_NONE.
+
+ The head of the list is a 32-bit word holding the index of the first free object in the low 16 bits, and a tag in the
+ high 16 bits. In lock-free pools, the head is updated with compare-and-set and the tag is incremented on every update,
+ so a stale head (an object taken and then returned by another CPU while this one was reading the next index) never
+ compares equal. The pool structure is always in internal memory, as compare-and-set doesn't work on external RAM.
+*/
+#define POOL_INDEX_NONE 0xFFFF
+#define POOL_MAX_OBJECTS POOL_INDEX_NONE
+#define POOL_HEAD_INDEX(HEAD) ((HEAD) & 0xFFFF)
+#define POOL_HEAD(TAG_FROM, INDEX) ((((TAG_FROM) + 0x10000) & 0xFFFF0000) | (INDEX))
+
+struct esp_pool {
+    volatile uint32_t head;
+    volatile uint32_t num_used;
+    volatile uint32_t peak_used;
+    volatile uint32_t failed_allocs;
+    portMUX_TYPE mux;
+    uint32_t flags;
+    uint32_t caps;
+    size_t object_size;
+    size_t num_objects;
+    intptr_t start;
+    const char *name;
+    SLIST_ENTRY(esp_pool) next;
+};
+
+static SLIST_HEAD(esp_pool_ll, esp_pool) registered_pools = SLIST_HEAD_INITIALIZER(registered_pools);
+static portMUX_TYPE registered_pools_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline IRAM_ATTR volatile uint32_t *pool_object_next(esp_pool_handle_t pool, uint32_t index)
+{
+    return (volatile uint32_t *)(pool->start + index * pool->object_size);
+}
+
+/* Atomically set *addr to 'set' if it is equal to 'compare'. Returns the previous value of *addr. */
+static inline IRAM_ATTR uint32_t pool_compare_set(volatile uint32_t *addr, uint32_t compare, uint32_t set)
+{
+    uxPortCompareSet(addr, compare, &set);
+    return set;
+}
+
+static IRAM_ATTR uint32_t pool_atomic_add(volatile uint32_t *addr, int32_t delta)
+{
+    uint32_t old = *addr;
+    while (true) {
+        uint32_t prev = pool_compare_set(addr, old, old + delta);
+        if (prev == old) {
+            return old + delta;
+        }
+        old = prev;
+    }
+}
+
+static IRAM_ATTR void pool_update_peak(esp_pool_handle_t pool, uint32_t used)
+{
+    uint32_t peak = pool->peak_used;
+    while (used > peak) {
+        uint32_t prev = pool_compare_set(&pool->peak_used, peak, used);
+        if (prev == peak) {
+            break;
+        }
+        peak = prev;
+    }
+}
+
+esp_pool_handle_t esp_pool_create(const char *name, size_t object_size, size_t num_objects, uint32_t caps, uint32_t flags)
+{
+    if (object_size == 0 || num_objects == 0 || num_objects > POOL_MAX_OBJECTS) {
+        return NULL;
+    }
+    //Objects must be able to hold the index of the next free object, and stay aligned
+    object_size = (object_size + 3) & (~3);
+    if (object_size == 0 || object_size > SIZE_MAX / num_objects) {
+        return NULL;
+    }
+
+    esp_pool_handle_t pool = heap_caps_malloc(sizeof(struct esp_pool), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (pool == NULL) {
+        return NULL;
+    }
+    void *start = heap_caps_malloc(object_size * num_objects, caps);
+    if (start == NULL) {
+        heap_caps_free(pool);
+        return NULL;
+    }
+
+    memset(pool, 0, sizeof(struct esp_pool));
+    vPortCPUInitializeMutex(&pool->mux);
+    pool->flags = flags;
+    pool->caps = caps;
+    pool->object_size = object_size;
+    pool->num_objects = num_objects;
+    pool->start = (intptr_t)start;
+    pool->name = name;
+
+    for (uint32_t i = 0; i < num_objects; i++) {
+        *pool_object_next(pool, i) = (i + 1 < num_objects) ? i + 1 : POOL_INDEX_NONE;
+    }
+    pool->head = 0;
+
+    portENTER_CRITICAL(&registered_pools_mux);
+    SLIST_INSERT_HEAD(&registered_pools, pool, next);
+    portEXIT_CRITICAL(&registered_pools_mux);
+
+    return pool;
+}
+
+void esp_pool_delete(esp_pool_handle_t pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    assert(pool->num_used == 0 && "esp_pool_delete() pool still has objects in use");
+
+    portENTER_CRITICAL(&registered_pools_mux);
+    SLIST_REMOVE(&registered_pools, pool, esp_pool, next);
+    portEXIT_CRITICAL(&registered_pools_mux);
+
+    heap_caps_free((void *)pool->start);
+    heap_caps_free(pool);
+}
+
+IRAM_ATTR void *esp_pool_alloc(esp_pool_handle_t pool)
+{
+    uint32_t index;
+
+    if (pool->flags & ESP_POOL_FLAG_LOCK_FREE) {
+        uint32_t head = pool->head;
+        while (true) {
+            index = POOL_HEAD_INDEX(head);
+            if (index == POOL_INDEX_NONE) {
+                pool_atomic_add(&pool->failed_allocs, 1);
+                return NULL;
+            }
+            //If another CPU takes this object first, this read may be stale but then the compare-and-set fails
+            uint32_t next = *pool_object_next(pool, index);
+            uint32_t prev = pool_compare_set(&pool->head, head, POOL_HEAD(head, next));
+            if (prev == head) {
+                break;
+            }
+            head = prev;
+        }
+        pool_update_peak(pool, pool_atomic_add(&pool->num_used, 1));
+    } else {
+        portENTER_CRITICAL(&pool->mux);
+        index = POOL_HEAD_INDEX(pool->head);
+        if (index == POOL_INDEX_NONE) {
+            pool->failed_allocs++;
+            portEXIT_CRITICAL(&pool->mux);
+            return NULL;
+        }
+        pool->head = *pool_object_next(pool, index);
+        if (++pool->num_used > pool->peak_used) {
+            pool->peak_used = pool->num_used;
+        }
+        portEXIT_CRITICAL(&pool->mux);
+    }
+
+    return (void *)(pool->start + index * pool->object_size);
+}
+
+IRAM_ATTR void esp_pool_free(esp_pool_handle_t pool, void *obj)
+{
+    if (obj == NULL) {
+        return;
+    }
+    assert(esp_pool_contains(pool, obj) && "esp_pool_free() target pointer is not an object in this pool");
+    uint32_t index = ((intptr_t)obj - pool->start) / pool->object_size;
+
+    if (pool->flags & ESP_POOL_FLAG_LOCK_FREE) {
+        //Count the object as free before it can be taken again, so the peak never exceeds the number of objects
+        pool_atomic_add(&pool->num_used, -1);
+        uint32_t head = pool->head;
+        while (true) {
+            *pool_object_next(pool, index) = POOL_HEAD_INDEX(head);
+            uint32_t prev = pool_compare_set(&pool->head, head, POOL_HEAD(head, index));
+            if (prev == head) {
+                break;
+            }
+            head = prev;
+        }
+    } else {
+        portENTER_CRITICAL(&pool->mux);
+        *pool_object_next(pool, index) = POOL_HEAD_INDEX(pool->head);
+        pool->head = index;
+        pool->num_used--;
+        portEXIT_CRITICAL(&pool->mux);
+    }
+}
+
+IRAM_ATTR bool esp_pool_contains(esp_pool_handle_t pool, const void *ptr)
+{
+    intptr_t p = (intptr_t)ptr;
+    return p >= pool->start
+        && p < pool->start + pool->num_objects * pool->object_size
+        && (p - pool->start) % pool->object_size == 0;
+}
+
+void esp_pool_get_info(esp_pool_handle_t pool, esp_pool_info_t *info)
+{
+    memset(info, 0, sizeof(esp_pool_info_t));
+    info->object_size = pool->object_size;
+    info->total_objects = pool->num_objects;
+    info->free_objects = pool->num_objects - pool->num_used;
+    info->peak_used_objects = pool->peak_used;
+    info->failed_allocs = pool->failed_allocs;
+}
+
+/* Fields of a pool printed by the dump functions */
+typedef struct {
+    const char *name;
+    intptr_t start;
+    uint32_t caps;
+    uint32_t flags;
+    esp_pool_info_t info;
+} pool_dump_t;
+
+/* Number of pools copied per pass of esp_pool_dump_region() */
+#define POOL_DUMP_BATCH 4
+
+static void pool_dump_copy(esp_pool_handle_t pool, pool_dump_t *dump)
+{
+    dump->name = pool->name;
+    dump->start = pool->start;
+    dump->caps = pool->caps;
+    dump->flags = pool->flags;
+    esp_pool_get_info(pool, &dump->info);
+}
+
+static void pool_dump_print(const pool_dump_t *dump)
+{
+    ets_printf("Pool %s at %p caps 0x%08x: %d objects of %d bytes, %d free, peak %d used, %d failed allocs%s\n",
+               dump->name ? dump->name : "(unnamed)", (void *)dump->start, dump->caps, dump->info.total_objects,
+               dump->info.object_size, dump->info.free_objects, dump->info.peak_used_objects, dump->info.failed_allocs,
+               (dump->flags & ESP_POOL_FLAG_LOCK_FREE) ? ", lock-free" : "");
+}
+
+void esp_pool_dump(esp_pool_handle_t pool)
+{
+    pool_dump_t dump;
+    pool_dump_copy(pool, &dump);
+    pool_dump_print(&dump);
+}
+
+void esp_pool_dump_region(intptr_t start, intptr_t end)
+{
+    pool_dump_t batch[POOL_DUMP_BATCH];
+    size_t done = 0;
+    size_t count;
+    do {
+        /* Copy a few pools under the list lock, so a pool can't be deleted while it is read,
+           then print them with the lock released as printing is slow. A pool created or
+           deleted between two passes may be skipped or printed twice. */
+        esp_pool_handle_t pool;
+        size_t index = 0;
+        count = 0;
+        portENTER_CRITICAL(&registered_pools_mux);
+        SLIST_FOREACH(pool, &registered_pools, next) {
+            if (pool->start < start || pool->start >= end || index++ < done) {
+                continue;
+            }
+            if (count == POOL_DUMP_BATCH) {
+                break;
+            }
+            pool_dump_copy(pool, &batch[count++]);
+        }
+        portEXIT_CRITICAL(&registered_pools_mux);
+
+        for (size_t i = 0; i < count; i++) {
+            pool_dump_print(&batch[i]);
+        }
+        done += count;
+    } while (count == POOL_DUMP_BATCH);
+}
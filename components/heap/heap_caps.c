@@ -55,6 +55,239 @@ IRAM_ATTR static void *dram_alloc_to_iram_addr(void *addr, size_t len)
     return (void *)(iptr + 1);
 }
 
+#ifdef CONFIG_HEAP_SLAB_CACHE
+/*
+ Slab cache for small allocations.
+
+ Allocations of up to SLAB_MAX_SIZE bytes, which only ask for plain internal memory, are served from a cache of fixed
+ size objects instead of from the heaps, so they don't take the per-heap lock.
+
+ The cache takes SLAB_CHUNK_SIZE chunks from the internal heaps when it needs them (up to
+ CONFIG_HEAP_SLAB_CACHE_MAX_CHUNKS chunks), and divides each chunk into SLAB_PAGE_SIZE pages. When a size class runs out
+ of objects, an unused page is assigned to it and carved into objects of that size. Chunks are never returned to the
+ heaps.
+
+ Free objects are kept in a small "magazine" for each size class on each CPU. Magazines are only touched by their own
+ CPU with interrupts disabled, so the common case takes no lock at all. When a magazine runs empty or full, half a
+ magazine of objects is moved from or to the "depot" free list for the size class, which is shared between CPUs and
+ protected by slab_mux.
+*/
+#define SLAB_NUM_CLASSES 6
+#define SLAB_MAX_SIZE 128
+#define SLAB_PAGE_SIZE 512
+#define SLAB_CHUNK_SIZE 4096
+#define SLAB_PAGES_PER_CHUNK (SLAB_CHUNK_SIZE / SLAB_PAGE_SIZE)
+#define SLAB_MAGAZINE_SIZE 8
+#define SLAB_PAGE_UNUSED 0xFF
+
+/* Capabilities which every object in the cache has */
+#define SLAB_CACHE_CAPS (MALLOC_CAP_8BIT | MALLOC_CAP_32BIT | MALLOC_CAP_INTERNAL | MALLOC_CAP_DEFAULT)
+
+static const uint16_t slab_class_size[SLAB_NUM_CLASSES] = { 16, 32, 48, 64, 96, 128 };
+
+/* Size class for each 16 byte step of allocation size */
+static const uint8_t slab_size_to_class[SLAB_MAX_SIZE / 16] = { 0, 1, 2, 3, 4, 4, 5, 5 };
+
+typedef struct slab_object {
+    struct slab_object *next; /* Next free object in the depot, valid if object is free */
+} slab_object_t;
+
+typedef struct {
+    size_t count;
+    slab_object_t *objects[SLAB_MAGAZINE_SIZE];
+} slab_magazine_t;
+
+typedef struct {
+    intptr_t start;
+    uint8_t page_class[SLAB_PAGES_PER_CHUNK]; /* Size class of each page, or SLAB_PAGE_UNUSED */
+} slab_chunk_t;
+
+static portMUX_TYPE slab_mux = portMUX_INITIALIZER_UNLOCKED;
+static slab_magazine_t slab_magazines[portNUM_PROCESSORS][SLAB_NUM_CLASSES];
+static slab_object_t *slab_depot[SLAB_NUM_CLASSES];
+static slab_chunk_t slab_chunks[CONFIG_HEAP_SLAB_CACHE_MAX_CHUNKS];
+static volatile size_t slab_num_chunks;
+
+/* Find the chunk holding 'p', or return NULL if 'p' isn't a slab object */
+IRAM_ATTR static slab_chunk_t *slab_find_chunk(intptr_t p)
+{
+    for (size_t i = 0; i < slab_num_chunks; i++) {
+        if (p >= slab_chunks[i].start && p < slab_chunks[i].start + SLAB_CHUNK_SIZE) {
+            return &slab_chunks[i];
+        }
+    }
+    return NULL;
+}
+
+/* Assign an unused page to size class 'cls' and put all of its objects in the depot.
+   Call with slab_mux held. Returns false if all pages are in use. */
+IRAM_ATTR static bool slab_carve_page(int cls)
+{
+    for (size_t i = 0; i < slab_num_chunks; i++) {
+        slab_chunk_t *chunk = &slab_chunks[i];
+        for (int page = 0; page < SLAB_PAGES_PER_CHUNK; page++) {
+            if (chunk->page_class[page] == SLAB_PAGE_UNUSED) {
+                chunk->page_class[page] = cls;
+                intptr_t start = chunk->start + page * SLAB_PAGE_SIZE;
+                for (intptr_t p = start; p + slab_class_size[cls] <= start + SLAB_PAGE_SIZE; p += slab_class_size[cls]) {
+                    slab_object_t *obj = (slab_object_t *)p;
+                    obj->next = slab_depot[cls];
+                    slab_depot[cls] = obj;
+                }
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* Take a new chunk from the heaps. Returns false if the cache is already at its maximum size, or there is no memory. */
+IRAM_ATTR static bool slab_add_chunk(void)
+{
+    if (slab_num_chunks == CONFIG_HEAP_SLAB_CACHE_MAX_CHUNKS) {
+        return false;
+    }
+    //SLAB_CHUNK_SIZE is larger than SLAB_MAX_SIZE, so this comes from the heaps not from the cache
+    void *start = heap_caps_malloc(SLAB_CHUNK_SIZE, SLAB_CACHE_CAPS);
+    if (start == NULL) {
+        return false;
+    }
+
+    bool added = false;
+    portENTER_CRITICAL(&slab_mux);
+    if (slab_num_chunks < CONFIG_HEAP_SLAB_CACHE_MAX_CHUNKS) {
+        slab_chunk_t *chunk = &slab_chunks[slab_num_chunks];
+        chunk->start = (intptr_t)start;
+        memset(chunk->page_class, SLAB_PAGE_UNUSED, sizeof(chunk->page_class));
+        slab_num_chunks++;
+        added = true;
+    }
+    portEXIT_CRITICAL(&slab_mux);
+
+    if (!added) {
+        //Another task added the last chunk first
+        heap_caps_free(start);
+    }
+    return true;
+}
+
+/* Move up to 'max' objects of size class 'cls' from the depot to 'objs', carving a new page if the depot is empty */
+IRAM_ATTR static size_t slab_depot_take(int cls, slab_object_t **objs, size_t max)
+{
+    size_t n = 0;
+    portENTER_CRITICAL(&slab_mux);
+    if (slab_depot[cls] == NULL) {
+        slab_carve_page(cls);
+    }
+    while (n < max && slab_depot[cls] != NULL) {
+        objs[n++] = slab_depot[cls];
+        slab_depot[cls] = slab_depot[cls]->next;
+    }
+    portEXIT_CRITICAL(&slab_mux);
+    return n;
+}
+
+/* Move 'n' objects of size class 'cls' from 'objs' to the depot */
+IRAM_ATTR static void slab_depot_put(int cls, slab_object_t **objs, size_t n)
+{
+    portENTER_CRITICAL(&slab_mux);
+    while (n > 0) {
+        slab_object_t *obj = objs[--n];
+        obj->next = slab_depot[cls];
+        slab_depot[cls] = obj;
+    }
+    portEXIT_CRITICAL(&slab_mux);
+}
+
+/* Allocate an object which can hold 'size' (1..SLAB_MAX_SIZE) bytes. Returns NULL if the cache is exhausted. */
+IRAM_ATTR static void *slab_malloc(size_t size)
+{
+    const int cls = slab_size_to_class[(size - 1) / 16];
+    slab_object_t *obj = NULL;
+
+    uint32_t state = portENTER_CRITICAL_NESTED();
+    slab_magazine_t *mag = &slab_magazines[xPortGetCoreID()][cls];
+    if (mag->count > 0) {
+        obj = mag->objects[--mag->count];
+    }
+    portEXIT_CRITICAL_NESTED(state);
+    if (obj != NULL) {
+        return obj;
+    }
+
+    //Magazine is empty, refill it from the depot
+    slab_object_t *objs[SLAB_MAGAZINE_SIZE / 2];
+    size_t n = slab_depot_take(cls, objs, SLAB_MAGAZINE_SIZE / 2);
+    if (n == 0) {
+        if (!slab_add_chunk()) {
+            return NULL;
+        }
+        n = slab_depot_take(cls, objs, SLAB_MAGAZINE_SIZE / 2);
+        if (n == 0) {
+            return NULL;
+        }
+    }
+    obj = objs[--n];
+
+    //The task may have moved to the other CPU or been preempted meanwhile, so anything which doesn't fit in the
+    //current CPU's magazine goes back to the depot
+    state = portENTER_CRITICAL_NESTED();
+    mag = &slab_magazines[xPortGetCoreID()][cls];
+    while (n > 0 && mag->count < SLAB_MAGAZINE_SIZE) {
+        mag->objects[mag->count++] = objs[--n];
+    }
+    portEXIT_CRITICAL_NESTED(state);
+    if (n > 0) {
+        slab_depot_put(cls, objs, n);
+    }
+    return obj;
+}
+
+/* Return the usable size of slab object 'ptr', or 0 if 'ptr' isn't a slab object */
+IRAM_ATTR static size_t slab_object_size(void *ptr)
+{
+    slab_chunk_t *chunk = slab_find_chunk((intptr_t)ptr);
+    if (chunk == NULL) {
+        return 0;
+    }
+    int cls = chunk->page_class[((intptr_t)ptr - chunk->start) / SLAB_PAGE_SIZE];
+    assert(cls != SLAB_PAGE_UNUSED && "pointer is in an unused slab page");
+    return slab_class_size[cls];
+}
+
+/* Free 'ptr' if it is a slab object. Returns false if it isn't one. */
+IRAM_ATTR static bool slab_free(void *ptr)
+{
+    slab_chunk_t *chunk = slab_find_chunk((intptr_t)ptr);
+    if (chunk == NULL) {
+        return false;
+    }
+    intptr_t offset = (intptr_t)ptr - chunk->start;
+    int cls = chunk->page_class[offset / SLAB_PAGE_SIZE];
+    assert(cls != SLAB_PAGE_UNUSED && "free() target pointer is in an unused slab page");
+    assert((offset % SLAB_PAGE_SIZE) % slab_class_size[cls] == 0 && "free() target pointer is not a slab object");
+
+    slab_object_t *spill[SLAB_MAGAZINE_SIZE / 2];
+    size_t n = 0;
+
+    uint32_t state = portENTER_CRITICAL_NESTED();
+    slab_magazine_t *mag = &slab_magazines[xPortGetCoreID()][cls];
+    if (mag->count == SLAB_MAGAZINE_SIZE) {
+        //Magazine is full, move half of it to the depot
+        while (n < SLAB_MAGAZINE_SIZE / 2) {
+            spill[n++] = mag->objects[--mag->count];
+        }
+    }
+    mag->objects[mag->count++] = ptr;
+    portEXIT_CRITICAL_NESTED(state);
+
+    if (n > 0) {
+        slab_depot_put(cls, spill, n);
+    }
+    return true;
+}
+#endif //CONFIG_HEAP_SLAB_CACHE
+
 bool heap_caps_match(const heap_t *heap, uint32_t caps)
 {
     return heap->heap != NULL && ((get_all_caps(heap) & caps) == caps);
@@ -85,6 +318,16 @@ IRAM_ATTR void *heap_caps_malloc( size_t size, uint32_t caps )
         size = (size + 3) & (~3);
     }
 
+#ifdef CONFIG_HEAP_SLAB_CACHE
+    if (size > 0 && size <= SLAB_MAX_SIZE && (caps & ~SLAB_CACHE_CAPS) == 0) {
+        ret = slab_malloc(size);
+        if (ret != NULL) {
+            return ret;
+        }
+        //Cache is exhausted, allocate from the heaps instead
+    }
+#endif
+
     for (int prio = 0; prio < SOC_MEMORY_TYPE_NO_PRIOS; prio++) {
         //Iterate over heaps and check capabilities at this priority
         heap_t *heap;
@@ -264,6 +507,13 @@ IRAM_ATTR void heap_caps_free( void *ptr)
         ptr = (void *)dramAddrPtr[-1];
     }
 
+#ifdef CONFIG_HEAP_SLAB_CACHE
+    //Slab objects are inside a heap, but are not heap blocks
+    if (slab_free(ptr)) {
+        return;
+    }
+#endif
+
     heap_t *heap = find_containing_heap(ptr);
     assert(heap != NULL && "free() target pointer is outside heap areas");
     multi_heap_free(heap->heap, ptr);
@@ -280,6 +530,21 @@ IRAM_ATTR void *heap_caps_realloc( void *ptr, size_t size, int caps)
         return NULL;
     }
 
+#ifdef CONFIG_HEAP_SLAB_CACHE
+    size_t slab_size = slab_object_size(ptr);
+    if (slab_size > 0) {
+        if (size <= slab_size && (caps & ~SLAB_CACHE_CAPS) == 0) {
+            return ptr; // still fits in the same object
+        }
+        void *new_p = heap_caps_malloc(size, caps);
+        if (new_p != NULL) {
+            memcpy(new_p, ptr, MIN(size, slab_size));
+            slab_free(ptr);
+        }
+        return new_p;
+    }
+#endif
+
     heap_t *heap = find_containing_heap(ptr);
 
     assert(heap != NULL && "realloc() pointer is outside heap areas");
@@ -439,6 +704,7 @@ void heap_caps_dump(uint32_t caps)
         if (heap->heap != NULL
             && (all_heaps || (get_all_caps(heap) & caps) == caps)) {
             multi_heap_dump(heap->heap);
+            esp_pool_dump_region(heap->start, heap->end);
         }
     }
 }
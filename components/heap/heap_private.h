@@ -69,6 +69,9 @@ inline static IRAM_ATTR uint32_t get_all_caps(const heap_t *heap)
 void *heap_caps_realloc_default(void *p, size_t size);
 void *heap_caps_malloc_default(size_t size);
 
+/* Print every object pool (see esp_pool.h) whose storage starts between 'start' and 'end'. Called by heap_caps_dump(). */
+void esp_pool_dump_region(intptr_t start, intptr_t end);
+
 
 #ifdef __cplusplus
 }
@@ -53,6 +53,28 @@ static size_t total_frees;
 /* Has the buffer overflowed and lost trace entries? */
 static bool has_overflowed = false;
 
+/* Sampling profiler state.
+
+   Call sites are kept in an open-addressed hash table, keyed by call stack. A site entry with samples == 0 is unused.
+*/
+static bool sampling;
+static heap_trace_site_t *sites;
+static size_t total_sites;
+static size_t sample_interval;
+
+/* Bytes left to allocate on each CPU until the next sample is taken */
+static size_t bytes_until_sample[portNUM_PROCESSORS];
+
+/* State of the PRNG used to randomise the distance between samples */
+static uint32_t sample_rand = 1;
+
+/* Samples (and estimated bytes) which didn't fit in the call site table */
+static size_t dropped_samples;
+static size_t dropped_bytes;
+
+/* Number of table entries to probe before a sample is dropped, to bound the time spent in the critical section */
+#define SAMPLE_MAX_PROBES 8
+
 esp_err_t heap_trace_init_standalone(heap_trace_record_t *record_buffer, size_t num_records)
 {
 #ifndef CONFIG_HEAP_TRACING
@@ -189,6 +211,169 @@ void heap_trace_dump(void)
     }
 }
 
+/* Return a random distance to the next sample, averaging sample_interval bytes */
+static IRAM_ATTR size_t next_sample_distance(void)
+{
+    /* xorshift32, a data race between CPUs only makes it more random */
+    uint32_t x = sample_rand;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sample_rand = x;
+    return sample_interval / 2 + x % sample_interval;
+}
+
+esp_err_t heap_trace_sampling_init(heap_trace_site_t *site_buffer, size_t num_sites)
+{
+#ifndef CONFIG_HEAP_TRACING
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+
+    if (sampling) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    sites = site_buffer;
+    total_sites = num_sites;
+    memset(sites, 0, num_sites * sizeof(heap_trace_site_t));
+    return ESP_OK;
+}
+
+esp_err_t heap_trace_sampling_start(size_t sample_interval_param)
+{
+#ifndef CONFIG_HEAP_TRACING
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+
+    if (sites == NULL || total_sites == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (sample_interval_param == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&trace_mux);
+
+    sampling = false;
+    memset(sites, 0, total_sites * sizeof(heap_trace_site_t));
+    sample_interval = sample_interval_param;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        bytes_until_sample[i] = next_sample_distance();
+    }
+    dropped_samples = 0;
+    dropped_bytes = 0;
+    sampling = true;
+
+    portEXIT_CRITICAL(&trace_mux);
+    return ESP_OK;
+}
+
+esp_err_t heap_trace_sampling_stop(void)
+{
+#ifndef CONFIG_HEAP_TRACING
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+    if (!sampling) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    sampling = false;
+    return ESP_OK;
+}
+
+esp_err_t heap_trace_sampling_get(size_t index, heap_trace_site_t *site)
+{
+#ifndef CONFIG_HEAP_TRACING
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+    if (sites == NULL || site == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (index >= total_sites) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&trace_mux);
+    memcpy(site, &sites[index], sizeof(heap_trace_site_t));
+    portEXIT_CRITICAL(&trace_mux);
+    return (site->samples == 0) ? ESP_ERR_NOT_FOUND : ESP_OK;
+}
+
+void heap_trace_sampling_dump(FILE *stream)
+{
+#ifndef CONFIG_HEAP_TRACING
+    printf("no data, heap tracing is disabled.\n");
+    return;
+#endif
+    if (stream == NULL) {
+        stream = stdout;
+    }
+    for (int i = 0; i < total_sites; i++) {
+        heap_trace_site_t site;
+        if (heap_trace_sampling_get(i, &site) != ESP_OK) {
+            continue;
+        }
+        /* folded stacks start from the outermost caller */
+        bool first = true;
+        for (int j = STACK_DEPTH - 1; j >= 0; j--) {
+            if (site.callers[j] != NULL) {
+                fprintf(stream, "%s%p", first ? "" : ";", site.callers[j]);
+                first = false;
+            }
+        }
+        fprintf(stream, "%s %u\n", first ? "[unknown]" : "", site.bytes);
+    }
+    if (dropped_samples > 0) {
+        fprintf(stream, "[dropped] %u\n", dropped_bytes);
+    }
+}
+
+/* Count an allocation of 'size' bytes towards the next sample.
+
+   Returns the number of bytes the sample stands for, or 0 if this allocation isn't sampled. An allocation is sampled
+   with probability of about size / sample_interval, so each sample stands for max(size, sample_interval) bytes.
+*/
+static IRAM_ATTR size_t sample_allocation(size_t size)
+{
+    size_t *remaining = &bytes_until_sample[xPortGetCoreID()];
+    if (size < *remaining) {
+        *remaining -= size;
+        return 0;
+    }
+    *remaining = next_sample_distance();
+    return MAX(size, sample_interval);
+}
+
+/* Add a sampled allocation to the totals for its call site */
+static IRAM_ATTR void record_sample(void **callers, size_t bytes)
+{
+    /* FNV-1a over the call stack */
+    uint32_t hash = 2166136261;
+    for (int i = 0; i < STACK_DEPTH; i++) {
+        hash = (hash ^ (uint32_t)callers[i]) * 16777619;
+    }
+
+    portENTER_CRITICAL(&trace_mux);
+    if (sampling) {
+        size_t index = hash % total_sites;
+        int probe;
+        for (probe = 0; probe < SAMPLE_MAX_PROBES && probe < total_sites; probe++) {
+            heap_trace_site_t *site = &sites[index];
+            if (site->samples == 0) {
+                memcpy(site->callers, callers, sizeof(void *) * STACK_DEPTH);
+            } else if (memcmp(site->callers, callers, sizeof(void *) * STACK_DEPTH) != 0) {
+                index = (index + 1) % total_sites;
+                continue;
+            }
+            site->samples++;
+            site->bytes += bytes;
+            break;
+        }
+        if (probe == SAMPLE_MAX_PROBES || probe == total_sites) {
+            dropped_samples++;
+            dropped_bytes += bytes;
+        }
+    }
+    portEXIT_CRITICAL(&trace_mux);
+}
+
 /* Add a new allocation to the heap trace records */
 static IRAM_ATTR void record_allocation(const heap_trace_record_t *record)
 {
@@ -337,6 +522,14 @@ static IRAM_ATTR __attribute__((noinline)) void *trace_malloc(size_t size, uint3
         get_call_stack(rec.alloced_by);
         record_allocation(&rec);
     }
+    if (sampling && p != NULL) {
+        size_t bytes = sample_allocation(size);
+        if (bytes > 0) {
+            void *callers[STACK_DEPTH];
+            get_call_stack(callers);
+            record_sample(callers, bytes);
+        }
+    }
     return p;
 }
 
@@ -384,6 +577,13 @@ static IRAM_ATTR __attribute__((noinline)) void *trace_realloc(void *p, size_t s
         memcpy(rec.alloced_by, callers, sizeof(void *) * STACK_DEPTH);
         record_allocation(&rec);
     }
+    if (sampling && r != NULL) {
+        size_t bytes = sample_allocation(size);
+        if (bytes > 0) {
+            get_call_stack(callers);
+            record_sample(callers, bytes);
+        }
+    }
     return r;
 }
 
@@ -295,6 +295,8 @@ void *heap_caps_calloc_prefer( size_t n, size_t size, size_t num, ... );
  * - Address of next block in the heap.
  * - If the block is free, the address of the next free block is also printed.
  *
+ * After each heap, any object pools (see esp_pool.h) stored in that heap are printed with their statistics.
+ *
  * @param caps        Bitwise OR of MALLOC_CAP_* flags indicating the type
  *                    of memory
  */
@@ -15,6 +15,7 @@
 
 #include "sdkconfig.h"
 #include <stdint.h>
+#include <stdio.h>
 #include <esp_err.h>
 
 #ifdef __cplusplus
@@ -45,6 +46,16 @@ typedef struct {
     void *freed_by[CONFIG_HEAP_TRACING_STACK_DEPTH];   ///< Call stack of the caller which freed the memory (all zero if not freed.)
 } heap_trace_record_t;
 
+/**
+ * @brief Allocation call site data type, used by the sampling profiler. Stores totals for all sampled allocations made
+ * with the same call stack.
+ */
+typedef struct {
+    void *callers[CONFIG_HEAP_TRACING_STACK_DEPTH]; ///< Call stack of the call site.
+    uint32_t samples; ///< Number of sampled allocations made from this call site (zero if this entry is unused.)
+    size_t bytes;     ///< Estimated total number of bytes allocated from this call site.
+} heap_trace_site_t;
+
 /**
  * @brief Initialise heap tracing in standalone mode.
  * @note Standalone mode is the only mode currently supported.
@@ -139,6 +150,82 @@ esp_err_t heap_trace_get(size_t index, heap_trace_record_t *record);
  */
 void heap_trace_dump(void);
 
+/**
+ * @brief Initialise the sampling allocation profiler.
+ *
+ * The sampling profiler records roughly one in every N bytes allocated, rather than every allocation. Each sampled
+ * allocation's call stack is looked up in a table of call sites, and added to that call site's totals. This keeps the
+ * memory used by the profiler fixed, and the overhead low enough to leave it running in the field.
+ *
+ * The profiler is independent of the trace buffer, so it can run at the same time as heap_trace_start(). Frees are
+ * not recorded, so the profile shows where memory is allocated rather than where it is leaked.
+ *
+ * @param site_buffer Provide a buffer to use for the table of call sites. Must remain valid any time sampling is
+ * enabled, meaning it must be allocated from internal memory not in PSRAM.
+ * @param num_sites Size of the call site table, as number of site structures. When the table is full, samples from
+ * new call sites are counted as dropped.
+ * @return
+ *  - ESP_ERR_NOT_SUPPORTED Project was compiled without heap tracing enabled in menuconfig.
+ *  - ESP_ERR_INVALID_STATE Sampling is currently in progress.
+ *  - ESP_OK Sampling profiler initialised successfully.
+ */
+esp_err_t heap_trace_sampling_init(heap_trace_site_t *site_buffer, size_t num_sites);
+
+/**
+ * @brief Start the sampling allocation profiler, clearing any previous samples.
+ *
+ * @param sample_interval Average number of bytes allocated between samples. The exact distance between samples is
+ * randomised so that periodic allocation patterns are not missed. Allocations larger than the interval are always
+ * sampled.
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without heap tracing enabled in menuconfig.
+ * - ESP_ERR_INVALID_STATE A non-zero-length buffer has not been set via heap_trace_sampling_init().
+ * - ESP_ERR_INVALID_ARG sample_interval is zero.
+ * - ESP_OK Sampling is started.
+ */
+esp_err_t heap_trace_sampling_start(size_t sample_interval);
+
+/**
+ * @brief Stop the sampling allocation profiler. The samples collected so far are kept.
+ *
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without heap tracing enabled in menuconfig.
+ * - ESP_ERR_INVALID_STATE Sampling was not in progress.
+ * - ESP_OK Sampling stopped.
+ */
+esp_err_t heap_trace_sampling_stop(void);
+
+/**
+ * @brief Return an entry from the table of call sites
+ *
+ * @note It is safe to call this function while sampling is running.
+ *
+ * @param index Index (zero-based) of the entry to return, less than the num_sites passed to heap_trace_sampling_init().
+ * @param[out] site Entry where the call site will be copied.
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without heap tracing enabled in menuconfig.
+ * - ESP_ERR_INVALID_STATE Sampling profiler was not initialised.
+ * - ESP_ERR_INVALID_ARG Index is out of bounds for the table of call sites.
+ * - ESP_ERR_NOT_FOUND This entry of the table is unused.
+ * - ESP_OK Call site returned successfully.
+ */
+esp_err_t heap_trace_sampling_get(size_t index, heap_trace_site_t *site);
+
+/**
+ * @brief Dump the sampled allocation profile
+ *
+ * The profile is written in "folded stacks" format: one line per call site, holding the call stack (outermost caller
+ * first, frames separated by ';') followed by a space and the estimated number of bytes allocated. Samples which didn't
+ * fit in the table of call sites are shown as a single "[dropped]" call site. After converting the addresses to
+ * function names, this format can be passed to flamegraph.pl directly, or converted to other profile formats.
+ *
+ * @note It is safe to call this function while sampling is running.
+ *
+ * @param stream Stream to write the profile to, or NULL to write it to stdout. This can be a file, or a stream made
+ * with funopen() to send the profile elsewhere (for example, over the application trace channel.)
+ */
+void heap_trace_sampling_dump(FILE *stream);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,124 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Flags for esp_pool_create()
+ */
+#define ESP_POOL_FLAG_LOCK_FREE     (1<<0)  ///< Allocate and free objects with compare-and-set instead of a spinlock
+
+/** @brief Opaque handle to an object pool */
+typedef struct esp_pool *esp_pool_handle_t;
+
+/**
+ * @brief Statistics about an object pool, as returned by esp_pool_get_info()
+ */
+typedef struct {
+    size_t object_size;         ///< Size of each object, in bytes (rounded up to a multiple of 4)
+    size_t total_objects;       ///< Number of objects in the pool
+    size_t free_objects;        ///< Number of objects which are currently free
+    size_t peak_used_objects;   ///< Largest number of objects which have been in use at once (high-water mark)
+    size_t failed_allocs;       ///< Number of times esp_pool_alloc() returned NULL because the pool was empty
+} esp_pool_info_t;
+
+/**
+ * @brief Create a pool of fixed size objects
+ *
+ * The storage for all objects is allocated up front, as a single block with the given
+ * capabilities. Allocating and freeing objects from the pool then takes constant time
+ * and doesn't fragment the heaps.
+ *
+ * By default the pool's free list is protected by a spinlock. If ESP_POOL_FLAG_LOCK_FREE is
+ * set, it is updated with compare-and-set instead, so allocating and freeing never waits for
+ * another CPU.
+ *
+ * Pools are listed, along with their statistics, by heap_caps_dump() and heap_caps_dump_all().
+ *
+ * @param name        Name of the pool, shown by heap_caps_dump(). The string is not copied, so it
+ *                    must stay valid until the pool is deleted. Can be NULL.
+ * @param object_size Size of each object, in bytes
+ * @param num_objects Number of objects in the pool, at most 65535
+ * @param caps        Bitwise OR of MALLOC_CAP_* flags indicating the type of memory to hold the objects
+ * @param flags       Bitwise OR of ESP_POOL_FLAG_* flags, or 0
+ *
+ * @return Handle to the new pool, or NULL if the arguments are invalid or there is not enough memory
+ */
+esp_pool_handle_t esp_pool_create(const char *name, size_t object_size, size_t num_objects, uint32_t caps, uint32_t flags);
+
+/**
+ * @brief Delete a pool and free its storage
+ *
+ * All objects must have been returned to the pool with esp_pool_free() first.
+ *
+ * @param pool Pool to delete
+ */
+void esp_pool_delete(esp_pool_handle_t pool);
+
+/**
+ * @brief Allocate an object from a pool
+ *
+ * Can be called from an ISR.
+ *
+ * @param pool Pool to allocate from
+ *
+ * @return Pointer to an uninitialised object, or NULL if all objects in the pool are in use
+ */
+void *esp_pool_alloc(esp_pool_handle_t pool);
+
+/**
+ * @brief Return an object to the pool it was allocated from
+ *
+ * Can be called from an ISR.
+ *
+ * @param pool Pool the object was allocated from
+ * @param obj  Object returned by esp_pool_alloc(). Passing NULL does nothing.
+ */
+void esp_pool_free(esp_pool_handle_t pool, void *obj);
+
+/**
+ * @brief Check if a pointer is an object in the given pool
+ *
+ * @param pool Pool to check
+ * @param ptr  Pointer to check
+ *
+ * @return true if ptr points to the start of an object in the pool (whether it is in use or not)
+ */
+bool esp_pool_contains(esp_pool_handle_t pool, const void *ptr);
+
+/**
+ * @brief Get statistics about a pool
+ *
+ * @param pool Pool to query
+ * @param info Pointer to a structure which will be filled with the pool's statistics
+ */
+void esp_pool_get_info(esp_pool_handle_t pool, esp_pool_info_t *info);
+
+/**
+ * @brief Print statistics about a pool to serial
+ *
+ * @param pool Pool to print
+ */
+void esp_pool_dump(esp_pool_handle_t pool);
+
+#ifdef __cplusplus
+}
+#endif
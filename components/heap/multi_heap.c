@@ -76,19 +76,57 @@ struct heap_block;
    'header' holds a pointer to the next block (used or free) ORed with a free flag (the LSB of the pointer.) is_free() and get_next_block() utility functions allow typed access to these values.
 
    'next_free' is valid if the block is free and is a pointer to the next block in the free list.
+
+   With MULTI_HEAP_TLSF, the free list is replaced by a set of segregated free lists (see below). Free blocks are doubly
+   linked via 'next_free' & 'prev_free', and the last word of every free block is a "boundary tag" pointing back to the
+   block, so that the following block can find it in constant time when merging.
 */
 typedef struct heap_block {
     intptr_t header;                  /* Encodes next block in heap (used or unused) and also free/used flag */
     union {
         uint8_t data[1];              /* First byte of data, valid if block is used. Actual size of data is 'block_data_size(block)' */
-        struct heap_block *next_free; /* Pointer to next free block, valid if block is free */
+        struct {
+            struct heap_block *next_free; /* Pointer to next free block, valid if block is free */
+#ifdef MULTI_HEAP_TLSF
+            struct heap_block *prev_free; /* Pointer to previous free block in the same free list, valid if block is free */
+#endif
+        };
     };
 } heap_block_t;
 
 /* These masks apply to the 'header' field of heap_block_t */
 #define BLOCK_FREE_FLAG 0x1  /* If set, this block is free & next_free pointer is valid */
+#define BLOCK_PREV_FREE_FLAG 0x2 /* MULTI_HEAP_TLSF only. If set, the previous block is free & its boundary tag is valid */
 #define NEXT_BLOCK_MASK (~3) /* AND header with this mask to get pointer to next block (free or used) */
 
+#ifdef MULTI_HEAP_TLSF
+/* TLSF ("Two-Level Segregated Fit") free lists.
+
+   Free blocks are sorted by size into TLSF_FL_INDEX_COUNT * TLSF_SL_INDEX_COUNT lists. The first level index is the
+   power of two of the block size, the second level index divides each power of two into TLSF_SL_INDEX_COUNT equal
+   ranges. A bitmap for each level records which lists are non-empty, so finding a suitable free block takes a couple of
+   find-first-set operations regardless of how many free blocks there are.
+
+   Blocks smaller than TLSF_SMALL_BLOCK_SIZE all share the first first-level list. Blocks of 2^(TLSF_FL_INDEX_MAX + 1)
+   bytes or more all share the very last list.
+*/
+#define TLSF_SL_INDEX_COUNT_LOG2 3
+#define TLSF_SL_INDEX_COUNT (1 << TLSF_SL_INDEX_COUNT_LOG2)
+#define TLSF_ALIGN_SIZE_LOG2 (sizeof(void *) == 8 ? 3 : 2)
+#define TLSF_FL_INDEX_MAX 22
+#define TLSF_FL_INDEX_SHIFT (TLSF_SL_INDEX_COUNT_LOG2 + TLSF_ALIGN_SIZE_LOG2)
+#define TLSF_FL_INDEX_COUNT (TLSF_FL_INDEX_MAX - TLSF_FL_INDEX_SHIFT + 1)
+#define TLSF_SMALL_BLOCK_SIZE (1 << TLSF_FL_INDEX_SHIFT)
+
+/* Size of the boundary tag at the end of each free block */
+#define BOUNDARY_TAG_SIZE sizeof(heap_block_t *)
+
+/* Minimum data size of a block, so that it can hold the free list pointers and boundary tag once freed */
+#define TLSF_MIN_DATA_SIZE (sizeof(heap_block_t) - offsetof(heap_block_t, data) + BOUNDARY_TAG_SIZE)
+#else
+#define BOUNDARY_TAG_SIZE 0
+#endif
+
 /* Metadata header for the heap, stored at the beginning of heap space.
 
    'first_block' is a "fake" first block, minimum length, used to provide a pointer to the first used & free block in
@@ -102,6 +140,11 @@ typedef struct multi_heap_info {
     size_t free_bytes;
     size_t minimum_free_bytes;
     heap_block_t *last_block;
+#ifdef MULTI_HEAP_TLSF
+    uint32_t fl_bitmap;                         /* Bit N is set if sl_bitmap[N] is non-zero */
+    uint32_t sl_bitmap[TLSF_FL_INDEX_COUNT];    /* Bit M of sl_bitmap[N] is set if free_lists[N][M] is non-empty */
+    heap_block_t *free_lists[TLSF_FL_INDEX_COUNT][TLSF_SL_INDEX_COUNT];
+#endif
     heap_block_t first_block; /* initial 'free block', never allocated */
 } heap_t;
 
@@ -163,13 +206,19 @@ static void assert_valid_block(const heap_t *heap, const heap_block_t *block)
     if (heap < (const heap_t *)heap->last_block) {
         const heap_block_t *next = get_next_block(block);
         MULTI_HEAP_ASSERT(next >= &heap->first_block && next <= heap->last_block, block); // Next block not in heap
+#ifndef MULTI_HEAP_TLSF
         if (is_free(block)) {
+#else
+        if (is_free(block) && block->next_free != NULL) {
+#endif
             // Check block->next_free is valid
             MULTI_HEAP_ASSERT(block->next_free >= &heap->first_block && block->next_free <= heap->last_block, &block->next_free);
         }
     }
 }
 
+#ifndef MULTI_HEAP_TLSF
+
 /* Get the first free block before 'block' in the heap. 'block' can be a free block or in use.
 
    Result is always the closest free block to 'block' in the heap, that is located before 'block'. There may be multiple
@@ -312,6 +361,312 @@ static void split_if_necessary(heap_t *heap, heap_block_t *block, size_t size, h
     prev_free_block->next_free = new_block;
 }
 
+/* Find the smallest free block which can hold 'size' bytes of data, by walking the whole free list.
+
+   '*prev_free' is set to the free block before the result.
+*/
+static heap_block_t *find_free_block(heap_t *heap, size_t size, heap_block_t **prev_free)
+{
+    heap_block_t *best_block = NULL;
+    heap_block_t *prev = &heap->first_block;
+    size_t best_size = SIZE_MAX;
+
+    for (heap_block_t *b = heap->first_block.next_free; b != NULL; b = b->next_free) {
+        MULTI_HEAP_ASSERT(b > prev, &prev->next_free); // free blocks should be ascending in address
+        MULTI_HEAP_ASSERT(is_free(b), b); // block should be free
+        size_t bs = block_data_size(b);
+        if (bs >= size && bs < best_size) {
+            best_block = b;
+            best_size = bs;
+            *prev_free = prev;
+            if (bs == size) {
+                break; /* we've found a perfect sized block */
+            }
+        }
+        prev = b;
+    }
+    return best_block;
+}
+
+/* Take free block 'block' out of the free list. 'prev_free' is the free block before it. */
+static void remove_free_block(heap_t *heap, heap_block_t *block, heap_block_t *prev_free)
+{
+    prev_free->next_free = block->next_free;
+}
+
+/* Add 'block' to the free list. 'prev_free' is the free block before it (see get_prev_free_block()). */
+static void insert_free_block(heap_t *heap, heap_block_t *block, heap_block_t *prev_free)
+{
+    // freelist validity check
+    MULTI_HEAP_ASSERT(prev_free->next_free == NULL || prev_free->next_free > block, &prev_free->next_free);
+    block->next_free = prev_free->next_free;
+    prev_free->next_free = block;
+}
+
+#else // MULTI_HEAP_TLSF
+
+/* Return the boundary tag stored just before 'block'. This is only valid if the previous block is free. */
+static inline heap_block_t **get_boundary_tag(const heap_block_t *block)
+{
+    return (heap_block_t **)block - 1;
+}
+
+/* Index of the most significant set bit in 'x' */
+static inline int tlsf_fls(size_t x)
+{
+    return (int)(sizeof(unsigned long) * 8) - 1 - __builtin_clzl(x);
+}
+
+/* Find the free list which a free block of data size 'size' belongs in */
+static void tlsf_mapping_insert(size_t size, int *fl, int *sl)
+{
+    if (size < TLSF_SMALL_BLOCK_SIZE) {
+        *fl = 0;
+        *sl = size / (TLSF_SMALL_BLOCK_SIZE / TLSF_SL_INDEX_COUNT);
+    } else {
+        int f = tlsf_fls(size);
+        *sl = (size >> (f - TLSF_SL_INDEX_COUNT_LOG2)) ^ TLSF_SL_INDEX_COUNT;
+        *fl = f - (TLSF_FL_INDEX_SHIFT - 1);
+        if (*fl >= TLSF_FL_INDEX_COUNT) {
+            *fl = TLSF_FL_INDEX_COUNT - 1;
+            *sl = TLSF_SL_INDEX_COUNT - 1;
+        }
+    }
+}
+
+/* Find the first free list where every block can hold 'size' bytes of data */
+static void tlsf_mapping_search(size_t size, int *fl, int *sl)
+{
+    if (size >= TLSF_SMALL_BLOCK_SIZE) {
+        /* round up to the start of the next list, blocks in size's own list may be smaller than size */
+        size += (1 << (tlsf_fls(size) - TLSF_SL_INDEX_COUNT_LOG2)) - 1;
+    }
+    tlsf_mapping_insert(size, fl, sl);
+}
+
+/* Add free block 'block' to the head of its free list, and set up its boundary tag.
+
+   'prev_free' is unused, it is only needed by the address-ordered free list.
+*/
+static void insert_free_block(heap_t *heap, heap_block_t *block, heap_block_t *prev_free)
+{
+    int fl, sl;
+    tlsf_mapping_insert(block_data_size(block), &fl, &sl);
+
+    heap_block_t *head = heap->free_lists[fl][sl];
+    block->next_free = head;
+    block->prev_free = NULL;
+    if (head != NULL) {
+        head->prev_free = block;
+    }
+    heap->free_lists[fl][sl] = block;
+    heap->fl_bitmap |= 1U << fl;
+    heap->sl_bitmap[fl] |= 1U << sl;
+
+    heap_block_t *next = get_next_block(block);
+    *get_boundary_tag(next) = block;
+    next->header |= BLOCK_PREV_FREE_FLAG;
+}
+
+/* Take free block 'block' out of its free list. */
+static void remove_free_block(heap_t *heap, heap_block_t *block, heap_block_t *prev_free)
+{
+    int fl, sl;
+    tlsf_mapping_insert(block_data_size(block), &fl, &sl);
+
+    heap_block_t *next_free = block->next_free;
+    heap_block_t *prev = block->prev_free;
+    if (next_free != NULL) {
+        next_free->prev_free = prev;
+    }
+    if (prev != NULL) {
+        prev->next_free = next_free;
+    } else {
+        MULTI_HEAP_ASSERT(heap->free_lists[fl][sl] == block, &heap->free_lists[fl][sl]); // block should be head of its list
+        heap->free_lists[fl][sl] = next_free;
+        if (next_free == NULL) {
+            heap->sl_bitmap[fl] &= ~(1U << sl);
+            if (heap->sl_bitmap[fl] == 0) {
+                heap->fl_bitmap &= ~(1U << fl);
+            }
+        }
+    }
+
+    heap_block_t *next = get_next_block(block);
+    next->header &= ~BLOCK_PREV_FREE_FLAG;
+#ifdef MULTI_HEAP_POISONING_SLOW
+    /* the boundary tag becomes part of a data region, needs to be replaced with a fill pattern */
+    multi_heap_internal_poison_fill_region(get_boundary_tag(next), BOUNDARY_TAG_SIZE, true /* free */);
+#endif
+}
+
+/* Return the first block in free list fl/sl which can hold 'size' bytes of data */
+static heap_block_t *tlsf_first_fit(heap_t *heap, int fl, int sl, size_t size)
+{
+    heap_block_t *b = heap->free_lists[fl][sl];
+    while (b != NULL && block_data_size(b) < size) {
+        b = b->next_free;
+    }
+    return b;
+}
+
+/* Find a free block which can hold 'size' bytes of data, in constant time.
+
+   This is a "good fit" rather than a best fit: the result is the head of the first non-empty list whose blocks are all
+   big enough. '*prev_free' is set to NULL.
+*/
+static heap_block_t *find_free_block(heap_t *heap, size_t size, heap_block_t **prev_free)
+{
+    int fl, sl;
+    tlsf_mapping_search(size, &fl, &sl);
+    *prev_free = NULL;
+
+    uint32_t sl_map = heap->sl_bitmap[fl] & (~0U << sl);
+    if (sl_map == 0) {
+        /* Nothing in this first level list, use the smallest blocks from the next non-empty one */
+        uint32_t fl_map = heap->fl_bitmap & (~0U << (fl + 1));
+        if (fl_map == 0) {
+            /* No list where every block is big enough. Some blocks in the list for 'size' itself may still fit
+               (for example, when allocating the largest free block), so fall back to searching that list. */
+            tlsf_mapping_insert(size, &fl, &sl);
+            return tlsf_first_fit(heap, fl, sl, size);
+        }
+        fl = __builtin_ctz(fl_map);
+        sl_map = heap->sl_bitmap[fl];
+        MULTI_HEAP_ASSERT(sl_map != 0, &heap->sl_bitmap[fl]); // bitmaps should be consistent
+    }
+    sl = __builtin_ctz(sl_map);
+
+    /* Only the last list (which holds all oversized blocks) can contain blocks which are too small */
+    return tlsf_first_fit(heap, fl, sl, size);
+}
+
+/* Get the free block immediately before 'block' in the heap, using its boundary tag. 'block' can be a free block or in
+   use.
+
+   Unlike the address-ordered free list, this can't find a free block which isn't adjacent to 'block'. If the previous
+   block is in use, the result is heap->first_block (callers only merge with the result if it is adjacent to 'block'.)
+*/
+static heap_block_t *get_prev_free_block(heap_t *heap, const heap_block_t *block)
+{
+    assert(!is_first_block(heap, block)); /* can't look for a block before first_block */
+
+    if (block->header & BLOCK_PREV_FREE_FLAG) {
+        heap_block_t *prev = *get_boundary_tag(block);
+        // boundary tag should point to the adjacent free block
+        MULTI_HEAP_ASSERT(prev >= &heap->first_block && prev < block && is_free(prev) && get_next_block(prev) == block,
+                          get_boundary_tag(block));
+        return prev;
+    }
+    return &heap->first_block;
+}
+
+/* Merge some block 'a' into the following block 'b'.
+
+   If both blocks are free, resulting block is marked free.
+   If only one block is free, resulting block is marked in use. No data is moved.
+
+   This operation may fail if block 'a' is the first block or 'b' is the last block,
+   the caller should check block_data_size() to know if anything happened here or not.
+*/
+static heap_block_t *merge_adjacent(heap_t *heap, heap_block_t *a, heap_block_t *b)
+{
+    assert(a < b);
+
+    /* Can't merge header blocks, just return the non-header block as-is */
+    if (is_last_block(b)) {
+        return a;
+    }
+    if (is_first_block(heap, a)) {
+        return b;
+    }
+
+    MULTI_HEAP_ASSERT(get_next_block(a) == b, a); // Blocks should be in order
+
+    bool free = is_free(a) && is_free(b); /* merging two free blocks creates a free block */
+
+    /* The size of 'a' is changing, so it needs to go in a different free list (if any) */
+    if (is_free(a)) {
+        remove_free_block(heap, a, NULL);
+    }
+    if (is_free(b)) {
+        remove_free_block(heap, b, NULL);
+    }
+    if (!free && (is_free(a) || is_free(b))) {
+        heap->free_bytes -= block_data_size(is_free(a) ? a : b);
+    }
+
+    a->header = (b->header & NEXT_BLOCK_MASK) | (a->header & BLOCK_PREV_FREE_FLAG);
+    MULTI_HEAP_ASSERT((a->header & NEXT_BLOCK_MASK) != 0, a);
+    if (free) {
+        a->header |= BLOCK_FREE_FLAG;
+        insert_free_block(heap, a, NULL);
+
+        /* b's header can be put into the pool of free bytes */
+        heap->free_bytes += sizeof(a->header);
+    }
+
+#ifdef MULTI_HEAP_POISONING_SLOW
+    /* b's former block header needs to be replaced with a fill pattern */
+    multi_heap_internal_poison_fill_region(b, sizeof(heap_block_t), free);
+#endif
+
+    return a;
+}
+
+/* Split a block so it can hold at least 'size' bytes of data, making any spare
+   space into a new free block.
+
+   'block' should be marked in-use when this function is called.
+
+   'prev_free_block' is unused, it is only needed by the address-ordered free list.
+*/
+static void split_if_necessary(heap_t *heap, heap_block_t *block, size_t size, heap_block_t *prev_free_block)
+{
+    const size_t block_size = block_data_size(block);
+    MULTI_HEAP_ASSERT(!is_free(block), block); // split block shouldn't be free
+    MULTI_HEAP_ASSERT(size <= block_size, block); // size should be valid
+    size = ALIGN_UP(size);
+    if (size < TLSF_MIN_DATA_SIZE) {
+        size = TLSF_MIN_DATA_SIZE;
+    }
+    if (size >= block_size) {
+        return; /* no spare space */
+    }
+
+    /* can't split the head or tail block */
+    assert(!is_first_block(heap, block));
+    assert(!is_last_block(block));
+
+    heap_block_t *new_block = (heap_block_t *)(block->data + size);
+    heap_block_t *next_block = get_next_block(block);
+
+    if (is_free(next_block) && !is_last_block(next_block)) {
+        /* The next block is free, just extend it downwards. */
+        intptr_t next_header = next_block->header;
+        remove_free_block(heap, next_block, NULL);
+#ifdef MULTI_HEAP_POISONING_SLOW
+        /* next_block header needs to be replaced with a fill pattern */
+        multi_heap_internal_poison_fill_region(next_block, sizeof(heap_block_t), true /* free */);
+#endif
+        new_block->header = next_header;
+        /* Note: We have not introduced a new block header, hence the simple math. */
+        heap->free_bytes += block_size - size;
+    } else {
+        /* Insert a free block between the current and the next one. */
+        if (block_size < size + sizeof(heap_block_t) + BOUNDARY_TAG_SIZE) {
+            /* Can't split 'block' if we're not going to get a usable free block afterwards */
+            return;
+        }
+        new_block->header = (block->header & NEXT_BLOCK_MASK) | BLOCK_FREE_FLAG;
+        heap->free_bytes += block_size - size - sizeof(new_block->header);
+    }
+    block->header = (intptr_t)new_block | (block->header & BLOCK_PREV_FREE_FLAG);
+    insert_free_block(heap, new_block, NULL);
+}
+
+#endif // MULTI_HEAP_TLSF
+
 void *multi_heap_get_block_address_impl(multi_heap_block_handle_t block)
 {
     return ((char *)block + offsetof(heap_block_t, data));
@@ -333,7 +688,7 @@ multi_heap_handle_t multi_heap_register_impl(void *start_ptr, size_t size)
     heap_t *heap = (heap_t *)start;
     size = end - start;
 
-    if (end < start || size < sizeof(heap_t) + 2*sizeof(heap_block_t)) {
+    if (end < start || size < sizeof(heap_t) + 2*sizeof(heap_block_t) + BOUNDARY_TAG_SIZE) {
         return NULL; /* 'size' is too small to fit a heap here */
     }
     heap->lock = NULL;
@@ -342,7 +697,9 @@ multi_heap_handle_t multi_heap_register_impl(void *start_ptr, size_t size)
     /* first 'real' (allocatable) free block goes after the heap structure */
     heap_block_t *first_free_block = (heap_block_t *)(start + sizeof(heap_t));
     first_free_block->header = (intptr_t)heap->last_block | BLOCK_FREE_FLAG;
+#ifndef MULTI_HEAP_TLSF
     first_free_block->next_free = heap->last_block;
+#endif
 
     /* last block is 'free' but has a NULL next pointer */
     heap->last_block->header = BLOCK_FREE_FLAG;
@@ -351,7 +708,16 @@ multi_heap_handle_t multi_heap_register_impl(void *start_ptr, size_t size)
     /* first block also 'free' but has legitimate length,
        malloc will never allocate into this block. */
     heap->first_block.header = (intptr_t)first_free_block | BLOCK_FREE_FLAG;
+#ifndef MULTI_HEAP_TLSF
     heap->first_block.next_free = first_free_block;
+#else
+    /* first_block & last_block are never in any of the free lists */
+    heap->first_block.next_free = NULL;
+    heap->fl_bitmap = 0;
+    memset(heap->sl_bitmap, 0, sizeof(heap->sl_bitmap));
+    memset(heap->free_lists, 0, sizeof(heap->free_lists));
+    insert_free_block(heap, first_free_block, NULL);
+#endif
 
     /* free bytes is:
        - total bytes in heap
@@ -405,13 +771,16 @@ void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
 {
     heap_block_t *best_block = NULL;
     heap_block_t *prev_free = NULL;
-    heap_block_t *prev = NULL;
-    size_t best_size = SIZE_MAX;
     size = ALIGN_UP(size);
 
     if (size == 0 || heap == NULL) {
         return NULL;
     }
+#ifdef MULTI_HEAP_TLSF
+    if (size < TLSF_MIN_DATA_SIZE) {
+        size = TLSF_MIN_DATA_SIZE;
+    }
+#endif
 
     multi_heap_internal_lock(heap);
 
@@ -426,28 +795,14 @@ void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
     }
 
     /* Find best free block to perform the allocation in */
-    prev = &heap->first_block;
-    for (heap_block_t *b = heap->first_block.next_free; b != NULL; b = b->next_free) {
-        MULTI_HEAP_ASSERT(b > prev, &prev->next_free); // free blocks should be ascending in address
-        MULTI_HEAP_ASSERT(is_free(b), b); // block should be free
-        size_t bs = block_data_size(b);
-        if (bs >= size && bs < best_size) {
-            best_block = b;
-            best_size = bs;
-            prev_free = prev;
-            if (bs == size) {
-                break; /* we've found a perfect sized block */
-            }
-        }
-        prev = b;
-    }
+    best_block = find_free_block(heap, size, &prev_free);
 
     if (best_block == NULL) {
         multi_heap_internal_unlock(heap);
         return NULL; /* No room in heap */
     }
 
-    prev_free->next_free = best_block->next_free;
+    remove_free_block(heap, best_block, prev_free);
     best_block->header &= ~BLOCK_FREE_FLAG;
 
     heap->free_bytes -= block_data_size(best_block);
@@ -482,10 +837,7 @@ void multi_heap_free_impl(multi_heap_handle_t heap, void *p)
 
     /* Update freelist pointers */
     heap_block_t *prev_free = get_prev_free_block(heap, pb);
-    // freelist validity check
-    MULTI_HEAP_ASSERT(prev_free->next_free == NULL || prev_free->next_free > pb, &prev_free->next_free);
-    pb->next_free = prev_free->next_free;
-    prev_free->next_free = pb;
+    insert_free_block(heap, pb, prev_free);
 
     /* Mark this block as free */
     pb->header |= BLOCK_FREE_FLAG;
@@ -606,6 +958,52 @@ void *multi_heap_realloc_impl(multi_heap_handle_t heap, void *p, size_t size)
     }                                                                   \
     while(0)
 
+#ifdef MULTI_HEAP_TLSF
+/* Check the TLSF free lists and bitmaps are consistent, and that the lists hold exactly 'num_free' blocks */
+static bool check_free_lists(heap_t *heap, size_t num_free, bool print_errors)
+{
+    bool valid = true;
+    size_t count = 0;
+
+    for (int fl = 0; fl < TLSF_FL_INDEX_COUNT; fl++) {
+        if (((heap->fl_bitmap >> fl) & 1) != (heap->sl_bitmap[fl] != 0)) {
+            FAIL_PRINT("CORRUPT HEAP: First level bitmap 0x%08x doesn't match second level bitmap %d\n",
+                       (unsigned)heap->fl_bitmap, fl);
+        }
+        for (int sl = 0; sl < TLSF_SL_INDEX_COUNT; sl++) {
+            if (((heap->sl_bitmap[fl] >> sl) & 1) != (heap->free_lists[fl][sl] != NULL)) {
+                FAIL_PRINT("CORRUPT HEAP: Second level bitmap 0x%08x doesn't match free list %d\n",
+                           (unsigned)heap->sl_bitmap[fl], sl);
+            }
+            heap_block_t *prev = NULL;
+            for (heap_block_t *b = heap->free_lists[fl][sl]; b != NULL; b = b->next_free) {
+                if (b <= &heap->first_block || b >= heap->last_block || !is_free(b)) {
+                    FAIL_PRINT("CORRUPT HEAP: Free list entry %p is not a free block\n", b);
+                    return false;
+                }
+                if (++count > num_free) {
+                    FAIL_PRINT("CORRUPT HEAP: Free lists hold more than %u free blocks\n", (unsigned)num_free);
+                    return false;
+                }
+                if (b->prev_free != prev) {
+                    FAIL_PRINT("CORRUPT HEAP: Free block %p points back to %p not %p\n", b, b->prev_free, prev);
+                }
+                int block_fl, block_sl;
+                tlsf_mapping_insert(block_data_size(b), &block_fl, &block_sl);
+                if (block_fl != fl || block_sl != sl) {
+                    FAIL_PRINT("CORRUPT HEAP: Free block %p is in the wrong free list\n", b);
+                }
+                prev = b;
+            }
+        }
+    }
+    if (count != num_free) {
+        FAIL_PRINT("CORRUPT HEAP: Expected %u blocks in free lists, found %u\n", (unsigned)num_free, (unsigned)count);
+    }
+    return valid;
+}
+#endif
+
 bool multi_heap_check(multi_heap_handle_t heap, bool print_errors)
 {
     bool valid = true;
@@ -615,8 +1013,12 @@ bool multi_heap_check(multi_heap_handle_t heap, bool print_errors)
     multi_heap_internal_lock(heap);
 
     heap_block_t *prev = NULL;
+#ifndef MULTI_HEAP_TLSF
     heap_block_t *prev_free = NULL;
     heap_block_t *expected_free = NULL;
+#else
+    size_t num_free = 0;
+#endif
 
     /* note: not using get_next_block() in loop, so that assertions aren't checked here */
     for(heap_block_t *b = &heap->first_block; b != NULL; b = (heap_block_t *)(b->header & NEXT_BLOCK_MASK)) {
@@ -636,12 +1038,23 @@ bool multi_heap_check(multi_heap_handle_t heap, bool print_errors)
             if (prev != NULL && is_free(prev) && !is_first_block(heap, prev) && !is_last_block(b)) {
                 FAIL_PRINT("CORRUPT HEAP: Two adjacent free blocks found, %p and %p\n", prev, b);
             }
+#ifndef MULTI_HEAP_TLSF
             if (expected_free != NULL && expected_free != b) {
                 FAIL_PRINT("CORRUPT HEAP: Prev free block %p pointed to next free %p but this free block is %p\n",
                        prev_free, expected_free, b);
             }
             prev_free = b;
             expected_free = b->next_free;
+#else
+            if (!is_first_block(heap, b) && !is_last_block(b)) {
+                const heap_block_t *next = (heap_block_t *)(b->header & NEXT_BLOCK_MASK);
+                if (next > b && next <= heap->last_block
+                    && (*get_boundary_tag(next) != b || !(next->header & BLOCK_PREV_FREE_FLAG))) {
+                    FAIL_PRINT("CORRUPT HEAP: Free block %p has no valid boundary tag\n", b);
+                }
+                num_free++;
+            }
+#endif
             if (!is_first_block(heap, b)) {
                 total_free_bytes += block_data_size(b);
             }
@@ -654,6 +1067,9 @@ bool multi_heap_check(multi_heap_handle_t heap, bool print_errors)
             bool poison_ok;
             if (is_free(b) && b != heap->last_block) {
                 uint32_t block_len = (intptr_t)get_next_block(b) - (intptr_t)b - sizeof(heap_block_t);
+                if (!is_first_block(heap, b)) {
+                    block_len -= BOUNDARY_TAG_SIZE; /* boundary tag is not filled */
+                }
                 poison_ok = multi_heap_internal_check_block_poisoning(&b[1], block_len, true, print_errors);
             }
             else {
@@ -672,6 +1088,10 @@ bool multi_heap_check(multi_heap_handle_t heap, bool print_errors)
         FAIL_PRINT("CORRUPT HEAP: Expected prev block %p to be free\n", heap->last_block);
     }
 
+#ifdef MULTI_HEAP_TLSF
+    valid = check_free_lists(heap, num_free, print_errors) && valid;
+#endif
+
     if (heap->free_bytes != total_free_bytes) {
         FAIL_PRINT("CORRUPT HEAP: Expected %u free bytes counted %u\n", (unsigned)heap->free_bytes, (unsigned)total_free_bytes);
     }
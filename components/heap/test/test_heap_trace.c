@@ -161,4 +161,34 @@ TEST_CASE("can trace allocations made by newlib", "[heap]")
 }
 
 
+TEST_CASE("heap trace sampling aggregates by call site", "[heap]")
+{
+    const size_t N = 16;
+    heap_trace_site_t sites[N];
+    TEST_ESP_OK(heap_trace_sampling_init(sites, N));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, heap_trace_sampling_start(0));
+
+    /* an interval of 1 byte samples every allocation */
+    TEST_ESP_OK(heap_trace_sampling_start(1));
+    for (int i = 0; i < 10; i++) {
+        void *p = malloc(100);
+        TEST_ASSERT_NOT_NULL(p);
+        free(p);
+    }
+    TEST_ESP_OK(heap_trace_sampling_stop());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, heap_trace_sampling_stop());
+
+    heap_trace_sampling_dump(NULL);
+
+    /* the loop above is a single call site, other tasks may have allocated meanwhile */
+    bool found = false;
+    for (int i = 0; i < N; i++) {
+        heap_trace_site_t site;
+        if (heap_trace_sampling_get(i, &site) == ESP_OK && site.samples == 10 && site.bytes == 1000) {
+            found = true;
+        }
+    }
+    TEST_ASSERT(found);
+}
+
 #endif
@@ -4,6 +4,7 @@
 
 #include <esp_types.h>
 #include <stdio.h>
+#include <string.h>
 #include "rom/ets_sys.h"
 
 #include "freertos/FreeRTOS.h"
@@ -127,3 +128,70 @@ TEST_CASE("unreasonable allocs should all fail", "[heap]")
     TEST_ASSERT_NULL(test_malloc_wrapper(xPortGetFreeHeapSize() - 1));
 }
 
+
+#ifdef CONFIG_HEAP_SLAB_CACHE
+
+#define SLAB_TEST_OBJECTS 100
+
+typedef struct {
+    void **objects;
+    SemaphoreHandle_t done;
+} slab_free_args_t;
+
+static void free_slab_objects_task(void *arg)
+{
+    slab_free_args_t *args = (slab_free_args_t *)arg;
+    for (int i = 0; i < SLAB_TEST_OBJECTS; i += 2) {
+        free(args->objects[i]);
+        args->objects[i] = NULL;
+    }
+    xSemaphoreGive(args->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("small allocations from the slab cache", "[heap]")
+{
+    void *p[SLAB_TEST_OBJECTS];
+
+    for (int i = 0; i < SLAB_TEST_OBJECTS; i++) {
+        size_t size = 1 + (i * 13) % 128;
+        p[i] = malloc(size);
+        TEST_ASSERT_NOT_NULL(p[i]);
+        memset(p[i], i, size);
+    }
+    /* no two objects may overlap */
+    for (int i = 0; i < SLAB_TEST_OBJECTS; i++) {
+        size_t size = 1 + (i * 13) % 128;
+        for (int j = 0; j < size; j++) {
+            TEST_ASSERT_EQUAL_HEX8(i, ((uint8_t *)p[i])[j]);
+        }
+    }
+
+    /* p[1] is 14 bytes: shrinking keeps it in place, growing moves it out of the cache */
+    void *q = realloc(p[1], 8);
+    TEST_ASSERT_EQUAL_PTR(p[1], q);
+    q = realloc(p[1], 1000);
+    TEST_ASSERT_NOT_NULL(q);
+    for (int j = 0; j < 8; j++) {
+        TEST_ASSERT_EQUAL_HEX8(1, ((uint8_t *)q)[j]);
+    }
+    p[1] = q;
+
+    /* objects freed on the other CPU go to that CPU's magazine */
+    slab_free_args_t args = {
+        .objects = p,
+        .done = xSemaphoreCreateBinary(),
+    };
+    TEST_ASSERT_NOT_NULL(args.done);
+    xTaskCreatePinnedToCore(free_slab_objects_task, "slabfree", 2048, &args, 5, NULL,
+                            (xPortGetCoreID() + 1) % portNUM_PROCESSORS);
+    TEST_ASSERT(xSemaphoreTake(args.done, 1000 / portTICK_PERIOD_MS));
+    vSemaphoreDelete(args.done);
+
+    for (int i = 0; i < SLAB_TEST_OBJECTS; i++) {
+        free(p[i]);
+    }
+    TEST_ASSERT(heap_caps_check_integrity_all(true));
+}
+
+#endif // CONFIG_HEAP_SLAB_CACHE
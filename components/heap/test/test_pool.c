@@ -0,0 +1,145 @@
+/*
+ Tests for fixed size object pools
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_pool.h"
+
+#define NUM_OBJECTS 16
+
+static void test_pool_alloc_free(uint32_t flags)
+{
+    void *objs[NUM_OBJECTS];
+    esp_pool_info_t info;
+
+    esp_pool_handle_t pool = esp_pool_create("test", 10, NUM_OBJECTS, MALLOC_CAP_8BIT, flags);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+        objs[i] = esp_pool_alloc(pool);
+        TEST_ASSERT_NOT_NULL(objs[i]);
+        TEST_ASSERT(esp_pool_contains(pool, objs[i]));
+        memset(objs[i], i, 10);
+    }
+    TEST_ASSERT_NULL(esp_pool_alloc(pool));
+
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+        for (int j = 0; j < 10; j++) {
+            TEST_ASSERT_EQUAL_HEX8(i, ((uint8_t *)objs[i])[j]);
+        }
+    }
+
+    esp_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(12, info.object_size);
+    TEST_ASSERT_EQUAL(NUM_OBJECTS, info.total_objects);
+    TEST_ASSERT_EQUAL(0, info.free_objects);
+    TEST_ASSERT_EQUAL(NUM_OBJECTS, info.peak_used_objects);
+    TEST_ASSERT_EQUAL(1, info.failed_allocs);
+
+    for (int i = 0; i < NUM_OBJECTS / 2; i++) {
+        esp_pool_free(pool, objs[i]);
+    }
+    esp_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(NUM_OBJECTS / 2, info.free_objects);
+    TEST_ASSERT_EQUAL(NUM_OBJECTS, info.peak_used_objects);
+
+    /* freed objects are handed out again */
+    for (int i = 0; i < NUM_OBJECTS / 2; i++) {
+        objs[i] = esp_pool_alloc(pool);
+        TEST_ASSERT_NOT_NULL(objs[i]);
+    }
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+        esp_pool_free(pool, objs[i]);
+    }
+    esp_pool_free(pool, NULL);
+
+    TEST_ASSERT_FALSE(esp_pool_contains(pool, (uint8_t *)objs[0] + 1));
+    heap_caps_dump_all();
+    esp_pool_delete(pool);
+}
+
+TEST_CASE("esp_pool alloc and free", "[heap]")
+{
+    test_pool_alloc_free(0);
+}
+
+TEST_CASE("esp_pool lock-free alloc and free", "[heap]")
+{
+    test_pool_alloc_free(ESP_POOL_FLAG_LOCK_FREE);
+}
+
+TEST_CASE("esp_pool invalid arguments", "[heap]")
+{
+    TEST_ASSERT_NULL(esp_pool_create(NULL, 0, 10, MALLOC_CAP_8BIT, 0));
+    TEST_ASSERT_NULL(esp_pool_create(NULL, 10, 0, MALLOC_CAP_8BIT, 0));
+    TEST_ASSERT_NULL(esp_pool_create(NULL, 10, 65536, MALLOC_CAP_8BIT, 0));
+    TEST_ASSERT_NULL(esp_pool_create(NULL, SIZE_MAX / 2, 4, MALLOC_CAP_8BIT, 0));
+    TEST_ASSERT_NULL(esp_pool_create(NULL, 16 * 1024, 1024, MALLOC_CAP_8BIT, 0));
+}
+
+#define STRESS_ITERATIONS 10000
+
+typedef struct {
+    esp_pool_handle_t pool;
+    SemaphoreHandle_t done;
+    bool failed;
+} stress_args_t;
+
+static void pool_stress_task(void *arg)
+{
+    stress_args_t *args = (stress_args_t *)arg;
+    uint32_t *objs[NUM_OBJECTS / 4];
+    const uint32_t id = (uint32_t)xTaskGetCurrentTaskHandle();
+
+    for (int iter = 0; iter < STRESS_ITERATIONS; iter++) {
+        for (int i = 0; i < NUM_OBJECTS / 4; i++) {
+            objs[i] = esp_pool_alloc(args->pool);
+            if (objs[i] == NULL) {
+                args->failed = true;
+                break;
+            }
+            *objs[i] = id;
+        }
+        for (int i = 0; i < NUM_OBJECTS / 4 && objs[i] != NULL; i++) {
+            /* no other task was handed the same object */
+            if (*objs[i] != id) {
+                args->failed = true;
+            }
+            esp_pool_free(args->pool, objs[i]);
+        }
+    }
+    xSemaphoreGive(args->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("esp_pool lock-free stress test from both CPUs", "[heap]")
+{
+    stress_args_t args[2];
+    esp_pool_handle_t pool = esp_pool_create("stress", sizeof(uint32_t), NUM_OBJECTS / 2, MALLOC_CAP_8BIT,
+                                             ESP_POOL_FLAG_LOCK_FREE);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    for (int i = 0; i < 2; i++) {
+        args[i].pool = pool;
+        args[i].done = xSemaphoreCreateBinary();
+        args[i].failed = false;
+        xTaskCreatePinnedToCore(pool_stress_task, "poolstress", 2048, &args[i], 5, NULL, i % portNUM_PROCESSORS);
+    }
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT(xSemaphoreTake(args[i].done, 10000 / portTICK_PERIOD_MS));
+        vSemaphoreDelete(args[i].done);
+        TEST_ASSERT_FALSE(args[i].failed);
+    }
+
+    esp_pool_info_t info;
+    esp_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(NUM_OBJECTS / 2, info.free_objects);
+    TEST_ASSERT_EQUAL(0, info.failed_allocs);
+    esp_pool_delete(pool);
+}
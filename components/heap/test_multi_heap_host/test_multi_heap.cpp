@@ -5,6 +5,7 @@
 
 #include <string.h>
 #include <assert.h>
+#include <chrono>
 
 /* Insurance against accidentally using libc heap functions in tests */
 #undef free
@@ -16,9 +17,32 @@
 #undef realloc
 #define realloc #error
 
+#ifdef MULTI_HEAP_TLSF
+/* Upper bound for the TLSF free list heads stored at the start of each heap,
+   added to the heap sizes used in these tests */
+#define HEAP_OVERHEAD (192 * sizeof(void *))
+#else
+#define HEAP_OVERHEAD 0
+#endif
+
+/* As HEAP_OVERHEAD is only an upper bound, a heap may have more room left with TLSF than without it.
+   If the largest free block can hold 'limit' bytes, allocate all but 'keep' bytes of it, so that the
+   heap is as full as the test expects. Returns the block to free afterwards, or NULL. */
+static void *take_heap_slack(multi_heap_handle_t heap, size_t limit, size_t keep)
+{
+    multi_heap_info_t info;
+    multi_heap_get_info(heap, &info);
+    if (info.largest_free_block < limit) {
+        return NULL;
+    }
+    void *slack = multi_heap_malloc(heap, info.largest_free_block - keep);
+    REQUIRE( slack != NULL );
+    return slack;
+}
+
 TEST_CASE("multi_heap simple allocations", "[multi_heap]")
 {
-    uint8_t small_heap[128];
+    uint8_t small_heap[128 + HEAP_OVERHEAD];
 
     multi_heap_handle_t heap = multi_heap_register(small_heap, sizeof(small_heap));
 
@@ -59,7 +83,7 @@ TEST_CASE("multi_heap simple allocations", "[multi_heap]")
 
 TEST_CASE("multi_heap fragmentation", "[multi_heap]")
 {
-    uint8_t small_heap[256];
+    uint8_t small_heap[256 + HEAP_OVERHEAD];
     multi_heap_handle_t heap = multi_heap_register(small_heap, sizeof(small_heap));
 
     const size_t alloc_size = 24;
@@ -76,7 +100,9 @@ TEST_CASE("multi_heap fragmentation", "[multi_heap]")
 
     printf("allocated %p %p %p %p\n", p[0], p[1], p[2], p[3]);
 
+    void *slack = take_heap_slack(heap, alloc_size * 5, alloc_size * 4);
     REQUIRE( multi_heap_malloc(heap, alloc_size * 5) == NULL ); /* no room to allocate 5*alloc_size now */
+    multi_heap_free(heap, slack);
 
     printf("4 allocations:\n");
     multi_heap_dump(heap);
@@ -109,7 +135,7 @@ TEST_CASE("multi_heap fragmentation", "[multi_heap]")
 TEST_CASE("multi_heap defrag", "[multi_heap]")
 {
     void *p[4];
-    uint8_t small_heap[512];
+    uint8_t small_heap[512 + HEAP_OVERHEAD];
     multi_heap_info_t info, info2;
     multi_heap_handle_t heap = multi_heap_register(small_heap, sizeof(small_heap));
 
@@ -159,7 +185,7 @@ TEST_CASE("multi_heap defrag", "[multi_heap]")
 TEST_CASE("multi_heap defrag realloc", "[multi_heap]")
 {
     void *p[4];
-    uint8_t small_heap[512];
+    uint8_t small_heap[512 + HEAP_OVERHEAD];
     multi_heap_info_t info, info2;
     multi_heap_handle_t heap = multi_heap_register(small_heap, sizeof(small_heap));
 
@@ -204,7 +230,7 @@ TEST_CASE("multi_heap defrag realloc", "[multi_heap]")
 
 TEST_CASE("multi_heap many random allocations", "[multi_heap]")
 {
-    uint8_t big_heap[1024];
+    uint8_t big_heap[1024 + HEAP_OVERHEAD];
     const int NUM_POINTERS = 64;
 
     printf("Running multi-allocation test...\n");
@@ -296,7 +322,7 @@ TEST_CASE("multi_heap many random allocations", "[multi_heap]")
 
 TEST_CASE("multi_heap_get_info() function", "[multi_heap]")
 {
-    uint8_t heapdata[256];
+    uint8_t heapdata[256 + HEAP_OVERHEAD];
     multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
     multi_heap_info_t before, after, freed;
 
@@ -349,7 +375,7 @@ TEST_CASE("multi_heap_get_info() function", "[multi_heap]")
 
 TEST_CASE("multi_heap minimum-size allocations", "[multi_heap]")
 {
-    uint8_t heapdata[16384];
+    uint8_t heapdata[16384 + HEAP_OVERHEAD];
     void *p[sizeof(heapdata) / sizeof(void *)];
     const size_t NUM_P = sizeof(p) / sizeof(void *);
     multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
@@ -391,7 +417,7 @@ TEST_CASE("multi_heap minimum-size allocations", "[multi_heap]")
 TEST_CASE("multi_heap_realloc()", "[multi_heap]")
 {
     const uint32_t PATTERN = 0xABABDADA;
-    uint8_t small_heap[300];
+    uint8_t small_heap[300 + HEAP_OVERHEAD];
     multi_heap_handle_t heap = multi_heap_register(small_heap, sizeof(small_heap));
 
     uint32_t *a = (uint32_t *)multi_heap_malloc(heap, 64);
@@ -432,8 +458,10 @@ TEST_CASE("multi_heap_realloc()", "[multi_heap]")
 #define TOO_MUCH 128 + 1
 #endif
     /* not enough contiguous space left in the heap */
+    void *slack = take_heap_slack(heap, TOO_MUCH, 64);
     uint32_t *g = (uint32_t *)multi_heap_realloc(heap, e, TOO_MUCH);
     REQUIRE( g == NULL );
+    multi_heap_free(heap, slack);
 
     multi_heap_free(heap, f);
     /* try again */
@@ -445,7 +473,7 @@ TEST_CASE("multi_heap_realloc()", "[multi_heap]")
 
 TEST_CASE("corrupt heap block", "[multi_heap]")
 {
-    uint8_t small_heap[256];
+    uint8_t small_heap[256 + HEAP_OVERHEAD];
     multi_heap_handle_t heap = multi_heap_register(small_heap, sizeof(small_heap));
 
     void *a = multi_heap_malloc(heap, 32);
@@ -456,7 +484,7 @@ TEST_CASE("corrupt heap block", "[multi_heap]")
 
 TEST_CASE("unaligned heaps", "[multi_heap]")
 {
-    const size_t CHUNK_LEN = 256;
+    const size_t CHUNK_LEN = 256 + HEAP_OVERHEAD;
     const size_t CANARY_LEN = 16;
     const uint8_t CANARY_BYTE = 0x3E;
     uint8_t heap_chunk[CHUNK_LEN + CANARY_LEN * 2];
@@ -475,8 +503,8 @@ TEST_CASE("unaligned heaps", "[multi_heap]")
 
         multi_heap_get_info(heap, &info);
 
-        REQUIRE( info.total_free_bytes > CHUNK_LEN - 64 - i );
-        REQUIRE( info.largest_free_block > CHUNK_LEN - 64 - i );
+        REQUIRE( info.total_free_bytes > CHUNK_LEN - HEAP_OVERHEAD - 64 - i );
+        REQUIRE( info.largest_free_block > CHUNK_LEN - HEAP_OVERHEAD - 64 - i );
 
         void *a = multi_heap_malloc(heap, info.largest_free_block);
         REQUIRE( a != NULL );
@@ -494,3 +522,75 @@ TEST_CASE("unaligned heaps", "[multi_heap]")
         }
     }
 }
+
+/* Measure malloc & free latency on a heavily fragmented heap.
+
+   Run test_all_configs.sh to compare the results of the default (best fit) allocator and the TLSF allocator.
+*/
+TEST_CASE("multi_heap fragmented heap latency", "[multi_heap][benchmark]")
+{
+    static uint8_t heapdata[256 * 1024];
+    const int NUM_P = 2000;
+    const int ITERATIONS = 20000;
+    static void *p[NUM_P];
+    multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+    multi_heap_info_t info;
+
+    /* Fill most of the heap with blocks of random sizes, then free every second block
+       so there are many small free blocks scattered through the heap */
+    srand(1);
+    for (int i = 0; i < NUM_P; i++) {
+        p[i] = multi_heap_malloc(heap, 16 + rand() % 112);
+        REQUIRE( p[i] != NULL );
+    }
+    for (int i = 0; i < NUM_P; i += 2) {
+        multi_heap_free(heap, p[i]);
+        p[i] = NULL;
+    }
+    multi_heap_get_info(heap, &info);
+
+    typedef std::chrono::steady_clock clock;
+    clock::duration malloc_total(0), malloc_max(0), free_total(0), free_max(0);
+    int mallocs = 0, frees = 0;
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        int n = rand() % NUM_P;
+        if (p[n] == NULL) {
+            size_t size = 16 + rand() % 240;
+            clock::time_point start = clock::now();
+            p[n] = multi_heap_malloc(heap, size);
+            clock::duration elapsed = clock::now() - start;
+            malloc_total += elapsed;
+            malloc_max = std::max(malloc_max, elapsed);
+            mallocs++;
+        } else {
+            clock::time_point start = clock::now();
+            multi_heap_free(heap, p[n]);
+            clock::duration elapsed = clock::now() - start;
+            p[n] = NULL;
+            free_total += elapsed;
+            free_max = std::max(free_max, elapsed);
+            frees++;
+        }
+    }
+
+    REQUIRE( multi_heap_check(heap, true) );
+
+    typedef std::chrono::nanoseconds ns;
+#ifdef MULTI_HEAP_TLSF
+    const char *allocator = "TLSF";
+#else
+    const char *allocator = "best fit";
+#endif
+    printf("%s allocator, %zu free blocks: malloc avg %lld ns max %lld ns, free avg %lld ns max %lld ns\n",
+           allocator, info.free_blocks,
+           (long long)(std::chrono::duration_cast<ns>(malloc_total).count() / std::max(mallocs, 1)),
+           (long long)std::chrono::duration_cast<ns>(malloc_max).count(),
+           (long long)(std::chrono::duration_cast<ns>(free_total).count() / std::max(frees, 1)),
+           (long long)std::chrono::duration_cast<ns>(free_max).count());
+
+    for (int i = 0; i < NUM_P; i++) {
+        multi_heap_free(heap, p[i]);
+    }
+    REQUIRE( multi_heap_check(heap, true) );
+}
@@ -22,3 +22,5 @@
 // events dispatched per second by event loop library
 #define IDF_PERFORMANCE_MIN_EVENT_DISPATCH                                      25000
 #define IDF_PERFORMANCE_MIN_EVENT_DISPATCH_PSRAM                                21000
+// URI handler lookup among 60 handlers by the HTTP server
+#define IDF_PERFORMANCE_MAX_HTTPD_URI_LOOKUP_TIME                               10000
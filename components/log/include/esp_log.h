@@ -106,6 +106,26 @@ uint32_t esp_log_early_timestamp(void);
  */
 void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...) __attribute__ ((format (printf, 3, 4)));
 
+/**
+ * @brief Output all queued log messages
+ *
+ * When asynchronous logging is enabled (CONFIG_LOG_ASYNC), log messages are
+ * queued and output later by a separate task. This function formats and outputs
+ * all messages queued so far in the calling task, for example before entering
+ * deep sleep or restarting.
+ *
+ * Does nothing if asynchronous logging is disabled, or if called from an interrupt.
+ */
+void esp_log_async_flush(void);
+
+/**
+ * @brief Get the number of log messages dropped because the log buffer was full
+ *
+ * @return Total number of dropped messages since startup, or 0 if asynchronous
+ *         logging is disabled.
+ */
+uint32_t esp_log_async_get_dropped(void);
+
 /** @cond */
 
 #include "esp_log_internal.h"
@@ -304,12 +324,24 @@ void esp_log_write(esp_log_level_t level, const char* tag, const char* format, .
     } while(0)
 
 /** runtime macro to output logs at a specified level. Also check the level with ``LOG_LOCAL_LEVEL``.
+ *
+ * If CONFIG_LOG_TAG_LEVEL_CACHE is enabled, the level of the tag is cached in a static variable,
+ * so a message disabled with ``esp_log_level_set`` is discarded without calling ``esp_log_write``.
  *
  * @see ``printf``, ``ESP_LOG_LEVEL``
  */
+#if CONFIG_LOG_TAG_LEVEL_CACHE && !defined(BOOTLOADER_BUILD)
+#define ESP_LOG_LEVEL_LOCAL(level, tag, format, ...) do {               \
+        if ( LOG_LOCAL_LEVEL >= level ) {                               \
+            static esp_log_tag_t __esp_log_tag_desc;                    \
+            if (esp_log_tag_enabled(&__esp_log_tag_desc, tag, level)) ESP_LOG_LEVEL(level, tag, format, ##__VA_ARGS__); \
+        }                                                               \
+    } while(0)
+#else
 #define ESP_LOG_LEVEL_LOCAL(level, tag, format, ...) do {               \
         if ( LOG_LOCAL_LEVEL >= level ) ESP_LOG_LEVEL(level, tag, format, ##__VA_ARGS__); \
     } while(0)
+#endif
 
 #ifdef __cplusplus
 }
@@ -15,10 +15,38 @@
 #ifndef __ESP_LOG_INTERNAL_H__
 #define __ESP_LOG_INTERNAL_H__
 
+#include <stdbool.h>
+
 //these functions do not check level versus ESP_LOCAL_LEVEL, this should be done in esp_log.h
 void esp_log_buffer_hex_internal(const char *tag, const void *buffer, uint16_t buff_len, esp_log_level_t level);
 void esp_log_buffer_char_internal(const char *tag, const void *buffer, uint16_t buff_len, esp_log_level_t level);
 void esp_log_buffer_hexdump_internal( const char *tag, const void *buffer, uint16_t buff_len, esp_log_level_t log_level);
 
+//output queued asynchronous log messages using ets_printf, without taking any locks. Only for use by the panic handler.
+void esp_log_async_panic_flush(void);
+
+#if CONFIG_LOG_TAG_LEVEL_CACHE && !defined(BOOTLOADER_BUILD)
+//level of a tag cached by an ESP_LOGx statement, see ESP_LOG_LEVEL_LOCAL
+typedef struct {
+    const char *volatile tag;   //set once, before state first becomes valid
+    volatile uint32_t state;    //generation << 8 | level. The cached level is only valid if generation is current.
+} esp_log_tag_t;
+
+//incremented by esp_log_level_set to invalidate all cached levels, never 0
+extern volatile uint32_t esp_log_tag_generation;
+
+//look up the level of 'tag', cache it in 'desc' and check if a message at 'level' should be output
+bool esp_log_tag_update(esp_log_tag_t *desc, const char *tag, esp_log_level_t level);
+
+static inline bool esp_log_tag_enabled(esp_log_tag_t *desc, const char *tag, esp_log_level_t level)
+{
+    uint32_t state = desc->state;
+    if ((state >> 8) == esp_log_tag_generation && desc->tag == tag) {
+        return level <= (esp_log_level_t)(state & 0xFF);
+    }
+    return esp_log_tag_update(desc, tag, level);
+}
+#endif
+
 #endif
 
@@ -34,6 +34,13 @@
  * than 4 billion log entries, at which point wrap-around will not be
  * the biggest problem.
  *
+ * If CONFIG_LOG_TAG_LEVEL_CACHE is enabled, each ESP_LOGx statement also
+ * has a static esp_log_tag_t holding the first tag it used, its level and
+ * the value of esp_log_tag_generation at that time. esp_log_level_set
+ * increments the generation, so all these levels are looked up again the
+ * next time each statement runs. Until then, a disabled statement only
+ * compares its cached level, without calling esp_log_write.
+ *
  */
 
 #ifndef BOOTLOADER_BUILD
@@ -55,6 +62,7 @@
 #include <ctype.h>
 
 #include "esp_log.h"
+#include "log_private.h"
 
 #include "rom/queue.h"
 #include "soc/soc_memory_layout.h"
@@ -94,6 +102,10 @@ static uint32_t s_log_cache_entry_count = 0;
 static vprintf_like_t s_log_print_func = &vprintf;
 static SemaphoreHandle_t s_log_mutex = NULL;
 
+#if CONFIG_LOG_TAG_LEVEL_CACHE
+volatile uint32_t esp_log_tag_generation = 1;
+#endif
+
 #ifdef LOG_BUILTIN_CHECKS
 static uint32_t s_log_cache_misses = 0;
 #endif
@@ -105,6 +117,8 @@ static void heap_bubble_down(int index);
 static inline void heap_swap(int i, int j);
 static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag);
 static inline void clear_log_level_list();
+static inline esp_log_level_t get_log_level(const char* tag);
+static inline void invalidate_tag_levels(void);
 
 vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
 {
@@ -131,6 +145,7 @@ void esp_log_level_set(const char* tag, esp_log_level_t level)
     if (strcmp(tag, "*") == 0) {
         s_log_default_level = level;
         clear_log_level_list();
+        invalidate_tag_levels();
         xSemaphoreGive(s_log_mutex);
         return;
     }
@@ -169,6 +184,7 @@ void esp_log_level_set(const char* tag, esp_log_level_t level)
             break;
         }
     }
+    invalidate_tag_levels();
     xSemaphoreGive(s_log_mutex);
 }
 
@@ -194,6 +210,75 @@ void IRAM_ATTR esp_log_write(esp_log_level_t level,
     if (xSemaphoreTake(s_log_mutex, MAX_MUTEX_WAIT_TICKS) == pdFALSE) {
         return;
     }
+    esp_log_level_t level_for_tag = get_log_level(tag);
+    xSemaphoreGive(s_log_mutex);
+    if (!should_output(level, level_for_tag)) {
+        return;
+    }
+
+    va_list list;
+#ifdef CONFIG_LOG_ASYNC
+    va_start(list, format);
+    bool queued = esp_log_async_write(format, list);
+    va_end(list);
+    if (queued) {
+        return;
+    }
+#elif defined(CONFIG_LOG_BINARY)
+    va_start(list, format);
+    bool written = esp_log_binary_write(format, list);
+    va_end(list);
+    if (written) {
+        return;
+    }
+#endif
+    va_start(list, format);
+    (*s_log_print_func)(format, list);
+    va_end(list);
+}
+
+#if CONFIG_LOG_TAG_LEVEL_CACHE
+bool IRAM_ATTR esp_log_tag_update(esp_log_tag_t *desc, const char *tag, esp_log_level_t level)
+{
+    if (!s_log_mutex) {
+        s_log_mutex = xSemaphoreCreateMutex();
+    }
+    if (xSemaphoreTake(s_log_mutex, MAX_MUTEX_WAIT_TICKS) == pdFALSE) {
+        // let esp_log_write decide
+        return true;
+    }
+    esp_log_level_t level_for_tag = get_log_level(tag);
+    // The tag is set once, before the state first becomes valid, and never changes after that.
+    // esp_log_tag_enabled() reads the state and the tag separately, so a tag changing under it
+    // could be paired with the level of another tag. A statement used with several tags only
+    // caches the level of the first one, the others always take this path.
+    if (desc->tag == NULL) {
+        desc->tag = tag;
+    }
+    if (desc->tag == tag) {
+        desc->state = (esp_log_tag_generation << 8) | level_for_tag;
+    }
+    xSemaphoreGive(s_log_mutex);
+    return should_output(level, level_for_tag);
+}
+#endif
+
+static int log_print(const char *format, ...)
+{
+    va_list list;
+    va_start(list, format);
+    int ret = (*s_log_print_func)(format, list);
+    va_end(list);
+    return ret;
+}
+
+void esp_log_output_line(const char *line)
+{
+    log_print("%s", line);
+}
+
+static inline esp_log_level_t get_log_level(const char* tag)
+{
     esp_log_level_t level_for_tag;
     // Look for the tag in cache first, then in the linked list of all tags
     if (!get_cached_log_level(tag, &level_for_tag)) {
@@ -205,15 +290,17 @@ void IRAM_ATTR esp_log_write(esp_log_level_t level,
         ++s_log_cache_misses;
 #endif
     }
-    xSemaphoreGive(s_log_mutex);
-    if (!should_output(level, level_for_tag)) {
-        return;
-    }
+    return level_for_tag;
+}
 
-    va_list list;
-    va_start(list, format);
-    (*s_log_print_func)(format, list);
-    va_end(list);
+static inline void invalidate_tag_levels(void)
+{
+#if CONFIG_LOG_TAG_LEVEL_CACHE
+    // Levels cached by ESP_LOGx statements are only valid for the current generation,
+    // which fits in 24 bits. Generation 0 marks descriptors which were never set.
+    uint32_t generation = (esp_log_tag_generation + 1) & 0xFFFFFF;
+    esp_log_tag_generation = (generation != 0) ? generation : 1;
+#endif
 }
 
 static inline bool get_cached_log_level(const char* tag, esp_log_level_t* level)
@@ -0,0 +1,358 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Asynchronous log output implementation notes.
+ *
+ * When CONFIG_LOG_ASYNC is enabled, esp_log_write does not format the
+ * message itself. Instead, it copies the format string pointer and the
+ * raw values of the arguments into a log record, and pushes the record
+ * into a ring buffer. A low priority task pops records, formats them and
+ * passes them to the vprintf-like output function.
+ *
+ * There is one ring buffer per CPU. A ring is only written by its own
+ * CPU, with interrupts disabled on that CPU while a record is captured
+ * into it, and only read by the logging task (or by a flush), so no lock
+ * is shared between the CPUs. The size of the record is computed first,
+ * so that the arguments are captured straight into the ring rather than
+ * into a buffer on the caller's stack. Head and tail offsets are published with
+ * acquire/release atomics. If a ring is full, the message is dropped and
+ * counted; the logging task reports the number of dropped messages.
+ *
+ * A va_list can't be stored, so the arguments are captured into the
+ * record by walking the format string, and formatted again from the
+ * record by the logging task (see log_format.c). The format string itself
+ * must stay valid, which is always the case for the string literals used
+ * by the ESP_LOGx macros. If CONFIG_LOG_BINARY is also enabled, the
+ * logging task outputs binary frames instead of formatting the records.
+ *
+ * Messages which can't be captured (too long, or using conversions such
+ * as %n or wide strings) are output synchronously as before.
+ */
+
+#ifndef BOOTLOADER_BUILD
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/param.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "soc/soc_memory_layout.h"
+#include "log_private.h"
+
+#ifdef CONFIG_LOG_ASYNC
+
+// Largest log record (header and captured arguments) which can be queued.
+#define MAX_RECORD_SIZE 256
+
+// Size of the buffer each record is formatted into. Longer lines are truncated.
+#define MAX_LINE_SIZE 256
+
+// Records in the ring buffers are aligned for their header
+#define RECORD_ALIGN __alignof__(log_record_t)
+
+// Size of each ring buffer, rounded down to keep records aligned
+#define RING_SIZE (CONFIG_LOG_ASYNC_BUFFER_SIZE & ~(RECORD_ALIGN - 1))
+
+// How long the logging task sleeps when all rings are empty, in case a wakeup is missed
+#define IDLE_WAIT_TICKS (100 / portTICK_PERIOD_MS)
+
+
+typedef struct {
+    uint16_t size;      // Size of the record in bytes, including the header. 0 marks the end of the ring.
+    uint16_t args_len;  // Size of the captured arguments following the header
+    const char *format;
+} log_record_t;
+
+typedef struct {
+    volatile uint32_t head;     // Offset of the next record to write, only changed by the owning CPU
+    volatile uint32_t tail;     // Offset of the next record to read, only changed by the consumer
+    volatile uint32_t dropped;  // Number of messages dropped because the ring was full
+    uint32_t dropped_reported;  // Number of dropped messages already reported by the consumer
+    uint8_t buf[RING_SIZE] __attribute__((aligned(RECORD_ALIGN)));
+} log_ring_t;
+
+typedef enum {
+    TASK_NOT_STARTED,
+    TASK_STARTING,
+    TASK_RUNNING,
+    TASK_FAILED,
+} task_state_t;
+
+static log_ring_t s_log_rings[portNUM_PROCESSORS];
+static volatile uint32_t s_task_state = TASK_NOT_STARTED;
+static TaskHandle_t s_log_task;
+static volatile bool s_log_task_waiting;
+static SemaphoreHandle_t s_consumer_mutex;
+static char s_line[MAX_LINE_SIZE];
+static char s_panic_line[MAX_LINE_SIZE];
+
+/* Find room for a record of 'len' bytes in 'ring', marking the end of the ring if the record wraps around.
+   Returns the offset of the record, or -1 if the ring is full. Called by the CPU owning the ring, with interrupts disabled. */
+static IRAM_ATTR int ring_reserve(log_ring_t *ring, uint32_t len)
+{
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    // head must never catch up with tail, as head == tail means the ring is empty
+    if (head >= tail) {
+        if (head + len < RING_SIZE || (head + len == RING_SIZE && tail != 0)) {
+            return head;
+        } else if (len < tail) {
+            // No room at the end, mark the end and wrap around. head < RING_SIZE, so a size field fits.
+            ((log_record_t *)&ring->buf[head])->size = 0;
+            return 0;
+        }
+    } else if (head + len < tail) {
+        return head;
+    }
+    return -1;
+}
+
+/* Make the record of 'len' bytes written at offset 'pos' visible to the consumer */
+static IRAM_ATTR void ring_commit(log_ring_t *ring, uint32_t pos, uint32_t len)
+{
+    pos += len;
+    __atomic_store_n(&ring->head, (pos == RING_SIZE) ? 0 : pos, __ATOMIC_RELEASE);
+}
+
+/* Return the oldest record in 'ring' without removing it, or NULL if the ring is empty */
+static const log_record_t *ring_peek(log_ring_t *ring)
+{
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = ring->tail;
+    if (tail == head) {
+        return NULL;
+    }
+    const log_record_t *record = (const log_record_t *)&ring->buf[tail];
+    if (record->size == 0) {
+        __atomic_store_n(&ring->tail, 0, __ATOMIC_RELEASE);
+        if (head == 0) {
+            return NULL;
+        }
+        record = (const log_record_t *)&ring->buf[0];
+    }
+    return record;
+}
+
+/* Remove the record returned by ring_peek() */
+static void ring_pop(log_ring_t *ring, const log_record_t *record)
+{
+    uint32_t tail = ((const uint8_t *)record - ring->buf) + record->size;
+    __atomic_store_n(&ring->tail, (tail == RING_SIZE) ? 0 : tail, __ATOMIC_RELEASE);
+}
+
+static bool rings_empty(void)
+{
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        if (s_log_rings[i].head != s_log_rings[i].tail) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void output_line(const char *line, bool panic)
+{
+    if (panic) {
+        ets_printf("%s", line);
+    } else {
+        esp_log_output_line(line);
+    }
+}
+
+static void format_record(char *line, const log_record_t *record)
+{
+    const uint8_t *args = (const uint8_t *)(record + 1);
+#ifdef CONFIG_LOG_BINARY
+    if (esp_ptr_in_drom(record->format)
+        && esp_log_encode_binary(line, MAX_LINE_SIZE, record->format, args, record->args_len) != 0) {
+        return;
+    }
+#endif
+    esp_log_format_args(line, MAX_LINE_SIZE, record->format, args);
+}
+
+/* Format and output all queued records, taking one record from each CPU's ring in turn.
+   Returns true if anything was output. */
+static bool drain_rings(char *line, bool panic)
+{
+    bool output = false;
+    bool more = true;
+    while (more) {
+        more = false;
+        for (int i = 0; i < portNUM_PROCESSORS; i++) {
+            log_ring_t *ring = &s_log_rings[i];
+            const uint32_t dropped = ring->dropped;
+            if (dropped != ring->dropped_reported) {
+                snprintf(line, MAX_LINE_SIZE, LOG_FORMAT(W, "%u messages from CPU %d dropped, log buffer full"),
+                         esp_log_timestamp(), "log", (unsigned)(dropped - ring->dropped_reported), i);
+                ring->dropped_reported = dropped;
+                output_line(line, panic);
+            }
+            const log_record_t *record = ring_peek(ring);
+            if (record != NULL) {
+                format_record(line, record);
+                ring_pop(ring, record);
+                output_line(line, panic);
+                more = true;
+                output = true;
+            }
+        }
+    }
+    return output;
+}
+
+static void log_async_task(void *arg)
+{
+    while (true) {
+        xSemaphoreTake(s_consumer_mutex, portMAX_DELAY);
+        bool output = drain_rings(s_line, false);
+        xSemaphoreGive(s_consumer_mutex);
+
+        if (!output) {
+            s_log_task_waiting = true;
+            // Make the flag visible to producers before checking the rings again, see log_async_wake()
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (rings_empty()) {
+                ulTaskNotifyTake(pdTRUE, IDLE_WAIT_TICKS);
+            }
+            s_log_task_waiting = false;
+        }
+    }
+}
+
+/* Start the logging task if it isn't running. Returns false if messages can't be queued yet. */
+static bool log_async_start(void)
+{
+    if (s_task_state == TASK_RUNNING) {
+        return true;
+    }
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING || xPortInIsrContext()) {
+        return false;
+    }
+    uint32_t state = TASK_STARTING;
+    uxPortCompareSet(&s_task_state, TASK_NOT_STARTED, &state);
+    if (state != TASK_NOT_STARTED) {
+        // Another task is starting it, or it failed to start
+        return false;
+    }
+
+    s_consumer_mutex = xSemaphoreCreateMutex();
+    if (s_consumer_mutex == NULL
+        || xTaskCreate(log_async_task, "log", CONFIG_LOG_ASYNC_TASK_STACK_SIZE, NULL,
+                       CONFIG_LOG_ASYNC_TASK_PRIORITY, &s_log_task) != pdPASS) {
+        s_task_state = TASK_FAILED;
+        return false;
+    }
+    s_task_state = TASK_RUNNING;
+    return true;
+}
+
+static void log_async_wake(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (s_log_task_waiting) {
+        s_log_task_waiting = false;
+        xTaskNotifyGive(s_log_task);
+    }
+}
+
+bool esp_log_async_write(const char *format, va_list args)
+{
+    if (!log_async_start()) {
+        return false;
+    }
+
+    // Find out the size of the record, so that the arguments can be captured straight into the ring
+    va_list measure_args;
+    va_copy(measure_args, args);
+    size_t len;
+    bool fits = esp_log_capture_args(NULL, MAX_RECORD_SIZE - sizeof(log_record_t), format, measure_args, &len);
+    va_end(measure_args);
+    if (!fits) {
+        return false;
+    }
+    const uint32_t size = (sizeof(log_record_t) + len + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+
+    uint32_t irq_state = portENTER_CRITICAL_NESTED();
+    log_ring_t *ring = &s_log_rings[xPortGetCoreID()];
+    int pos = ring_reserve(ring, size);
+    log_record_t *record = (pos >= 0) ? (log_record_t *)&ring->buf[pos] : NULL;
+    // A string argument changed by another task since it was measured may not fit any more
+    if (record != NULL
+        && esp_log_capture_args((uint8_t *)(record + 1), size - sizeof(log_record_t), format, args, &len)) {
+        record->size = size;
+        record->args_len = len;
+        record->format = format;
+        ring_commit(ring, pos, size);
+    } else {
+        ring->dropped++;
+    }
+    portEXIT_CRITICAL_NESTED(irq_state);
+
+    log_async_wake();
+    return true;
+}
+
+void esp_log_async_flush(void)
+{
+    if (s_task_state != TASK_RUNNING || xPortInIsrContext()) {
+        return;
+    }
+    xSemaphoreTake(s_consumer_mutex, portMAX_DELAY);
+    drain_rings(s_line, false);
+    xSemaphoreGive(s_consumer_mutex);
+}
+
+void esp_log_async_panic_flush(void)
+{
+    // The logging task may have been stopped while formatting a record; that record may be output twice
+    drain_rings(s_panic_line, true);
+}
+
+uint32_t esp_log_async_get_dropped(void)
+{
+    uint32_t dropped = 0;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        dropped += s_log_rings[i].dropped;
+    }
+    return dropped;
+}
+
+#else // CONFIG_LOG_ASYNC
+
+void esp_log_async_flush(void)
+{
+}
+
+void esp_log_async_panic_flush(void)
+{
+}
+
+uint32_t esp_log_async_get_dropped(void)
+{
+    return 0;
+}
+
+#endif // CONFIG_LOG_ASYNC
+
+#endif // BOOTLOADER_BUILD
@@ -0,0 +1,410 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Deferred formatting of log messages.
+ *
+ * Asynchronous and binary log output don't format messages in the
+ * calling task. Instead, the arguments of a message are "captured": the
+ * format string is walked, each conversion is read from the va_list with
+ * the type it implies, and the raw value is copied into a buffer.
+ *
+ * Strings (%s) are stored with a one byte marker. If the string is in
+ * flash (.rodata), only its address is stored, as it can't change.
+ * Otherwise its contents are copied, as the caller's buffer may be gone
+ * by the time the message is formatted.
+ *
+ * Captured arguments can later be formatted into a line of text, by
+ * walking the format string again and printing each conversion with
+ * snprintf, or encoded into a binary log frame which is decoded on the
+ * host by tools/log_decoder.py using the application ELF file.
+ */
+
+#ifndef BOOTLOADER_BUILD
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "soc/soc_memory_layout.h"
+#include "log_private.h"
+
+#if defined(CONFIG_LOG_ASYNC) || defined(CONFIG_LOG_BINARY)
+
+// Longest single conversion specification, e.g. "%-08.3llx"
+#define MAX_SPEC_SIZE 16
+
+// Largest captured arguments of a message output synchronously in binary
+#define MAX_BINARY_ARGS_SIZE 128
+
+// Markers stored before each captured string
+#define STRING_INLINE 0     // NUL-terminated contents follow
+#define STRING_REF 1        // Address of a string in flash follows
+
+// Binary log frames. See esp_log_encode_binary() in log_private.h.
+#define BINARY_FRAME_START  0x1E
+#define BINARY_ESCAPE       0x1B
+#define BINARY_ESCAPE_XOR   0x40
+
+typedef enum {
+    ARG_NONE,           // "%%", nothing to read
+    ARG_INT,
+    ARG_LONG,
+    ARG_LONG_LONG,
+    ARG_INTMAX,
+    ARG_SIZE,
+    ARG_PTRDIFF,
+    ARG_POINTER,
+    ARG_DOUBLE,
+    ARG_LONG_DOUBLE,
+    ARG_STRING,
+    ARG_UNSUPPORTED,
+} arg_type_t;
+
+typedef struct {
+    const char *start;  // Points to the '%' of the conversion, or NULL if there are no more conversions
+    size_t len;         // Length of the conversion specification, including '%' and the conversion character
+    int stars;          // Number of '*' (width or precision) int arguments before the value
+    int precision;      // Precision given as digits, or -1 if none or given by '*'
+    bool star_precision; // Precision is given by the last '*' argument
+    arg_type_t type;
+} conv_spec_t;
+
+/* Parse the next conversion specification in 'format'. Returns a pointer to the text after it. */
+static const char *next_conv_spec(const char *format, conv_spec_t *spec)
+{
+    memset(spec, 0, sizeof(conv_spec_t));
+    spec->precision = -1;
+    const char *p = strchr(format, '%');
+    if (p == NULL) {
+        return format + strlen(format);
+    }
+    spec->start = p++;
+
+    while (*p != '\0' && strchr("-+ #0'", *p) != NULL) {
+        p++;
+    }
+    if (*p == '*') {
+        spec->stars++;
+        p++;
+    } else {
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec->stars++;
+            spec->star_precision = true;
+            p++;
+        } else {
+            spec->precision = 0;
+            while (*p >= '0' && *p <= '9') {
+                spec->precision = spec->precision * 10 + (*p++ - '0');
+            }
+        }
+    }
+
+    enum { LEN_NONE, LEN_L, LEN_LL, LEN_BIG_L, LEN_J, LEN_Z, LEN_T } length = LEN_NONE;
+    if (p[0] == 'h') {
+        p += (p[1] == 'h') ? 2 : 1;
+    } else if (p[0] == 'l' && p[1] == 'l') {
+        length = LEN_LL;
+        p += 2;
+    } else if (p[0] == 'l') {
+        length = LEN_L;
+        p++;
+    } else if (p[0] == 'q') {
+        length = LEN_LL;
+        p++;
+    } else if (p[0] == 'L') {
+        length = LEN_BIG_L;
+        p++;
+    } else if (p[0] == 'j') {
+        length = LEN_J;
+        p++;
+    } else if (p[0] == 'z') {
+        length = LEN_Z;
+        p++;
+    } else if (p[0] == 't') {
+        length = LEN_T;
+        p++;
+    }
+
+    spec->type = ARG_UNSUPPORTED;
+    switch (*p) {
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+        switch (length) {
+        case LEN_L:  spec->type = ARG_LONG; break;
+        case LEN_LL: spec->type = ARG_LONG_LONG; break;
+        case LEN_J:  spec->type = ARG_INTMAX; break;
+        case LEN_Z:  spec->type = ARG_SIZE; break;
+        case LEN_T:  spec->type = ARG_PTRDIFF; break;
+        case LEN_NONE: spec->type = ARG_INT; break;
+        default: break;
+        }
+        break;
+    case 'c':
+        spec->type = (length == LEN_NONE) ? ARG_INT : ARG_UNSUPPORTED;
+        break;
+    case 's':
+        spec->type = (length == LEN_NONE) ? ARG_STRING : ARG_UNSUPPORTED;
+        break;
+    case 'p':
+        spec->type = ARG_POINTER;
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        spec->type = (length == LEN_BIG_L) ? ARG_LONG_DOUBLE : ARG_DOUBLE;
+        break;
+    case '%':
+        spec->type = (spec->stars == 0) ? ARG_NONE : ARG_UNSUPPORTED;
+        break;
+    default:
+        // %n, wide characters and malformed conversions
+        break;
+    }
+    if (*p != '\0') {
+        p++;
+    }
+    spec->len = p - spec->start;
+    if (spec->len >= MAX_SPEC_SIZE) {
+        spec->type = ARG_UNSUPPORTED;
+    }
+    return p;
+}
+
+#define CAPTURE(TYPE) do {                              \
+        TYPE value = va_arg(args, TYPE);                \
+        if (pos + sizeof(TYPE) > size) {                \
+            return false;                               \
+        }                                               \
+        if (buf != NULL) {                              \
+            memcpy(&buf[pos], &value, sizeof(TYPE));    \
+        }                                               \
+        pos += sizeof(TYPE);                            \
+    } while(0)
+
+bool esp_log_capture_args(uint8_t *buf, size_t size, const char *format, va_list args, size_t *len)
+{
+    size_t pos = 0;
+    const char *p = format;
+
+    while (*p != '\0') {
+        conv_spec_t spec;
+        p = next_conv_spec(p, &spec);
+        if (spec.start == NULL) {
+            break;
+        }
+        int precision = spec.precision;
+        for (int i = 0; i < spec.stars; i++) {
+            int star = va_arg(args, int);
+            if (pos + sizeof(int) > size) {
+                return false;
+            }
+            if (buf != NULL) {
+                memcpy(&buf[pos], &star, sizeof(int));
+            }
+            pos += sizeof(int);
+            if (spec.star_precision && i == spec.stars - 1) {
+                precision = star;
+            }
+        }
+
+        switch (spec.type) {
+        case ARG_NONE: break;
+        case ARG_INT: CAPTURE(int); break;
+        case ARG_LONG: CAPTURE(long); break;
+        case ARG_LONG_LONG: CAPTURE(long long); break;
+        case ARG_INTMAX: CAPTURE(intmax_t); break;
+        case ARG_SIZE: CAPTURE(size_t); break;
+        case ARG_PTRDIFF: CAPTURE(ptrdiff_t); break;
+        case ARG_POINTER: CAPTURE(void *); break;
+        case ARG_DOUBLE: CAPTURE(double); break;
+        case ARG_LONG_DOUBLE: CAPTURE(long double); break;
+        case ARG_STRING: {
+            const char *str = va_arg(args, const char *);
+            if (str == NULL) {
+                str = "(null)";
+            }
+            if (esp_ptr_in_drom(str) && precision < 0) {
+                if (pos + 1 + sizeof(const char *) > size) {
+                    return false;
+                }
+                if (buf != NULL) {
+                    buf[pos] = STRING_REF;
+                    memcpy(&buf[pos + 1], &str, sizeof(const char *));
+                }
+                pos += 1 + sizeof(const char *);
+                break;
+            }
+            // The string may not be terminated if a precision is given
+            size_t str_len = (precision >= 0) ? strnlen(str, precision) : strlen(str);
+            if (pos + 1 + str_len + 1 > size) {
+                return false;
+            }
+            if (buf != NULL) {
+                buf[pos] = STRING_INLINE;
+                memcpy(&buf[pos + 1], str, str_len);
+                buf[pos + 1 + str_len] = '\0';
+            }
+            pos += 1 + str_len + 1;
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    *len = pos;
+    return true;
+}
+
+#define RENDER(TYPE) do {                                                       \
+        TYPE value;                                                             \
+        memcpy(&value, args, sizeof(TYPE));                                     \
+        args += sizeof(TYPE);                                                   \
+        if (spec.stars == 0) {                                                  \
+            n = snprintf(&line[pos], size - pos, conv, value);                  \
+        } else if (spec.stars == 1) {                                           \
+            n = snprintf(&line[pos], size - pos, conv, star[0], value);         \
+        } else {                                                                \
+            n = snprintf(&line[pos], size - pos, conv, star[0], star[1], value); \
+        }                                                                       \
+    } while(0)
+
+void esp_log_format_args(char *line, size_t size, const char *format, const uint8_t *args)
+{
+    size_t pos = 0;
+    const char *p = format;
+
+    while (*p != '\0' && pos < size - 1) {
+        conv_spec_t spec;
+        const char *next = next_conv_spec(p, &spec);
+        const char *literal_end = (spec.start != NULL) ? spec.start : next;
+        size_t len = MIN(literal_end - p, size - 1 - pos);
+        memcpy(&line[pos], p, len);
+        pos += len;
+        p = next;
+        if (spec.start == NULL || pos == size - 1) {
+            break;
+        }
+
+        char conv[MAX_SPEC_SIZE];
+        memcpy(conv, spec.start, spec.len);
+        conv[spec.len] = '\0';
+        int star[2] = { 0, 0 };
+        for (int i = 0; i < spec.stars; i++) {
+            memcpy(&star[i], args, sizeof(int));
+            args += sizeof(int);
+        }
+
+        int n = 0;
+        switch (spec.type) {
+        case ARG_NONE: n = snprintf(&line[pos], size - pos, "%%"); break;
+        case ARG_INT: RENDER(int); break;
+        case ARG_LONG: RENDER(long); break;
+        case ARG_LONG_LONG: RENDER(long long); break;
+        case ARG_INTMAX: RENDER(intmax_t); break;
+        case ARG_SIZE: RENDER(size_t); break;
+        case ARG_PTRDIFF: RENDER(ptrdiff_t); break;
+        case ARG_POINTER: RENDER(void *); break;
+        case ARG_DOUBLE: RENDER(double); break;
+        case ARG_LONG_DOUBLE: RENDER(long double); break;
+        case ARG_STRING: {
+            const char *value;
+            if (*args++ == STRING_REF) {
+                memcpy(&value, args, sizeof(const char *));
+                args += sizeof(const char *);
+            } else {
+                value = (const char *)args;
+                args += strlen(value) + 1;
+            }
+            if (spec.stars == 0) {
+                n = snprintf(&line[pos], size - pos, conv, value);
+            } else if (spec.stars == 1) {
+                n = snprintf(&line[pos], size - pos, conv, star[0], value);
+            } else {
+                n = snprintf(&line[pos], size - pos, conv, star[0], star[1], value);
+            }
+            break;
+        }
+        default:
+            // esp_log_capture_args() fails for unsupported conversions
+            break;
+        }
+        if (n > 0) {
+            pos = MIN(pos + n, size - 1);
+        }
+    }
+    line[pos] = '\0';
+}
+
+/* Append byte 'b' to a binary frame, escaping bytes which can't appear in a line of text */
+static inline size_t frame_put(char *out, size_t pos, uint8_t b)
+{
+    if (b == 0 || b == '\n' || b == '\r' || b == BINARY_ESCAPE || b == BINARY_FRAME_START) {
+        out[pos++] = BINARY_ESCAPE;
+        b ^= BINARY_ESCAPE_XOR;
+    }
+    out[pos++] = b;
+    return pos;
+}
+
+size_t esp_log_encode_binary(char *out, size_t size, const char *format, const uint8_t *args, size_t len)
+{
+    const uint32_t addr = (uint32_t)format;
+    // Worst case, every byte is escaped. At most 1 + 2 * (4 + i) bytes are written before args[i]
+    // is read, so 'args' may be placed in 'out' to encode the frame in place (see log_private.h).
+    if (size < ESP_LOG_BINARY_FRAME_SIZE(len)) {
+        return 0;
+    }
+    size_t pos = 0;
+    out[pos++] = BINARY_FRAME_START;
+    for (size_t i = 0; i < sizeof(addr); i++) {
+        pos = frame_put(out, pos, (addr >> (8 * i)) & 0xFF);
+    }
+    for (size_t i = 0; i < len; i++) {
+        pos = frame_put(out, pos, args[i]);
+    }
+    out[pos++] = '\n';
+    out[pos] = '\0';
+    return pos;
+}
+
+#ifdef CONFIG_LOG_BINARY
+
+bool esp_log_binary_write(const char *format, va_list args)
+{
+    // The arguments are captured at the end of the frame and encoded in place, see esp_log_encode_binary()
+    char frame[ESP_LOG_BINARY_FRAME_SIZE(MAX_BINARY_ARGS_SIZE)];
+    uint8_t *buf = (uint8_t *)&frame[sizeof(frame) - MAX_BINARY_ARGS_SIZE - 2];
+    size_t len;
+
+    if (!esp_ptr_in_drom(format) || !esp_log_capture_args(buf, MAX_BINARY_ARGS_SIZE, format, args, &len)) {
+        return false;
+    }
+    esp_log_encode_binary(frame, sizeof(frame), format, buf, len);
+    esp_log_output_line(frame);
+    return true;
+}
+
+#endif // CONFIG_LOG_BINARY
+
+#endif // CONFIG_LOG_ASYNC || CONFIG_LOG_BINARY
+
+#endif // BOOTLOADER_BUILD
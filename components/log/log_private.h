@@ -0,0 +1,71 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Functions shared between log.c, log_async.c and log_format.c */
+
+/* Output a formatted line with the function set by esp_log_set_vprintf */
+void esp_log_output_line(const char *line);
+
+/* Queue a message for the logging task to format and output.
+
+   Returns false if the message can't be queued, in which case the caller
+   should output it synchronously. Messages dropped because the buffer is
+   full count as queued.
+*/
+bool esp_log_async_write(const char *format, va_list args);
+
+/* Capture the arguments of a message, as implied by the conversions in 'format', into 'buf'.
+
+   Returns false if the arguments don't fit in 'size' bytes or 'format' uses
+   a conversion which can't be captured (such as %n). Otherwise, stores the
+   number of bytes used in '*len'. If 'buf' is NULL, only the number of bytes
+   needed is computed.
+*/
+bool esp_log_capture_args(uint8_t *buf, size_t size, const char *format, va_list args, size_t *len);
+
+/* Format a message from 'format' and the arguments captured by esp_log_capture_args()
+   into 'line'. The result is truncated to 'size' bytes, including the terminating NUL.
+*/
+void esp_log_format_args(char *line, size_t size, const char *format, const uint8_t *args);
+
+/* Encode a message into a binary log frame, for tools/log_decoder.py.
+
+   The frame is 0x1E, the format string address (32-bit little endian) and
+   the 'len' bytes of captured arguments, then '\n'. Bytes 0x00, '\n', '\r',
+   0x1B and 0x1E are escaped as 0x1B followed by the byte XOR 0x40, so the
+   frame is a NUL-terminated line which can be output like a text message.
+
+   'args' may point into 'out', at or after ESP_LOG_BINARY_FRAME_SIZE(len) - len - 2
+   bytes from its start, to encode the frame in place.
+
+   Returns the length of the frame, or 0 if it may not fit in 'size' bytes.
+*/
+size_t esp_log_encode_binary(char *out, size_t size, const char *format, const uint8_t *args, size_t len);
+
+/* Maximum size of a binary frame holding 'len' bytes of captured arguments, including the NUL */
+#define ESP_LOG_BINARY_FRAME_SIZE(len) (1 + 2 * (4 + (len)) + 2)
+
+/* Output a message as a binary log frame.
+
+   Returns false if the format string isn't in flash (so the host can't look
+   it up) or the arguments can't be captured, in which case the caller should
+   output the message as text.
+*/
+bool esp_log_binary_write(const char *format, va_list args);
@@ -0,0 +1,7 @@
+#pragma once
+
+#define CONFIG_LOG_DEFAULT_LEVEL 3
+#define CONFIG_LOG_ASYNC 1
+#define CONFIG_LOG_ASYNC_BUFFER_SIZE 1024
+#define CONFIG_LOG_ASYNC_TASK_PRIORITY 1
+#define CONFIG_LOG_ASYNC_TASK_STACK_SIZE 3072
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Just enough of FreeRTOS for the log component to run in a single host thread.
+   The logging task is never started, records are only output by esp_log_async_flush(). */
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffff
+#define portTICK_PERIOD_MS 10
+#define portNUM_PROCESSORS 2
+
+/* CPU the test pretends to run on */
+extern int test_core_id;
+
+static inline int xPortGetCoreID(void)
+{
+    return test_core_id;
+}
+
+static inline BaseType_t xPortInIsrContext(void)
+{
+    return 0;
+}
+
+static inline void uxPortCompareSet(volatile uint32_t *addr, uint32_t compare, uint32_t *set)
+{
+    *set = __sync_val_compare_and_swap(addr, compare, *set);
+}
+
+#define portENTER_CRITICAL_NESTED() 0
+#define portEXIT_CRITICAL_NESTED(state) (void)(state)
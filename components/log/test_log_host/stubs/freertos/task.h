@@ -0,0 +1,29 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+
+#define taskSCHEDULER_RUNNING 2
+
+static inline BaseType_t xTaskGetSchedulerState(void)
+{
+    return taskSCHEDULER_RUNNING;
+}
+
+static inline BaseType_t xTaskCreate(void (*task)(void *), const char *name, uint32_t stack_size,
+                                     void *arg, int priority, TaskHandle_t *handle)
+{
+    *handle = (TaskHandle_t) 1;
+    return pdPASS;
+}
+
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    return 0;
+}
+
+static inline BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    return pdPASS;
+}
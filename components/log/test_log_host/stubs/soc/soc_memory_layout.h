@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Strings between these addresses are treated as if they were in flash (.rodata) */
+extern uintptr_t test_drom_start, test_drom_end;
+
+static inline bool esp_ptr_in_drom(const void *p)
+{
+    return (uintptr_t)p >= test_drom_start && (uintptr_t)p < test_drom_end;
+}
@@ -0,0 +1,147 @@
+#include "catch.hpp"
+#include "esp_log.h"
+
+extern "C" {
+#include "log_private.h"
+}
+
+#include "test_log_stubs.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Output whatever is still queued and forget it */
+static void reset_output()
+{
+    test_core_id = 0;
+    esp_log_async_flush();
+    test_output.clear();
+}
+
+/* Queue a message, and if it was queued append the line vsnprintf() makes of it to 'expected' */
+static bool queue(std::string &expected, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static bool queue(std::string &expected, const char *format, ...)
+{
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    va_start(args, format);
+    bool queued = esp_log_async_write(format, args);
+    va_end(args);
+    if (queued) {
+        expected += line;
+    }
+    return queued;
+}
+
+TEST_CASE("queued messages are formatted like vsnprintf", "[log_async]")
+{
+    reset_output();
+    uint32_t dropped = esp_log_async_get_dropped();
+    std::string expected;
+    char buf[16] = "stack";
+    const char *null_str = NULL;
+
+    /* Flushing every other round leaves records at varying offsets, so the ring wraps around in many places */
+    for (int round = 0; round < 100; round++) {
+        REQUIRE( queue(expected, "I (%d) %s: %d %u %x %5.2f %-6s| %c %%\n", round, "tag", -5, 7u, 255, 3.14159, buf, 'z') );
+        REQUIRE( queue(expected, "%lld %llu %ld %zu %p %.3s %*d %-*.*s|\n", -1234567890123LL, 18446744073709551615ULL,
+                       -7L, (size_t) 99, (void *) 0x1234, "abcdef", 6, 42, 8, 2, "xyz") );
+        REQUIRE( queue(expected, "%Lf %e %g %hhd %hd %jd %td\n", (long double) 1.5, 1e10, 0.0001,
+                       (signed char) 100, (short) 7000, (intmax_t) 5, (ptrdiff_t) -3) );
+        REQUIRE( queue(expected, "no arguments %d\n", round) );
+        REQUIRE( queue(expected, "%s\n", null_str) );
+        if (round % 2 == 1) {
+            esp_log_async_flush();
+            REQUIRE( test_output == expected );
+        }
+    }
+    REQUIRE( esp_log_async_get_dropped() == dropped );
+}
+
+TEST_CASE("queued messages from both CPUs are output in turn", "[log_async]")
+{
+    reset_output();
+    std::string expected;
+    for (int i = 0; i < 20; i++) {
+        test_core_id = i % 2;
+        REQUIRE( queue(expected, "message %d from CPU %d\n", i, test_core_id) );
+    }
+    esp_log_async_flush();
+    REQUIRE( test_output == expected );
+}
+
+TEST_CASE("messages are dropped and counted when the ring is full", "[log_async]")
+{
+    reset_output();
+    uint32_t dropped = esp_log_async_get_dropped();
+    std::string queued;
+    const int count = 100;
+    for (int i = 0; i < count; i++) {
+        REQUIRE( queue(queued, "message %d is queued until the ring is full\n", i) );
+    }
+    uint32_t lost = esp_log_async_get_dropped() - dropped;
+    REQUIRE( lost > 0 );
+    REQUIRE( lost < count );
+
+    /* The number of dropped messages is reported first, then the messages which fit */
+    char line[128];
+    std::string expected;
+    snprintf(line, sizeof(line), LOG_FORMAT(W, "%u messages from CPU %d dropped, log buffer full"),
+             1234, "log", (unsigned) lost, 0);
+    expected += line;
+    for (int i = 0; i < count - (int) lost; i++) {
+        snprintf(line, sizeof(line), "message %d is queued until the ring is full\n", i);
+        expected += line;
+    }
+    esp_log_async_flush();
+    REQUIRE( test_output == expected );
+
+    /* Once output, there is room again and the drop isn't reported twice */
+    test_output.clear();
+    expected.clear();
+    REQUIRE( queue(expected, "room again\n") );
+    esp_log_async_flush();
+    REQUIRE( test_output == expected );
+    REQUIRE( esp_log_async_get_dropped() - dropped == lost );
+}
+
+TEST_CASE("messages which can't be captured aren't queued", "[log_async]")
+{
+    reset_output();
+    uint32_t dropped = esp_log_async_get_dropped();
+    std::string expected;
+    char long_str[400];
+    memset(long_str, 'a', sizeof(long_str) - 1);
+    long_str[sizeof(long_str) - 1] = '\0';
+    int n;
+
+    REQUIRE_FALSE( queue(expected, "%s\n", long_str) );
+    REQUIRE_FALSE( queue(expected, "written%n\n", &n) );
+    esp_log_async_flush();
+    REQUIRE( test_output.empty() );
+    REQUIRE( esp_log_async_get_dropped() == dropped );
+}
+
+TEST_CASE("strings are copied unless they are in flash", "[log_async]")
+{
+    reset_output();
+    char ram[16] = "before";
+    static char flash[16] = "flash";
+    test_drom_start = (uintptr_t) flash;
+    test_drom_end = (uintptr_t) flash + sizeof(flash);
+
+    std::string expected;
+    REQUIRE( queue(expected, "%s %s\n", ram, flash) );
+    /* A string in flash can't change, so only its address was queued */
+    strcpy(ram, "after");
+    strcpy(flash, "FLASH");
+    esp_log_async_flush();
+    REQUIRE( test_output == "before FLASH\n" );
+
+    test_drom_start = test_drom_end = 0;
+}
@@ -0,0 +1,146 @@
+#include "catch.hpp"
+#include "esp_log.h"
+
+extern "C" {
+#include "log_private.h"
+}
+
+#include "test_log_stubs.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+/* Framing, see esp_log_encode_binary() in log_private.h */
+#define FRAME_START 0x1E
+#define ESCAPE 0x1B
+#define ESCAPE_XOR 0x40
+
+#define ARGS_SIZE 128
+
+/* Decode a frame the way tools/log_decoder.py does and format the message, checking
+   that the frame is a single line and refers to 'format' */
+static std::string decode_frame(const std::string &frame, const char *format)
+{
+    REQUIRE( frame.size() >= 6 );
+    REQUIRE( (uint8_t) frame[0] == FRAME_START );
+    REQUIRE( frame.back() == '\n' );
+
+    std::string data;
+    for (size_t i = 1; i < frame.size() - 1; i++) {
+        uint8_t b = frame[i];
+        REQUIRE( b != 0 );
+        REQUIRE( b != '\n' );
+        REQUIRE( b != '\r' );
+        REQUIRE( b != FRAME_START );
+        if (b == ESCAPE) {
+            REQUIRE( i + 1 < frame.size() - 1 );
+            b = frame[++i] ^ ESCAPE_XOR;
+        }
+        data += (char) b;
+    }
+
+    REQUIRE( data.size() >= 4 );
+    const uint8_t *addr = (const uint8_t *) data.data();
+    REQUIRE( (addr[0] | addr[1] << 8 | addr[2] << 16 | (uint32_t) addr[3] << 24) == (uint32_t) (uintptr_t) format );
+
+    char line[256];
+    esp_log_format_args(line, sizeof(line), format, addr + 4);
+    return line;
+}
+
+/* Capture the arguments at the end of a frame buffer and encode the frame in place,
+   as esp_log_binary_write() does. Returns false if the arguments can't be captured. */
+static bool encode(std::string &frame, const char *format, va_list args)
+{
+    char buf[ESP_LOG_BINARY_FRAME_SIZE(ARGS_SIZE)];
+    uint8_t *captured = (uint8_t *) &buf[sizeof(buf) - ARGS_SIZE - 2];
+    size_t len;
+
+    if (!esp_log_capture_args(captured, ARGS_SIZE, format, args, &len)) {
+        return false;
+    }
+    size_t frame_len = esp_log_encode_binary(buf, sizeof(buf), format, captured, len);
+    REQUIRE( frame_len > 0 );
+    REQUIRE( strlen(buf) == frame_len );
+    frame.assign(buf, frame_len);
+    return true;
+}
+
+/* Encode a message, decode it and check it reads like vsnprintf() formats it. Returns the frame. */
+static std::string check_frame(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+static std::string check_frame(const char *format, ...)
+{
+    char expected[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(expected, sizeof(expected), format, args);
+    va_end(args);
+
+    std::string frame;
+    va_start(args, format);
+    bool encoded = encode(frame, format, args);
+    va_end(args);
+    REQUIRE( encoded );
+    REQUIRE( decode_frame(frame, format) == expected );
+    return frame;
+}
+
+static bool try_encode(const char *format, ...)
+{
+    std::string frame;
+    va_list args;
+    va_start(args, format);
+    bool encoded = encode(frame, format, args);
+    va_end(args);
+    return encoded;
+}
+
+TEST_CASE("binary frames decode to the formatted message", "[log_binary]")
+{
+    char ram[16] = "in RAM";
+    static const char flash[16] = "in flash";
+    test_drom_start = (uintptr_t) flash;
+    test_drom_end = (uintptr_t) flash + sizeof(flash);
+
+    check_frame("I (%d) %s: %d %u %x %c %%\n", 1234, "tag", -5, 7u, 255, 'z');
+    check_frame("%lld %llu %p %.3s %*d %-*.*s|\n", -1234567890123LL, 18446744073709551615ULL,
+                (void *) 0x1234, "abcdef", 6, 42, 8, 2, "xyz");
+    check_frame("%f %e %g %hhd %hd %zu\n", 3.14159, 1e10, 0.0001, (signed char) 100, (short) 7000, (size_t) 99);
+    /* A string in flash is referred to by its address, others are copied */
+    check_frame("%s %s\n", ram, flash);
+    check_frame("no arguments\n");
+
+    test_drom_start = test_drom_end = 0;
+}
+
+TEST_CASE("bytes which can't appear in a line are escaped", "[log_binary]")
+{
+    std::string frame = check_frame("%x %x %x\n", 0x1E0A0D1Bu, 0u, 0x401B1B40u);
+    REQUIRE( std::count(frame.begin(), frame.end(), ESCAPE) >= 4 + 4 + 2 );
+
+    /* The largest message which fits, with every byte escaped, still encodes in place:
+       each escaped argument byte is written over ones already read */
+    char newlines[ARGS_SIZE - 1];
+    memset(newlines, '\n', sizeof(newlines) - 1);
+    newlines[sizeof(newlines) - 1] = '\0';
+    frame = check_frame("%s", newlines);
+    REQUIRE( std::count(frame.begin() + 5, frame.end() - 1, ESCAPE) >= (long) sizeof(newlines) );
+}
+
+TEST_CASE("messages which don't fit aren't encoded", "[log_binary]")
+{
+    char long_str[ARGS_SIZE];
+    memset(long_str, 'a', sizeof(long_str) - 1);
+    long_str[sizeof(long_str) - 1] = '\0';
+    int n;
+
+    REQUIRE_FALSE( try_encode("%s", long_str) );
+    REQUIRE_FALSE( try_encode("written%n\n", &n) );
+
+    /* A frame buffer too small for the worst case is refused */
+    uint8_t args[4] = { 0 };
+    char out[ESP_LOG_BINARY_FRAME_SIZE(sizeof(args)) - 1];
+    REQUIRE( esp_log_encode_binary(out, sizeof(out), "%d", args, sizeof(args)) == 0 );
+}
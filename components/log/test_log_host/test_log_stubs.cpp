@@ -0,0 +1,25 @@
+#include "test_log_stubs.h"
+#include "esp_log.h"
+
+extern "C" {
+#include "log_private.h"
+}
+
+std::string test_output;
+
+extern "C" {
+
+int test_core_id;
+uintptr_t test_drom_start, test_drom_end;
+
+void esp_log_output_line(const char *line)
+{
+    test_output += line;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return 1234;
+}
+
+}
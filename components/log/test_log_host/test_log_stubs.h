@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+/* Everything the log component has output through esp_log_output_line() */
+extern std::string test_output;
+
+extern "C" {
+
+/* CPU the log component is made to think it runs on, see stubs/freertos/FreeRTOS.h */
+extern int test_core_id;
+
+/* Strings between these addresses are treated as if they were in flash, see stubs/soc/soc_memory_layout.h */
+extern uintptr_t test_drom_start, test_drom_end;
+
+}
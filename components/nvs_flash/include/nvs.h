@@ -205,6 +205,51 @@ esp_err_t nvs_set_str (nvs_handle handle, const char* key, const char* value);
  */
 esp_err_t nvs_set_blob(nvs_handle handle, const char* key, const void* value, size_t length);
 
+/**
+ * @brief      Key-value pair to be written by nvs_set_batch
+ */
+typedef struct {
+    const char* key;     /**< Key name. Maximal length is 15 characters. Shouldn't be empty. */
+    nvs_type_t type;     /**< Type of the value. Only integer types are supported. */
+    const void* value;   /**< Pointer to the value, of the size given by type. */
+} nvs_batch_item_t;
+
+/**
+ * @brief      set values for several keys at once
+ *
+ * All values are written into consecutive entries of one page, using a single
+ * flash write for the data and one write per 16 entries to mark them as valid.
+ * Previous values of the keys are invalidated afterwards, updating each word of
+ * the entry state table of a page only once.
+ *
+ * The operation is atomic with regard to power loss: after the next call to
+ * nvs_flash_init, either all keys will have the new values, or all keys will
+ * have the values they had before the call.
+ *
+ * @param[in]  handle     Handle obtained from nvs_open function.
+ *                        Handles that were opened read only cannot be used.
+ * @param[in]  items      Array of key-value pairs. Each key may appear only once.
+ * @param[in]  count      Number of elements in the array. All items must fit into
+ *                        one page, so maximum count is 126.
+ * @param[out] saved_ops  If not NULL, set to the number of flash write operations
+ *                        saved compared to writing the values one by one.
+ *
+ * @return
+ *             - ESP_OK if values were set successfully
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if storage handle was opened as read only
+ *             - ESP_ERR_INVALID_ARG if items is NULL, a key or value is NULL,
+ *               a type is not an integer type, or a key appears twice
+ *             - ESP_ERR_NVS_KEY_TOO_LONG if a key name is too long
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space in the
+ *               underlying storage to save the values
+ *             - ESP_ERR_NVS_REMOVE_FAILED if the values were written, but the old
+ *               values could not be erased because flash write operation has failed.
+ *               Update will be finished after re-initialization of nvs, provided that
+ *               flash operation doesn't fail again.
+ */
+esp_err_t nvs_set_batch(nvs_handle handle, const nvs_batch_item_t* items, size_t count, size_t* saved_ops);
+
 /**@{*/
 /**
  * @brief      get value for given key
@@ -314,6 +359,235 @@ esp_err_t nvs_get_str (nvs_handle handle, const char* key, char* out_value, size
 esp_err_t nvs_get_blob(nvs_handle handle, const char* key, void* out_value, size_t* length);
 /**@}*/
 
+/**
+ * @brief      Contiguous part of a blob obtained with nvs_get_blob_mapped
+ */
+typedef struct {
+    const void* data;   /**< Pointer to the data of the segment */
+    size_t size;        /**< Size of the segment in bytes */
+} nvs_blob_segment_t;
+
+/**
+ * @brief      Opaque handle of a blob obtained with nvs_get_blob_mapped
+ */
+typedef struct nvs_blob_map* nvs_blob_map_handle_t;
+
+/**
+ * @brief      get read-only access to a blob without copying it
+ *
+ * Blobs larger than one page are stored in several chunks, each of which is
+ * contiguous in flash. This function maps every chunk into the data address space
+ * using spi_flash_mmap and returns one segment per chunk, in the order in which they
+ * form the blob. Contents of the blob is the concatenation of all segments.
+ *
+ * If the data can't be mapped directly, because the NVS partition is encrypted or
+ * because flash encryption is enabled, the blob is copied into a buffer allocated
+ * from the heap, which is returned as the only segment.
+ *
+ * The segments stay valid until nvs_release_blob_mapped is called. In the meantime
+ * the blob may be modified or erased, but pages holding the mapped chunks are not
+ * reused, so writes to the partition may fail with ESP_ERR_NVS_NOT_ENOUGH_SPACE
+ * sooner than usual. Mappings are released when the partition is deinitialized or
+ * initialized again.
+ *
+ * \code{c}
+ * // Example (without error checking) of passing a large blob to a parser:
+ * nvs_blob_map_handle_t map;
+ * const nvs_blob_segment_t* segments;
+ * size_t count;
+ * nvs_get_blob_mapped(my_handle, "model", &map, &segments, &count);
+ * for (size_t i = 0; i < count; ++i) {
+ *     parser_feed(&parser, segments[i].data, segments[i].size);
+ * }
+ * nvs_release_blob_mapped(map);
+ * \endcode
+ *
+ * @param[in]  handle        Handle obtained from nvs_open function.
+ * @param[in]  key           Key name. Maximal length is 15 characters. Shouldn't be empty.
+ * @param[out] out_map       Handle which should be passed to nvs_release_blob_mapped.
+ * @param[out] out_segments  Set to the array of segments of the blob.
+ * @param[out] out_count     Set to the number of segments. May be zero for an empty blob.
+ *
+ * @return
+ *             - ESP_OK if the blob was mapped successfully
+ *             - ESP_ERR_NVS_NOT_FOUND if the requested key doesn't exist
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_INVALID_ARG if any of the output arguments is NULL
+ *             - ESP_ERR_NO_MEM if memory for the copy can not be allocated
+ *             - other error codes from spi_flash_mmap
+ */
+esp_err_t nvs_get_blob_mapped(nvs_handle handle, const char* key, nvs_blob_map_handle_t* out_map,
+                              const nvs_blob_segment_t** out_segments, size_t* out_count);
+
+/**
+ * @brief      release a blob obtained with nvs_get_blob_mapped
+ *
+ * @param[in]  map  Handle obtained from nvs_get_blob_mapped
+ *
+ * @return
+ *             - ESP_OK if the blob was released
+ *             - ESP_ERR_NVS_INVALID_HANDLE if the handle is not valid, or its partition
+ *               has already been deinitialized
+ */
+esp_err_t nvs_release_blob_mapped(nvs_blob_map_handle_t map);
+
+/**
+ * @brief      Opaque handle of a blob being written with nvs_blob_write_append
+ */
+typedef struct nvs_blob_writer* nvs_blob_writer_handle_t;
+
+/**
+ * @brief      start writing a blob piece by piece
+ *
+ * This allows storing a blob without holding all of its data in RAM at once.
+ * Data passed to nvs_blob_write_append is collected in a buffer of buffer_size bytes,
+ * and written to flash as one or more chunks of the blob whenever the buffer is full.
+ * The blob is stored as a new version, next to the previous value of the key.
+ * Only when nvs_blob_write_close is called, the new version replaces the previous one.
+ * If the writer is aborted, or power goes out before it is closed, the previous value
+ * of the key stays in place and the chunks written so far are erased.
+ *
+ * While the writer is open, writing or erasing the key with other functions fails with
+ * ESP_ERR_INVALID_STATE. Writers are discarded when the partition is deinitialized or
+ * initialized again.
+ *
+ * Each chunk takes one more entry for its header, and a blob can be made of at most
+ * 127 chunks. A small buffer saves RAM, but limits the size of the blob.
+ *
+ * \code{c}
+ * // Example (without error checking) of storing a download:
+ * nvs_blob_writer_handle_t writer;
+ * nvs_blob_write_open(my_handle, "firmware", 1024, &writer);
+ * while ((len = recv(sock, buf, sizeof(buf), 0)) > 0) {
+ *     nvs_blob_write_append(writer, buf, len);
+ * }
+ * nvs_blob_write_close(writer);
+ * \endcode
+ *
+ * @param[in]  handle       Handle obtained from nvs_open function.
+ * @param[in]  key          Key name. Maximal length is 15 characters. Shouldn't be empty.
+ * @param[in]  buffer_size  Size of the buffer allocated for the writer. 0 selects the
+ *                          largest size which fits into one page, which is also the maximum.
+ * @param[out] out_writer   Handle which should be passed to the other nvs_blob_write_* functions.
+ *
+ * @return
+ *             - ESP_OK if the writer was created
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if storage handle was opened as read only
+ *             - ESP_ERR_NVS_KEY_TOO_LONG if key name is too long
+ *             - ESP_ERR_INVALID_STATE if another writer is open for the same key
+ *             - ESP_ERR_INVALID_ARG if out_writer is NULL
+ *             - ESP_ERR_NO_MEM if the buffer can not be allocated
+ */
+esp_err_t nvs_blob_write_open(nvs_handle handle, const char* key, size_t buffer_size, nvs_blob_writer_handle_t* out_writer);
+
+/**
+ * @brief      add data to the end of a blob being written
+ *
+ * Once an error is returned, the writer keeps returning it, and nvs_blob_write_close
+ * discards the blob. The writer still has to be closed.
+ *
+ * @param[in]  writer  Handle obtained from nvs_blob_write_open
+ * @param[in]  data    Data to be appended
+ * @param[in]  length  Length of the data, in bytes
+ *
+ * @return
+ *             - ESP_OK if the data was added
+ *             - ESP_ERR_NVS_INVALID_HANDLE if the writer handle is not valid
+ *             - ESP_ERR_NVS_VALUE_TOO_LONG if the blob becomes too long
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space to store the data
+ *             - ESP_ERR_NVS_NOT_FOUND if the namespace has been erased in the meantime
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_write_append(nvs_blob_writer_handle_t writer, const void* data, size_t length);
+
+/**
+ * @brief      finish writing a blob and make it replace the previous value of the key
+ *
+ * The handle is freed, whether the blob is stored or not.
+ *
+ * @param[in]  writer  Handle obtained from nvs_blob_write_open
+ *
+ * @return
+ *             - ESP_OK if the blob was stored
+ *             - ESP_ERR_NVS_INVALID_HANDLE if the writer handle is not valid
+ *             - error returned by an earlier call to nvs_blob_write_append, or other
+ *               error codes from the underlying storage driver. The blob is not stored.
+ */
+esp_err_t nvs_blob_write_close(nvs_blob_writer_handle_t writer);
+
+/**
+ * @brief      discard a blob being written and free the writer
+ *
+ * The previous value of the key is not changed.
+ *
+ * @param[in]  writer  Handle obtained from nvs_blob_write_open
+ *
+ * @return
+ *             - ESP_OK if the writer was discarded
+ *             - ESP_ERR_NVS_INVALID_HANDLE if the writer handle is not valid
+ */
+esp_err_t nvs_blob_write_abort(nvs_blob_writer_handle_t writer);
+
+/**
+ * @brief      Opaque handle of a blob being read with nvs_blob_read
+ */
+typedef struct nvs_blob_reader* nvs_blob_reader_handle_t;
+
+/**
+ * @brief      start reading a blob piece by piece
+ *
+ * The reader only keeps its position in the blob, so reading a blob of any size needs
+ * no more RAM than the buffer passed to nvs_blob_read. The CRC of every chunk is checked
+ * once all of its data has been read, so data returned by nvs_blob_read can't be trusted
+ * until the end of the blob has been reached without errors.
+ *
+ * If the blob is written again or erased while it is being read, nvs_blob_read fails with
+ * ESP_ERR_NVS_NOT_FOUND. Readers are discarded when the partition is deinitialized or
+ * initialized again.
+ *
+ * @param[in]  handle      Handle obtained from nvs_open function.
+ * @param[in]  key         Key name. Maximal length is 15 characters. Shouldn't be empty.
+ * @param[out] out_reader  Handle which should be passed to nvs_blob_read and nvs_blob_read_close.
+ * @param[out] out_length  If not NULL, set to the length of the blob.
+ *
+ * @return
+ *             - ESP_OK if the reader was created
+ *             - ESP_ERR_NVS_NOT_FOUND if the requested key doesn't exist
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_INVALID_ARG if out_reader is NULL
+ */
+esp_err_t nvs_blob_read_open(nvs_handle handle, const char* key, nvs_blob_reader_handle_t* out_reader, size_t* out_length);
+
+/**
+ * @brief      read the next part of a blob
+ *
+ * @param[in]  reader    Handle obtained from nvs_blob_read_open
+ * @param[out] out_data  Buffer for the data
+ * @param[in]  length    Size of the buffer, in bytes
+ * @param[out] out_read  Set to the number of bytes read, which is less than length only
+ *                       at the end of the blob, and zero once the end has been reached.
+ *
+ * @return
+ *             - ESP_OK if the data was read
+ *             - ESP_ERR_NVS_INVALID_HANDLE if the reader handle is not valid
+ *             - ESP_ERR_INVALID_ARG if out_data or out_read is NULL
+ *             - ESP_ERR_NVS_NOT_FOUND if the blob has been modified or erased, or a
+ *               chunk of the blob is corrupted
+ */
+esp_err_t nvs_blob_read(nvs_blob_reader_handle_t reader, void* out_data, size_t length, size_t* out_read);
+
+/**
+ * @brief      free a blob reader
+ *
+ * @param[in]  reader  Handle obtained from nvs_blob_read_open
+ *
+ * @return
+ *             - ESP_OK if the reader was freed
+ *             - ESP_ERR_NVS_INVALID_HANDLE if the reader handle is not valid
+ */
+esp_err_t nvs_blob_read_close(nvs_blob_reader_handle_t reader);
+
 /**
  * @brief      Erase key-value pair with given key name.
  *
@@ -389,6 +663,8 @@ typedef struct {
     size_t free_entries;      /**< Amount of free entries. */
     size_t total_entries;     /**< Amount all available entries. */
     size_t namespace_count;   /**< Amount name space. */
+    size_t cache_hits;        /**< Number of reads served from the read cache since the partition was initialized. */
+    size_t cache_misses;      /**< Number of reads which had to go to flash although the read cache is enabled. */
 } nvs_stats_t;
 
 /**
@@ -426,6 +702,40 @@ typedef struct {
  */
 esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats);
 
+/**
+ * @brief      Do one step of garbage collection ahead of time.
+ *
+ * When all free pages but one have been used up, the nvs_set_* call which runs out
+ * of space in the active page has to move items out of another page and erase it
+ * before it can complete. Calling this function periodically, for example from
+ * a low priority task, does this work in advance: while fewer than two pages are free,
+ * items of the full page with most erased entries are moved to the active page, and
+ * the page is erased. With enough erased entries in the partition, a spare free page
+ * is then always available and nvs_set_* calls don't need to erase flash.
+ *
+ * Each call erases at most one page.
+ *
+ * \code{c}
+ * // Example of a low priority task which keeps a page in reserve:
+ * while (true) {
+ *     while (nvs_gc_step(NULL) == ESP_OK) {
+ *     }
+ *     vTaskDelay(1000 / portTICK_PERIOD_MS);
+ * }
+ * \endcode
+ *
+ * @param[in]   part_name   Partition name NVS in the partition table.
+ *                          If pass a NULL than will use NVS_DEFAULT_PART_NAME ("nvs").
+ *
+ * @return
+ *             - ESP_OK if a page has been freed or a new active page has been started.
+ *               Calling the function again may do more work.
+ *             - ESP_ERR_NVS_NOT_FOUND if there is nothing to do at the moment.
+ *             - ESP_ERR_NVS_NOT_INITIALIZED if the storage driver is not initialized.
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_gc_step(const char* part_name);
+
 /**
  * @brief      Calculate all entries in a namespace.
  *
@@ -399,6 +399,32 @@ extern "C" esp_err_t nvs_set_u64 (nvs_handle handle, const char* key, uint64_t v
     return nvs_set(handle, key, value);
 }
 
+extern "C" esp_err_t nvs_set_batch(nvs_handle handle, const nvs_batch_item_t* items, size_t count, size_t* saved_ops)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %d", __func__, count);
+    if (saved_ops) {
+        *saved_ops = 0;
+    }
+    HandleEntry entry;
+    auto err = nvs_find_ns_handle(handle, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (entry.mReadOnly) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (items == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t savedOps;
+    err = entry.mStoragePtr->writeItems(entry.mNsIndex, items, count, savedOps);
+    if (saved_ops) {
+        *saved_ops = savedOps;
+    }
+    return err;
+}
+
 extern "C" esp_err_t nvs_commit(nvs_handle handle)
 {
     Lock lock;
@@ -525,6 +551,172 @@ extern "C" esp_err_t nvs_get_blob(nvs_handle handle, const char* key, void* out_
     return nvs_get_str_or_blob(handle, nvs::ItemType::BLOB, key, out_value, length);
 }
 
+extern "C" esp_err_t nvs_get_blob_mapped(nvs_handle handle, const char* key, nvs_blob_map_handle_t* out_map,
+                                         const nvs_blob_segment_t** out_segments, size_t* out_count)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %s", __func__, key);
+    HandleEntry entry;
+    auto err = nvs_find_ns_handle(handle, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (out_map == nullptr || out_segments == nullptr || out_count == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs::BlobMap* blobMap;
+    err = entry.mStoragePtr->mapBlob(entry.mNsIndex, key, blobMap);
+    if (err != ESP_OK) {
+        return err;
+    }
+    *out_map = reinterpret_cast<nvs_blob_map_handle_t>(blobMap);
+    *out_segments = blobMap->segments();
+    *out_count = blobMap->segmentCount();
+    return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_release_blob_mapped(nvs_blob_map_handle_t map)
+{
+    Lock lock;
+    auto blobMap = reinterpret_cast<nvs::BlobMap*>(map);
+    for (auto it = s_nvs_storage_list.begin(); it != s_nvs_storage_list.end(); ++it) {
+        if (it->unmapBlob(blobMap) == ESP_OK) {
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+static nvs::Storage* lookup_storage_from_blob_writer(const nvs::BlobWriter* writer)
+{
+    for (auto it = s_nvs_storage_list.begin(); it != s_nvs_storage_list.end(); ++it) {
+        if (it->hasBlobWriter(writer)) {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+static nvs::Storage* lookup_storage_from_blob_reader(const nvs::BlobReader* reader)
+{
+    for (auto it = s_nvs_storage_list.begin(); it != s_nvs_storage_list.end(); ++it) {
+        if (it->hasBlobReader(reader)) {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+extern "C" esp_err_t nvs_blob_write_open(nvs_handle handle, const char* key, size_t buffer_size, nvs_blob_writer_handle_t* out_writer)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %s %d", __func__, key, buffer_size);
+    HandleEntry entry;
+    auto err = nvs_find_ns_handle(handle, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (entry.mReadOnly) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (out_writer == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs::BlobWriter* writer;
+    err = entry.mStoragePtr->openBlobWriter(entry.mNsIndex, key, buffer_size, writer);
+    if (err != ESP_OK) {
+        return err;
+    }
+    *out_writer = reinterpret_cast<nvs_blob_writer_handle_t>(writer);
+    return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_blob_write_append(nvs_blob_writer_handle_t writer, const void* data, size_t length)
+{
+    Lock lock;
+    auto blobWriter = reinterpret_cast<nvs::BlobWriter*>(writer);
+    auto storage = lookup_storage_from_blob_writer(blobWriter);
+    if (storage == nullptr) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    return storage->appendBlob(blobWriter, data, length);
+}
+
+extern "C" esp_err_t nvs_blob_write_close(nvs_blob_writer_handle_t writer)
+{
+    Lock lock;
+    auto blobWriter = reinterpret_cast<nvs::BlobWriter*>(writer);
+    auto storage = lookup_storage_from_blob_writer(blobWriter);
+    if (storage == nullptr) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    return storage->closeBlobWriter(blobWriter, true);
+}
+
+extern "C" esp_err_t nvs_blob_write_abort(nvs_blob_writer_handle_t writer)
+{
+    Lock lock;
+    auto blobWriter = reinterpret_cast<nvs::BlobWriter*>(writer);
+    auto storage = lookup_storage_from_blob_writer(blobWriter);
+    if (storage == nullptr) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    storage->closeBlobWriter(blobWriter, false);
+    return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_blob_read_open(nvs_handle handle, const char* key, nvs_blob_reader_handle_t* out_reader, size_t* out_length)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %s", __func__, key);
+    HandleEntry entry;
+    auto err = nvs_find_ns_handle(handle, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (out_reader == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs::BlobReader* reader;
+    err = entry.mStoragePtr->openBlobReader(entry.mNsIndex, key, reader);
+    if (err != ESP_OK) {
+        return err;
+    }
+    *out_reader = reinterpret_cast<nvs_blob_reader_handle_t>(reader);
+    if (out_length) {
+        *out_length = reader->mDataSize;
+    }
+    return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_blob_read(nvs_blob_reader_handle_t reader, void* out_data, size_t length, size_t* out_read)
+{
+    Lock lock;
+    auto blobReader = reinterpret_cast<nvs::BlobReader*>(reader);
+    auto storage = lookup_storage_from_blob_reader(blobReader);
+    if (storage == nullptr) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (out_data == nullptr || out_read == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return storage->readBlob(blobReader, out_data, length, *out_read);
+}
+
+extern "C" esp_err_t nvs_blob_read_close(nvs_blob_reader_handle_t reader)
+{
+    Lock lock;
+    auto blobReader = reinterpret_cast<nvs::BlobReader*>(reader);
+    auto storage = lookup_storage_from_blob_reader(blobReader);
+    if (storage == nullptr) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    return storage->closeBlobReader(blobReader);
+}
+
 extern "C" esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats)
 {
     Lock lock;
@@ -537,6 +729,8 @@ extern "C" esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats
     nvs_stats->free_entries     = 0;
     nvs_stats->total_entries    = 0;
     nvs_stats->namespace_count  = 0;
+    nvs_stats->cache_hits       = 0;
+    nvs_stats->cache_misses     = 0;
 
     pStorage = lookup_storage_from_name((part_name == NULL) ? NVS_DEFAULT_PART_NAME : part_name);
     if (pStorage == NULL) {
@@ -550,6 +744,19 @@ extern "C" esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats
     return pStorage->fillStats(*nvs_stats);
 }
 
+extern "C" esp_err_t nvs_gc_step(const char* part_name)
+{
+    Lock lock;
+    nvs::Storage* pStorage;
+
+    pStorage = lookup_storage_from_name((part_name == NULL) ? NVS_DEFAULT_PART_NAME : part_name);
+    if (pStorage == NULL) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    return pStorage->gcStep();
+}
+
 extern "C" esp_err_t nvs_get_used_entry_count(nvs_handle handle, size_t* used_entries)
 {
     Lock lock;
@@ -19,67 +19,56 @@ namespace nvs
 
 HashList::HashList()
 {
+    static_assert(sizeof(HashListNode) == 4, "hash list node should be 4 bytes");
 }
-    
+
 void HashList::clear()
 {
-    for (auto it = mBlockList.begin(); it != mBlockList.end();) {
-        auto tmp = it;
-        ++it;
-        mBlockList.erase(tmp);
-        delete static_cast<HashListBlock*>(tmp);
-    }
+    std::fill_n(mNodes, CAPACITY, HashListNode());
+    mSize = 0;
 }
-    
-HashList::~HashList()
+
+void HashList::insert(const Item& item, size_t index)
 {
-    clear();
+    insert(item.calculateCrc32WithoutValue() & 0xffffff, index);
 }
 
-HashList::HashListBlock::HashListBlock()
+void HashList::insert(uint32_t hash_24, size_t index)
 {
-    static_assert(sizeof(HashListBlock) == HashListBlock::BYTE_SIZE,
-                  "cache block size calculation incorrect");
+    assert(mSize < CAPACITY - 1);
+    size_t slot = home(hash_24);
+    while (mNodes[slot].mIndex != 0xff) {
+        slot = (slot + 1) & (CAPACITY - 1);
+    }
+    mNodes[slot] = HashListNode(hash_24, index);
+    ++mSize;
 }
 
-void HashList::insert(const Item& item, size_t index)
+void HashList::eraseAt(size_t slot)
 {
-    const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
-    // add entry to the end of last block if possible
-    if (mBlockList.size()) {
-        auto& block = mBlockList.back();
-        if (block.mCount < HashListBlock::ENTRY_COUNT) {
-            block.mNodes[block.mCount++] = HashListNode(hash_24, index);
-            return;
+    const size_t mask = CAPACITY - 1;
+    size_t hole = slot;
+    mNodes[hole].mIndex = 0xff;
+    --mSize;
+
+    // Move back any nodes which would become unreachable because of the hole
+    for (size_t next = (hole + 1) & mask; mNodes[next].mIndex != 0xff; next = (next + 1) & mask) {
+        size_t want = home(mNodes[next].mHash);
+        bool canMove = (hole <= next) ? (want <= hole || want > next) : (want <= hole && want > next);
+        if (canMove) {
+            mNodes[hole] = mNodes[next];
+            mNodes[next].mIndex = 0xff;
+            hole = next;
         }
     }
-    // if the above failed, create a new block and add entry to it
-    HashListBlock* newBlock = new HashListBlock;
-    mBlockList.push_back(newBlock);
-    newBlock->mNodes[0] = HashListNode(hash_24, index);
-    newBlock->mCount++;
 }
 
 void HashList::erase(size_t index, bool itemShouldExist)
 {
-    for (auto it = mBlockList.begin(); it != mBlockList.end();) {
-        bool haveEntries = false;
-        for (size_t i = 0; i < it->mCount; ++i) {
-            if (it->mNodes[i].mIndex == index) {
-                it->mNodes[i].mIndex = 0xff;
-                return;
-            }
-            if (it->mNodes[i].mIndex != 0xff) {
-                haveEntries = true;
-            }
-        }
-        if (!haveEntries) {
-            auto tmp = it;
-            ++it;
-            mBlockList.erase(tmp);
-            delete static_cast<HashListBlock*>(tmp);
-        } else {
-            ++it;
+    for (size_t slot = 0; slot < CAPACITY; ++slot) {
+        if (mNodes[slot].mIndex == index) {
+            eraseAt(slot);
+            return;
         }
     }
     if (itemShouldExist) {
@@ -90,18 +79,26 @@ void HashList::erase(size_t index, bool itemShouldExist)
 size_t HashList::find(size_t start, const Item& item)
 {
     const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
-    for (auto it = mBlockList.begin(); it != mBlockList.end(); ++it) {
-        for (size_t index = 0; index < it->mCount; ++index) {
-            HashListNode& e = it->mNodes[index];
-            if (e.mIndex >= start &&
-                    e.mHash == hash_24 &&
-                    e.mIndex != 0xff) {
-                return e.mIndex;
-            }
+    size_t result = SIZE_MAX;
+    for (size_t slot = home(hash_24); mNodes[slot].mIndex != 0xff; slot = (slot + 1) & (CAPACITY - 1)) {
+        const HashListNode& e = mNodes[slot];
+        if (e.mHash == hash_24 && e.mIndex >= start && e.mIndex < result) {
+            result = e.mIndex;
         }
     }
-    return SIZE_MAX;
+    return result;
 }
 
+size_t HashList::getEntries(uint32_t* entries, size_t maxCount) const
+{
+    size_t count = 0;
+    for (size_t slot = 0; slot < CAPACITY && count < maxCount; ++slot) {
+        const HashListNode& e = mNodes[slot];
+        if (e.mIndex != 0xff) {
+            entries[count++] = e.mIndex | (static_cast<uint32_t>(e.mHash) << 8);
+        }
+    }
+    return count;
+}
 
 } // namespace nvs
@@ -17,26 +17,46 @@
 
 #include "nvs.h"
 #include "nvs_types.hpp"
-#include "intrusive_list.h"
 
 namespace nvs
 {
 
+/**
+ * Hashes of the items stored in one page, used to find an item without reading
+ * every entry of the page.
+ *
+ * Each node holds the 24-bit hash of an item (namespace, key and chunk index)
+ * and the index of its first entry. Nodes are kept in a fixed open-addressed
+ * table with linear probing and backward shift deletion. A page can't hold more
+ * items than it has entries, so the table always has free nodes and never needs
+ * to grow.
+ */
 class HashList
 {
 public:
     HashList();
-    ~HashList();
-    
+
     void insert(const Item& item, size_t index);
+    void insert(uint32_t hash, size_t index);
     void erase(const size_t index, bool itemShouldExist=true);
     size_t find(size_t start, const Item& item);
     void clear();
-    
+
+    /**
+     * Copy entries into 'entries' in no particular order, each one packed as
+     * (index | hash << 8). Returns the number of entries copied.
+     */
+    size_t getEntries(uint32_t* entries, size_t maxCount) const;
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
 private:
     HashList(const HashList& other);
     const HashList& operator= (const HashList& rhs);
-    
+
 protected:
 
     struct HashListNode {
@@ -54,18 +74,18 @@ protected:
         uint32_t mHash  : 24;
     };
 
-    struct HashListBlock : public intrusive_list_node<HashList::HashListBlock> {
-        HashListBlock();
+    /* Power of two larger than the number of entries in a page */
+    static const size_t CAPACITY = 128;
 
-        static const size_t BYTE_SIZE = 128;
-        static const size_t ENTRY_COUNT = (BYTE_SIZE - sizeof(intrusive_list_node<HashListBlock>) - sizeof(size_t)) / 4;
+    static size_t home(uint32_t hash)
+    {
+        return hash & (CAPACITY - 1);
+    }
 
-        size_t mCount = 0;
-        HashListNode mNodes[ENTRY_COUNT];
-    };
+    void eraseAt(size_t slot);
 
-    typedef intrusive_list<HashListBlock> TBlockList;
-    TBlockList mBlockList;
+    HashListNode mNodes[CAPACITY];
+    size_t mSize = 0;
 }; // class HashList
 
 } // namespace nvs
@@ -0,0 +1,183 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nvs_item_index.hpp"
+
+namespace nvs
+{
+
+ItemIndex::ItemIndex()
+{
+}
+
+ItemIndex::~ItemIndex()
+{
+    delete[] mNodes;
+}
+
+void ItemIndex::clear()
+{
+    delete[] mNodes;
+    mNodes = nullptr;
+    mCapacity = 0;
+    mCount = 0;
+}
+
+void ItemIndex::grow()
+{
+    IndexNode* oldNodes = mNodes;
+    size_t oldCapacity = mCapacity;
+
+    mCapacity = (oldCapacity == 0) ? INITIAL_CAPACITY : oldCapacity * 2;
+    mNodes = new IndexNode[mCapacity];
+    std::fill_n(mNodes, mCapacity, IndexNode{nullptr, 0, 0});
+    mCount = 0;
+
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (oldNodes[i].mPage != nullptr) {
+            insertNode(oldNodes[i]);
+        }
+    }
+    delete[] oldNodes;
+}
+
+void ItemIndex::insertNode(const IndexNode& node)
+{
+    size_t slot = home(node.mHash);
+    while (mNodes[slot].mPage != nullptr) {
+        slot = (slot + 1) & (mCapacity - 1);
+    }
+    mNodes[slot] = node;
+    ++mCount;
+}
+
+void ItemIndex::insert(const Item& item, Page* page, size_t index)
+{
+    insert(hash(item), page, index);
+}
+
+void ItemIndex::insert(uint32_t hash, Page* page, size_t index)
+{
+    if ((mCount + 1) * 4 > mCapacity * 3) {
+        grow();
+    }
+    IndexNode node;
+    node.mPage = page;
+    node.mIndex = static_cast<uint32_t>(index);
+    node.mHash = hash;
+    insertNode(node);
+}
+
+void ItemIndex::eraseAt(size_t slot)
+{
+    const size_t mask = mCapacity - 1;
+    size_t hole = slot;
+    mNodes[hole].mPage = nullptr;
+    --mCount;
+
+    // Move back any nodes which would become unreachable because of the hole
+    for (size_t next = (hole + 1) & mask; mNodes[next].mPage != nullptr; next = (next + 1) & mask) {
+        size_t want = home(mNodes[next].mHash);
+        bool canMove = (hole <= next) ? (want <= hole || want > next) : (want <= hole && want > next);
+        if (canMove) {
+            mNodes[hole] = mNodes[next];
+            mNodes[next].mPage = nullptr;
+            hole = next;
+        }
+    }
+}
+
+void ItemIndex::erase(const Item& item, const Page* page, size_t index)
+{
+    if (mCount == 0) {
+        return;
+    }
+    const uint32_t hash_24 = hash(item);
+    for (size_t slot = home(hash_24); mNodes[slot].mPage != nullptr; slot = (slot + 1) & (mCapacity - 1)) {
+        if (mNodes[slot].mPage == page && mNodes[slot].mIndex == index) {
+            eraseAt(slot);
+            return;
+        }
+    }
+    // Item has been found in flash but its hash is not the one it was indexed with.
+    erase(page, index);
+}
+
+void ItemIndex::erase(const Page* page, size_t index)
+{
+    for (size_t slot = 0; slot < mCapacity; ++slot) {
+        if (mNodes[slot].mPage == page && mNodes[slot].mIndex == index) {
+            eraseAt(slot);
+            return;
+        }
+    }
+}
+
+void ItemIndex::erase(const Page* page)
+{
+    // Backward shift only ever moves nodes towards the slot being examined,
+    // so a single forward pass is enough to remove all nodes of the page.
+    for (size_t slot = 0; slot < mCapacity; ++slot) {
+        while (mNodes[slot].mPage == page) {
+            eraseAt(slot);
+        }
+    }
+}
+
+bool ItemIndex::contains(uint32_t hash, const Page* page, size_t index) const
+{
+    if (mCount == 0) {
+        return false;
+    }
+    for (size_t slot = home(hash); mNodes[slot].mPage != nullptr; slot = (slot + 1) & (mCapacity - 1)) {
+        if (mNodes[slot].mHash == hash && mNodes[slot].mPage == page && mNodes[slot].mIndex == index) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t ItemIndex::find(uint32_t hash, Page** pages, size_t* indices, size_t maxCount) const
+{
+    size_t count = 0;
+    if (mCount == 0) {
+        return 0;
+    }
+    for (size_t slot = home(hash); mNodes[slot].mPage != nullptr; slot = (slot + 1) & (mCapacity - 1)) {
+        const IndexNode& node = mNodes[slot];
+        if (node.mHash != hash) {
+            continue;
+        }
+        size_t i;
+        for (i = 0; i < count; ++i) {
+            if (pages[i] == node.mPage) {
+                if (node.mIndex < indices[i]) {
+                    indices[i] = node.mIndex;
+                }
+                break;
+            }
+        }
+        if (i == count) {
+            if (count == maxCount) {
+                return SIZE_MAX;
+            }
+            pages[count] = node.mPage;
+            indices[count] = node.mIndex;
+            ++count;
+        }
+    }
+    return count;
+}
+
+} // namespace nvs
@@ -0,0 +1,106 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef nvs_item_index_hpp
+#define nvs_item_index_hpp
+
+#include "nvs.h"
+#include "nvs_types.hpp"
+
+namespace nvs
+{
+
+class Page;
+
+/**
+ * Storage-wide index of items, kept next to the per-page HashList.
+ *
+ * Each node maps the 24-bit item hash (namespace, key and chunk index, same as
+ * in HashList) to the page holding the item and the index of the item within
+ * that page. Pages update the index whenever they update their own hash list,
+ * so the set of (page, index) pairs in this table always matches the union of
+ * all page hash lists. This allows Storage to go straight to the pages which
+ * may contain an item instead of asking every page in turn.
+ *
+ * The table is open-addressed with linear probing and backward shift deletion,
+ * and grows by doubling when it becomes 3/4 full.
+ */
+class ItemIndex
+{
+public:
+    ItemIndex();
+    ~ItemIndex();
+
+    static uint32_t hash(const Item& item)
+    {
+        return item.calculateCrc32WithoutValue() & 0xffffff;
+    }
+
+    void insert(const Item& item, Page* page, size_t index);
+    void insert(uint32_t hash, Page* page, size_t index);
+    void erase(const Item& item, const Page* page, size_t index);
+    void erase(const Page* page, size_t index);
+    void erase(const Page* page);
+    bool contains(uint32_t hash, const Page* page, size_t index) const;
+    void clear();
+
+    /**
+     * Collect pages which hold an item with the given hash.
+     * For every page, the lowest matching item index is reported in 'indices'.
+     * Returns the number of distinct pages found, or SIZE_MAX if there are more
+     * than 'maxCount' of them.
+     */
+    size_t find(uint32_t hash, Page** pages, size_t* indices, size_t maxCount) const;
+
+    size_t size() const
+    {
+        return mCount;
+    }
+
+    size_t capacity() const
+    {
+        return mCapacity;
+    }
+
+private:
+    ItemIndex(const ItemIndex& other);
+    const ItemIndex& operator= (const ItemIndex& rhs);
+
+protected:
+    struct IndexNode {
+        Page* mPage;
+        uint32_t mIndex : 8;
+        uint32_t mHash  : 24;
+    };
+
+    static const size_t INITIAL_CAPACITY = 64;
+
+    size_t home(uint32_t hash) const
+    {
+        return hash & (mCapacity - 1);
+    }
+
+    void grow();
+    void insertNode(const IndexNode& node);
+    void eraseAt(size_t slot);
+
+    IndexNode* mNodes = nullptr;
+    size_t mCapacity = 0;
+    size_t mCount = 0;
+}; // class ItemIndex
+
+} // namespace nvs
+
+
+#endif /* nvs_item_index_hpp */
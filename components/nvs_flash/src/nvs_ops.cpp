@@ -14,6 +14,9 @@
 
 #include "esp_spi_flash.h"
 #include "nvs_ops.hpp"
+#ifdef ESP_PLATFORM
+#include "esp_flash_encrypt.h"
+#endif
 #ifdef CONFIG_NVS_ENCRYPTION
 #include "nvs_encr.hpp"
 #include <string.h>
@@ -61,6 +64,19 @@ esp_err_t nvs_flash_read(size_t srcAddr, void *destAddr, size_t size) {
     }
     return ESP_OK;
 }
+
+bool nvs_flash_can_mmap(size_t addr) {
+#ifdef ESP_PLATFORM
+    /* Flash cache decrypts everything it reads, while NVS data is written in plain text */
+    if (esp_flash_encryption_enabled()) {
+        return false;
+    }
+#endif
+    if(EncrMgr::isEncrActive()) {
+        return EncrMgr::getInstance()->findXtsCtxtFromAddr(addr) == nullptr;
+    }
+    return true;
+}
 #else
 esp_err_t nvs_flash_write(size_t destAddr, const void *srcAddr, size_t size) {
     return spi_flash_write(destAddr, srcAddr, size);
@@ -69,5 +85,14 @@ esp_err_t nvs_flash_write(size_t destAddr, const void *srcAddr, size_t size) {
 esp_err_t nvs_flash_read(size_t srcAddr, void *destAddr, size_t size) {
     return spi_flash_read(srcAddr, destAddr, size);
 }
+
+bool nvs_flash_can_mmap(size_t addr) {
+#ifdef ESP_PLATFORM
+    /* Flash cache decrypts everything it reads, while NVS data is written in plain text */
+    return !esp_flash_encryption_enabled();
+#else
+    return true;
+#endif
+}
 #endif
 }
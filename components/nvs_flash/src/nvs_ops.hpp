@@ -20,6 +20,7 @@ namespace nvs
 {
     esp_err_t nvs_flash_write(size_t destAddr, const void *srcAddr, size_t size);
     esp_err_t nvs_flash_read(size_t srcAddr, void *destAddr, size_t size);
+    bool nvs_flash_can_mmap(size_t addr);
 
 } // namespace nvs
 
@@ -19,6 +19,8 @@
 #endif
 #include <cstdio>
 #include <cstring>
+#include <memory>
+#include <new>
 
 #include "nvs_ops.hpp"
 
@@ -37,6 +39,8 @@ esp_err_t Page::load(uint32_t sectorNumber)
     mBaseAddress = sectorNumber * SEC_SIZE;
     mUsedEntryCount = 0;
     mErasedEntryCount = 0;
+    mLoadedFromCheckpoint = false;
+    std::fill_n(mMountEntries.data(), mMountEntries.byteSize() / sizeof(uint32_t), 0);
 
     Header header;
     auto rc = spi_flash_read(mBaseAddress, &header, sizeof(header));
@@ -204,7 +208,9 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
     assert(totalSize == ENTRY_SIZE ||
        isVariableLengthType(datatype));
 
-    if (mNextFreeEntry == INVALID_ENTRY || mNextFreeEntry + entriesCount > ENTRY_COUNT) {
+    // items which don't fit anywhere else can use the room of the checkpoint
+    const size_t reserved = (mNextFreeEntry == 0) ? 0 : getReservedEntryCount(mHashList.size() + 1);
+    if (mNextFreeEntry == INVALID_ENTRY || mNextFreeEntry + entriesCount + reserved > ENTRY_COUNT) {
         // page will not fit this amount of data
         return ESP_ERR_NVS_PAGE_FULL;
     }
@@ -212,7 +218,7 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
     // write first item
     size_t span = (totalSize + ENTRY_SIZE - 1) / ENTRY_SIZE;
     item = Item(nsIndex, datatype, span, key, chunkIdx);
-    mHashList.insert(item, mNextFreeEntry);
+    insertHash(item, mNextFreeEntry);
 
     if (!isVariableLengthType(datatype)) {
         memcpy(item.data, data, dataSize);
@@ -254,6 +260,87 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
     return ESP_OK;
 }
 
+esp_err_t Page::writeItems(uint8_t nsIndex, const nvs_batch_item_t* items, size_t count, size_t& writeCount)
+{
+    esp_err_t err;
+    writeCount = 0;
+
+    assert(count > 0);
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    if (mState == PageState::UNINITIALIZED) {
+        err = initialize();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (mState == PageState::FULL) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    if (mNextFreeEntry == INVALID_ENTRY || mNextFreeEntry + count > ENTRY_COUNT) {
+        // page will not fit all the items
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    // Flag the page before anything else. If power goes out after the batch is committed,
+    // but before the old values are erased, the flag tells PageManager::load to look for
+    // duplicates of every item on this page, not only the last one.
+    if (!isBatchWritten()) {
+        err = setFlag(BATCH_FLAG_MASK);
+        if (err != ESP_OK) {
+            return err;
+        }
+        ++writeCount;
+    }
+
+    Item* buf = new Item[count];
+    for (size_t i = 0; i < count; ++i) {
+        ItemType datatype = static_cast<ItemType>(items[i].type);
+        assert(!isVariableLengthType(datatype));
+        buf[i] = Item(nsIndex, datatype, 1, items[i].key);
+        memcpy(buf[i].data, items[i].value, getAlignmentForType(datatype));
+        buf[i].crc32 = buf[i].calculateCrc32();
+    }
+
+    // Stage all entries with a single write while they are still marked as empty.
+    // Should power go out now, mLoadEntryTable will find them half-written and erase them.
+    const size_t begin = mNextFreeEntry;
+    err = nvs_flash_write(getEntryAddress(begin), buf, count * ENTRY_SIZE);
+    if (err != ESP_OK) {
+        delete[] buf;
+        mState = PageState::INVALID;
+        return err;
+    }
+    ++writeCount;
+
+    // Commit. Entry state words are written from last to first, so the batch only
+    // becomes visible once the word holding the first entry has been written.
+    err = alterEntryRangeState(begin, begin + count, EntryState::WRITTEN);
+    if (err != ESP_OK) {
+        delete[] buf;
+        mState = PageState::INVALID;
+        return err;
+    }
+    writeCount += mEntryTable.getWordIndex(begin + count - 1) - mEntryTable.getWordIndex(begin) + 1;
+
+    for (size_t i = 0; i < count; ++i) {
+        insertHash(buf[i], begin + i);
+    }
+    delete[] buf;
+
+    if (mFirstUsedEntry == INVALID_ENTRY) {
+        mFirstUsedEntry = begin;
+    }
+    mUsedEntryCount += count;
+    mNextFreeEntry += count;
+    return ESP_OK;
+}
+
 esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx, VerOffset chunkStart)
 {
     size_t index = 0;
@@ -323,6 +410,60 @@ esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, ui
     return findItem(nsIndex, datatype, key, index, item, chunkIdx, chunkStart);
 }
 
+esp_err_t Page::readItemData(uint8_t nsIndex, ItemType datatype, const char* key, size_t offset, void* data, size_t size, uint8_t chunkIdx)
+{
+    size_t index = 0;
+    Item item;
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    esp_err_t rc = findItem(nsIndex, datatype, key, index, item, chunkIdx);
+    if (rc != ESP_OK) {
+        return rc;
+    }
+
+    if (!isVariableLengthType(datatype) || offset + size > static_cast<size_t>(item.varLength.dataSize)) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+
+    /* Unlike readItem, the CRC of the data can't be checked here, it is left to the caller */
+    uint8_t* dst = reinterpret_cast<uint8_t*>(data);
+    size_t skip = offset % ENTRY_SIZE;
+    for (size_t i = index + 1 + offset / ENTRY_SIZE; size > 0; ++i) {
+        Item ditem;
+        rc = readEntry(i, ditem);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        size_t willCopy = ENTRY_SIZE - skip;
+        willCopy = (size < willCopy)?size:willCopy;
+        memcpy(dst, ditem.rawData + skip, willCopy);
+        size -= willCopy;
+        dst += willCopy;
+        skip = 0;
+    }
+    return ESP_OK;
+}
+
+esp_err_t Page::findItemData(uint8_t nsIndex, ItemType datatype, const char* key, uint32_t& dataAddress, Item& item, uint8_t chunkIdx)
+{
+    size_t index = 0;
+    esp_err_t rc = findItem(nsIndex, datatype, key, index, item, chunkIdx);
+    if (rc != ESP_OK) {
+        return rc;
+    }
+
+    if (!isVariableLengthType(datatype)) {
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+
+    // data of variable length items directly follows the header entry
+    dataAddress = (item.span > 1) ? getEntryAddress(index + 1) : getEntryAddress(index);
+    return ESP_OK;
+}
+
 esp_err_t Page::eraseEntryAndSpan(size_t index)
 {
     auto state = mEntryTable.get(index);
@@ -337,6 +478,9 @@ esp_err_t Page::eraseEntryAndSpan(size_t index)
         }
         if (item.calculateCrc32() != item.crc32) {
             mHashList.erase(index, false);
+            if (mItemIndex) {
+                mItemIndex->erase(this, index);
+            }
             rc = alterEntryState(index, EntryState::ERASED);
             --mUsedEntryCount;
             ++mErasedEntryCount;
@@ -345,6 +489,9 @@ esp_err_t Page::eraseEntryAndSpan(size_t index)
             }
         } else {
             mHashList.erase(index);
+            if (mItemIndex) {
+                mItemIndex->erase(item, this, index);
+            }
             span = item.span;
             for (ptrdiff_t i = index + span - 1; i >= static_cast<ptrdiff_t>(index); --i) {
                 if (mEntryTable.get(i) == EntryState::WRITTEN) {
@@ -379,6 +526,78 @@ esp_err_t Page::eraseEntryAndSpan(size_t index)
     return ESP_OK;
 }
 
+esp_err_t Page::eraseEntries(const size_t* indices, size_t count, size_t& writeCount)
+{
+    uint32_t dirtyWords = 0;
+    static_assert(TEntryTable::byteSize() / 4 <= 32, "dirty word mask is too small");
+
+    writeCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const size_t index = indices[i];
+        assert(mEntryTable.get(index) == EntryState::WRITTEN);
+
+        Item item;
+        auto rc = readEntry(index, item);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        // only single entry items can be erased this way
+        assert(item.span == 1);
+        if (item.calculateCrc32() != item.crc32) {
+            mHashList.erase(index, false);
+            if (mItemIndex) {
+                mItemIndex->erase(this, index);
+            }
+        } else {
+            mHashList.erase(index);
+            if (mItemIndex) {
+                mItemIndex->erase(item, this, index);
+            }
+        }
+        mEntryTable.set(index, EntryState::ERASED);
+        dirtyWords |= 1 << mEntryTable.getWordIndex(index);
+        --mUsedEntryCount;
+        ++mErasedEntryCount;
+    }
+
+    // Each word of the entry state table is written once, however many entries it holds
+    for (size_t wordIndex = 0; dirtyWords != 0; ++wordIndex, dirtyWords >>= 1) {
+        if ((dirtyWords & 1) == 0) {
+            continue;
+        }
+        uint32_t word = mEntryTable.data()[wordIndex];
+        auto rc = spi_flash_write(mBaseAddress + ENTRY_TABLE_OFFSET + static_cast<uint32_t>(wordIndex) * 4,
+                &word, sizeof(word));
+        if (rc != ESP_OK) {
+            mState = PageState::INVALID;
+            return rc;
+        }
+        ++writeCount;
+    }
+
+    if (mFirstUsedEntry != INVALID_ENTRY && mEntryTable.get(mFirstUsedEntry) != EntryState::WRITTEN) {
+        updateFirstUsedEntry(mFirstUsedEntry, 1);
+    }
+    return ESP_OK;
+}
+
+void Page::insertHash(const Item& item, size_t index)
+{
+    mHashList.insert(item, index);
+    if (mItemIndex) {
+        mItemIndex->insert(item, this, index);
+    }
+    mMountEntries.set(index, isMountItem(item));
+}
+
+void Page::insertHash(uint32_t hash, size_t index)
+{
+    mHashList.insert(hash, index);
+    if (mItemIndex) {
+        mItemIndex->insert(hash, this, index);
+    }
+}
+
 void Page::updateFirstUsedEntry(size_t index, size_t span)
 {
     assert(index == mFirstUsedEntry);
@@ -395,7 +614,7 @@ void Page::updateFirstUsedEntry(size_t index, size_t span)
     }
 }
 
-esp_err_t Page::copyItems(Page& other)
+esp_err_t Page::copyItems(Page& other, Page* skipItemsIn)
 {
     if (mFirstUsedEntry == INVALID_ENTRY) {
         return ESP_ERR_NVS_NOT_FOUND;
@@ -423,7 +642,14 @@ esp_err_t Page::copyItems(Page& other)
             return err;
         }
 
-        other.mHashList.insert(entry, other.mNextFreeEntry);
+        // item has already been copied before copying was interrupted
+        if (skipItemsIn != nullptr &&
+                skipItemsIn->findItem(entry.nsIndex, entry.datatype, entry.key, entry.chunkIndex) == ESP_OK) {
+            readEntryIndex += entry.span;
+            continue;
+        }
+
+        other.insertHash(entry, other.mNextFreeEntry);
         err = other.writeEntry(entry);
         if (err != ESP_OK) {
             return err;
@@ -514,6 +740,11 @@ esp_err_t Page::mLoadEntryTable()
             }
         }
 
+        // entries erased above may include the one found as first used
+        if (mFirstUsedEntry != INVALID_ENTRY && mEntryTable.get(mFirstUsedEntry) != EntryState::WRITTEN) {
+            updateFirstUsedEntry(mFirstUsedEntry, 1);
+        }
+
         // check that all variable-length items are written or erased fully
         Item item;
         size_t lastItemIndex = INVALID_ENTRY;
@@ -546,7 +777,7 @@ esp_err_t Page::mLoadEntryTable()
                 continue;
             }
 
-            mHashList.insert(item, i);
+            insertHash(item, i);
 
             // search for potential duplicate item
             size_t duplicateIndex = mHashList.find(0, item);
@@ -591,6 +822,11 @@ esp_err_t Page::mLoadEntryTable()
             }
         }
     } else if (mState == PageState::FULL || mState == PageState::FREEING) {
+        if (mFastMount && mLoadCheckpoint() == ESP_OK) {
+            mLoadedFromCheckpoint = true;
+            return ESP_OK;
+        }
+
         // We have already filled mHashList for page in active state.
         // Do the same for the case when page is in full or freeing state.
         Item item;
@@ -616,7 +852,7 @@ esp_err_t Page::mLoadEntryTable()
 
             assert(item.span > 0);
 
-            mHashList.insert(item, i);
+            insertHash(item, i);
 
             size_t span = item.span;
 
@@ -637,6 +873,199 @@ esp_err_t Page::mLoadEntryTable()
     return ESP_OK;
 }
 
+esp_err_t Page::mLoadCheckpoint()
+{
+    // the checkpoint is made of the last entries which are not empty
+    size_t end = ENTRY_COUNT;
+    while (end > 0 && mEntryTable.get(end - 1) == EntryState::EMPTY) {
+        --end;
+    }
+    if (end == 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    CheckpointBlock last;
+    auto rc = nvs_flash_read(getEntryAddress(end - 1), &last, sizeof(last));
+    if (rc != ESP_OK) {
+        return rc;
+    }
+    const size_t blockCount = last.mBlockCount;
+    if (last.mMark != CHECKPOINT_MARK || last.mType != ItemType::ANY ||
+            blockCount == 0 || blockCount > end || last.mBlockIndex != blockCount - 1) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    const size_t begin = end - blockCount;
+    for (size_t i = begin; i < end; ++i) {
+        if (mEntryTable.get(i) != EntryState::ERASED) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+    }
+
+    std::unique_ptr<uint8_t[]> buf(new (std::nothrow) uint8_t[blockCount * ENTRY_SIZE]);
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // check block headers, and move the payloads next to each other
+    uint8_t* payload = buf.get();
+    for (size_t b = 0; b < blockCount; ++b) {
+        // encrypted entries can only be read one at a time
+        rc = nvs_flash_read(getEntryAddress(begin + b), buf.get() + b * ENTRY_SIZE, ENTRY_SIZE);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        auto block = reinterpret_cast<const CheckpointBlock*>(buf.get() + b * ENTRY_SIZE);
+        if (block->mMark != CHECKPOINT_MARK || block->mType != ItemType::ANY ||
+                block->mBlockIndex != b || block->mBlockCount != blockCount) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        memmove(payload + b * CHECKPOINT_PAYLOAD_SIZE, block->mPayload, CHECKPOINT_PAYLOAD_SIZE);
+    }
+
+    const size_t payloadSize = blockCount * CHECKPOINT_PAYLOAD_SIZE;
+    uint32_t crc32;
+    uint16_t itemCount;
+    memcpy(&crc32, payload + payloadSize - sizeof(crc32), sizeof(crc32));
+    memcpy(&itemCount, payload + payloadSize - 8, sizeof(itemCount));
+    if (crc32 != Item::calculateCrc32(payload, payloadSize - sizeof(crc32)) ||
+            getCheckpointEntryCount(itemCount) != blockCount) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    TEntryFlags written;
+    TEntryFlags mountEntries;
+    memcpy(written.data(), payload, written.byteSize());
+    memcpy(mountEntries.data(), payload + written.byteSize(), mountEntries.byteSize());
+    std::unique_ptr<uint32_t[]> records(new (std::nothrow) uint32_t[itemCount + 1]);
+    if (!records) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(records.get(), payload + 2 * written.byteSize(), itemCount * sizeof(uint32_t));
+    // the checkpoint itself ends the span of the last item
+    records[itemCount] = begin;
+
+    // Entries are only erased after the page has been marked full, so every entry
+    // which is still written must have been written when the checkpoint was made.
+    // Items erased since then must have been erased completely, otherwise the page
+    // needs the cleanup done by a full scan.
+    size_t next = 0;
+    for (size_t r = 0; r <= itemCount; ++r) {
+        const size_t index = records[r] & 0xff;
+        if (index < next || index > begin || (r < itemCount && (index == begin || !written.get(index)))) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        // entries between two items are not part of any item
+        for (; next < index; ++next) {
+            if (written.get(next) || mEntryTable.get(next) == EntryState::WRITTEN) {
+                return ESP_ERR_NVS_NOT_FOUND;
+            }
+        }
+        if (r == itemCount) {
+            break;
+        }
+        const EntryState state = mEntryTable.get(index);
+        if (state == EntryState::EMPTY) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        const size_t spanEnd = records[r + 1] & 0xff;
+        for (next = index + 1; next < spanEnd && written.get(next); ++next) {
+            if (mEntryTable.get(next) != state) {
+                return ESP_ERR_NVS_NOT_FOUND;
+            }
+        }
+    }
+
+    for (size_t r = 0; r < itemCount; ++r) {
+        const uint32_t record = records[r];
+        const size_t index = record & 0xff;
+        if (mEntryTable.get(index) == EntryState::WRITTEN) {
+            insertHash(record >> 8, index);
+            mMountEntries.set(index, mountEntries.get(index));
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Page::writeCheckpoint()
+{
+    if (mNextFreeEntry == INVALID_ENTRY) {
+        return ESP_OK;
+    }
+    const size_t blockCount = getCheckpointEntryCount(mHashList.size());
+    if (mNextFreeEntry + blockCount > ENTRY_COUNT) {
+        // reserved entries have been used by batch writes or by copying items
+        return ESP_OK;
+    }
+
+    std::unique_ptr<uint8_t[]> buf(new (std::nothrow) uint8_t[blockCount * ENTRY_SIZE]);
+    if (!buf) {
+        // the page can still be loaded without a checkpoint
+        return ESP_OK;
+    }
+    uint8_t* payload = buf.get();
+    const size_t payloadSize = blockCount * CHECKPOINT_PAYLOAD_SIZE;
+    std::fill_n(payload, blockCount * ENTRY_SIZE, 0xff);
+
+    TEntryFlags written;
+    TEntryFlags mountEntries;
+    for (size_t i = 0; i < ENTRY_COUNT; ++i) {
+        const bool isWritten = mEntryTable.get(i) == EntryState::WRITTEN;
+        written.set(i, isWritten);
+        mountEntries.set(i, isWritten && mMountEntries.get(i));
+    }
+    memcpy(payload, written.data(), written.byteSize());
+    memcpy(payload + written.byteSize(), mountEntries.data(), mountEntries.byteSize());
+
+    std::unique_ptr<uint32_t[]> records(new (std::nothrow) uint32_t[ENTRY_COUNT]);
+    if (!records) {
+        return ESP_OK;
+    }
+    const size_t itemCount = mHashList.getEntries(records.get(), ENTRY_COUNT);
+    if (itemCount != mHashList.size()) {
+        return ESP_OK;
+    }
+    std::sort(records.get(), records.get() + itemCount, [](uint32_t a, uint32_t b) -> bool {
+        return (a & 0xff) < (b & 0xff);
+    });
+    for (size_t r = 0; r < itemCount; ++r) {
+        if (!written.get(records[r] & 0xff)) {
+            return ESP_OK;
+        }
+    }
+    memcpy(payload + 2 * written.byteSize(), records.get(), itemCount * sizeof(uint32_t));
+
+    const uint16_t count = static_cast<uint16_t>(itemCount);
+    memcpy(payload + payloadSize - 8, &count, sizeof(count));
+    const uint32_t crc32 = Item::calculateCrc32(payload, payloadSize - sizeof(crc32));
+    memcpy(payload + payloadSize - sizeof(crc32), &crc32, sizeof(crc32));
+
+    // spread the payload over blocks, starting from the last one so that nothing is overwritten
+    for (size_t b = blockCount; b-- > 0;) {
+        auto block = reinterpret_cast<CheckpointBlock*>(buf.get() + b * ENTRY_SIZE);
+        memmove(block->mPayload, payload + b * CHECKPOINT_PAYLOAD_SIZE, CHECKPOINT_PAYLOAD_SIZE);
+        block->mMark = CHECKPOINT_MARK;
+        block->mType = ItemType::ANY;
+        block->mBlockIndex = static_cast<uint8_t>(b);
+        block->mBlockCount = static_cast<uint8_t>(blockCount);
+    }
+
+    // Should power go out before the entries are marked, they are found half-written
+    // when the page is loaded as active, and erased.
+    auto rc = nvs_flash_write(getEntryAddress(mNextFreeEntry), buf.get(), blockCount * ENTRY_SIZE);
+    if (rc != ESP_OK) {
+        mState = PageState::INVALID;
+        return rc;
+    }
+    rc = alterEntryRangeState(mNextFreeEntry, mNextFreeEntry + blockCount, EntryState::ERASED);
+    if (rc != ESP_OK) {
+        mState = PageState::INVALID;
+        return rc;
+    }
+    mErasedEntryCount += blockCount;
+    mNextFreeEntry += blockCount;
+    return ESP_OK;
+}
+
 
 esp_err_t Page::initialize()
 {
@@ -820,6 +1249,49 @@ esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, si
     return ESP_ERR_NVS_NOT_FOUND;
 }
 
+esp_err_t Page::findMountItem(size_t &itemIndex, Item& item)
+{
+    if (mState == PageState::CORRUPT || mState == PageState::INVALID || mState == PageState::UNINITIALIZED) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    size_t end = mNextFreeEntry;
+    if (end > ENTRY_COUNT) {
+        end = ENTRY_COUNT;
+    }
+
+    // only the first entry of an item can be flagged, so spans don't need to be skipped
+    for (size_t i = std::max(itemIndex, mFirstUsedEntry); i < end; ++i) {
+        if (mEntryTable.get(i) != EntryState::WRITTEN || !mMountEntries.get(i)) {
+            continue;
+        }
+
+        auto rc = readEntry(i, item);
+        if (rc != ESP_OK) {
+            mState = PageState::INVALID;
+            return rc;
+        }
+
+        if (item.crc32 != item.calculateCrc32()) {
+            rc = eraseEntryAndSpan(i);
+            if (rc != ESP_OK) {
+                mState = PageState::INVALID;
+                return rc;
+            }
+            continue;
+        }
+
+        if (!isMountItem(item)) {
+            continue;
+        }
+
+        itemIndex = i;
+        return ESP_OK;
+    }
+
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
 esp_err_t Page::getSeqNumber(uint32_t& seqNumber) const
 {
     if (mState != PageState::UNINITIALIZED && mState != PageState::INVALID && mState != PageState::CORRUPT) {
@@ -861,7 +1333,12 @@ esp_err_t Page::erase()
     mFirstUsedEntry = INVALID_ENTRY;
     mNextFreeEntry = INVALID_ENTRY;
     mState = PageState::UNINITIALIZED;
+    mLoadedFromCheckpoint = false;
+    std::fill_n(mMountEntries.data(), mMountEntries.byteSize() / sizeof(uint32_t), 0);
     mHashList.clear();
+    if (mItemIndex) {
+        mItemIndex->erase(this);
+    }
     return ESP_OK;
 }
 
@@ -878,18 +1355,74 @@ esp_err_t Page::markFull()
     if (mState != PageState::ACTIVE) {
         return ESP_ERR_NVS_INVALID_STATE;
     }
+    if (mFastMount) {
+        auto err = writeCheckpoint();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
     return alterPageState(PageState::FULL);
 }
 
 size_t Page::getVarDataTailroom() const
 {
+    /* Keep room for the checkpoint, assuming that a blob index follows the data */
+    const size_t reserved = getReservedEntryCount(mHashList.size() + 2);
     if (mState == PageState::UNINITIALIZED) {
-        return CHUNK_MAX_SIZE;
+        return CHUNK_MAX_SIZE - reserved * ENTRY_SIZE;
     } else if (mState == PageState::FULL) {
         return 0;
     }
     /* Skip one entry for header*/
-    return ((mNextFreeEntry < (ENTRY_COUNT-1)) ? ((ENTRY_COUNT - mNextFreeEntry - 1) * ENTRY_SIZE): 0);
+    return ((mNextFreeEntry < (ENTRY_COUNT - 1 - reserved)) ? ((ENTRY_COUNT - mNextFreeEntry - 1 - reserved) * ENTRY_SIZE): 0);
+}
+
+size_t Page::getFreeEntryCount() const
+{
+    if (mState == PageState::UNINITIALIZED) {
+        return ENTRY_COUNT;
+    } else if (mState != PageState::ACTIVE || mNextFreeEntry >= ENTRY_COUNT) {
+        return 0;
+    }
+    return ENTRY_COUNT - mNextFreeEntry;
+}
+
+esp_err_t Page::markCompactionTarget()
+{
+    if (mState == PageState::UNINITIALIZED) {
+        auto err = initialize();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (mState != PageState::ACTIVE) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+    if (isCompactionTarget()) {
+        return ESP_OK;
+    }
+    return setFlag(COMPACT_FLAG_MASK);
+}
+
+bool Page::hasFlag(uint32_t mask) const
+{
+    if (mState != PageState::ACTIVE && mState != PageState::FULL && mState != PageState::FREEING) {
+        return false;
+    }
+    return (mEntryTable.data()[FLAG_WORD] & mask) == 0;
+}
+
+esp_err_t Page::setFlag(uint32_t mask)
+{
+    mEntryTable.data()[FLAG_WORD] &= ~mask;
+    uint32_t word = mEntryTable.data()[FLAG_WORD];
+    auto rc = spi_flash_write(mBaseAddress + ENTRY_TABLE_OFFSET + static_cast<uint32_t>(FLAG_WORD) * 4,
+            &word, sizeof(word));
+    if (rc != ESP_OK) {
+        mState = PageState::INVALID;
+        return rc;
+    }
+    return ESP_OK;
 }
 
 const char* Page::pageStateToName(PageState ps)
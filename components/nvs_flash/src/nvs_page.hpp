@@ -24,6 +24,7 @@
 #include "compressed_enum_table.hpp"
 #include "intrusive_list.h"
 #include "nvs_item_hash_list.hpp"
+#include "nvs_item_index.hpp"
 
 namespace nvs
 {
@@ -94,12 +95,27 @@ public:
 
     esp_err_t readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    esp_err_t readItemData(uint8_t nsIndex, ItemType datatype, const char* key, size_t offset, void* data, size_t size, uint8_t chunkIdx = CHUNK_ANY);
+
     esp_err_t eraseItem(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, size_t &itemIndex, Item& item, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    esp_err_t findItemData(uint8_t nsIndex, ItemType datatype, const char* key, uint32_t& dataAddress, Item& item, uint8_t chunkIdx = CHUNK_ANY);
+
+    /**
+     * Find the next namespace entry, blob index or blob data chunk, starting at itemIndex.
+     * These are the items Storage needs when it is initialized. Entries of other items
+     * are skipped without being read.
+     */
+    esp_err_t findMountItem(size_t &itemIndex, Item& item);
+
+    esp_err_t writeItems(uint8_t nsIndex, const nvs_batch_item_t* items, size_t count, size_t& writeCount);
+
+    esp_err_t eraseEntries(const size_t* indices, size_t count, size_t& writeCount);
+
     template<typename T>
     esp_err_t writeItem(uint8_t nsIndex, const char* key, const T& value)
     {
@@ -129,11 +145,25 @@ public:
     }
     size_t getVarDataTailroom() const ;
 
+    size_t getFreeEntryCount() const;
+
+    bool isBatchWritten() const
+    {
+        return hasFlag(BATCH_FLAG_MASK);
+    }
+
+    bool isCompactionTarget() const
+    {
+        return hasFlag(COMPACT_FLAG_MASK);
+    }
+
+    esp_err_t markCompactionTarget();
+
     esp_err_t markFull();
 
     esp_err_t markFreeing();
 
-    esp_err_t copyItems(Page& other);
+    esp_err_t copyItems(Page& other, Page* skipItemsIn = nullptr);
 
     esp_err_t erase();
 
@@ -141,6 +171,47 @@ public:
 
     esp_err_t calcEntries(nvs_stats_t &nvsStats);
 
+    void setItemIndex(ItemIndex* itemIndex)
+    {
+        mItemIndex = itemIndex;
+    }
+
+    /**
+     * With fast mount enabled, markFull appends a checkpoint to the page, listing the
+     * hashes and positions of all items on it. Loading a full page with a valid
+     * checkpoint doesn't need to read the items themselves. Entries needed for the
+     * checkpoint are kept free while the page is active. Must be set before load.
+     */
+    void setFastMount(bool enabled)
+    {
+        mFastMount = enabled;
+    }
+
+    bool isLoadedFromCheckpoint() const
+    {
+        return mLoadedFromCheckpoint;
+    }
+
+    /**
+     * Pinned pages hold data which is accessed directly through a flash mapping.
+     * PageManager doesn't select them to be freed, so their contents stay unchanged.
+     */
+    void pin()
+    {
+        ++mPinCount;
+    }
+
+    void unpin()
+    {
+        assert(mPinCount > 0);
+        --mPinCount;
+    }
+
+    bool isPinned() const
+    {
+        return mPinCount > 0;
+    }
+
 protected:
 
     class Header
@@ -169,6 +240,25 @@ protected:
 
     esp_err_t mLoadEntryTable();
 
+    esp_err_t mLoadCheckpoint();
+
+    esp_err_t writeCheckpoint();
+
+    static size_t getCheckpointEntryCount(size_t itemCount)
+    {
+        return (CHECKPOINT_FIXED_SIZE + itemCount * 4 + CHECKPOINT_PAYLOAD_SIZE - 1) / CHECKPOINT_PAYLOAD_SIZE;
+    }
+
+    size_t getReservedEntryCount(size_t itemCount) const
+    {
+        return mFastMount ? getCheckpointEntryCount(itemCount) : 0;
+    }
+
+    static bool isMountItem(const Item& item)
+    {
+        return item.nsIndex == NS_INDEX || item.datatype == ItemType::BLOB_IDX || item.datatype == ItemType::BLOB_DATA;
+    }
+
     esp_err_t initialize();
 
     esp_err_t alterEntryState(size_t index, EntryState state);
@@ -187,6 +277,14 @@ protected:
 
     void updateFirstUsedEntry(size_t index, size_t span);
 
+    void insertHash(const Item& item, size_t index);
+
+    void insertHash(uint32_t hash, size_t index);
+
+    bool hasFlag(uint32_t mask) const;
+
+    esp_err_t setFlag(uint32_t mask);
+
     static constexpr size_t getAlignmentForType(ItemType type)
     {
         return static_cast<uint8_t>(type) & 0x0f;
@@ -215,11 +313,49 @@ protected:
 
     HashList mHashList;
 
+    ItemIndex* mItemIndex = nullptr;
+
+    uint16_t mPinCount = 0;
+
+    typedef CompressedEnumTable<bool, 1, ENTRY_COUNT> TEntryFlags;
+    TEntryFlags mMountEntries;
+
+    bool mFastMount = false;
+    bool mLoadedFromCheckpoint = false;
+
     static const uint32_t HEADER_OFFSET = 0;
     static const uint32_t ENTRY_TABLE_OFFSET = HEADER_OFFSET + 32;
     static const uint32_t ENTRY_DATA_OFFSET = ENTRY_TABLE_OFFSET + 32;
 
+    /* Spare bits after the last entry state. Each one is cleared once the page takes part
+     * in an operation which needs additional recovery steps when the page is loaded. */
+    static const size_t FLAG_WORD = ENTRY_COUNT * 2 / 32;
+    static const uint32_t BATCH_FLAG_MASK = 1u << (ENTRY_COUNT * 2 % 32);
+    static const uint32_t COMPACT_FLAG_MASK = BATCH_FLAG_MASK << 1;
+
+    /* Checkpoint entries follow the last item of a full page. Each one starts with
+     * CHECKPOINT_MARK in place of the namespace index and ItemType::ANY, which no
+     * stored item has, so they are never taken for items. Together, their payloads
+     * hold the entry states and the mount item flags at the time the page was marked
+     * full, one (index | hash << 8) word per item, and a trailer with the item count
+     * and a CRC of the payload. */
+    class CheckpointBlock
+    {
+    public:
+        uint8_t mMark;
+        ItemType mType;
+        uint8_t mBlockIndex;
+        uint8_t mBlockCount;
+        uint8_t mPayload[28];
+    };
+
+    static const uint8_t CHECKPOINT_MARK = 0xc5;
+    static const size_t CHECKPOINT_PAYLOAD_SIZE = sizeof(CheckpointBlock::mPayload);
+    static const size_t CHECKPOINT_FIXED_SIZE = 2 * TEntryFlags::byteSize() + 8;
+
+    static_assert(sizeof(CheckpointBlock) == ENTRY_SIZE, "checkpoint block size must be one entry");
     static_assert(sizeof(Header) == 32, "header size must be 32 bytes");
+    static_assert(ENTRY_COUNT * 2 % 32 != 0 && ENTRY_COUNT * 2 % 32 <= 30, "entry state table should have spare bits for page flags");
     static_assert(ENTRY_TABLE_OFFSET % 32 == 0, "entry table offset should be aligned");
     static_assert(ENTRY_DATA_OFFSET % 32 == 0, "entry data offset should be aligned");
 
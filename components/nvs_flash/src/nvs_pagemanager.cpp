@@ -15,15 +15,20 @@
 
 namespace nvs
 {
-esp_err_t PageManager::load(uint32_t baseSector, uint32_t sectorCount)
+esp_err_t PageManager::load(uint32_t baseSector, uint32_t sectorCount, ItemIndex* index, bool fastMount)
 {
     mBaseSector = baseSector;
     mPageCount = sectorCount;
     mPageList.clear();
     mFreePageList.clear();
     mPages.reset(new Page[sectorCount]);
+    if (index) {
+        index->clear();
+    }
 
     for (uint32_t i = 0; i < sectorCount; ++i) {
+        mPages[i].setItemIndex(index);
+        mPages[i].setFastMount(fastMount);
         auto err = mPages[i].load(baseSector + i);
         if (err != ESP_OK) {
             return err;
@@ -56,6 +61,27 @@ esp_err_t PageManager::load(uint32_t baseSector, uint32_t sectorCount)
     // if power went out after a new item for the given key was written,
     // but before the old one was erased, we end up with a duplicate item
     Page& lastPage = back();
+
+    // a batch write may leave such duplicates for every item of the batch,
+    // so check all single entry items of the last page if it holds a batch
+    if (lastPage.isBatchWritten()) {
+        auto last = PageManager::TPageListIterator(&lastPage);
+        Item batchItem;
+        size_t batchItemIndex = 0;
+        while (lastPage.findItem(Page::NS_ANY, ItemType::ANY, nullptr, batchItemIndex, batchItem) == ESP_OK) {
+            batchItemIndex += batchItem.span;
+            if (isVariableLengthType(batchItem.datatype) || batchItem.datatype == ItemType::BLOB_IDX) {
+                continue;
+            }
+            for (auto it = begin(); it != last; ++it) {
+                if ((it->state() != Page::PageState::FREEING) &&
+                        (it->eraseItem(batchItem.nsIndex, batchItem.datatype, batchItem.key, batchItem.chunkIndex) == ESP_OK)) {
+                    break;
+                }
+            }
+        }
+    }
+
     size_t lastItemIndex = SIZE_MAX;
     Item item;
     size_t itemIndex = 0;
@@ -92,7 +118,18 @@ esp_err_t PageManager::load(uint32_t baseSector, uint32_t sectorCount)
     for (auto it = begin(); it!= end(); ++it) {
         if (it->state() == Page::PageState::FREEING) {
             Page* newPage = &mPageList.back();
-            if (newPage->state() == Page::PageState::ACTIVE) {
+            Page* compactedPage = nullptr;
+            if (newPage->isCompactionTarget()) {
+                // items were being moved into a page which holds other data as well,
+                // keep it and only copy what hasn't reached it yet
+                compactedPage = newPage;
+                if (newPage->state() == Page::PageState::ACTIVE) {
+                    auto err = newPage->markFull();
+                    if (err != ESP_OK) {
+                        return err;
+                    }
+                }
+            } else if (newPage->state() == Page::PageState::ACTIVE) {
                 auto err = newPage->erase();
                 if (err != ESP_OK) {
                     return err;
@@ -106,7 +143,7 @@ esp_err_t PageManager::load(uint32_t baseSector, uint32_t sectorCount)
             }
             newPage = &mPageList.back();
 
-            err = it->copyItems(*newPage);
+            err = it->copyItems(*newPage, compactedPage);
             if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
                 return err;
             }
@@ -146,6 +183,9 @@ esp_err_t PageManager::requestNewPage()
     TPageListIterator maxUnusedItemsPageIt;
     size_t maxUnusedItems = 0;
     for (auto it = begin(); it != end(); ++it) {
+        if (it->isPinned()) {
+            continue;
+        }
 
         auto unused =  Page::ENTRY_COUNT - it->getUsedEntryCount();
         if (unused > maxUnusedItems) {
@@ -194,6 +234,80 @@ esp_err_t PageManager::requestNewPage()
     return ESP_OK;
 }
 
+esp_err_t PageManager::gcStep()
+{
+    Page& activePage = back();
+    if (activePage.state() != Page::PageState::ACTIVE && activePage.state() != Page::PageState::UNINITIALIZED) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+    if (mFreePageList.size() >= GC_RESERVED_FREE_PAGES) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    // find the full page with the highest number of unused entries,
+    // and the one of those which would fit into the active page
+    TPageListIterator fittingPageIt;
+    size_t fittingUnused = 0;
+    size_t maxUnused = 0;
+    auto last = TPageListIterator(&activePage);
+    for (auto it = begin(); it != last; ++it) {
+        if (it->state() != Page::PageState::FULL || it->isPinned()) {
+            continue;
+        }
+        size_t unused = Page::ENTRY_COUNT - it->getUsedEntryCount();
+        if (unused > maxUnused) {
+            maxUnused = unused;
+        }
+        if (unused > fittingUnused && it->getUsedEntryCount() <= activePage.getFreeEntryCount()) {
+            fittingPageIt = it;
+            fittingUnused = unused;
+        }
+    }
+
+    if (fittingUnused > 0) {
+        // move items of the page to the end of the active page, and erase it
+        Page* erasedPage = fittingPageIt;
+        auto err = activePage.markCompactionTarget();
+        if (err != ESP_OK) {
+            return err;
+        }
+#ifndef NDEBUG
+        size_t usedEntries = erasedPage->getUsedEntryCount() + activePage.getUsedEntryCount();
+#endif
+        err = erasedPage->markFreeing();
+        if (err != ESP_OK) {
+            return err;
+        }
+        err = erasedPage->copyItems(activePage);
+        if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+            return err;
+        }
+        err = erasedPage->erase();
+        if (err != ESP_OK) {
+            return err;
+        }
+#ifndef NDEBUG
+        assert(usedEntries == activePage.getUsedEntryCount());
+#endif
+        mPageList.erase(fittingPageIt);
+        mFreePageList.push_back(erasedPage);
+        return ESP_OK;
+    }
+
+    if (maxUnused >= GC_MIN_UNUSED_ENTRIES && activePage.state() == Page::PageState::ACTIVE) {
+        // active page has no room for items of any full page. Start a new one now,
+        // so that the next steps have somewhere to move items to. Requiring enough
+        // unused entries in the reclaimed page makes sure this can't repeat forever.
+        auto err = activePage.markFull();
+        if (err != ESP_OK) {
+            return err;
+        }
+        return requestNewPage();
+    }
+
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
 esp_err_t PageManager::activatePage()
 {
     if (mFreePageList.empty()) {
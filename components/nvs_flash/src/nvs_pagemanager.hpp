@@ -31,7 +31,7 @@ public:
 
     PageManager() {}
 
-    esp_err_t load(uint32_t baseSector, uint32_t sectorCount);
+    esp_err_t load(uint32_t baseSector, uint32_t sectorCount, ItemIndex* index = nullptr, bool fastMount = false);
 
     TPageListIterator begin()
     {
@@ -54,6 +54,14 @@ public:
 
     esp_err_t requestNewPage();
 
+    /**
+     * Do one step of garbage collection ahead of time. While fewer than
+     * GC_RESERVED_FREE_PAGES pages are free, move items of the full page with most
+     * unused entries into the active page, and erase it.
+     * Returns ESP_ERR_NVS_NOT_FOUND if there was nothing to do.
+     */
+    esp_err_t gcStep();
+
     esp_err_t fillStats(nvs_stats_t& nvsStats);
 
     uint32_t getBaseSector()
@@ -61,6 +69,12 @@ public:
         return mBaseSector;
     }
 
+    /* Free pages kept by gcStep, so that requestNewPage doesn't need to erase a page */
+    static const size_t GC_RESERVED_FREE_PAGES = 2;
+
+    /* Unused entries needed in a page before gcStep starts a new active page to reclaim it */
+    static const size_t GC_MIN_UNUSED_ENTRIES = Page::ENTRY_COUNT / 2;
+
 protected:
     friend class Iterator;
 
@@ -0,0 +1,125 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nvs_read_cache.hpp"
+#include <cstring>
+
+namespace nvs
+{
+
+ReadCache::ReadCache(size_t entryCount, size_t valueSize) :
+    mEntries(new CacheEntry[entryCount]),
+    mValues(new uint8_t[entryCount * valueSize]),
+    mValueSize(valueSize)
+{
+    for (size_t i = 0; i < entryCount; ++i) {
+        mEntries[i].data = mValues.get() + i * valueSize;
+        mFree.push_back(&mEntries[i]);
+    }
+}
+
+ReadCache::~ReadCache()
+{
+    // entries belong to mEntries, lists must not free them
+    mUsed.clear();
+    mFree.clear();
+}
+
+const ReadCache::CacheEntry* ReadCache::find(uint8_t nsIndex, ItemType datatype, const char* key)
+{
+    for (auto it = mUsed.begin(); it != mUsed.end(); ++it) {
+        if (it->nsIndex == nsIndex && it->datatype == datatype && strncmp(it->key, key, Item::MAX_KEY_LENGTH) == 0) {
+            CacheEntry* entry = it;
+            if (mUsed.begin() != it) {
+                mUsed.erase(it);
+                mUsed.push_front(entry);
+            }
+            ++mHits;
+            return entry;
+        }
+    }
+    ++mMisses;
+    return nullptr;
+}
+
+const ReadCache::CacheEntry* ReadCache::peek(uint8_t nsIndex, ItemType datatype, const char* key)
+{
+    for (auto it = mUsed.begin(); it != mUsed.end(); ++it) {
+        if (it->nsIndex == nsIndex && it->datatype == datatype && strncmp(it->key, key, Item::MAX_KEY_LENGTH) == 0) {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+void ReadCache::insert(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    if (dataSize > mValueSize) {
+        return;
+    }
+
+    CacheEntry* entry;
+    if (!mFree.empty()) {
+        entry = &mFree.front();
+        mFree.pop_front();
+    } else if (!mUsed.empty()) {
+        entry = &mUsed.back();
+        mUsed.pop_back();
+    } else {
+        return;
+    }
+
+    entry->nsIndex = nsIndex;
+    entry->datatype = datatype;
+    entry->dataSize = static_cast<uint16_t>(dataSize);
+    strncpy(entry->key, key, sizeof(entry->key) - 1);
+    entry->key[sizeof(entry->key) - 1] = 0;
+    memcpy(entry->data, data, dataSize);
+    mUsed.push_front(entry);
+}
+
+void ReadCache::invalidate(uint8_t nsIndex, const char* key)
+{
+    for (auto it = mUsed.begin(); it != mUsed.end(); ) {
+        auto tmp = it++;
+        if (tmp->nsIndex == nsIndex && strncmp(tmp->key, key, Item::MAX_KEY_LENGTH) == 0) {
+            CacheEntry* entry = tmp;
+            mUsed.erase(tmp);
+            mFree.push_back(entry);
+        }
+    }
+}
+
+void ReadCache::invalidate(uint8_t nsIndex)
+{
+    for (auto it = mUsed.begin(); it != mUsed.end(); ) {
+        auto tmp = it++;
+        if (tmp->nsIndex == nsIndex) {
+            CacheEntry* entry = tmp;
+            mUsed.erase(tmp);
+            mFree.push_back(entry);
+        }
+    }
+}
+
+void ReadCache::clear()
+{
+    while (!mUsed.empty()) {
+        CacheEntry* entry = &mUsed.front();
+        mUsed.pop_front();
+        mFree.push_back(entry);
+    }
+}
+
+} // namespace nvs
@@ -0,0 +1,108 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef nvs_read_cache_hpp
+#define nvs_read_cache_hpp
+
+#include <memory>
+#include "nvs.h"
+#include "nvs_types.hpp"
+#include "intrusive_list.h"
+
+namespace nvs
+{
+
+/**
+ * Cache of recently read values, looked up by namespace, type and key.
+ *
+ * Entries and value buffers are allocated once, when the cache is created.
+ * Entries are kept in least recently used order: a lookup moves the entry to
+ * the front of the list, and when all entries are in use, inserting a value
+ * replaces the one at the back. Values larger than the value size given to
+ * the constructor are not cached.
+ *
+ * The cache knows nothing about flash contents. Storage has to invalidate the
+ * values of a key before changing it.
+ */
+class ReadCache
+{
+public:
+    struct CacheEntry : public intrusive_list_node<CacheEntry> {
+    public:
+        uint8_t nsIndex;
+        ItemType datatype;
+        uint16_t dataSize;
+        char key[Item::MAX_KEY_LENGTH + 1];
+        uint8_t* data;
+    };
+
+    ReadCache(size_t entryCount, size_t valueSize);
+    ~ReadCache();
+
+    /**
+     * Find the cached value of an item and mark it as most recently used.
+     * Updates the hit and miss counters. Returns nullptr if the value isn't cached.
+     */
+    const CacheEntry* find(uint8_t nsIndex, ItemType datatype, const char* key);
+
+    /**
+     * Find the cached value of an item without touching the counters or the LRU order.
+     */
+    const CacheEntry* peek(uint8_t nsIndex, ItemType datatype, const char* key);
+
+    void insert(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
+
+    /** Drop the values of the given key, of all types */
+    void invalidate(uint8_t nsIndex, const char* key);
+
+    /** Drop all values in the given namespace */
+    void invalidate(uint8_t nsIndex);
+
+    void clear();
+
+    size_t hits() const
+    {
+        return mHits;
+    }
+
+    size_t misses() const
+    {
+        return mMisses;
+    }
+
+    size_t valueSize() const
+    {
+        return mValueSize;
+    }
+
+private:
+    ReadCache(const ReadCache& other);
+    const ReadCache& operator= (const ReadCache& rhs);
+
+protected:
+    typedef intrusive_list<CacheEntry> TEntryList;
+
+    std::unique_ptr<CacheEntry[]> mEntries;
+    std::unique_ptr<uint8_t[]> mValues;
+    size_t mValueSize;
+    TEntryList mUsed;
+    TEntryList mFree;
+    size_t mHits = 0;
+    size_t mMisses = 0;
+}; // class ReadCache
+
+} // namespace nvs
+
+
+#endif /* nvs_read_cache_hpp */
@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include "nvs_storage.hpp"
+#include "nvs_ops.hpp"
+#include <new>
 
 #ifndef ESP_PLATFORM
 #include <map>
@@ -21,8 +23,67 @@
 namespace nvs
 {
 
+BlobMap::BlobMap(size_t chunkCount) :
+    mSegments(new nvs_blob_segment_t[chunkCount]),
+    mPages(new Page*[chunkCount]),
+    mRegions(new uint32_t[chunkCount]),
+    mRegionPtrs(new const uint8_t*[chunkCount]),
+    mRegionHandles(new spi_flash_mmap_handle_t[chunkCount])
+{
+}
+
+BlobMap::~BlobMap()
+{
+    for (size_t i = 0; i < mRegionCount; ++i) {
+        spi_flash_munmap(mRegionHandles[i]);
+    }
+    for (size_t i = 0; i < mSegmentCount; ++i) {
+        if (mPages[i]) {
+            mPages[i]->unpin();
+        }
+    }
+}
+
+void BlobMap::addSegment(const void* data, size_t size, Page* page)
+{
+    mSegments[mSegmentCount].data = data;
+    mSegments[mSegmentCount].size = size;
+    mPages[mSegmentCount] = page;
+    if (page) {
+        page->pin();
+    }
+    ++mSegmentCount;
+}
+
+esp_err_t BlobMap::mapRegion(uint32_t address, const uint8_t*& ptr)
+{
+    // chunks never cross a sector boundary, so they never cross an MMU page either
+    const uint32_t region = address & ~(SPI_FLASH_MMU_PAGE_SIZE - 1);
+    size_t i;
+    for (i = 0; i < mRegionCount; ++i) {
+        if (mRegions[i] == region) {
+            break;
+        }
+    }
+    if (i == mRegionCount) {
+        const void* regionPtr;
+        auto err = spi_flash_mmap(region, SPI_FLASH_MMU_PAGE_SIZE, SPI_FLASH_MMAP_DATA, &regionPtr, &mRegionHandles[i]);
+        if (err != ESP_OK) {
+            return err;
+        }
+        mRegions[i] = region;
+        mRegionPtrs[i] = static_cast<const uint8_t*>(regionPtr);
+        ++mRegionCount;
+    }
+    ptr = mRegionPtrs[i] + (address - region);
+    return ESP_OK;
+}
+
 Storage::~Storage()
 {
+    mBlobMaps.clearAndFreeNodes();
+    mBlobWriters.clearAndFreeNodes();
+    mBlobReaders.clearAndFreeNodes();
     clearNamespaces();
 }
 
@@ -31,7 +92,7 @@ void Storage::clearNamespaces()
     mNamespaces.clearAndFreeNodes();
 }
 
-void Storage::populateBlobIndices(TBlobIndexList& blobIdxList)
+void Storage::loadNamespacesAndBlobIndices(TBlobIndexList& blobIdxList)
 {
     for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
         Page& p = *it;
@@ -42,15 +103,23 @@ void Storage::populateBlobIndices(TBlobIndexList& blobIdxList)
          * logic in pagemanager will remove the earlier index. So we should never find a
          * duplicate index at this point */
 
-        while (p.findItem(Page::NS_ANY, ItemType::BLOB_IDX, nullptr, itemIndex, item) == ESP_OK) {
-            BlobIndexNode* entry = new BlobIndexNode;
-
-            item.getKey(entry->key, sizeof(entry->key) - 1);
-            entry->nsIndex = item.nsIndex;
-            entry->chunkStart = item.blobIndex.chunkStart;
-            entry->chunkCount = item.blobIndex.chunkCount;
-
-            blobIdxList.push_back(entry);
+        while (p.findMountItem(itemIndex, item) == ESP_OK) {
+            if (item.nsIndex == Page::NS_INDEX && item.datatype == ItemType::U8) {
+                NamespaceEntry* entry = new NamespaceEntry;
+                item.getKey(entry->mName, sizeof(entry->mName) - 1);
+                item.getValue(entry->mIndex);
+                mNamespaces.push_back(entry);
+                mNamespaceUsage.set(entry->mIndex, true);
+            } else if (item.datatype == ItemType::BLOB_IDX && item.chunkIndex == Page::CHUNK_ANY) {
+                BlobIndexNode* entry = new BlobIndexNode;
+
+                item.getKey(entry->key, sizeof(entry->key) - 1);
+                entry->nsIndex = item.nsIndex;
+                entry->chunkStart = item.blobIndex.chunkStart;
+                entry->chunkCount = item.blobIndex.chunkCount;
+
+                blobIdxList.push_back(entry);
+            }
             itemIndex += item.span;
         }
     }
@@ -67,7 +136,11 @@ void Storage::eraseOrphanDataBlobs(TBlobIndexList& blobIdxList)
          * 1) VER_0_OFFSET <= chunkIndex < VER_1_OFFSET-1 => Version0 chunks
          * 2) VER_1_OFFSET <= chunkIndex < VER_ANY => Version1 chunks
          */
-        while (p.findItem(Page::NS_ANY, ItemType::BLOB_DATA, nullptr, itemIndex, item) == ESP_OK) {
+        while (p.findMountItem(itemIndex, item) == ESP_OK) {
+            if (item.datatype != ItemType::BLOB_DATA) {
+                itemIndex += item.span;
+                continue;
+            }
 
             auto iter = std::find_if(blobIdxList.begin(),
                     blobIdxList.end(),
@@ -86,36 +159,39 @@ void Storage::eraseOrphanDataBlobs(TBlobIndexList& blobIdxList)
 
 esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
 {
-    auto err = mPageManager.load(baseSector, sectorCount);
+    // pages are about to be reloaded, so mappings can't keep them pinned
+    mBlobMaps.clearAndFreeNodes();
+    // chunks written by open writers are orphans now, and get erased during load
+    mBlobWriters.clearAndFreeNodes();
+    mBlobReaders.clearAndFreeNodes();
+
+    if (mItemIndexEnabled && !mItemIndex) {
+        mItemIndex.reset(new ItemIndex);
+    } else if (!mItemIndexEnabled) {
+        mItemIndex.reset();
+    }
+
+    // values are read from flash again after init, and counters start over
+    mReadCache.reset();
+    if (mReadCacheEntries > 0) {
+        mReadCache.reset(new ReadCache(mReadCacheEntries, mReadCacheValueSize));
+    }
+
+    auto err = mPageManager.load(baseSector, sectorCount, mItemIndex.get(), mFastMountEnabled);
     if (err != ESP_OK) {
         mState = StorageState::INVALID;
         return err;
     }
 
-    // load namespaces list
+    // Load namespaces list, and populate list of multi-page index entries.
     clearNamespaces();
     std::fill_n(mNamespaceUsage.data(), mNamespaceUsage.byteSize() / 4, 0);
-    for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
-        Page& p = *it;
-        size_t itemIndex = 0;
-        Item item;
-        while (p.findItem(Page::NS_INDEX, ItemType::U8, nullptr, itemIndex, item) == ESP_OK) {
-            NamespaceEntry* entry = new NamespaceEntry;
-            item.getKey(entry->mName, sizeof(entry->mName) - 1);
-            item.getValue(entry->mIndex);
-            mNamespaces.push_back(entry);
-            mNamespaceUsage.set(entry->mIndex, true);
-            itemIndex += item.span;
-        }
-    }
+    TBlobIndexList blobIdxList;
+    loadNamespacesAndBlobIndices(blobIdxList);
     mNamespaceUsage.set(0, true);
     mNamespaceUsage.set(255, true);
     mState = StorageState::ACTIVE;
 
-    // Populate list of multi-page index entries.
-    TBlobIndexList blobIdxList;
-    populateBlobIndices(blobIdxList);
-
     // Remove the entries for which there is no parent multi-page index.
     eraseOrphanDataBlobs(blobIdxList);
 
@@ -133,8 +209,55 @@ bool Storage::isValid() const
     return mState == StorageState::ACTIVE;
 }
 
+esp_err_t Storage::findIndexedItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
+{
+    Page* pages[INDEX_MAX_CANDIDATES];
+    size_t indices[INDEX_MAX_CANDIDATES];
+    uint32_t seqNumbers[INDEX_MAX_CANDIDATES];
+
+    const uint32_t hash = ItemIndex::hash(Item(nsIndex, datatype, 0, key, chunkIdx));
+    size_t count = mItemIndex->find(hash, pages, indices, INDEX_MAX_CANDIDATES);
+    if (count == SIZE_MAX) {
+        /* Too many pages share this hash, let the caller check all pages */
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /* Check candidate pages in the same order as they appear in the page list */
+    for (size_t i = 0; i < count; ++i) {
+        if (pages[i]->getSeqNumber(seqNumbers[i]) != ESP_OK) {
+            seqNumbers[i] = UINT32_MAX;
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        size_t first = i;
+        for (size_t j = i + 1; j < count; ++j) {
+            if (seqNumbers[j] < seqNumbers[first]) {
+                first = j;
+            }
+        }
+        std::swap(pages[i], pages[first]);
+        std::swap(indices[i], indices[first]);
+        std::swap(seqNumbers[i], seqNumbers[first]);
+
+        size_t itemIndex = indices[i];
+        auto err = pages[i]->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
+        if (err == ESP_OK) {
+            page = pages[i];
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
 esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
+    if (mItemIndex && nsIndex != Page::NS_ANY && datatype != ItemType::ANY && key != nullptr) {
+        auto err = findIndexedItem(nsIndex, datatype, key, page, item, chunkIdx, chunkStart);
+        if (err != ESP_ERR_NOT_SUPPORTED) {
+            return err;
+        }
+    }
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         size_t itemIndex = 0;
         auto err = it->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
@@ -146,22 +269,26 @@ esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key,
     return ESP_ERR_NVS_NOT_FOUND;
 }
 
-esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const void* data, size_t dataSize, VerOffset chunkStart)
+size_t Storage::getMaxBlobSize()
 {
-    uint8_t chunkCount = 0;
-    TUsedPageList usedPages;
-    size_t remainingSize = dataSize;
-    size_t offset=0;
-    esp_err_t err = ESP_OK;
-
     /* Check how much maximum data can be accommodated**/
     uint32_t max_pages = mPageManager.getPageCount() - 1;
 
     if(max_pages > (Page::CHUNK_ANY-1)/2) {
        max_pages = (Page::CHUNK_ANY-1)/2;
     }
+    return max_pages * Page::CHUNK_MAX_SIZE;
+}
+
+esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const void* data, size_t dataSize, VerOffset chunkStart)
+{
+    uint8_t chunkCount = 0;
+    TUsedPageList usedPages;
+    size_t remainingSize = dataSize;
+    size_t offset=0;
+    esp_err_t err = ESP_OK;
 
-    if (dataSize > max_pages * Page::CHUNK_MAX_SIZE) {
+    if (dataSize > getMaxBlobSize()) {
         return ESP_ERR_NVS_VALUE_TOO_LONG;
     }
 
@@ -251,6 +378,14 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    if (datatype == ItemType::BLOB && findBlobWriter(nsIndex, key)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (mReadCache) {
+        mReadCache->invalidate(nsIndex, key);
+    }
+
     Page* findPage = nullptr;
     Item item;
 
@@ -357,6 +492,145 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
     return ESP_OK;
 }
 
+static bool isBatchItemType(nvs_type_t type)
+{
+    switch (type) {
+    case NVS_TYPE_U8:
+    case NVS_TYPE_I8:
+    case NVS_TYPE_U16:
+    case NVS_TYPE_I16:
+    case NVS_TYPE_U32:
+    case NVS_TYPE_I32:
+    case NVS_TYPE_U64:
+    case NVS_TYPE_I64:
+        return true;
+    default:
+        return false;
+    }
+}
+
+esp_err_t Storage::writeItems(uint8_t nsIndex, const nvs_batch_item_t* items, size_t count, size_t& savedOps)
+{
+    savedOps = 0;
+
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    if (count == 0) {
+        return ESP_OK;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (items[i].key == nullptr || items[i].value == nullptr || !isBatchItemType(items[i].type)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (strlen(items[i].key) > Item::MAX_KEY_LENGTH) {
+            return ESP_ERR_NVS_KEY_TOO_LONG;
+        }
+        for (size_t j = 0; j < i; ++j) {
+            if (strcmp(items[i].key, items[j].key) == 0) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+
+    // all items go to one page, so that they can be committed at once
+    if (count > Page::ENTRY_COUNT) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+
+    if (mReadCache) {
+        for (size_t i = 0; i < count; ++i) {
+            mReadCache->invalidate(nsIndex, items[i].key);
+        }
+    }
+
+    esp_err_t err;
+    if (getCurrentPage().getFreeEntryCount() < count) {
+        Page& page = getCurrentPage();
+        if (page.state() == Page::PageState::ACTIVE) {
+            err = page.markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = mPageManager.requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (getCurrentPage().getFreeEntryCount() < count) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+    }
+
+    // Look for old values only now, as requesting a new page may have moved them
+    struct OldEntry {
+        Page* page;
+        size_t index;
+    };
+    std::unique_ptr<OldEntry[]> oldEntries(new OldEntry[count]);
+    size_t oldCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const ItemType datatype = static_cast<ItemType>(items[i].type);
+        Page* findPage = nullptr;
+        Item item;
+        err = findItem(nsIndex, datatype, items[i].key, findPage, item);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            continue;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+        size_t index = 0;
+        ESP_ERROR_CHECK(findPage->findItem(nsIndex, datatype, items[i].key, index, item));
+        oldEntries[oldCount].page = findPage;
+        oldEntries[oldCount].index = index;
+        ++oldCount;
+    }
+
+    size_t writeCount;
+    err = getCurrentPage().writeItems(nsIndex, items, count, writeCount);
+    if (err == ESP_ERR_NVS_PAGE_FULL) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // Erase old values page by page, so that every page updates its entry state table once
+    std::sort(oldEntries.get(), oldEntries.get() + oldCount, [](const OldEntry& a, const OldEntry& b) -> bool {
+        return a.page < b.page || (a.page == b.page && a.index < b.index);
+    });
+    std::unique_ptr<size_t[]> indices(new size_t[oldCount + 1]);
+    for (size_t first = 0; first < oldCount; ) {
+        size_t last = first;
+        while (last < oldCount && oldEntries[last].page == oldEntries[first].page) {
+            indices[last - first] = oldEntries[last].index;
+            ++last;
+        }
+        size_t eraseCount;
+        err = oldEntries[first].page->eraseEntries(indices.get(), last - first, eraseCount);
+        if (err == ESP_ERR_FLASH_OP_FAIL) {
+            return ESP_ERR_NVS_REMOVE_FAILED;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+        writeCount += eraseCount;
+        first = last;
+    }
+
+    // Writing the items one by one takes two writes per item and one per old value
+    const size_t singleWriteCount = count * 2 + oldCount;
+    savedOps = (singleWriteCount > writeCount) ? singleWriteCount - writeCount : 0;
+
+#ifndef ESP_PLATFORM
+    debugCheck();
+#endif
+    return ESP_OK;
+}
+
 esp_err_t Storage::createOrOpenNamespace(const char* nsName, bool canCreate, uint8_t& nsIndex)
 {
     if (mState != StorageState::ACTIVE) {
@@ -443,16 +717,462 @@ esp_err_t Storage::readMultiPageBlob(uint8_t nsIndex, const char* key, void* dat
     return err;
 }
 
+esp_err_t Storage::mapBlob(uint8_t nsIndex, const char* key, BlobMap*& blobMap)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    Item item;
+    Page* findPage = nullptr;
+    uint8_t chunkCount = 1;
+    uint8_t chunkStart = Page::CHUNK_ANY;
+    ItemType chunkType = ItemType::BLOB_DATA;
+    size_t dataSize;
+
+    auto err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    if (err == ESP_OK) {
+        chunkCount = item.blobIndex.chunkCount;
+        chunkStart = static_cast<uint8_t>(item.blobIndex.chunkStart);
+        dataSize = item.blobIndex.dataSize;
+    } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+        // blob stored with earlier version format without index
+        chunkType = ItemType::BLOB;
+        err = findItem(nsIndex, ItemType::BLOB, key, findPage, item);
+        if (err != ESP_OK) {
+            return err;
+        }
+        dataSize = item.varLength.dataSize;
+    } else {
+        return err;
+    }
+
+    std::unique_ptr<BlobMap> map(new BlobMap(chunkCount));
+    for (uint8_t chunkNum = 0; chunkNum < chunkCount; chunkNum++) {
+        const uint8_t chunkIdx = (chunkType == ItemType::BLOB) ? Page::CHUNK_ANY : chunkStart + chunkNum;
+        err = findItem(nsIndex, chunkType, key, findPage, item, chunkIdx);
+        if (err != ESP_OK) {
+            return err;
+        }
+        uint32_t address;
+        err = findPage->findItemData(nsIndex, chunkType, key, address, item, chunkIdx);
+        if (err != ESP_OK) {
+            return err;
+        }
+        const size_t size = item.varLength.dataSize;
+        if (size == 0) {
+            continue;
+        }
+        if (!nvs_flash_can_mmap(address)) {
+            return copyBlob(nsIndex, key, dataSize, blobMap);
+        }
+        const uint8_t* ptr;
+        err = map->mapRegion(address, ptr);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (Item::calculateCrc32(ptr, size) != item.varLength.dataCrc32) {
+            // let the usual read path deal with corrupted data
+            return copyBlob(nsIndex, key, dataSize, blobMap);
+        }
+        map->addSegment(ptr, size, findPage);
+    }
+
+    blobMap = map.release();
+    mBlobMaps.push_back(blobMap);
+    return ESP_OK;
+}
+
+esp_err_t Storage::copyBlob(uint8_t nsIndex, const char* key, size_t dataSize, BlobMap*& blobMap)
+{
+    std::unique_ptr<BlobMap> map(new BlobMap(1));
+    map->mBuffer.reset(new (std::nothrow) uint8_t[dataSize]);
+    if (!map->mBuffer) {
+        return ESP_ERR_NO_MEM;
+    }
+    auto err = readItem(nsIndex, ItemType::BLOB, key, map->mBuffer.get(), dataSize);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (dataSize > 0) {
+        map->addSegment(map->mBuffer.get(), dataSize, nullptr);
+    }
+
+    blobMap = map.release();
+    mBlobMaps.push_back(blobMap);
+    return ESP_OK;
+}
+
+esp_err_t Storage::unmapBlob(BlobMap* blobMap)
+{
+    for (auto it = mBlobMaps.begin(); it != mBlobMaps.end(); ++it) {
+        if (static_cast<BlobMap*>(it) == blobMap) {
+            mBlobMaps.erase(it);
+            delete blobMap;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+BlobWriter* Storage::findBlobWriter(uint8_t nsIndex, const char* key)
+{
+    for (auto it = mBlobWriters.begin(); it != mBlobWriters.end(); ++it) {
+        if (it->mNsIndex == nsIndex && strncmp(it->mKey, key, Item::MAX_KEY_LENGTH) == 0) {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+esp_err_t Storage::openBlobWriter(uint8_t nsIndex, const char* key, size_t bufferSize, BlobWriter*& writer)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    if (bufferSize == 0 || bufferSize > Page::CHUNK_MAX_SIZE) {
+        bufferSize = Page::CHUNK_MAX_SIZE;
+    }
+    if (findBlobWriter(nsIndex, key)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    Item item;
+    Page* findPage = nullptr;
+    auto err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        return err;
+    }
+
+    std::unique_ptr<BlobWriter> newWriter(new BlobWriter(bufferSize));
+    if (!newWriter->mBuffer) {
+        return ESP_ERR_NO_MEM;
+    }
+    strncpy(newWriter->mKey, key, sizeof(newWriter->mKey) - 1);
+    newWriter->mKey[sizeof(newWriter->mKey) - 1] = 0;
+    newWriter->mNsIndex = nsIndex;
+    newWriter->mHasPrevIndex = (err == ESP_OK);
+    if (newWriter->mHasPrevIndex) {
+        /* The new version goes next to the current one, like in writeItem */
+        newWriter->mPrevStart = item.blobIndex.chunkStart;
+        newWriter->mChunkStart = (newWriter->mPrevStart == VerOffset::VER_1_OFFSET) ? VerOffset::VER_0_OFFSET : VerOffset::VER_1_OFFSET;
+    } else {
+        newWriter->mPrevStart = VerOffset::VER_0_OFFSET;
+        newWriter->mChunkStart = VerOffset::VER_0_OFFSET;
+    }
+
+    writer = newWriter.release();
+    mBlobWriters.push_back(writer);
+    return ESP_OK;
+}
+
+esp_err_t Storage::writeBlobChunks(BlobWriter* writer, const uint8_t* data, size_t dataSize)
+{
+    while (dataSize > 0) {
+        Page& page = getCurrentPage();
+        size_t tailroom = page.getVarDataTailroom();
+        if (tailroom < std::min(dataSize, Page::CHUNK_MAX_SIZE / 10)) {
+            /* Don't waste a chunk on the few entries left in this page */
+            if (page.state() != Page::PageState::FULL) {
+                auto err = page.markFull();
+                if (err != ESP_OK) {
+                    return err;
+                }
+            }
+            auto err = mPageManager.requestNewPage();
+            if (err != ESP_OK) {
+                return err;
+            }
+            if (getCurrentPage().getVarDataTailroom() == tailroom) {
+                return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+            }
+            continue;
+        }
+
+        /* Chunk indices of one version must stay below the start of the other one */
+        if (writer->mChunkCount == Page::CHUNK_ANY / 2) {
+            return ESP_ERR_NVS_VALUE_TOO_LONG;
+        }
+        size_t chunkSize = std::min(dataSize, tailroom);
+        auto err = page.writeItem(writer->mNsIndex, ItemType::BLOB_DATA, writer->mKey, data, chunkSize,
+                                  static_cast<uint8_t>(writer->mChunkStart) + writer->mChunkCount);
+        if (err != ESP_OK) {
+            return err;
+        }
+        writer->mChunkCount++;
+        data += chunkSize;
+        dataSize -= chunkSize;
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::appendBlob(BlobWriter* writer, const void* data, size_t dataSize)
+{
+    if (writer->mErr != ESP_OK) {
+        return writer->mErr;
+    }
+    if (writer->mDataSize + dataSize > getMaxBlobSize()) {
+        writer->mErr = ESP_ERR_NVS_VALUE_TOO_LONG;
+        return writer->mErr;
+    }
+
+    auto src = static_cast<const uint8_t*>(data);
+    while (dataSize > 0) {
+        if (writer->mBufferUsed == 0 && dataSize >= writer->mBufferSize) {
+            /* Whole buffers can be written without copying them first */
+            size_t size = dataSize - dataSize % writer->mBufferSize;
+            writer->mErr = writeBlobChunks(writer, src, size);
+            src += size;
+            dataSize -= size;
+            writer->mDataSize += size;
+        } else {
+            size_t size = std::min(dataSize, writer->mBufferSize - writer->mBufferUsed);
+            memcpy(writer->mBuffer.get() + writer->mBufferUsed, src, size);
+            writer->mBufferUsed += size;
+            src += size;
+            dataSize -= size;
+            writer->mDataSize += size;
+            if (writer->mBufferUsed == writer->mBufferSize) {
+                writer->mErr = writeBlobChunks(writer, writer->mBuffer.get(), writer->mBufferUsed);
+                writer->mBufferUsed = 0;
+            }
+        }
+        if (writer->mErr != ESP_OK) {
+            return writer->mErr;
+        }
+    }
+    return ESP_OK;
+}
+
+void Storage::eraseBlobChunks(BlobWriter* writer)
+{
+    for (uint8_t chunkNum = 0; chunkNum < writer->mChunkCount; chunkNum++) {
+        Item item;
+        Page* findPage = nullptr;
+        const uint8_t chunkIdx = static_cast<uint8_t>(writer->mChunkStart) + chunkNum;
+        if (findItem(writer->mNsIndex, ItemType::BLOB_DATA, writer->mKey, findPage, item, chunkIdx) == ESP_OK) {
+            findPage->eraseItem(writer->mNsIndex, ItemType::BLOB_DATA, writer->mKey, chunkIdx);
+        }
+    }
+}
+
+esp_err_t Storage::closeBlobWriter(BlobWriter* writer, bool commit)
+{
+    mBlobWriters.erase(writer);
+    std::unique_ptr<BlobWriter> closed(writer);
+
+    esp_err_t err = writer->mErr;
+    if (!commit || err != ESP_OK) {
+        eraseBlobChunks(writer);
+        return err;
+    }
+
+    err = writeBlobChunks(writer, writer->mBuffer.get(), writer->mBufferUsed);
+    if (err != ESP_OK) {
+        eraseBlobChunks(writer);
+        return err;
+    }
+
+    if (mReadCache) {
+        mReadCache->invalidate(writer->mNsIndex, writer->mKey);
+    }
+
+    /* All chunks are stored. Writing the index makes the new version visible */
+    Item item;
+    std::fill_n(item.data, sizeof(item.data), 0xff);
+    item.blobIndex.dataSize = writer->mDataSize;
+    item.blobIndex.chunkCount = writer->mChunkCount;
+    item.blobIndex.chunkStart = writer->mChunkStart;
+    err = getCurrentPage().writeItem(writer->mNsIndex, ItemType::BLOB_IDX, writer->mKey, item.data, sizeof(item.data));
+    if (err == ESP_ERR_NVS_PAGE_FULL) {
+        Page& page = getCurrentPage();
+        if (page.state() != Page::PageState::FULL) {
+            err = page.markFull();
+            if (err != ESP_OK) {
+                eraseBlobChunks(writer);
+                return err;
+            }
+        }
+        err = mPageManager.requestNewPage();
+        if (err == ESP_OK) {
+            err = getCurrentPage().writeItem(writer->mNsIndex, ItemType::BLOB_IDX, writer->mKey, item.data, sizeof(item.data));
+        }
+        if (err == ESP_ERR_NVS_PAGE_FULL) {
+            err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+    }
+    if (err != ESP_OK) {
+        eraseBlobChunks(writer);
+        return err;
+    }
+
+    /* Erase the previous version, which may also be a blob stored without index */
+    if (writer->mHasPrevIndex) {
+        err = eraseMultiPageBlob(writer->mNsIndex, writer->mKey, writer->mPrevStart);
+    } else {
+        Page* findPage = nullptr;
+        err = findItem(writer->mNsIndex, ItemType::BLOB, writer->mKey, findPage, item);
+        if (err == ESP_OK) {
+            err = findPage->eraseItem(writer->mNsIndex, ItemType::BLOB, writer->mKey);
+        }
+    }
+    if (err == ESP_ERR_FLASH_OP_FAIL) {
+        return ESP_ERR_NVS_REMOVE_FAILED;
+    }
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        return err;
+    }
+#ifndef ESP_PLATFORM
+    debugCheck();
+#endif
+    return ESP_OK;
+}
+
+bool Storage::hasBlobWriter(const BlobWriter* writer)
+{
+    for (auto it = mBlobWriters.begin(); it != mBlobWriters.end(); ++it) {
+        if (static_cast<BlobWriter*>(it) == writer) {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t Storage::openBlobReader(uint8_t nsIndex, const char* key, BlobReader*& reader)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    std::unique_ptr<BlobReader> newReader(new BlobReader);
+    Item item;
+    Page* findPage = nullptr;
+    auto err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    if (err == ESP_OK) {
+        newReader->mChunkType = ItemType::BLOB_DATA;
+        newReader->mChunkStart = static_cast<uint8_t>(item.blobIndex.chunkStart);
+        newReader->mChunkCount = item.blobIndex.chunkCount;
+        newReader->mDataSize = item.blobIndex.dataSize;
+    } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+        // blob stored with earlier version format without index
+        err = findItem(nsIndex, ItemType::BLOB, key, findPage, item);
+        if (err != ESP_OK) {
+            return err;
+        }
+        newReader->mChunkType = ItemType::BLOB;
+        newReader->mChunkStart = Page::CHUNK_ANY;
+        newReader->mChunkCount = 1;
+        newReader->mDataSize = item.varLength.dataSize;
+    } else {
+        return err;
+    }
+    strncpy(newReader->mKey, key, sizeof(newReader->mKey) - 1);
+    newReader->mKey[sizeof(newReader->mKey) - 1] = 0;
+    newReader->mNsIndex = nsIndex;
+
+    reader = newReader.release();
+    mBlobReaders.push_back(reader);
+    return ESP_OK;
+}
+
+esp_err_t Storage::readBlob(BlobReader* reader, void* data, size_t dataSize, size_t& readSize)
+{
+    readSize = 0;
+    auto dst = static_cast<uint8_t*>(data);
+    while (dataSize > 0 && reader->mOffset < reader->mDataSize) {
+        if (reader->mChunkNum == reader->mChunkCount) {
+            // index claims more data than its chunks hold
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        const uint8_t chunkIdx = (reader->mChunkType == ItemType::BLOB) ? Page::CHUNK_ANY : reader->mChunkStart + reader->mChunkNum;
+        Item item;
+        Page* findPage = nullptr;
+        auto err = findItem(reader->mNsIndex, reader->mChunkType, reader->mKey, findPage, item, chunkIdx);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (reader->mChunkOffset == 0) {
+            reader->mChunkCrc32 = item.varLength.dataCrc32;
+            reader->mCrc32 = 0xffffffff;
+        } else if (item.varLength.dataCrc32 != reader->mChunkCrc32) {
+            // the blob has been written again since the last read
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+
+        const size_t chunkSize = item.varLength.dataSize;
+        size_t size = std::min(dataSize, chunkSize - reader->mChunkOffset);
+        if (size > 0) {
+            err = findPage->readItemData(reader->mNsIndex, reader->mChunkType, reader->mKey, reader->mChunkOffset, dst, size, chunkIdx);
+            if (err != ESP_OK) {
+                return err;
+            }
+            reader->mCrc32 = Item::calculateCrc32(dst, size, reader->mCrc32);
+        }
+        reader->mChunkOffset += size;
+        reader->mOffset += size;
+        dst += size;
+        dataSize -= size;
+        readSize += size;
+
+        if (reader->mChunkOffset == chunkSize) {
+            if (reader->mCrc32 != reader->mChunkCrc32) {
+                return ESP_ERR_NVS_NOT_FOUND;
+            }
+            reader->mChunkNum++;
+            reader->mChunkOffset = 0;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::closeBlobReader(BlobReader* reader)
+{
+    mBlobReaders.erase(reader);
+    delete reader;
+    return ESP_OK;
+}
+
+bool Storage::hasBlobReader(const BlobReader* reader)
+{
+    for (auto it = mBlobReaders.begin(); it != mBlobReaders.end(); ++it) {
+        if (static_cast<BlobReader*>(it) == reader) {
+            return true;
+        }
+    }
+    return false;
+}
+
 esp_err_t Storage::readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize)
 {
     if (mState != StorageState::ACTIVE) {
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    if (mReadCache) {
+        auto entry = mReadCache->find(nsIndex, datatype, key);
+        if (entry) {
+            if (!isVariableLengthType(datatype)) {
+                if (dataSize != entry->dataSize) {
+                    return ESP_ERR_NVS_TYPE_MISMATCH;
+                }
+            } else if (dataSize < entry->dataSize) {
+                return ESP_ERR_NVS_INVALID_LENGTH;
+            }
+            memcpy(data, entry->data, entry->dataSize);
+            return ESP_OK;
+        }
+    }
+
     Item item;
     Page* findPage = nullptr;
     if (datatype == ItemType::BLOB) {
         auto err = readMultiPageBlob(nsIndex, key, data, dataSize);
+        if (err == ESP_OK && mReadCache) {
+            mReadCache->insert(nsIndex, datatype, key, data, dataSize);
+        }
         if (err != ESP_ERR_NVS_NOT_FOUND) {
             return err;
         } // else check if the blob is stored with earlier version format without index
@@ -462,8 +1182,12 @@ esp_err_t Storage::readItem(uint8_t nsIndex, ItemType datatype, const char* key,
     if (err != ESP_OK) {
         return err;
     }
-    return findPage->readItem(nsIndex, datatype, key, data, dataSize);
-    
+    err = findPage->readItem(nsIndex, datatype, key, data, dataSize);
+    if (err == ESP_OK && mReadCache) {
+        size_t readSize = isVariableLengthType(datatype) ? item.varLength.dataSize : dataSize;
+        mReadCache->insert(nsIndex, datatype, key, data, readSize);
+    }
+    return err;
 }
 
 esp_err_t Storage::eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffset chunkStart)
@@ -517,6 +1241,14 @@ esp_err_t Storage::eraseItem(uint8_t nsIndex, ItemType datatype, const char* key
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    if ((datatype == ItemType::BLOB || datatype == ItemType::ANY) && findBlobWriter(nsIndex, key)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (mReadCache) {
+        mReadCache->invalidate(nsIndex, key);
+    }
+
     if (datatype == ItemType::BLOB) {
         return eraseMultiPageBlob(nsIndex, key);
     }
@@ -537,6 +1269,17 @@ esp_err_t Storage::eraseNamespace(uint8_t nsIndex)
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    if (mReadCache) {
+        mReadCache->invalidate(nsIndex);
+    }
+
+    // chunks of blobs being written in this namespace are about to be erased
+    for (auto it = mBlobWriters.begin(); it != mBlobWriters.end(); ++it) {
+        if (it->mNsIndex == nsIndex && it->mErr == ESP_OK) {
+            it->mErr = ESP_ERR_NVS_NOT_FOUND;
+        }
+    }
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         while (true) {
             auto err = it->eraseItem(nsIndex, ItemType::ANY, nullptr);
@@ -558,6 +1301,14 @@ esp_err_t Storage::getItemDataSize(uint8_t nsIndex, ItemType datatype, const cha
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    if (mReadCache && isVariableLengthType(datatype)) {
+        auto entry = mReadCache->peek(nsIndex, datatype, key);
+        if (entry) {
+            dataSize = entry->dataSize;
+            return ESP_OK;
+        }
+    }
+
     Item item;
     Page* findPage = nullptr;
     auto err = findItem(nsIndex, datatype, key, findPage, item);
@@ -608,15 +1359,46 @@ void Storage::debugCheck()
         }
         assert(usedCount == p->getUsedEntryCount());
     }
+
+    if (mItemIndex) {
+        for (auto p = mPageManager.begin(); p != mPageManager.end(); ++p) {
+            size_t itemIndex = 0;
+            Item item;
+            while (p->findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) == ESP_OK) {
+                if (!mItemIndex->contains(ItemIndex::hash(item), p, itemIndex)) {
+                    printf("Item missing from index: ns=%d key=%s\n", item.nsIndex, item.key);
+                    assert(0);
+                }
+                itemIndex += item.span;
+            }
+        }
+    }
 }
 #endif //ESP_PLATFORM
 
 esp_err_t Storage::fillStats(nvs_stats_t& nvsStats)
 {
     nvsStats.namespace_count = mNamespaces.size();
+    nvsStats.cache_hits = mReadCache ? mReadCache->hits() : 0;
+    nvsStats.cache_misses = mReadCache ? mReadCache->misses() : 0;
     return mPageManager.fillStats(nvsStats);
 }
 
+esp_err_t Storage::gcStep()
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    auto err = mPageManager.gcStep();
+#ifndef ESP_PLATFORM
+    if (err == ESP_OK) {
+        debugCheck();
+    }
+#endif
+    return err;
+}
+
 esp_err_t Storage::calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries)
 {
     usedEntries = 0;
@@ -15,18 +15,101 @@
 #define nvs_storage_hpp
 
 #include <memory>
+#include <new>
 #include <string>
 #include <unordered_map>
 #include "nvs.hpp"
 #include "nvs_types.hpp"
 #include "nvs_page.hpp"
 #include "nvs_pagemanager.hpp"
+#include "nvs_item_index.hpp"
+#include "nvs_read_cache.hpp"
 
 //extern void dumpBytes(const uint8_t* data, size_t count);
 
 namespace nvs
 {
 
+/**
+ * Blob data made accessible through flash mappings, one segment per chunk.
+ * If the data can't be mapped, it is copied into a buffer which forms the only segment.
+ */
+class BlobMap : public intrusive_list_node<BlobMap>
+{
+public:
+    BlobMap(size_t chunkCount);
+    ~BlobMap();
+
+    void addSegment(const void* data, size_t size, Page* page);
+
+    esp_err_t mapRegion(uint32_t address, const uint8_t*& ptr);
+
+    const nvs_blob_segment_t* segments() const
+    {
+        return mSegments.get();
+    }
+
+    size_t segmentCount() const
+    {
+        return mSegmentCount;
+    }
+
+    std::unique_ptr<uint8_t[]> mBuffer;
+
+protected:
+    std::unique_ptr<nvs_blob_segment_t[]> mSegments;
+    std::unique_ptr<Page*[]> mPages;
+    size_t mSegmentCount = 0;
+
+    std::unique_ptr<uint32_t[]> mRegions;
+    std::unique_ptr<const uint8_t*[]> mRegionPtrs;
+    std::unique_ptr<spi_flash_mmap_handle_t[]> mRegionHandles;
+    size_t mRegionCount = 0;
+};
+
+/**
+ * State of a blob being written piece by piece. Data is collected in a buffer
+ * and written as chunks of the next version of the blob whenever the buffer is full.
+ * The blob index pointing to the new chunks is only written when the writer is closed.
+ */
+class BlobWriter : public intrusive_list_node<BlobWriter>
+{
+public:
+    BlobWriter(size_t bufferSize) : mBuffer(new (std::nothrow) uint8_t[bufferSize]), mBufferSize(bufferSize) { }
+
+    char mKey[Item::MAX_KEY_LENGTH + 1];
+    uint8_t mNsIndex;
+    VerOffset mChunkStart;
+    VerOffset mPrevStart;
+    bool mHasPrevIndex;
+    uint8_t mChunkCount = 0;
+    size_t mDataSize = 0;
+    std::unique_ptr<uint8_t[]> mBuffer;
+    size_t mBufferSize;
+    size_t mBufferUsed = 0;
+    esp_err_t mErr = ESP_OK;
+};
+
+/**
+ * Position of a reader within a blob. Chunks are looked up again on every read,
+ * so the reader stays valid while other items are written.
+ */
+class BlobReader : public intrusive_list_node<BlobReader>
+{
+public:
+    char mKey[Item::MAX_KEY_LENGTH + 1];
+    uint8_t mNsIndex;
+    ItemType mChunkType;
+    uint8_t mChunkStart;
+    uint8_t mChunkCount;
+    size_t mDataSize;
+    size_t mOffset = 0;
+    uint8_t mChunkNum = 0;
+    size_t mChunkOffset = 0;
+    uint32_t mChunkCrc32 = 0;
+    uint32_t mCrc32 = 0;
+};
+
 class Storage : public intrusive_list_node<Storage>
 {
     enum class StorageState : uint32_t {
@@ -58,6 +141,12 @@ class Storage : public intrusive_list_node<Storage>
 
     typedef intrusive_list<BlobIndexNode> TBlobIndexList;
 
+    typedef intrusive_list<BlobMap> TBlobMapList;
+
+    typedef intrusive_list<BlobWriter> TBlobWriterList;
+
+    typedef intrusive_list<BlobReader> TBlobReaderList;
+
 public:
     ~Storage();
 
@@ -71,6 +160,8 @@ public:
 
     esp_err_t writeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
 
+    esp_err_t writeItems(uint8_t nsIndex, const nvs_batch_item_t* items, size_t count, size_t& savedOps);
+
     esp_err_t readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize);
 
     esp_err_t getItemDataSize(uint8_t nsIndex, ItemType datatype, const char* key, size_t& dataSize);
@@ -111,14 +202,66 @@ public:
 
     esp_err_t eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    esp_err_t mapBlob(uint8_t nsIndex, const char* key, BlobMap*& blobMap);
+
+    esp_err_t unmapBlob(BlobMap* blobMap);
+
+    esp_err_t openBlobWriter(uint8_t nsIndex, const char* key, size_t bufferSize, BlobWriter*& writer);
+
+    esp_err_t appendBlob(BlobWriter* writer, const void* data, size_t dataSize);
+
+    esp_err_t closeBlobWriter(BlobWriter* writer, bool commit);
+
+    bool hasBlobWriter(const BlobWriter* writer);
+
+    esp_err_t openBlobReader(uint8_t nsIndex, const char* key, BlobReader*& reader);
+
+    esp_err_t readBlob(BlobReader* reader, void* data, size_t dataSize, size_t& readSize);
+
+    esp_err_t closeBlobReader(BlobReader* reader);
+
+    bool hasBlobReader(const BlobReader* reader);
+
     void debugDump();
     
     void debugCheck();
 
     esp_err_t fillStats(nvs_stats_t& nvsStats);
 
+    esp_err_t gcStep();
+
     esp_err_t calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries);
 
+    /**
+     * Enable or disable the storage-wide item index. Takes effect on the next call to init.
+     * Default is set by CONFIG_NVS_ITEM_INDEX.
+     */
+    void setItemIndexEnabled(bool enabled)
+    {
+        mItemIndexEnabled = enabled;
+    }
+
+    /**
+     * Set the number of values kept in the read cache, and the largest value size
+     * which is cached. Takes effect on the next call to init. A count of 0 disables the cache.
+     * Defaults are set by CONFIG_NVS_READ_CACHE_ENTRIES and CONFIG_NVS_READ_CACHE_VALUE_SIZE.
+     */
+    void setReadCacheSize(size_t entryCount, size_t valueSize)
+    {
+        mReadCacheEntries = entryCount;
+        mReadCacheValueSize = valueSize;
+    }
+
+    /**
+     * Enable or disable page checkpoints, which let full pages be loaded without
+     * reading every item. Takes effect on the next call to init.
+     * Default is set by CONFIG_NVS_FAST_MOUNT.
+     */
+    void setFastMountEnabled(bool enabled)
+    {
+        mFastMountEnabled = enabled;
+    }
+
 protected:
 
     Page& getCurrentPage()
@@ -128,13 +271,25 @@ protected:
 
     void clearNamespaces();
 
-    void populateBlobIndices(TBlobIndexList&);
+    void loadNamespacesAndBlobIndices(TBlobIndexList&);
 
     void eraseOrphanDataBlobs(TBlobIndexList&);
 
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx = Page::CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    esp_err_t copyBlob(uint8_t nsIndex, const char* key, size_t dataSize, BlobMap*& blobMap);
+
+    esp_err_t writeBlobChunks(BlobWriter* writer, const uint8_t* data, size_t dataSize);
+
+    void eraseBlobChunks(BlobWriter* writer);
+
+    BlobWriter* findBlobWriter(uint8_t nsIndex, const char* key);
+
+    size_t getMaxBlobSize();
+
+    esp_err_t findIndexedItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart);
+
 protected:
     const char *mPartitionName;
     size_t mPageCount;
@@ -142,6 +297,31 @@ protected:
     TNamespaces mNamespaces;
     CompressedEnumTable<bool, 1, 256> mNamespaceUsage;
     StorageState mState = StorageState::INVALID;
+    std::unique_ptr<ItemIndex> mItemIndex;
+    TBlobMapList mBlobMaps;
+    TBlobWriterList mBlobWriters;
+    TBlobReaderList mBlobReaders;
+#ifdef CONFIG_NVS_ITEM_INDEX
+    bool mItemIndexEnabled = true;
+#else
+    bool mItemIndexEnabled = false;
+#endif
+    std::unique_ptr<ReadCache> mReadCache;
+#ifdef CONFIG_NVS_READ_CACHE
+    size_t mReadCacheEntries = CONFIG_NVS_READ_CACHE_ENTRIES;
+    size_t mReadCacheValueSize = CONFIG_NVS_READ_CACHE_VALUE_SIZE;
+#else
+    size_t mReadCacheEntries = 0;
+    size_t mReadCacheValueSize = 0;
+#endif
+#ifdef CONFIG_NVS_FAST_MOUNT
+    bool mFastMountEnabled = true;
+#else
+    bool mFastMountEnabled = false;
+#endif
+
+    /* Maximum number of pages checked for one hash before falling back to a full scan */
+    static const size_t INDEX_MAX_CANDIDATES = 8;
 };
 
 } // namespace nvs
@@ -43,11 +43,10 @@ uint32_t Item::calculateCrc32WithoutValue() const
     return result;
 }
 
-uint32_t Item::calculateCrc32(const uint8_t* data, size_t size)
+uint32_t Item::calculateCrc32(const uint8_t* data, size_t size, uint32_t crc)
 {
-    uint32_t result = 0xffffffff;
-    result = crc32_le(result, data, size);
-    return result;
+    // crc is the result for the preceding part of the data, if it is split
+    return crc32_le(crc, data, size);
 }
 
 } // namespace nvs
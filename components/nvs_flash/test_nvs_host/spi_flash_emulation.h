@@ -69,6 +69,25 @@ public:
         return true;
     }
 
+    const void* mmap(size_t srcAddr)
+    {
+        if (srcAddr % SPI_FLASH_MMU_PAGE_SIZE != 0 || srcAddr >= mData.size() * 4) {
+            return nullptr;
+        }
+        ++mMmapCount;
+        return reinterpret_cast<const uint8_t*>(mData.data()) + srcAddr;
+    }
+
+    void munmap()
+    {
+        --mMmapCount;
+    }
+
+    size_t getMmapCount() const
+    {
+        return mMmapCount;
+    }
+
     bool write(size_t dstAddr, const uint32_t* src, size_t size)
     {
         uint32_t sectorNumber = dstAddr/SPI_FLASH_SEC_SIZE;
@@ -236,6 +255,8 @@ protected:
     
     size_t mFailCountdown = SIZE_MAX;
 
+    size_t mMmapCount = 0;
+
 };
 
 
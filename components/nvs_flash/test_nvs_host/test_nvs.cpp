@@ -23,6 +23,7 @@
 #include <fstream>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <chrono>
 
 #define TEST_ESP_ERR(rc, res) CHECK((rc) == (res))
 #define TEST_ESP_OK(rc) CHECK((rc) == ESP_OK)
@@ -2396,6 +2397,1084 @@ TEST_CASE("test nvs apis for nvs partition generator utility with encryption ena
 }
 #endif
 
+TEST_CASE("storage-wide item index speeds up lookups in large partitions", "[nvs][index]")
+{
+    const size_t lookupCount = 2000;
+    for (size_t pageCount : {4, 8, 16, 32, 64}) {
+        const size_t itemCount = (pageCount - 1) * Page::ENTRY_COUNT;
+        SpiFlashEmulator emu(pageCount);
+        for (size_t i = 0; i < pageCount - 1; ++i) {
+            Page p;
+            p.load(i);
+            p.setSeqNumber(i);
+            for (size_t j = 0; j < Page::ENTRY_COUNT; ++j) {
+                char key[16];
+                snprintf(key, sizeof(key), "key%d", static_cast<int>(i * Page::ENTRY_COUNT + j));
+                REQUIRE(p.writeItem(1, key, static_cast<uint32_t>(i * Page::ENTRY_COUNT + j)) == ESP_OK);
+            }
+            REQUIRE(p.markFull() == ESP_OK);
+        }
+
+        for (bool useIndex : {false, true}) {
+            Storage storage;
+            storage.setItemIndexEnabled(useIndex);
+            REQUIRE(storage.init(0, pageCount) == ESP_OK);
+
+            std::mt19937 gen(pageCount);
+            emu.clearStats();
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < lookupCount; ++i) {
+                size_t n = gen() % itemCount;
+                char key[16];
+                snprintf(key, sizeof(key), "key%d", static_cast<int>(n));
+                uint32_t value;
+                REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+                REQUIRE(value == n);
+            }
+            auto foundTime = std::chrono::steady_clock::now() - start;
+            size_t foundReads = emu.getReadOps();
+
+            emu.clearStats();
+            start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < lookupCount; ++i) {
+                char key[16];
+                snprintf(key, sizeof(key), "miss%d", static_cast<int>(i));
+                uint32_t value;
+                REQUIRE(storage.readItem(1, key, value) == ESP_ERR_NVS_NOT_FOUND);
+            }
+            auto missTime = std::chrono::steady_clock::now() - start;
+            size_t missReads = emu.getReadOps();
+
+            s_perf << "Lookup in " << pageCount << " pages (" << itemCount << " items), index " << (useIndex ? "on: " : "off: ")
+                   << std::chrono::duration_cast<std::chrono::nanoseconds>(foundTime).count() / lookupCount << " ns/hit ("
+                   << foundReads << "R), "
+                   << std::chrono::duration_cast<std::chrono::nanoseconds>(missTime).count() / lookupCount << " ns/miss ("
+                   << missReads << "R)" << std::endl;
+        }
+    }
+}
+
+TEST_CASE("nvs_set_batch writes several values at once", "[nvs][batch]")
+{
+    SpiFlashEmulator emu(4);
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 4));
+    nvs_handle handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+
+    const size_t count = 24;
+    char keys[count][16];
+    uint32_t values[count];
+    nvs_batch_item_t items[count];
+    for (size_t i = 0; i < count; ++i) {
+        snprintf(keys[i], sizeof(keys[i]), "key%d", static_cast<int>(i));
+        values[i] = i;
+        items[i] = {keys[i], NVS_TYPE_U32, &values[i]};
+    }
+
+    /* Same update of existing values, once with single writes and once as a batch */
+    for (size_t i = 0; i < count; ++i) {
+        TEST_ESP_OK(nvs_set_u32(handle, keys[i], values[i]));
+    }
+    emu.clearStats();
+    for (size_t i = 0; i < count; ++i) {
+        TEST_ESP_OK(nvs_set_u32(handle, keys[i], values[i] + 100));
+    }
+    size_t singleWriteOps = emu.getWriteOps();
+
+    size_t savedOps;
+    emu.clearStats();
+    TEST_ESP_OK(nvs_set_batch(handle, items, count, &savedOps));
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t value;
+        TEST_ESP_OK(nvs_get_u32(handle, keys[i], &value));
+        CHECK(value == i);
+    }
+    size_t batchWriteOps = emu.getWriteOps();
+    CHECK(batchWriteOps < singleWriteOps / 4);
+    CHECK(savedOps == singleWriteOps - batchWriteOps);
+
+    s_perf << "Updating " << count << " values: single writes " << singleWriteOps << "W, batch "
+           << batchWriteOps << "W, saved " << savedOps << " operations" << std::endl;
+
+    /* Only the new values are left */
+    nvs_stats_t stats;
+    TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+    CHECK(stats.used_entries == count + 1);
+
+    /* Invalid batches are rejected before anything is written */
+    emu.clearStats();
+    nvs_batch_item_t bad[2] = {items[0], items[0]};
+    TEST_ESP_ERR(nvs_set_batch(handle, bad, 2, NULL), ESP_ERR_INVALID_ARG);
+    bad[1] = {"str", NVS_TYPE_STR, "value"};
+    TEST_ESP_ERR(nvs_set_batch(handle, bad, 2, NULL), ESP_ERR_INVALID_ARG);
+    bad[1] = {"key_name_is_too_long", NVS_TYPE_U32, &values[0]};
+    TEST_ESP_ERR(nvs_set_batch(handle, bad, 2, NULL), ESP_ERR_NVS_KEY_TOO_LONG);
+    TEST_ESP_ERR(nvs_set_batch(handle, NULL, 2, NULL), ESP_ERR_INVALID_ARG);
+    CHECK(emu.getWriteOps() == 0);
+
+    nvs_handle handle_ro;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle_ro));
+    TEST_ESP_ERR(nvs_set_batch(handle_ro, items, count, NULL), ESP_ERR_NVS_READ_ONLY);
+    nvs_close(handle_ro);
+
+    /* Values survive re-initialization */
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 4));
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t value;
+        TEST_ESP_OK(nvs_get_u32(handle, keys[i], &value));
+        CHECK(value == i);
+    }
+    nvs_close(handle);
+}
+
+TEST_CASE("nvs_set_batch is atomic if power goes out", "[nvs][batch]")
+{
+    const size_t count = 20;
+    char keys[count][16];
+    uint32_t values[count];
+    nvs_batch_item_t items[count];
+    for (size_t i = 0; i < count; ++i) {
+        snprintf(keys[i], sizeof(keys[i]), "key%d", static_cast<int>(i));
+        values[i] = 2;
+        items[i] = {keys[i], NVS_TYPE_U32, &values[i]};
+    }
+
+    /* Page holding the old values is almost full, so the batch goes to the next one */
+    const size_t blob_size = 90 * Page::ENTRY_SIZE;
+    uint8_t blob[blob_size] = {0x5a};
+
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        SpiFlashEmulator emu(4);
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 4));
+        nvs_handle handle;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        for (size_t i = 0; i < count; ++i) {
+            TEST_ESP_OK(nvs_set_u32(handle, keys[i], 1));
+        }
+        TEST_ESP_OK(nvs_set_blob(handle, "blob", blob, blob_size));
+
+        emu.failAfter(errDelay);
+        esp_err_t err = nvs_set_batch(handle, items, count, NULL);
+        nvs_close(handle);
+
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 4));
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        uint32_t first;
+        TEST_ESP_OK(nvs_get_u32(handle, keys[0], &first));
+        CHECK((first == 1 || first == 2));
+        for (size_t i = 1; i < count; ++i) {
+            uint32_t value;
+            TEST_ESP_OK(nvs_get_u32(handle, keys[i], &value));
+            CHECK(value == first);
+        }
+        nvs_close(handle);
+
+        /* No duplicates are left behind: namespace, values, blob index and blob data */
+        nvs_stats_t stats;
+        TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+        CHECK(stats.used_entries == 1 + count + 1 + 1 + blob_size / Page::ENTRY_SIZE);
+
+        if (err == ESP_OK) {
+            CHECK(first == 2);
+            break;
+        }
+    }
+}
+
+TEST_CASE("nvs_gc_step keeps writes from erasing flash", "[nvs][gc]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 8;
+    const size_t keyCount = 100;
+    const size_t writeCount = 5000;
+
+    for (bool useGc : {false, true}) {
+        SpiFlashEmulator emu(NVS_FLASH_SECTOR_COUNT);
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, NVS_FLASH_SECTOR_COUNT));
+        nvs_handle handle;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+
+        std::mt19937 gen(42);
+        uint32_t values[keyCount] = {0};
+        size_t maxTime = 0;
+        size_t maxEraseOps = 0;
+        size_t totalEraseOps = 0;
+        size_t gcTime = 0;
+        for (size_t i = 0; i < writeCount; ++i) {
+            if (useGc) {
+                emu.clearStats();
+                while (nvs_gc_step(NULL) == ESP_OK) {
+                }
+                gcTime += emu.getTotalTime();
+                totalEraseOps += emu.getEraseOps();
+            }
+            size_t n = gen() % keyCount;
+            char key[16];
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(n));
+            values[n] = static_cast<uint32_t>(i);
+            emu.clearStats();
+            TEST_ESP_OK(nvs_set_u32(handle, key, values[n]));
+            maxTime = std::max(maxTime, emu.getTotalTime());
+            maxEraseOps = std::max(maxEraseOps, emu.getEraseOps());
+            totalEraseOps += emu.getEraseOps();
+        }
+        if (useGc) {
+            CHECK(maxEraseOps == 0);
+        } else {
+            CHECK(maxEraseOps > 0);
+        }
+
+        s_perf << "Worst write latency, " << writeCount << " writes of " << keyCount << " keys, GC " << (useGc ? "on: " : "off: ")
+               << maxTime << " us, " << maxEraseOps << "E (total erases " << totalEraseOps << ", time spent in GC " << gcTime << " us)" << std::endl;
+
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, NVS_FLASH_SECTOR_COUNT));
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle));
+        for (size_t n = 0; n < keyCount; ++n) {
+            char key[16];
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(n));
+            uint32_t value;
+            esp_err_t err = nvs_get_u32(handle, key, &value);
+            if (err == ESP_OK) {
+                CHECK(value == values[n]);
+            } else {
+                CHECK(err == ESP_ERR_NVS_NOT_FOUND);
+            }
+        }
+        nvs_close(handle);
+    }
+}
+
+TEST_CASE("Recovery from power-off during nvs_gc_step", "[nvs][gc]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 3;
+    const size_t keyCount = 30;
+    const size_t blob_size = 20 * Page::ENTRY_SIZE;
+    uint8_t blob[blob_size];
+    std::fill_n(blob, blob_size, 0xa5);
+
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        SpiFlashEmulator emu(NVS_FLASH_SECTOR_COUNT);
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, NVS_FLASH_SECTOR_COUNT));
+        nvs_handle handle;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+
+        /* Leave live items, including a blob, in between lots of erased ones */
+        TEST_ESP_OK(nvs_set_blob(handle, "blob", blob, blob_size));
+        uint32_t values[keyCount];
+        for (size_t round = 0; round < 8; ++round) {
+            for (size_t n = (round == 0) ? 0 : keyCount / 2; n < keyCount; ++n) {
+                char key[16];
+                snprintf(key, sizeof(key), "key%d", static_cast<int>(n));
+                values[n] = static_cast<uint32_t>(round * keyCount + n);
+                TEST_ESP_OK(nvs_set_u32(handle, key, values[n]));
+            }
+        }
+        nvs_stats_t statsBefore;
+        TEST_ESP_OK(nvs_get_stats(NULL, &statsBefore));
+
+        emu.failAfter(errDelay);
+        esp_err_t err;
+        size_t steps = 0;
+        while ((err = nvs_gc_step(NULL)) == ESP_OK) {
+            ++steps;
+        }
+        nvs_close(handle);
+        if (err != ESP_ERR_FLASH_OP_FAIL) {
+            CHECK(err == ESP_ERR_NVS_NOT_FOUND);
+            CHECK(steps > 0);
+            break;
+        }
+
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, NVS_FLASH_SECTOR_COUNT));
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        for (size_t n = 0; n < keyCount; ++n) {
+            char key[16];
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(n));
+            uint32_t value;
+            TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+            CHECK(value == values[n]);
+        }
+        uint8_t readBlob[blob_size];
+        size_t readSize = blob_size;
+        TEST_ESP_OK(nvs_get_blob(handle, "blob", readBlob, &readSize));
+        CHECK(memcmp(readBlob, blob, blob_size) == 0);
+
+        /* Nothing is lost or duplicated */
+        nvs_stats_t stats;
+        TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+        CHECK(stats.used_entries == statsBefore.used_entries);
+
+        /* Writes still work afterwards */
+        TEST_ESP_OK(nvs_set_u32(handle, "key0", 0));
+        nvs_close(handle);
+    }
+}
+
+static std::vector<uint8_t> joinSegments(const nvs_blob_segment_t* segments, size_t count)
+{
+    std::vector<uint8_t> result;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* data = static_cast<const uint8_t*>(segments[i].data);
+        result.insert(result.end(), data, data + segments[i].size);
+    }
+    return result;
+}
+
+TEST_CASE("nvs_get_blob_mapped returns blob data without copying it", "[nvs][mmap]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 16;
+    SpiFlashEmulator emu(NVS_FLASH_SECTOR_COUNT);
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, NVS_FLASH_SECTOR_COUNT));
+    nvs_handle handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+
+    std::vector<uint8_t> blob(5 * Page::CHUNK_MAX_SIZE + 100);
+    std::mt19937 gen(42);
+    std::generate(blob.begin(), blob.end(), [&gen]() { return static_cast<uint8_t>(gen()); });
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", blob.data(), blob.size()));
+    const char small[] = "small blob";
+    TEST_ESP_OK(nvs_set_blob(handle, "small", small, sizeof(small)));
+
+    emu.clearStats();
+    std::vector<uint8_t> copy(blob.size());
+    size_t copySize = copy.size();
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", copy.data(), &copySize));
+    size_t copyReadBytes = emu.getReadBytes();
+
+    emu.clearStats();
+    nvs_blob_map_handle_t map;
+    const nvs_blob_segment_t* segments;
+    size_t count;
+    TEST_ESP_OK(nvs_get_blob_mapped(handle, "blob", &map, &segments, &count));
+    size_t mapReadBytes = emu.getReadBytes();
+    CHECK(count >= 6);
+    CHECK(joinSegments(segments, count) == blob);
+    CHECK(emu.getMmapCount() > 0);
+    CHECK(mapReadBytes < copyReadBytes / 4);
+
+    nvs_blob_map_handle_t smallMap;
+    const nvs_blob_segment_t* smallSegments;
+    size_t smallCount;
+    TEST_ESP_OK(nvs_get_blob_mapped(handle, "small", &smallMap, &smallSegments, &smallCount));
+    CHECK(smallCount == 1);
+    CHECK(smallSegments[0].size == sizeof(small));
+    CHECK(memcmp(smallSegments[0].data, small, sizeof(small)) == 0);
+
+    s_perf << "Reading a " << blob.size() << " byte blob: copy " << copyReadBytes << "Rb, mapped "
+           << mapReadBytes << "Rb (" << count << " segments)" << std::endl;
+
+    /* Pages holding the mapped chunks are not reused while the map exists */
+    std::vector<uint8_t> newBlob(blob.size(), 0x5a);
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", newBlob.data(), newBlob.size()));
+    TEST_ESP_OK(nvs_erase_key(handle, "small"));
+    for (size_t i = 0; i < 3000; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", static_cast<int>(i % 50));
+        TEST_ESP_OK(nvs_set_u32(handle, key, static_cast<uint32_t>(i)));
+        if (i % 100 == 0) {
+            while (nvs_gc_step(NULL) == ESP_OK) {
+            }
+        }
+    }
+    CHECK(joinSegments(segments, count) == blob);
+    CHECK(memcmp(smallSegments[0].data, small, sizeof(small)) == 0);
+
+    TEST_ESP_OK(nvs_release_blob_mapped(map));
+    TEST_ESP_OK(nvs_release_blob_mapped(smallMap));
+    CHECK(emu.getMmapCount() == 0);
+    TEST_ESP_ERR(nvs_release_blob_mapped(map), ESP_ERR_NVS_INVALID_HANDLE);
+    TEST_ESP_ERR(nvs_release_blob_mapped(NULL), ESP_ERR_NVS_INVALID_HANDLE);
+
+    /* Released pages can be reclaimed again */
+    for (size_t i = 0; i < 3000; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", static_cast<int>(i % 50));
+        TEST_ESP_OK(nvs_set_u32(handle, key, static_cast<uint32_t>(i)));
+    }
+    TEST_ESP_OK(nvs_get_blob_mapped(handle, "blob", &map, &segments, &count));
+    CHECK(joinSegments(segments, count) == newBlob);
+    TEST_ESP_ERR(nvs_get_blob_mapped(handle, "small", &smallMap, &smallSegments, &smallCount), ESP_ERR_NVS_NOT_FOUND);
+
+    /* Re-initializing the partition releases remaining maps */
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, NVS_FLASH_SECTOR_COUNT));
+    CHECK(emu.getMmapCount() == 0);
+    TEST_ESP_ERR(nvs_release_blob_mapped(map), ESP_ERR_NVS_INVALID_HANDLE);
+}
+
+TEST_CASE("nvs_get_blob_mapped copies blob data if partition is encrypted", "[nvs][mmap]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 8;
+    SpiFlashEmulator emu(NVS_FLASH_SECTOR_COUNT);
+
+    nvs_sec_cfg_t xts_cfg;
+    for (int count = 0; count < NVS_KEY_SIZE; count++) {
+        xts_cfg.eky[count] = 0x11;
+        xts_cfg.tky[count] = 0x22;
+    }
+    TEST_ESP_OK(nvs_flash_secure_init_custom(NVS_DEFAULT_PART_NAME, 0, NVS_FLASH_SECTOR_COUNT, &xts_cfg));
+    nvs_handle handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+
+    std::vector<uint8_t> blob(2 * Page::CHUNK_MAX_SIZE + 100);
+    std::mt19937 gen(42);
+    std::generate(blob.begin(), blob.end(), [&gen]() { return static_cast<uint8_t>(gen()); });
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", blob.data(), blob.size()));
+
+    nvs_blob_map_handle_t map;
+    const nvs_blob_segment_t* segments;
+    size_t count;
+    TEST_ESP_OK(nvs_get_blob_mapped(handle, "blob", &map, &segments, &count));
+    CHECK(count == 1);
+    CHECK(joinSegments(segments, count) == blob);
+    CHECK(emu.getMmapCount() == 0);
+    TEST_ESP_OK(nvs_release_blob_mapped(map));
+    nvs_close(handle);
+}
+
+TEST_CASE("read cache serves repeated reads without accessing flash", "[nvs][cache]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 4;
+    SpiFlashEmulator emu(NVS_FLASH_SECTOR_COUNT);
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, NVS_FLASH_SECTOR_COUNT));
+    nvs_handle handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_u32(handle, "flag", 1));
+    TEST_ESP_OK(nvs_set_str(handle, "name", "value"));
+    std::vector<uint8_t> bigBlob(CONFIG_NVS_READ_CACHE_VALUE_SIZE + 1, 0xa5);
+    TEST_ESP_OK(nvs_set_blob(handle, "big", bigBlob.data(), bigBlob.size()));
+
+    uint32_t value;
+    char str[16];
+    size_t strSize = sizeof(str);
+    TEST_ESP_OK(nvs_get_u32(handle, "flag", &value));
+    TEST_ESP_OK(nvs_get_str(handle, "name", str, &strSize));
+
+    emu.clearStats();
+    for (size_t i = 0; i < 100; ++i) {
+        TEST_ESP_OK(nvs_get_u32(handle, "flag", &value));
+        CHECK(value == 1);
+        strSize = sizeof(str);
+        TEST_ESP_OK(nvs_get_str(handle, "name", str, &strSize));
+        CHECK(strSize == 6);
+        CHECK(strcmp(str, "value") == 0);
+    }
+    CHECK(emu.getReadOps() == 0);
+
+    /* Cached values keep their type and size checks */
+    uint16_t value16;
+    TEST_ESP_ERR(nvs_get_u16(handle, "flag", &value16), ESP_ERR_NVS_NOT_FOUND);
+    strSize = 3;
+    TEST_ESP_ERR(nvs_get_str(handle, "name", str, &strSize), ESP_ERR_NVS_INVALID_LENGTH);
+
+    /* Values larger than CONFIG_NVS_READ_CACHE_VALUE_SIZE are read from flash */
+    std::vector<uint8_t> readBlob(bigBlob.size());
+    size_t blobSize = readBlob.size();
+    TEST_ESP_OK(nvs_get_blob(handle, "big", readBlob.data(), &blobSize));
+    emu.clearStats();
+    TEST_ESP_OK(nvs_get_blob(handle, "big", readBlob.data(), &blobSize));
+    CHECK(emu.getReadOps() > 0);
+    CHECK(readBlob == bigBlob);
+
+    nvs_stats_t stats;
+    TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+    CHECK(stats.cache_hits == 200);
+    CHECK(stats.cache_misses == 5);
+
+    /* Writes and erases replace cached values */
+    TEST_ESP_OK(nvs_set_u32(handle, "flag", 2));
+    TEST_ESP_OK(nvs_get_u32(handle, "flag", &value));
+    CHECK(value == 2);
+    TEST_ESP_OK(nvs_set_str(handle, "name", "longer value"));
+    strSize = sizeof(str);
+    TEST_ESP_OK(nvs_get_str(handle, "name", str, &strSize));
+    CHECK(strcmp(str, "longer value") == 0);
+    nvs_batch_item_t batch[] = {
+        { "flag", NVS_TYPE_U32, &value },
+    };
+    value = 3;
+    TEST_ESP_OK(nvs_set_batch(handle, batch, 1, NULL));
+    TEST_ESP_OK(nvs_get_u32(handle, "flag", &value));
+    CHECK(value == 3);
+    TEST_ESP_OK(nvs_erase_key(handle, "flag"));
+    TEST_ESP_ERR(nvs_get_u32(handle, "flag", &value), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(nvs_get_str(handle, "name", str, &strSize));
+    TEST_ESP_OK(nvs_erase_all(handle));
+    strSize = sizeof(str);
+    TEST_ESP_ERR(nvs_get_str(handle, "name", str, &strSize), ESP_ERR_NVS_NOT_FOUND);
+
+    /* Least recently read values are evicted first */
+    const size_t keyCount = CONFIG_NVS_READ_CACHE_ENTRIES + 1;
+    for (size_t i = 0; i < keyCount; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+        TEST_ESP_OK(nvs_set_u32(handle, key, i));
+    }
+    for (size_t i = 0; i < keyCount; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+        TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+    }
+    emu.clearStats();
+    TEST_ESP_OK(nvs_get_u32(handle, "key1", &value));
+    CHECK(emu.getReadOps() == 0);
+    TEST_ESP_OK(nvs_get_u32(handle, "key0", &value));
+    CHECK(emu.getReadOps() > 0);
+    CHECK(value == 0);
+    nvs_close(handle);
+
+    /* Counters start over when the partition is initialized */
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, NVS_FLASH_SECTOR_COUNT));
+    TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+    CHECK(stats.cache_hits == 0);
+    CHECK(stats.cache_misses == 0);
+}
+
+TEST_CASE("read cache benchmark", "[nvs][cache]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 8;
+    const size_t keyCount = 200;
+    const size_t hotKeyCount = 8;
+    const size_t readCount = 2000;
+
+    for (bool useCache : {false, true}) {
+        SpiFlashEmulator emu(NVS_FLASH_SECTOR_COUNT);
+        Storage storage;
+        storage.setReadCacheSize(useCache ? CONFIG_NVS_READ_CACHE_ENTRIES : 0, CONFIG_NVS_READ_CACHE_VALUE_SIZE);
+        REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+        for (size_t i = 0; i < keyCount; ++i) {
+            char key[16];
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+        }
+
+        /* Most reads go to a few hot keys, the rest are spread over all keys */
+        std::mt19937 gen(42);
+        emu.clearStats();
+        for (size_t i = 0; i < readCount; ++i) {
+            size_t n = (gen() % 10 == 0) ? gen() % keyCount : gen() % hotKeyCount;
+            char key[16];
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(n));
+            uint32_t value;
+            REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+            REQUIRE(value == n);
+        }
+
+        nvs_stats_t stats;
+        REQUIRE(storage.fillStats(stats) == ESP_OK);
+        if (useCache) {
+            CHECK(stats.cache_hits + stats.cache_misses == readCount);
+            CHECK(stats.cache_hits > readCount / 2);
+        }
+        s_perf << "Reading " << readCount << " values, read cache " << (useCache ? "on: " : "off: ")
+               << emu.getTotalTime() << " us (" << emu.getReadOps() << "R, "
+               << stats.cache_hits << " hits, " << stats.cache_misses << " misses)" << std::endl;
+    }
+}
+
+TEST_CASE("nvs_blob_write_* and nvs_blob_read_* work on a blob piece by piece", "[nvs][stream]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 16;
+    SpiFlashEmulator emu(NVS_FLASH_SECTOR_COUNT);
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, NVS_FLASH_SECTOR_COUNT));
+    nvs_handle handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    const char oldBlob[] = "previous value";
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", oldBlob, sizeof(oldBlob)));
+    TEST_ESP_OK(nvs_set_u32(handle, "other", 1));
+
+    std::vector<uint8_t> blob(5 * Page::CHUNK_MAX_SIZE);
+    std::mt19937 gen(42);
+    std::generate(blob.begin(), blob.end(), [&gen]() { return static_cast<uint8_t>(gen()); });
+
+    for (size_t bufferSize : {0, 1024, 300}) {
+        INFO(bufferSize);
+        nvs_blob_writer_handle_t writer;
+        TEST_ESP_OK(nvs_blob_write_open(handle, "blob", bufferSize, &writer));
+        for (size_t offset = 0; offset < blob.size(); ) {
+            size_t size = std::min(blob.size() - offset, static_cast<size_t>(gen() % 2000));
+            TEST_ESP_OK(nvs_blob_write_append(writer, blob.data() + offset, size));
+            offset += size;
+            /* Other keys can be written in between */
+            TEST_ESP_OK(nvs_set_u32(handle, "other", offset));
+        }
+
+        /* Previous value is kept until the writer is closed */
+        char readOld[sizeof(oldBlob)];
+        size_t readSize = sizeof(readOld);
+        if (bufferSize == 0) {
+            TEST_ESP_OK(nvs_get_blob(handle, "blob", readOld, &readSize));
+            CHECK(memcmp(readOld, oldBlob, sizeof(oldBlob)) == 0);
+        }
+        TEST_ESP_OK(nvs_blob_write_close(writer));
+        TEST_ESP_ERR(nvs_blob_write_append(writer, blob.data(), 1), ESP_ERR_NVS_INVALID_HANDLE);
+
+        std::vector<uint8_t> readBlob(blob.size());
+        readSize = readBlob.size();
+        TEST_ESP_OK(nvs_get_blob(handle, "blob", readBlob.data(), &readSize));
+        CHECK(readBlob == blob);
+
+        nvs_blob_reader_handle_t reader;
+        size_t length;
+        TEST_ESP_OK(nvs_blob_read_open(handle, "blob", &reader, &length));
+        CHECK(length == blob.size());
+        std::fill(readBlob.begin(), readBlob.end(), 0);
+        size_t offset = 0;
+        uint8_t buf[333];
+        size_t n;
+        do {
+            TEST_ESP_OK(nvs_blob_read(reader, buf, sizeof(buf), &n));
+            REQUIRE(offset + n <= readBlob.size());
+            memcpy(readBlob.data() + offset, buf, n);
+            offset += n;
+        } while (n > 0);
+        CHECK(offset == blob.size());
+        CHECK(readBlob == blob);
+        TEST_ESP_OK(nvs_blob_read_close(reader));
+        TEST_ESP_ERR(nvs_blob_read_close(reader), ESP_ERR_NVS_INVALID_HANDLE);
+    }
+
+    /* Aborted writes leave the previous value in place */
+    nvs_stats_t statsBefore;
+    TEST_ESP_OK(nvs_get_stats(NULL, &statsBefore));
+    nvs_blob_writer_handle_t writer;
+    TEST_ESP_OK(nvs_blob_write_open(handle, "blob", 512, &writer));
+    TEST_ESP_OK(nvs_blob_write_append(writer, oldBlob, sizeof(oldBlob)));
+    TEST_ESP_OK(nvs_blob_write_append(writer, blob.data(), 2000));
+    nvs_blob_writer_handle_t writer2;
+    TEST_ESP_ERR(nvs_blob_write_open(handle, "blob", 512, &writer2), ESP_ERR_INVALID_STATE);
+    TEST_ESP_ERR(nvs_set_blob(handle, "blob", oldBlob, sizeof(oldBlob)), ESP_ERR_INVALID_STATE);
+    TEST_ESP_ERR(nvs_erase_key(handle, "blob"), ESP_ERR_INVALID_STATE);
+    TEST_ESP_OK(nvs_blob_write_abort(writer));
+    TEST_ESP_ERR(nvs_blob_write_close(writer), ESP_ERR_NVS_INVALID_HANDLE);
+    nvs_stats_t stats;
+    TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+    CHECK(stats.used_entries == statsBefore.used_entries);
+    size_t blobSize;
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", NULL, &blobSize));
+    CHECK(blobSize == blob.size());
+
+    /* Errors are sticky, and the blob isn't stored */
+    TEST_ESP_OK(nvs_blob_write_open(handle, "big", 100, &writer));
+    esp_err_t err;
+    while ((err = nvs_blob_write_append(writer, blob.data(), 50)) == ESP_OK) {
+    }
+    CHECK(err == ESP_ERR_NVS_VALUE_TOO_LONG);
+    TEST_ESP_ERR(nvs_blob_write_append(writer, blob.data(), 1), ESP_ERR_NVS_VALUE_TOO_LONG);
+    TEST_ESP_ERR(nvs_blob_write_close(writer), ESP_ERR_NVS_VALUE_TOO_LONG);
+    TEST_ESP_ERR(nvs_get_blob(handle, "big", NULL, &blobSize), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+    CHECK(stats.used_entries == statsBefore.used_entries);
+
+    /* Readers notice when the blob changes under them */
+    nvs_blob_reader_handle_t reader;
+    TEST_ESP_OK(nvs_blob_read_open(handle, "blob", &reader, NULL));
+    uint8_t buf[100];
+    size_t n;
+    TEST_ESP_OK(nvs_blob_read(reader, buf, sizeof(buf), &n));
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", oldBlob, sizeof(oldBlob)));
+    TEST_ESP_ERR(nvs_blob_read(reader, buf, sizeof(buf), &n), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(nvs_blob_read_close(reader));
+
+    /* Empty blobs */
+    TEST_ESP_OK(nvs_blob_write_open(handle, "empty", 0, &writer));
+    TEST_ESP_OK(nvs_blob_write_close(writer));
+    TEST_ESP_OK(nvs_get_blob(handle, "empty", NULL, &blobSize));
+    CHECK(blobSize == 0);
+
+    /* Read only handles can't write, and initialization discards open handles */
+    nvs_handle roHandle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &roHandle));
+    TEST_ESP_ERR(nvs_blob_write_open(roHandle, "blob", 0, &writer), ESP_ERR_NVS_READ_ONLY);
+    TEST_ESP_OK(nvs_blob_read_open(roHandle, "blob", &reader, NULL));
+    TEST_ESP_OK(nvs_get_stats(NULL, &statsBefore));
+    TEST_ESP_OK(nvs_blob_write_open(handle, "new", 0, &writer));
+    TEST_ESP_OK(nvs_blob_write_append(writer, blob.data(), blob.size()));
+    nvs_close(roHandle);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, NVS_FLASH_SECTOR_COUNT));
+    TEST_ESP_ERR(nvs_blob_write_close(writer), ESP_ERR_NVS_INVALID_HANDLE);
+    TEST_ESP_ERR(nvs_blob_read(reader, buf, sizeof(buf), &n), ESP_ERR_NVS_INVALID_HANDLE);
+    TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+    CHECK(stats.used_entries == statsBefore.used_entries);
+}
+
+TEST_CASE("Recovery from power-off during nvs_blob_write_*", "[nvs][stream]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 5;
+    std::vector<uint8_t> oldBlob(3000, 0x11);
+    std::vector<uint8_t> newBlob(6000);
+    for (size_t i = 0; i < newBlob.size(); ++i) {
+        newBlob[i] = static_cast<uint8_t>(i);
+    }
+
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        SpiFlashEmulator emu(NVS_FLASH_SECTOR_COUNT);
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, NVS_FLASH_SECTOR_COUNT));
+        nvs_handle handle;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        TEST_ESP_OK(nvs_set_blob(handle, "blob", oldBlob.data(), oldBlob.size()));
+        nvs_stats_t statsBefore;
+        TEST_ESP_OK(nvs_get_stats(NULL, &statsBefore));
+
+        emu.failAfter(errDelay);
+        nvs_blob_writer_handle_t writer;
+        TEST_ESP_OK(nvs_blob_write_open(handle, "blob", 1000, &writer));
+        esp_err_t err = ESP_OK;
+        for (size_t offset = 0; offset < newBlob.size() && err == ESP_OK; offset += 500) {
+            err = nvs_blob_write_append(writer, newBlob.data() + offset, 500);
+        }
+        esp_err_t closeErr = nvs_blob_write_close(writer);
+        if (err == ESP_OK) {
+            err = closeErr;
+        }
+        nvs_close(handle);
+        if (err == ESP_OK) {
+            break;
+        }
+
+        TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, NVS_FLASH_SECTOR_COUNT));
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        size_t size;
+        TEST_ESP_OK(nvs_get_blob(handle, "blob", NULL, &size));
+        std::vector<uint8_t> readBlob(size);
+        TEST_ESP_OK(nvs_get_blob(handle, "blob", readBlob.data(), &size));
+        if (readBlob != newBlob) {
+            CHECK(readBlob == oldBlob);
+            /* Chunks of the new version are gone */
+            nvs_stats_t stats;
+            TEST_ESP_OK(nvs_get_stats(NULL, &stats));
+            CHECK(stats.used_entries == statsBefore.used_entries);
+        }
+        TEST_ESP_OK(nvs_set_blob(handle, "blob", newBlob.data(), newBlob.size()));
+        nvs_close(handle);
+    }
+}
+
+TEST_CASE("fast mount loads full pages from their checkpoints", "[nvs][mount]")
+{
+    const size_t pageCount = 8;
+    const size_t keyCount = 300;
+    SpiFlashEmulator emu(pageCount);
+    std::vector<uint8_t> blob(Page::CHUNK_MAX_SIZE * 3 / 2);
+    for (size_t i = 0; i < blob.size(); ++i) {
+        blob[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    uint8_t ns1, ns2;
+    {
+        Storage storage;
+        storage.setFastMountEnabled(true);
+        REQUIRE(storage.init(0, pageCount) == ESP_OK);
+        REQUIRE(storage.createOrOpenNamespace("first", true, ns1) == ESP_OK);
+        for (size_t i = 0; i < keyCount; ++i) {
+            char key[16];
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            REQUIRE(storage.writeItem(ns1, key, static_cast<uint32_t>(i)) == ESP_OK);
+        }
+        REQUIRE(storage.createOrOpenNamespace("second", true, ns2) == ESP_OK);
+        REQUIRE(storage.writeItem(ns2, ItemType::BLOB, "blob", blob.data(), blob.size()) == ESP_OK);
+        REQUIRE(storage.writeItem(ns2, ItemType::SZ, "str", "fast mount", strlen("fast mount") + 1) == ESP_OK);
+        /* Items on full pages are erased after their checkpoints have been written */
+        for (size_t i = 0; i < keyCount; i += 3) {
+            char key[16];
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            REQUIRE(storage.eraseItem(ns1, ItemType::ANY, key) == ESP_OK);
+        }
+    }
+
+    size_t fullPages = 0;
+    for (size_t i = 0; i < pageCount; ++i) {
+        Page p;
+        p.setFastMount(true);
+        p.load(i);
+        if (p.state() == Page::PageState::FULL) {
+            CHECK(p.isLoadedFromCheckpoint());
+            ++fullPages;
+        }
+    }
+    CHECK(fullPages >= 4);
+
+    size_t usedEntries[2];
+    for (bool fastMount : {false, true}) {
+        /* init also checks item counts and the item index against the contents of flash */
+        Storage storage;
+        storage.setFastMountEnabled(fastMount);
+        REQUIRE(storage.init(0, pageCount) == ESP_OK);
+        uint8_t nsIndex;
+        REQUIRE(storage.createOrOpenNamespace("first", false, nsIndex) == ESP_OK);
+        CHECK(nsIndex == ns1);
+        REQUIRE(storage.createOrOpenNamespace("second", false, nsIndex) == ESP_OK);
+        CHECK(nsIndex == ns2);
+        for (size_t i = 0; i < keyCount; ++i) {
+            char key[16];
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            uint32_t value;
+            if (i % 3 == 0) {
+                CHECK(storage.readItem(ns1, key, value) == ESP_ERR_NVS_NOT_FOUND);
+            } else {
+                REQUIRE(storage.readItem(ns1, key, value) == ESP_OK);
+                CHECK(value == i);
+            }
+        }
+        std::vector<uint8_t> readBlob(blob.size());
+        REQUIRE(storage.readItem(ns2, ItemType::BLOB, "blob", readBlob.data(), readBlob.size()) == ESP_OK);
+        CHECK(readBlob == blob);
+        char str[16];
+        REQUIRE(storage.readItem(ns2, ItemType::SZ, "str", str, sizeof(str)) == ESP_OK);
+        CHECK(strcmp(str, "fast mount") == 0);
+
+        nvs_stats_t stats;
+        memset(&stats, 0, sizeof(stats));
+        REQUIRE(storage.fillStats(stats) == ESP_OK);
+        usedEntries[fastMount] = stats.used_entries;
+
+        /* Pages which are filled now get their checkpoints as well */
+        for (size_t i = 0; i < keyCount; ++i) {
+            char key[16];
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            REQUIRE(storage.writeItem(ns1, key, static_cast<uint32_t>(i)) == ESP_OK);
+        }
+        for (size_t i = 0; i < keyCount; i += 3) {
+            char key[16];
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+            REQUIRE(storage.eraseItem(ns1, ItemType::ANY, key) == ESP_OK);
+        }
+    }
+    CHECK(usedEntries[0] == usedEntries[1]);
+}
+
+TEST_CASE("Recovery from power-off with fast mount enabled", "[nvs][mount]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 4;
+    const size_t keyCount = 6;
+    const size_t roundCount = 4;
+
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        SpiFlashEmulator emu(NVS_FLASH_SECTOR_COUNT);
+        /* Erased blobs are kept as empty vectors */
+        std::vector<uint8_t> expected[keyCount];
+        std::vector<uint8_t> pendingValue;
+        size_t pendingKey = keyCount;
+        esp_err_t err = ESP_OK;
+        {
+            Storage storage;
+            storage.setFastMountEnabled(true);
+            TEST_ESP_OK(storage.init(0, NVS_FLASH_SECTOR_COUNT));
+            emu.failAfter(errDelay);
+            for (size_t round = 0; round < roundCount && err == ESP_OK; ++round) {
+                for (size_t k = 0; k < keyCount && err == ESP_OK; ++k) {
+                    char key[16];
+                    snprintf(key, sizeof(key), "blob%d", static_cast<int>(k));
+                    pendingKey = k;
+                    const size_t n = round * keyCount + k;
+                    if (n % 5 == 4) {
+                        pendingValue.clear();
+                        err = storage.eraseItem(1, ItemType::BLOB, key);
+                        if (err == ESP_ERR_NVS_NOT_FOUND) {
+                            err = ESP_OK;
+                        }
+                    } else {
+                        /* Blobs of up to 20 entries, so that erasing one may be interrupted halfway */
+                        pendingValue.assign(64 + n * 37 % 600, static_cast<uint8_t>(n));
+                        err = storage.writeItem(1, ItemType::BLOB, key, pendingValue.data(), pendingValue.size());
+                    }
+                    if (err == ESP_OK) {
+                        expected[k] = pendingValue;
+                    }
+                }
+            }
+        }
+        if (err == ESP_OK) {
+            break;
+        }
+        /* Failing to erase the previous version of a blob is reported as ESP_ERR_NVS_REMOVE_FAILED */
+        CHECK((err == ESP_ERR_FLASH_OP_FAIL || err == ESP_ERR_NVS_REMOVE_FAILED));
+
+        Storage storage;
+        storage.setFastMountEnabled(true);
+        TEST_ESP_OK(storage.init(0, NVS_FLASH_SECTOR_COUNT));
+        for (size_t k = 0; k < keyCount; ++k) {
+            char key[16];
+            snprintf(key, sizeof(key), "blob%d", static_cast<int>(k));
+            std::vector<uint8_t> value;
+            size_t size;
+            err = storage.getItemDataSize(1, ItemType::BLOB, key, size);
+            if (err == ESP_OK) {
+                value.resize(size);
+                TEST_ESP_OK(storage.readItem(1, ItemType::BLOB, key, value.data(), size));
+            } else {
+                CHECK(err == ESP_ERR_NVS_NOT_FOUND);
+            }
+            if (k == pendingKey) {
+                CHECK((value == expected[k] || value == pendingValue));
+            } else {
+                CHECK(value == expected[k]);
+            }
+        }
+
+        /* Writes still work afterwards */
+        uint8_t blob[300] = {0x5a};
+        TEST_ESP_OK(storage.writeItem(1, ItemType::BLOB, "blob0", blob, sizeof(blob)));
+    }
+}
+
+TEST_CASE("fast mount benchmark", "[nvs][mount]")
+{
+    for (size_t pageCount : {16, 64}) {
+        SpiFlashEmulator emu(pageCount);
+        const size_t itemCount = (pageCount - 2) * 100;
+        {
+            Storage storage;
+            storage.setFastMountEnabled(true);
+            REQUIRE(storage.init(0, pageCount) == ESP_OK);
+            for (size_t i = 0; i < itemCount; ++i) {
+                char key[16];
+                snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+                if (i % 10 == 0) {
+                    char str[48];
+                    snprintf(str, sizeof(str), "string value number %d", static_cast<int>(i));
+                    REQUIRE(storage.writeItem(1, ItemType::SZ, key, str, strlen(str) + 1) == ESP_OK);
+                } else {
+                    REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+                }
+            }
+        }
+
+        size_t mountTime[2];
+        for (bool fastMount : {false, true}) {
+            Storage storage;
+            storage.setFastMountEnabled(fastMount);
+            emu.clearStats();
+            REQUIRE(storage.init(0, pageCount) == ESP_OK);
+            size_t initTime = emu.getTotalTime();
+            size_t initReads = emu.getReadOps();
+            size_t initReadBytes = emu.getReadBytes();
+
+            /* Leave out the consistency check which init does on the host only */
+            emu.clearStats();
+            storage.debugCheck();
+            initTime -= emu.getTotalTime();
+            initReads -= emu.getReadOps();
+            initReadBytes -= emu.getReadBytes();
+            mountTime[fastMount] = initTime;
+
+            uint32_t value;
+            REQUIRE(storage.readItem(1, "key1", value) == ESP_OK);
+            CHECK(value == 1);
+
+            s_perf << "Mount of " << pageCount << " pages (" << itemCount << " items), fast mount " << (fastMount ? "on: " : "off: ")
+                   << initTime << " us (" << initReads << "R " << initReadBytes << "Rb)" << std::endl;
+        }
+        CHECK(mountTime[1] < mountTime[0]);
+    }
+}
+
+TEST_CASE("HashList finds the first item with a given hash", "[nvs][hashlist]")
+{
+    /* Few distinct keys, so that many nodes share a hash and probe sequences overlap */
+    const size_t keyCount = 40;
+    const size_t entryCount = Page::ENTRY_COUNT;
+    std::vector<Item> items;
+    for (size_t k = 0; k < keyCount; ++k) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", static_cast<int>(k));
+        items.push_back(Item(1, ItemType::U32, 1, key));
+    }
+
+    std::mt19937 gen(42);
+    HashList hashList;
+    std::vector<size_t> keyAt(entryCount, SIZE_MAX);
+    for (size_t n = 0; n < 20000; ++n) {
+        size_t index = gen() % entryCount;
+        if (keyAt[index] == SIZE_MAX) {
+            keyAt[index] = gen() % keyCount;
+            hashList.insert(items[keyAt[index]], index);
+        } else if (gen() % 2) {
+            hashList.erase(index);
+            keyAt[index] = SIZE_MAX;
+        }
+        REQUIRE(hashList.size() == entryCount - std::count(keyAt.begin(), keyAt.end(), SIZE_MAX));
+
+        size_t k = gen() % keyCount;
+        size_t start = gen() % entryCount;
+        size_t expected = SIZE_MAX;
+        for (size_t i = start; i < entryCount; ++i) {
+            if (keyAt[i] == k) {
+                expected = i;
+                break;
+            }
+        }
+        REQUIRE(hashList.find(start, items[k]) == expected);
+    }
+
+    /* Every entry of a page may hold an item */
+    hashList.clear();
+    CHECK(hashList.size() == 0);
+    for (size_t i = 0; i < entryCount; ++i) {
+        hashList.insert(items[i % keyCount], i);
+    }
+    for (size_t i = 0; i < entryCount; ++i) {
+        CHECK(hashList.find(i, items[i % keyCount]) == i);
+    }
+    std::vector<uint32_t> entries(entryCount);
+    REQUIRE(hashList.getEntries(entries.data(), entries.size()) == entryCount);
+    std::sort(entries.begin(), entries.end(), [](uint32_t a, uint32_t b) -> bool {
+        return (a & 0xff) < (b & 0xff);
+    });
+    for (size_t i = 0; i < entryCount; ++i) {
+        CHECK((entries[i] & 0xff) == i);
+        CHECK((entries[i] >> 8) == (items[i % keyCount].calculateCrc32WithoutValue() & 0xffffff));
+    }
+}
+
+TEST_CASE("HashList benchmark", "[nvs][hashlist]")
+{
+    const size_t lookupCount = 100000;
+    std::vector<Item> items;
+    std::vector<Item> missingItems;
+    for (size_t i = 0; i < Page::ENTRY_COUNT; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+        items.push_back(Item(1, ItemType::U32, 1, key));
+        snprintf(key, sizeof(key), "miss%d", static_cast<int>(i));
+        missingItems.push_back(Item(1, ItemType::U32, 1, key));
+    }
+
+    HashList hashList;
+    for (size_t i = 0; i < items.size(); ++i) {
+        hashList.insert(items[i], i);
+    }
+
+    size_t errors = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < lookupCount; ++n) {
+        size_t i = n % items.size();
+        if (hashList.find(0, items[i]) != i) {
+            ++errors;
+        }
+    }
+    auto hitTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < lookupCount; ++n) {
+        if (hashList.find(0, missingItems[n % missingItems.size()]) != SIZE_MAX) {
+            ++errors;
+        }
+    }
+    auto missTime = std::chrono::steady_clock::now() - start;
+    CHECK(errors == 0);
+
+    s_perf << "HashList of " << items.size() << " items: " << sizeof(HashList) << " bytes, "
+           << std::chrono::duration_cast<std::chrono::nanoseconds>(hitTime).count() / lookupCount << " ns/hit, "
+           << std::chrono::duration_cast<std::chrono::nanoseconds>(missTime).count() / lookupCount << " ns/miss" << std::endl;
+}
+
 /* Add new tests above */
 /* This test has to be the final one */
 
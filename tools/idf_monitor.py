@@ -6,6 +6,7 @@
 # - Run "make (or idf.py) flash" (Ctrl-T Ctrl-F)
 # - Run "make (or idf.py) app-flash" (Ctrl-T Ctrl-A)
 # - If gdbstub output is detected, gdb is automatically loaded
+# - Decodes binary log output (CONFIG_LOG_BINARY) with the format strings in the ELF file
 #
 # Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
 #
@@ -49,7 +50,9 @@ import serial.tools.miniterm as miniterm
 import threading
 import ctypes
 import types
+import struct
 from distutils.version import StrictVersion
+from log_decoder import LogDecoder, DecodeError
 
 key_description = miniterm.key_description
 
@@ -331,6 +334,7 @@ class Monitor(object):
         self.console_reader = ConsoleReader(self.console, self.event_queue, socket_mode)
         self.serial_reader = SerialReader(self.serial, self.event_queue)
         self.elf_file = elf_file
+        self._log_decoder = None
         if not os.path.exists(make):
             self.make = shlex.split(make)  # allow for possibility the "make" arg is a list of arguments (for idf.py)
         else:
@@ -413,6 +417,15 @@ class Monitor(object):
             except UnicodeEncodeError:
                 pass  # this can happen if a non-ascii character was passed, ignoring
 
+    def decode_log_frame(self, line):
+        """ Returns the text of a binary log message, without the trailing newline """
+        try:
+            if self._log_decoder is None:
+                self._log_decoder = LogDecoder(self.elf_file)
+            return self._log_decoder.decode_frame(line).rstrip("\n").encode("utf-8")
+        except (DecodeError, IOError, struct.error, IndexError) as e:
+            return ("[failed to decode binary log message: %s]" % e).encode("utf-8")
+
     def handle_serial_input(self, data, finalize_line=False):
         sp = data.split(b'\n')
         if self._last_line_part != b"":
@@ -423,6 +436,8 @@ class Monitor(object):
             # last part is not a full line
             self._last_line_part = sp.pop()
         for line in sp:
+            if LogDecoder.is_frame(line):
+                line = self.decode_log_frame(line)
             if line != b"":
                 if self._serial_check_exit and line == self.exit_key.encode('latin-1'):
                     raise SerialStopException()
@@ -0,0 +1,229 @@
+#!/usr/bin/env python
+#
+# Decoder for binary log output (CONFIG_LOG_BINARY).
+#
+# When binary log output is enabled, ESP_LOGx messages are not formatted on
+# the chip. Each message is sent as a frame holding the address of its format
+# string and the raw values of its arguments. This tool looks up the format
+# strings in the application ELF file and formats the messages on the host.
+#
+# Lines which are not binary frames (bootloader output, printf, panic
+# backtraces...) are passed through unchanged. idf_monitor.py uses the same
+# decoder automatically, so this tool is only needed for captured logs:
+#
+#   log_decoder.py build/app.elf < captured_log.bin
+#
+# Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+from __future__ import print_function, division
+from __future__ import unicode_literals
+import argparse
+import io
+import re
+import struct
+import sys
+
+# Framing, see esp_log_encode_binary() in components/log/log_private.h
+FRAME_START = 0x1E
+ESCAPE = 0x1B
+ESCAPE_XOR = 0x40
+
+# Markers before captured strings, see components/log/log_format.c
+STRING_INLINE = 0
+STRING_REF = 1
+
+# Conversion specification, as parsed by next_conv_spec() in log_format.c
+CONV_SPEC = re.compile(r"%([-+ #0']*)(\*|\d*)(?:\.(\*|\d*))?(hh|h|ll|l|q|L|j|z|t)?(.)")
+
+# struct formats of the arguments captured for each length modifier (all little endian, as on the ESP32)
+INT_ARGS = {
+    None: "i", "hh": "i", "h": "i", "l": "i", "ll": "q", "q": "q", "j": "q", "z": "i", "t": "i",
+}
+FLOAT_ARGS = {None: "d", "l": "d", "L": "d"}
+
+SHT_PROGBITS = 1
+SHF_ALLOC = 2
+
+
+class DecodeError(RuntimeError):
+    pass
+
+
+class ElfStrings(object):
+    """ Reads NUL-terminated strings from the loadable sections of an ELF32 file """
+
+    def __init__(self, elf_file):
+        with open(elf_file, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or bytearray(self.data)[4] != 1:
+            raise DecodeError("%s is not an ELF32 file" % elf_file)
+        (shoff,) = struct.unpack_from("<I", self.data, 0x20)
+        (shentsize, shnum) = struct.unpack_from("<HH", self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            (_, sh_type, flags, addr, offset, size) = struct.unpack_from("<IIIIII", self.data, shoff + i * shentsize)
+            if sh_type == SHT_PROGBITS and (flags & SHF_ALLOC) and addr != 0:
+                self.sections.append((addr, offset, size))
+
+    def read_string(self, addr):
+        for (start, offset, size) in self.sections:
+            if start <= addr < start + size:
+                begin = offset + addr - start
+                end = self.data.find(b"\0", begin, offset + size)
+                if end < 0:
+                    raise DecodeError("string at 0x%08x is not terminated" % addr)
+                return self.data[begin:end].decode("utf-8", errors="replace")
+        raise DecodeError("no string at 0x%08x in the ELF file" % addr)
+
+
+def unescape_frame(line):
+    """ Returns the payload of a binary frame (without the start byte and newline) """
+    payload = bytearray()
+    escaped = False
+    for b in bytearray(line):
+        if escaped:
+            payload.append(b ^ ESCAPE_XOR)
+            escaped = False
+        elif b == ESCAPE:
+            escaped = True
+        else:
+            payload.append(b)
+    if escaped:
+        raise DecodeError("frame ends with an escape byte")
+    return bytes(payload)
+
+
+class LogDecoder(object):
+    """ Formats binary log frames using the format strings in the application ELF file """
+
+    def __init__(self, elf_file):
+        self.strings = ElfStrings(elf_file)
+
+    @staticmethod
+    def is_frame(line):
+        return len(line) > 0 and bytearray(line)[0] == FRAME_START
+
+    def decode_frame(self, line):
+        """ Decode one line holding a binary frame, with or without the trailing newline.
+        Returns the formatted message. Raises DecodeError if the frame is invalid. """
+        line = line.rstrip(b"\r\n")
+        payload = unescape_frame(line[1:])
+        if len(payload) < 4:
+            raise DecodeError("frame is too short")
+        (addr,) = struct.unpack_from("<I", payload, 0)
+        return self.format_message(self.strings.read_string(addr), payload, 4)
+
+    def format_message(self, fmt, args, pos):
+        out = []
+        last = 0
+        for m in CONV_SPEC.finditer(fmt):
+            out.append(fmt[last:m.start()])
+            last = m.end()
+            (flags, width, precision, length, conv) = m.groups()
+            flags = flags.replace("'", "")
+            if width == "*":
+                (width,) = struct.unpack_from("<i", args, pos)
+                pos += 4
+                if width < 0:
+                    flags += "-"
+                width = str(abs(width))
+            if precision == "*":
+                (precision,) = struct.unpack_from("<i", args, pos)
+                pos += 4
+                precision = None if precision < 0 else str(precision)
+            spec = "%" + flags + width + ("." + precision if precision is not None else "")
+
+            if conv == "%":
+                out.append("%")
+            elif conv in "diouxXc":
+                if length not in INT_ARGS or (conv == "c" and length is not None):
+                    raise DecodeError("unsupported conversion %s" % m.group(0))
+                fmt_char = INT_ARGS[length]
+                if conv in "ouxX":
+                    fmt_char = fmt_char.upper()
+                (value,) = struct.unpack_from("<" + fmt_char, args, pos)
+                pos += struct.calcsize(fmt_char)
+                if length == "hh":
+                    value = value & 0xFF if conv in "ouxX" else struct.unpack("<b", struct.pack("<B", value & 0xFF))[0]
+                elif length == "h":
+                    value = value & 0xFFFF if conv in "ouxX" else struct.unpack("<h", struct.pack("<H", value & 0xFFFF))[0]
+                if conv == "c":
+                    out.append((spec + "s") % chr(value & 0xFF))
+                elif conv == "u":
+                    out.append((spec + "d") % value)
+                elif conv == "o":
+                    # Python's alternate form is "0o17", C's is "017"
+                    out.append(((spec + conv) % value).replace("0o", "0", 1))
+                else:
+                    out.append((spec + conv) % value)
+            elif conv in "eEfFgGaA":
+                if length not in FLOAT_ARGS:
+                    raise DecodeError("unsupported conversion %s" % m.group(0))
+                (value,) = struct.unpack_from("<d", args, pos)
+                pos += 8
+                if conv in "aA":
+                    text = value.hex()
+                    out.append((spec + "s") % (text.upper() if conv == "A" else text))
+                else:
+                    out.append((spec + conv) % value)
+            elif conv == "p":
+                (value,) = struct.unpack_from("<I", args, pos)
+                pos += 4
+                out.append((spec + "s") % ("0x%x" % value))
+            elif conv == "s":
+                if length is not None:
+                    raise DecodeError("unsupported conversion %s" % m.group(0))
+                marker = bytearray(args[pos:pos + 1])[0]
+                pos += 1
+                if marker == STRING_REF:
+                    (addr,) = struct.unpack_from("<I", args, pos)
+                    pos += 4
+                    value = self.strings.read_string(addr)
+                else:
+                    end = args.find(b"\0", pos)
+                    if end < 0:
+                        raise DecodeError("string argument is not terminated")
+                    value = args[pos:end].decode("utf-8", errors="replace")
+                    pos = end + 1
+                out.append((spec + "s") % value)
+            else:
+                raise DecodeError("unsupported conversion %s" % m.group(0))
+        out.append(fmt[last:])
+        return "".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser("log_decoder - decode binary log output using the application ELF file")
+    parser.add_argument("elf_file", help="ELF file of the application")
+    parser.add_argument("input", nargs="?", type=argparse.FileType("rb"),
+                        default=getattr(sys.stdin, "buffer", sys.stdin),
+                        help="Captured serial output (default: stdin)")
+    args = parser.parse_args()
+
+    decoder = LogDecoder(args.elf_file)
+    out = io.open(sys.stdout.fileno(), "w", encoding="utf-8", errors="replace", closefd=False)
+    for line in args.input:
+        if LogDecoder.is_frame(line):
+            try:
+                out.write(decoder.decode_frame(line))
+            except (DecodeError, struct.error, IndexError) as e:
+                out.write("[log_decoder: %s]\n" % e)
+        else:
+            out.write(line.decode("utf-8", errors="replace"))
+        out.flush()
+
+
+if __name__ == "__main__":
+    main()
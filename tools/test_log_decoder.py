@@ -0,0 +1,95 @@
+#!/usr/bin/env python
+#
+# Copyright 2019 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+import struct
+import tempfile
+import unittest
+from log_decoder import LogDecoder
+from log_decoder import DecodeError
+
+RODATA_ADDR = 0x3F400020
+
+
+def make_elf(rodata):
+    """ Returns a minimal ELF32 file with 'rodata' in an allocated section at RODATA_ADDR """
+    shoff = 52 + len(rodata)
+    header = b"\x7fELF\x01\x01\x01" + b"\0" * 9
+    header += struct.pack("<HHIIIIIHHHHHH", 2, 94, 1, 0, 0, shoff, 0, 52, 0, 0, 40, 2, 0)
+    null_section = b"\0" * 40
+    rodata_section = struct.pack("<IIIIIIIIII", 0, 1, 2, RODATA_ADDR, 52, len(rodata), 0, 0, 4, 0)
+    return header + rodata + null_section + rodata_section
+
+
+def escape(payload):
+    out = bytearray([0x1E])
+    for b in bytearray(payload):
+        if b in (0x00, 0x0A, 0x0D, 0x1B, 0x1E):
+            out += bytearray([0x1B, b ^ 0x40])
+        else:
+            out.append(b)
+    return bytes(out + b"\n")
+
+
+class TestLogDecoder(unittest.TestCase):
+    def setUp(self):
+        self.strings = {}
+        rodata = b""
+        for s in ["I (%d) %s: hello %s, %5.2f %-4u|%x %c %%\n", "wifi",
+                  "%lld %llu %zu %p %.3s|%*d|%-*.*s|\n", "%hhd %hu %#o %s\n"]:
+            self.strings[s] = RODATA_ADDR + len(rodata)
+            rodata += s.encode() + b"\0"
+        fd, self.elf_file = tempfile.mkstemp()
+        with os.fdopen(fd, "wb") as f:
+            f.write(make_elf(rodata))
+        self.decoder = LogDecoder(self.elf_file)
+
+    def tearDown(self):
+        os.remove(self.elf_file)
+
+    def frame(self, fmt, args):
+        return escape(struct.pack("<I", self.strings[fmt]) + args)
+
+    def test_basic(self):
+        fmt = "I (%d) %s: hello %s, %5.2f %-4u|%x %c %%\n"
+        args = struct.pack("<iBI", 1234, 1, self.strings["wifi"])
+        args += b"\0world\0" + struct.pack("<dIii", 3.14159, 7, 0x0A0D, ord("z"))
+        line = self.frame(fmt, args)
+        self.assertTrue(LogDecoder.is_frame(line))
+        self.assertEqual(self.decoder.decode_frame(line), fmt % (1234, "wifi", "world", 3.14159, 7, 0x0A0D, "z"))
+
+    def test_lengths_and_stars(self):
+        fmt = "%lld %llu %zu %p %.3s|%*d|%-*.*s|\n"
+        args = struct.pack("<qQIIB", -1234567890123, 2 ** 64 - 1, 99, 0x3FFB0000, 0) + b"abc\0"
+        args += struct.pack("<iiiiB", 6, 42, 8, 2, 0) + b"xyz\0"
+        self.assertEqual(self.decoder.decode_frame(self.frame(fmt, args)),
+                         "-1234567890123 18446744073709551615 99 0x3ffb0000 abc|    42|xy      |\n")
+
+    def test_short_and_octal(self):
+        fmt = "%hhd %hu %#o %s\n"
+        args = struct.pack("<iIIB", 300, 70000, 8, 0) + b"\0"
+        self.assertEqual(self.decoder.decode_frame(self.frame(fmt, args) + b"\r"), "44 4464 010 \n")
+
+    def test_invalid(self):
+        self.assertFalse(LogDecoder.is_frame(b"I (12) tag: text\n"))
+        with self.assertRaises(DecodeError):
+            self.decoder.decode_frame(escape(struct.pack("<I", 0x3F000000)))
+        with self.assertRaises(DecodeError):
+            self.decoder.decode_frame(b"\x1e\x01\x02\x1b")
+
+
+if __name__ == "__main__":
+    unittest.main()